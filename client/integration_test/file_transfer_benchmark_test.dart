@@ -0,0 +1,85 @@
+// 文件传输基准：对比 Uint8List 字节缓冲和旧版 List<int> 两种方式经过 file_operation
+// 通道上传、下载的吞吐（MB/s）和进程峰值常驻内存，Dart 和原生端在同一进程内。
+//
+// 在桌面端运行：
+//   flutter test integration_test/file_transfer_benchmark_test.dart -d linux
+// 默认测 1 MB 到 1 GB，可用 --dart-define=BENCH_MAX_MB=256 缩小范围。
+// 旧版按字节装箱，每字节在 Dart 和原生端各占几十字节，默认只测到 64 MB，
+// 可用 BENCH_LEGACY_MAX_MB 调整。原生端下载只返回字节缓冲，legacy 行的下载列仅作对照。
+// 峰值常驻内存只增不减，按大小从小到大依次测量。
+
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:flutter/services.dart';
+import 'package:flutter_test/flutter_test.dart';
+import 'package:integration_test/integration_test.dart';
+
+import 'package:client/services/file_operation_service.dart';
+
+const int _maxMb = int.fromEnvironment('BENCH_MAX_MB', defaultValue: 1024);
+const int _legacyMaxMb = int.fromEnvironment('BENCH_LEGACY_MAX_MB', defaultValue: 64);
+const MethodChannel _channel = MethodChannel('file_operation');
+
+double _mbPerSecond(int bytes, Stopwatch watch) =>
+    bytes / (1024 * 1024) / (watch.elapsedMicroseconds / 1e6);
+
+String _mb(int bytes) => (bytes / (1024 * 1024)).toStringAsFixed(0);
+
+void main() {
+  IntegrationTestWidgetsFlutterBinding.ensureInitialized();
+
+  testWidgets('file transfer throughput and peak RSS', (tester) async {
+    final service = FileOperationService();
+    final dir = await Directory.systemTemp.createTemp('file_transfer_benchmark');
+    final rows = <String>['mode      size(MB)  upload MB/s  download MB/s  peak RSS(MB)'];
+
+    try {
+      for (int sizeMb = 1; sizeMb <= _maxMb; sizeMb *= 4) {
+        final bytes = sizeMb * 1024 * 1024;
+        final data = Uint8List(bytes);
+        for (int i = 0; i < bytes; i += 4096) {
+          data[i] = i >> 12;
+        }
+
+        for (final legacy in [false, true]) {
+          if (legacy && sizeMb > _legacyMaxMb) continue;
+          final name = legacy ? 'legacy_$sizeMb' : 'buffer_$sizeMb';
+
+          final upload = Stopwatch()..start();
+          final bool ok;
+          if (legacy) {
+            // 旧版客户端的传法：每个字节一个 int
+            ok = await _channel.invokeMethod<bool>('uploadFile', {
+                  'targetPath': dir.path,
+                  'fileName': name,
+                  'fileData': data.toList(),
+                }) ??
+                false;
+          } else {
+            ok = await service.uploadFile(dir.path, name, data);
+          }
+          upload.stop();
+          expect(ok, isTrue);
+
+          final download = Stopwatch()..start();
+          final result = await service.downloadFile('${dir.path}/$name');
+          download.stop();
+          expect(result?.length, bytes);
+
+          rows.add('${legacy ? 'legacy' : 'buffer'}'.padRight(10) +
+              _mb(bytes).padLeft(8) +
+              _mbPerSecond(bytes, upload).toStringAsFixed(1).padLeft(13) +
+              _mbPerSecond(bytes, download).toStringAsFixed(1).padLeft(15) +
+              _mb(ProcessInfo.maxRss).padLeft(14));
+          File('${dir.path}/$name').deleteSync();
+        }
+      }
+    } finally {
+      dir.deleteSync(recursive: true);
+    }
+
+    // ignore: avoid_print
+    print(rows.join('\n'));
+  }, timeout: const Timeout(Duration(hours: 1)));
+}
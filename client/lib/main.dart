@@ -52,7 +52,11 @@ class MyApp extends StatelessWidget {
                   // 用户接受连接，开始发送屏幕帧
                   final channel = deviceService.channel;
                   if (channel != null) {
-                    await screenStreamService.startSendingScreen(channel);
+                    await screenStreamService.startSendingScreen(
+                      channel,
+                      viewerId: sessionId ?? '',
+                      wireVersion: deviceService.wireVersion,
+                    );
                   }
                 } else if (accepted == false && sessionId != null) {
                   // 用户拒绝连接，通知服务器
@@ -71,12 +75,21 @@ class MyApp extends StatelessWidget {
                 if (action == 'accept') {
                   final channel = deviceService.channel;
                   if (channel != null) {
-                    await screenStreamService.startSendingScreen(channel);
+                    await screenStreamService.startSendingScreen(
+                      channel,
+                      viewerId: sessionId ?? '',
+                      wireVersion: deviceService.wireVersion,
+                    );
                   }
                 }
               }
             };
             
+            // 二进制输入消息交给原生插件解码注入（被控端）
+            deviceService.onWireMessageReceived = (data) {
+              inputControlService.injectWire(data);
+            };
+            
             // 设置输入控制处理（被控端）
             deviceService.onInputControlReceived = (data) {
               final type = data['type'] as String;
@@ -92,6 +105,13 @@ class MyApp extends StatelessWidget {
                 } else if (action == 'click') {
                   final button = inputData['button'] as String? ?? 'left';
                   inputControlService.clickMouse(x, y, button);
+                } else if (action == 'down' || action == 'up') {
+                  final button = inputData['button'] as String? ?? 'left';
+                  if (action == 'down') {
+                    inputControlService.mouseDown(button, x: x, y: y);
+                  } else {
+                    inputControlService.mouseUp(button, x: x, y: y);
+                  }
                 } else if (action == 'scroll') {
                   final delta = inputData['delta'] as int? ?? 0;
                   inputControlService.scrollMouse(x, y, delta);
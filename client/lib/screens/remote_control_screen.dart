@@ -1,5 +1,6 @@
 import 'dart:async';
 import 'dart:convert';
+import 'dart:typed_data';
 import 'dart:ui' as ui;
 import 'package:flutter/material.dart';
 import 'package:provider/provider.dart';
@@ -79,8 +80,9 @@ class _RemoteControlScreenState extends State<RemoteControlScreen> {
   // 处理屏幕帧（通过 WebSocket 接收）
   Future<void> _handleScreenFrame(Map<String, dynamic> data) async {
     try {
-      final frameDataBase64 = data['frame_data'] as String;
-      final frameData = base64Decode(frameDataBase64);
+      // 二进制协议的帧直接带原始字节，JSON 消息里是 base64
+      final frameData = data['frame_bytes'] as Uint8List? ??
+          base64Decode(data['frame_data'] as String);
       
       final codec = await ui.instantiateImageCodec(frameData);
       final frame = await codec.getNextFrame();
@@ -1,6 +1,7 @@
 import 'dart:async';
 import 'dart:convert';
 import 'dart:io';
+import 'dart:typed_data';
 import 'package:flutter/foundation.dart';
 import 'package:web_socket_channel/web_socket_channel.dart';
 import '../models/device.dart';
@@ -11,8 +12,12 @@ class DeviceService extends ChangeNotifier {
   String? _currentDeviceId;
   bool _connected = false;
 
+  // 与服务器协商的二进制协议版本，0 表示只用 JSON
+  int _wireVersion = 0;
+
   List<Device> get devices => _devices;
   bool get connected => _connected;
+  int get wireVersion => _wireVersion;
   String? get currentDeviceId => _currentDeviceId;
   WebSocketChannel? get channel => _channel;
 
@@ -47,6 +52,7 @@ class DeviceService extends ChangeNotifier {
           print('WebSocket 连接关闭');
           _connected = false;
           _currentSessionId = null;
+          _wireVersion = 0;
           notifyListeners();
           // 自动重连（仅在非手动断开时）
           if (_channel != null) {
@@ -89,6 +95,21 @@ class DeviceService extends ChangeNotifier {
     _channel?.sink.add(jsonEncode(message));
   }
 
+  // 协商二进制协议。目前只有 Linux 端的原生插件能直接产出和解析二进制消息
+  Future<void> negotiateWireProtocol() async {
+    if (!_connected || !Platform.isLinux) return;
+
+    final message = {
+      'type': 'protocol_negotiate',
+      'timestamp': DateTime.now().millisecondsSinceEpoch ~/ 1000,
+      'data': {
+        'versions': [1],
+      },
+    };
+
+    _channel?.sink.add(jsonEncode(message));
+  }
+
   Future<void> requestDeviceList() async {
     if (!_connected) return;
 
@@ -128,11 +149,18 @@ class DeviceService extends ChangeNotifier {
   // 应用安装响应接收回调
   Function(Map<String, dynamic>)? onAppInstallResponseReceived;
   
+  // 二进制消息接收回调（被控端的输入消息）
+  Function(Uint8List)? onWireMessageReceived;
+  
   // 当前会话ID
   String? _currentSessionId;
   String? get currentSessionId => _currentSessionId;
 
   void _handleMessage(dynamic message) {
+    if (message is List<int>) {
+      _handleWireMessage(Uint8List.fromList(message));
+      return;
+    }
     try {
       final data = jsonDecode(message.toString());
       final type = data['type'] as String;
@@ -145,6 +173,10 @@ class DeviceService extends ChangeNotifier {
           print('设备注册成功');
           // 注册成功后请求设备列表
           requestDeviceList();
+          negotiateWireProtocol();
+          break;
+        case 'protocol_negotiate_response':
+          _wireVersion = (data['data'] as Map<String, dynamic>)['version'] as int? ?? 0;
           break;
         case 'connect_response':
           final responseData = data['data'] as Map<String, dynamic>;
@@ -214,6 +246,27 @@ class DeviceService extends ChangeNotifier {
     }
   }
 
+  // 二进制消息：屏幕帧（类型 1）在这里取出宽高和图像数据，其余交给原生插件解码。
+  // 头部布局见 linux/runner/wire_protocol.h
+  void _handleWireMessage(Uint8List message) {
+    const headerBytes = 24;
+    const frameFieldsBytes = 6;
+    if (message.length < headerBytes || message[0] != 0x57) {
+      return;
+    }
+    if (message[2] == 1) {
+      if (message.length <= headerBytes + frameFieldsBytes) return;
+      final view = ByteData.sublistView(message);
+      onScreenFrameReceived?.call({
+        'frame_bytes': Uint8List.sublistView(message, headerBytes + frameFieldsBytes),
+        'width': view.getUint16(headerBytes, Endian.little),
+        'height': view.getUint16(headerBytes + 2, Endian.little),
+      });
+    } else {
+      onWireMessageReceived?.call(message);
+    }
+  }
+
   void _handleDeviceList(Map<String, dynamic> data) {
     final devicesJson = data['devices'] as List<dynamic>;
     _devices = devicesJson
@@ -329,6 +382,7 @@ class DeviceService extends ChangeNotifier {
     _channel = null;
     _connected = false;
     _currentSessionId = null;
+    _wireVersion = 0;
     notifyListeners();
   }
 
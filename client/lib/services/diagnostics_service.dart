@@ -0,0 +1,24 @@
+import 'package:flutter/foundation.dart';
+import 'package:flutter/services.dart';
+
+class DiagnosticsService {
+  static const MethodChannel _channel = MethodChannel('diagnostics');
+
+  // 测量输入到像素的端到端延迟
+  // 返回 samples、timeouts、minMs、meanMs、p50Ms、p90Ms、p99Ms、maxMs、samplesMs
+  Future<Map<String, dynamic>?> runLatencyProbe({int samples = 20, int timeoutMs = 1000}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('runLatencyProbe', {
+        'samples': samples,
+        'timeoutMs': timeoutMs,
+      });
+      if (result != null) {
+        return result.map((key, value) => MapEntry(key as String, value));
+      }
+      return null;
+    } catch (e) {
+      debugPrint('延迟探测失败: $e');
+      return null;
+    }
+  }
+}
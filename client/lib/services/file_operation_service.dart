@@ -5,6 +5,12 @@ import 'file_service.dart';
 
 class FileOperationService {
   static const MethodChannel _channel = MethodChannel('file_operation');
+  static const EventChannel _progressChannel = EventChannel('file_operation/progress');
+
+  // 后台文件任务的进度事件，每个任务最多每 100 毫秒一条，结束时 finished 为 true
+  Stream<Map<String, dynamic>> get jobProgress => _progressChannel
+      .receiveBroadcastStream()
+      .map((event) => (event as Map<Object?, Object?>).map((key, value) => MapEntry(key as String, value)));
 
   // 获取文件列表
   Future<List<FileInfo>> getFileList(String path) async {
@@ -29,7 +35,7 @@ class FileOperationService {
       final result = await _channel.invokeMethod<bool>('uploadFile', {
         'targetPath': targetPath,
         'fileName': fileName,
-        'fileData': fileData.toList(),
+        'fileData': fileData,
       });
       return result ?? false;
     } catch (e) {
@@ -41,12 +47,16 @@ class FileOperationService {
   // 下载文件
   Future<Uint8List?> downloadFile(String filePath) async {
     try {
-      final result = await _channel.invokeMethod<List<dynamic>>('downloadFile', {
+      final result = await _channel.invokeMethod<Object>('downloadFile', {
         'filePath': filePath,
       });
-      
-      if (result != null) {
-        return Uint8List.fromList(result.map((e) => e as int).toList());
+
+      if (result is Uint8List) {
+        return result;
+      }
+      if (result is List) {
+        // 旧版本原生端按字节列表返回
+        return Uint8List.fromList(result.cast<int>());
       }
       return null;
     } catch (e) {
@@ -55,6 +65,628 @@ class FileOperationService {
     }
   }
 
+  // 打开分块读取，返回 handle、size、chunkSize。compress 为 true 时每块都是 zstd 压缩数据，
+  // level 为 0 时按吞吐自动选择级别
+  Future<Map<String, int>?> openRead(String path,
+      {int? chunkSize, bool compress = false, int level = 0}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openRead', {
+        'path': path,
+        if (chunkSize != null) 'chunkSize': chunkSize,
+        if (compress) 'compress': true,
+        if (compress) 'level': level,
+      });
+      if (result != null) {
+        return {
+          'handle': result['handle'] as int,
+          'size': result['size'] as int,
+          'chunkSize': result['chunkSize'] as int,
+        };
+      }
+      return null;
+    } catch (e) {
+      debugPrint('打开文件读取失败: $e');
+      return null;
+    }
+  }
+
+  // 打开分块写入，返回 handle。compressed 为 true 时写入的块先解压
+  Future<int?> openWrite(String path,
+      {int? chunkSize, bool append = false, bool compressed = false}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openWrite', {
+        'path': path,
+        if (chunkSize != null) 'chunkSize': chunkSize,
+        'append': append,
+        if (compressed) 'compressed': true,
+      });
+      return result?['handle'] as int?;
+    } catch (e) {
+      debugPrint('打开文件写入失败: $e');
+      return null;
+    }
+  }
+
+  // 读取下一块，到达文件末尾时返回空数据
+  Future<Uint8List?> readChunk(int handle, {int? offset}) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('readChunk', {
+        'handle': handle,
+        if (offset != null) 'offset': offset,
+      });
+    } catch (e) {
+      debugPrint('读取文件块失败: $e');
+      return null;
+    }
+  }
+
+  // 写入一块，返回写入的字节数
+  Future<int> writeChunk(int handle, Uint8List data, {int? offset}) async {
+    try {
+      final result = await _channel.invokeMethod<int>('writeChunk', {
+        'handle': handle,
+        'data': data,
+        if (offset != null) 'offset': offset,
+      });
+      return result ?? 0;
+    } catch (e) {
+      debugPrint('写入文件块失败: $e');
+      return 0;
+    }
+  }
+
+  // 关闭传输，返回 bytes、elapsedMs、mbPerSec
+  Future<Map<String, dynamic>?> closeHandle(int handle) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('closeHandle', {
+        'handle': handle,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('关闭文件传输失败: $e');
+      return null;
+    }
+  }
+
+  // 按块流式读取整个文件，内存占用与文件大小无关
+  Stream<Uint8List> readFileChunks(String path, {int? chunkSize, bool compress = false}) async* {
+    final opened = await openRead(path, chunkSize: chunkSize, compress: compress);
+    if (opened == null) {
+      return;
+    }
+    final handle = opened['handle']!;
+    try {
+      while (true) {
+        final chunk = await readChunk(handle);
+        if (chunk == null || chunk.isEmpty) {
+          break;
+        }
+        yield chunk;
+      }
+    } finally {
+      await closeHandle(handle);
+    }
+  }
+
+  // 把整个目录作为一个 tar.zst 流读取，边打包边压缩，不生成临时文件
+  Stream<Uint8List> readDirectoryArchive(String path, {int level = 0}) async* {
+    int? handle;
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openArchive', {
+        'path': path,
+        'level': level,
+      });
+      handle = result?['handle'] as int?;
+    } catch (e) {
+      debugPrint('打开目录归档失败: $e');
+    }
+    if (handle == null) {
+      return;
+    }
+    try {
+      while (true) {
+        final chunk = await readChunk(handle);
+        if (chunk == null || chunk.isEmpty) {
+          break;
+        }
+        yield chunk;
+      }
+    } finally {
+      await closeHandle(handle);
+    }
+  }
+
+  // 打开目录归档解包，之后用 writeChunk 写入 readDirectoryArchive 的数据，closeHandle 时校验完整性
+  Future<int?> openExtract(String destination) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openExtract', {
+        'path': destination,
+      });
+      return result?['handle'] as int?;
+    } catch (e) {
+      debugPrint('打开目录解包失败: $e');
+      return null;
+    }
+  }
+
+  // 由原生端直接把文件发送到传输套接字（Linux 上走 sendfile 零拷贝）
+  Future<Map<String, dynamic>?> sendFile(
+    String filePath, {
+    String? host,
+    int? port,
+    String? socketPath,
+    int? offset,
+    int? length,
+    bool buffered = false,
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('sendFile', {
+        'filePath': filePath,
+        if (host != null) 'host': host,
+        if (port != null) 'port': port,
+        if (socketPath != null) 'socketPath': socketPath,
+        if (offset != null) 'offset': offset,
+        if (length != null) 'length': length,
+        'buffered': buffered,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('发送文件失败: $e');
+      return null;
+    }
+  }
+
+  // 发送端计算各块哈希，接收端据此校验
+  Future<Map<String, dynamic>?> getChunkHashes(String filePath, {int? chunkSize}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('getChunkHashes', {
+        'filePath': filePath,
+        if (chunkSize != null) 'chunkSize': chunkSize,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('计算文件分块哈希失败: $e');
+      return null;
+    }
+  }
+
+  // 开始或续传一个分块接收任务，返回 transferId 和仍缺失的块序号
+  Future<Map<String, dynamic>?> beginTransfer(String path, int size, {int? chunkSize}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('beginTransfer', {
+        'path': path,
+        'size': size,
+        if (chunkSize != null) 'chunkSize': chunkSize,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('开始分块传输失败: $e');
+      return null;
+    }
+  }
+
+  // 写入一块数据，hash 为发送端给出的十六进制 xxHash64
+  Future<bool> putChunk(int transferId, int index, Uint8List data, String hash) async {
+    try {
+      await _channel.invokeMethod<int>('putChunk', {
+        'transferId': transferId,
+        'index': index,
+        'data': data,
+        'hash': hash,
+      });
+      return true;
+    } catch (e) {
+      debugPrint('写入数据块失败: $e');
+      return false;
+    }
+  }
+
+  Future<Map<String, dynamic>?> finishTransfer(int transferId, {String? fileHash}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('finishTransfer', {
+        'transferId': transferId,
+        if (fileHash != null) 'fileHash': fileHash,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('完成分块传输失败: $e');
+      return null;
+    }
+  }
+
+  Future<bool> abortTransfer(int transferId, {bool keepPartial = true}) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('abortTransfer', {
+        'transferId': transferId,
+        'keepPartial': keepPartial,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('取消分块传输失败: $e');
+      return false;
+    }
+  }
+
+  // 可续传的多路传输：streams 路并发拉取缺失的块并写入，失败的块最多重试 retries 次。
+  // 中断后用相同的参数再次调用，只会传输尚未完成的块。
+  Future<bool> receiveFileResumable(
+    String path, {
+    required int size,
+    required int chunkSize,
+    required List<String> chunkHashes,
+    required String fileHash,
+    required Future<Uint8List?> Function(int index) fetchChunk,
+    int streams = 4,
+    int retries = 3,
+  }) async {
+    final begin = await beginTransfer(path, size, chunkSize: chunkSize);
+    if (begin == null || begin['chunkSize'] != chunkSize) {
+      return false;
+    }
+    final transferId = begin['transferId'] as int;
+    var pending = (begin['missing'] as List<dynamic>).cast<int>().toList();
+
+    for (var attempt = 0; attempt <= retries && pending.isNotEmpty; attempt++) {
+      final queue = List<int>.of(pending);
+      final failed = <int>[];
+      Future<void> worker() async {
+        while (queue.isNotEmpty) {
+          final index = queue.removeLast();
+          final data = await fetchChunk(index);
+          if (data == null || !await putChunk(transferId, index, data, chunkHashes[index])) {
+            failed.add(index);
+          }
+        }
+      }
+
+      await Future.wait(List.generate(streams, (_) => worker()));
+      pending = failed;
+    }
+    if (pending.isNotEmpty) {
+      await abortTransfer(transferId);
+      return false;
+    }
+    return await finishTransfer(transferId, fileHash: fileHash) != null;
+  }
+
+  // 增量同步第一步：目标端对现有文件生成块签名
+  Future<Uint8List?> getSignature(String filePath, {int? blockSize}) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('getSignature', {
+        'filePath': filePath,
+        if (blockSize != null) 'blockSize': blockSize,
+      });
+    } catch (e) {
+      debugPrint('生成文件签名失败: $e');
+      return null;
+    }
+  }
+
+  // 增量同步第二步：源端根据签名生成增量
+  Future<Uint8List?> computeDelta(String filePath, Uint8List signature) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('computeDelta', {
+        'filePath': filePath,
+        'signature': signature,
+      });
+      return result?['delta'] as Uint8List?;
+    } catch (e) {
+      debugPrint('生成增量失败: $e');
+      return null;
+    }
+  }
+
+  // 增量同步第三步：目标端重建文件并原子替换
+  Future<bool> applyDelta(String filePath, Uint8List delta) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('applyDelta', {
+        'filePath': filePath,
+        'delta': delta,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('应用增量失败: $e');
+      return false;
+    }
+  }
+
+  // 发送端：按内容分块，返回 size、hashes（每块 32 字节 SHA-256 依次排列）和 lengths
+  Future<Map<String, dynamic>?> chunkFile(String filePath) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('chunkFile', {
+        'filePath': filePath,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('文件分块失败: $e');
+      return null;
+    }
+  }
+
+  // 发送端：读取 chunkFile 给出的一块
+  Future<Uint8List?> readContentChunk(String filePath, int offset, int length) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('readContentChunk', {
+        'filePath': filePath,
+        'offset': offset,
+        'length': length,
+      });
+    } catch (e) {
+      debugPrint('读取数据块失败: $e');
+      return null;
+    }
+  }
+
+  // 接收端：返回本地块缓存中没有的块序号
+  Future<List<int>?> cacheMissing(Uint8List hashes) async {
+    try {
+      final result = await _channel.invokeMethod<List<Object?>>('cacheMissing', {
+        'hashes': hashes,
+      });
+      return result?.cast<int>();
+    } catch (e) {
+      debugPrint('查询块缓存失败: $e');
+      return null;
+    }
+  }
+
+  Future<bool> cachePut(Uint8List hash, Uint8List data) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('cachePut', {
+        'hash': hash,
+        'data': data,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('写入块缓存失败: $e');
+      return false;
+    }
+  }
+
+  // 用缓存的块拼出文件，成功时返回 bytes；拼接期间有块被淘汰时返回 missing
+  Future<Map<String, dynamic>?> cacheAssemble(String path, Uint8List hashes) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('cacheAssemble', {
+        'path': path,
+        'hashes': hashes,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } on PlatformException catch (e) {
+      if (e.code == 'MISSING_CHUNKS' && e.details is List) {
+        return {'missing': (e.details as List).cast<int>()};
+      }
+      debugPrint('从块缓存拼接文件失败: $e');
+      return null;
+    } catch (e) {
+      debugPrint('从块缓存拼接文件失败: $e');
+      return null;
+    }
+  }
+
+  // 把本地文件放入块缓存，返回新增的块数
+  Future<int?> cacheAddFile(String filePath) async {
+    try {
+      return await _channel.invokeMethod<int>('cacheAddFile', {
+        'filePath': filePath,
+      });
+    } catch (e) {
+      debugPrint('添加文件到块缓存失败: $e');
+      return null;
+    }
+  }
+
+  Future<Map<String, dynamic>?> cacheStats() async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('cacheStats');
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('获取块缓存状态失败: $e');
+      return null;
+    }
+  }
+
+  Future<bool> cacheConfigure({String? directory, int? capacityBytes}) async {
+    try {
+      await _channel.invokeMethod<Map<Object?, Object?>>('cacheConfigure', {
+        if (directory != null) 'directory': directory,
+        if (capacityBytes != null) 'capacityBytes': capacityBytes,
+      });
+      return true;
+    } catch (e) {
+      debugPrint('设置块缓存失败: $e');
+      return false;
+    }
+  }
+
+  Future<bool> cacheClear() async {
+    try {
+      final result = await _channel.invokeMethod<bool>('cacheClear');
+      return result ?? false;
+    } catch (e) {
+      debugPrint('清空块缓存失败: $e');
+      return false;
+    }
+  }
+
+  // 借助本地块缓存接收文件：只拉取缓存里没有的块，相同或相似的文件再次传输时几乎不产生流量。
+  // hashes 来自发送端的 chunkFile，fetchChunk 按序号从发送端取块。缓存上限需要大于文件大小
+  Future<bool> receiveFileCached(
+    String path, {
+    required Uint8List hashes,
+    required Future<Uint8List?> Function(int index) fetchChunk,
+    int streams = 4,
+  }) async {
+    var pending = await cacheMissing(hashes);
+    // 拼接期间块可能被淘汰，补传一次后再拼
+    for (var attempt = 0; attempt < 2 && pending != null; attempt++) {
+      final queue = List<int>.of(pending);
+      var ok = true;
+      Future<void> worker() async {
+        while (ok && queue.isNotEmpty) {
+          final index = queue.removeLast();
+          final data = await fetchChunk(index);
+          final hash = Uint8List.sublistView(hashes, index * 32, index * 32 + 32);
+          if (data == null || !await cachePut(hash, data)) {
+            ok = false;
+          }
+        }
+      }
+
+      await Future.wait(List.generate(streams, (_) => worker()));
+      if (!ok) {
+        return false;
+      }
+      final assembled = await cacheAssemble(path, hashes);
+      if (assembled == null) {
+        return false;
+      }
+      if (assembled.containsKey('bytes')) {
+        return true;
+      }
+      pending = (assembled['missing'] as List).cast<int>();
+    }
+    return false;
+  }
+
+  // 分页列举目录：首次调用传 path 和排序过滤选项，之后用返回的 cursor 和 offset 取后续页
+  Future<DirectoryPage?> listDirectory(
+    String path, {
+    String sort = 'name',
+    bool descending = false,
+    bool directoriesFirst = true,
+    bool showHidden = true,
+    String? filter,
+    int pageSize = 1000,
+  }) async {
+    return _listDirectoryPage({
+      'path': path,
+      'sort': sort,
+      'descending': descending,
+      'directoriesFirst': directoriesFirst,
+      'showHidden': showHidden,
+      if (filter != null) 'filter': filter,
+      'pageSize': pageSize,
+    });
+  }
+
+  Future<DirectoryPage?> nextDirectoryPage(DirectoryPage page, {int pageSize = 1000}) async {
+    if (!page.hasMore) {
+      return null;
+    }
+    return _listDirectoryPage({
+      'cursor': page.cursor,
+      'offset': page.offset + page.names.length,
+      'pageSize': pageSize,
+    });
+  }
+
+  // 不再翻页时释放原生端的快照
+  Future<void> closeListing(int cursor) async {
+    try {
+      await _channel.invokeMethod<bool>('closeListing', {'cursor': cursor});
+    } catch (e) {
+      debugPrint('关闭目录列举失败: $e');
+    }
+  }
+
+  Future<DirectoryPage?> _listDirectoryPage(Map<String, dynamic> arguments) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('listDirectory', arguments);
+      return result != null ? DirectoryPage.fromMap(result) : null;
+    } catch (e) {
+      debugPrint('列举目录失败: $e');
+      return null;
+    }
+  }
+
+  // 把目录加入被控端的文件名索引，在后台建立，之后由 inotify 保持更新
+  Future<bool> indexAddRoot(String path) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('indexAddRoot', {'path': path});
+      return result ?? false;
+    } catch (e) {
+      debugPrint('添加索引目录失败: $e');
+      return false;
+    }
+  }
+
+  // 搜索索引，mode 为 prefix、substring 或 glob，返回 paths、isDirectory、total、elapsedMs
+  Future<Map<String, dynamic>?> indexSearch(
+    String query, {
+    String mode = 'substring',
+    bool caseSensitive = false,
+    bool includeDirectories = true,
+    int limit = 200,
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('indexSearch', {
+        'query': query,
+        'mode': mode,
+        'caseSensitive': caseSensitive,
+        'includeDirectories': includeDirectories,
+        'limit': limit,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('搜索文件索引失败: $e');
+      return null;
+    }
+  }
+
+  Future<Map<String, dynamic>?> indexStatus() async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('indexStatus');
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('获取索引状态失败: $e');
+      return null;
+    }
+  }
+
+  Future<bool> indexClear() async {
+    try {
+      final result = await _channel.invokeMethod<bool>('indexClear');
+      return result ?? false;
+    } catch (e) {
+      debugPrint('清空文件索引失败: $e');
+      return false;
+    }
+  }
+
+  // 在后台递归复制，返回任务 id，进度见 jobProgress
+  Future<int?> copyItems(List<String> sources, String destination, {bool overwrite = false}) {
+    return _startJob('copyItems', {'sources': sources, 'destination': destination, 'overwrite': overwrite});
+  }
+
+  // 在后台移动，跨文件系统时自动退回复制后删除
+  Future<int?> moveItems(List<String> sources, String destination, {bool overwrite = false}) {
+    return _startJob('moveItems', {'sources': sources, 'destination': destination, 'overwrite': overwrite});
+  }
+
+  // 在后台递归删除
+  Future<int?> deleteItems(List<String> paths) {
+    return _startJob('deleteItems', {'paths': paths});
+  }
+
+  Future<bool> cancelJob(int jobId) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('cancelJob', {'jobId': jobId});
+      return result ?? false;
+    } catch (e) {
+      debugPrint('取消文件任务失败: $e');
+      return false;
+    }
+  }
+
+  Future<int?> _startJob(String method, Map<String, dynamic> arguments) async {
+    try {
+      return await _channel.invokeMethod<int>(method, arguments);
+    } catch (e) {
+      debugPrint('启动文件任务失败: $e');
+      return null;
+    }
+  }
+
   // 删除文件
   Future<bool> deleteFile(String filePath) async {
     try {
@@ -110,3 +742,43 @@ class FileOperationService {
   }
 }
 
+// 目录列举的一页，按列存放
+class DirectoryPage {
+  final int cursor;
+  final String path;
+  final int total;
+  final int offset;
+  final bool hasMore;
+  final List<String> names;
+  final Uint8List types;
+  final Int64List sizes;
+  final Int64List modified;
+
+  DirectoryPage.fromMap(Map<Object?, Object?> map)
+      : cursor = map['cursor'] as int,
+        path = map['path'] as String,
+        total = map['total'] as int,
+        offset = map['offset'] as int,
+        hasMore = map['hasMore'] as bool,
+        names = (map['names'] as List<Object?>).cast<String>(),
+        types = map['types'] as Uint8List,
+        sizes = map['sizes'] as Int64List,
+        modified = map['modified'] as Int64List;
+
+  bool isDirectory(int i) => types[i] == 1;
+
+  // 转换成原有的 FileInfo，供文件列表界面使用
+  List<FileInfo> toFileInfos() {
+    final separator = path.endsWith('/') ? '' : '/';
+    return List.generate(
+      names.length,
+      (i) => FileInfo(
+        name: names[i],
+        path: '$path$separator${names[i]}',
+        type: isDirectory(i) ? 'directory' : 'file',
+        size: sizes[i],
+        modified: modified[i],
+      ),
+    );
+  }
+}
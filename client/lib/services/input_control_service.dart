@@ -1,9 +1,19 @@
+import 'dart:typed_data';
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 class InputControlService {
   static const MethodChannel _channel = MethodChannel('input_control');
 
+  // 注入服务器转发来的二进制输入消息（仅 Linux），由原生插件解码
+  Future<void> injectWire(Uint8List data) async {
+    try {
+      await _channel.invokeMethod('injectWire', {'data': data});
+    } catch (e) {
+      debugPrint('注入二进制输入失败: $e');
+    }
+  }
+
   // 鼠标移动
   Future<void> moveMouse(double x, double y) async {
     try {
@@ -29,19 +39,130 @@ class InputControlService {
     }
   }
 
-  // 鼠标滚轮
-  Future<void> scrollMouse(double x, double y, int delta) async {
+  // 鼠标按下（拖拽开始）
+  Future<void> mouseDown(String button, {double? x, double? y}) async {
+    try {
+      await _channel.invokeMethod('mouseDown', {
+        'button': button,
+        if (x != null) 'x': x,
+        if (y != null) 'y': y,
+      });
+    } catch (e) {
+      debugPrint('鼠标按下失败: $e');
+    }
+  }
+
+  // 鼠标抬起（拖拽结束）
+  Future<void> mouseUp(String button, {double? x, double? y}) async {
+    try {
+      await _channel.invokeMethod('mouseUp', {
+        'button': button,
+        if (x != null) 'x': x,
+        if (y != null) 'y': y,
+      });
+    } catch (e) {
+      debugPrint('鼠标抬起失败: $e');
+    }
+  }
+
+  // 鼠标相对移动
+  Future<void> moveMouseRelative(int dx, int dy) async {
+    try {
+      await _channel.invokeMethod('moveMouseRelative', {
+        'dx': dx,
+        'dy': dy,
+      });
+    } catch (e) {
+      debugPrint('鼠标相对移动失败: $e');
+    }
+  }
+
+  // 鼠标滚轮（120 为一格，可传入不足一格的高精度增量）
+  Future<void> scrollMouse(double x, double y, int delta, {int deltaX = 0}) async {
     try {
       await _channel.invokeMethod('scrollMouse', {
         'x': x,
         'y': y,
         'delta': delta,
+        if (deltaX != 0) 'deltaX': deltaX,
       });
     } catch (e) {
       debugPrint('鼠标滚轮失败: $e');
     }
   }
 
+  // 批量注入事件，例如 [{'type': 'down', 'x': 10.0, 'y': 10.0}, {'type': 'move', ...}]
+  // 返回实际注入的事件数
+  Future<int> injectEvents(List<Map<String, dynamic>> events) async {
+    try {
+      final result = await _channel.invokeMethod<int>('injectEvents', {
+        'events': events,
+      });
+      return result ?? 0;
+    } catch (e) {
+      debugPrint('批量注入事件失败: $e');
+      return 0;
+    }
+  }
+
+  // 开始录制注入的输入事件到本地日志
+  Future<bool> startRecording(String path) async {
+    try {
+      await _channel.invokeMethod('startRecording', {
+        'path': path,
+      });
+      return true;
+    } catch (e) {
+      debugPrint('开始录制输入失败: $e');
+      return false;
+    }
+  }
+
+  // 停止录制，返回录制的事件数
+  Future<int> stopRecording() async {
+    try {
+      final result = await _channel.invokeMethod<int>('stopRecording');
+      return result ?? 0;
+    } catch (e) {
+      debugPrint('停止录制输入失败: $e');
+      return 0;
+    }
+  }
+
+  // 回放输入日志，speed 为倍速，0 表示尽快回放
+  Future<bool> startReplay(String path, {double speed = 1.0}) async {
+    try {
+      await _channel.invokeMethod('startReplay', {
+        'path': path,
+        'speed': speed,
+      });
+      return true;
+    } catch (e) {
+      debugPrint('开始回放输入失败: $e');
+      return false;
+    }
+  }
+
+  // 停止回放
+  Future<void> stopReplay() async {
+    try {
+      await _channel.invokeMethod('stopReplay');
+    } catch (e) {
+      debugPrint('停止回放输入失败: $e');
+    }
+  }
+
+  // 回放状态：running、events、durationMs、maxLagMs
+  Future<Map<String, dynamic>?> getReplayStatus() async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('getReplayStatus');
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('获取回放状态失败: $e');
+      return null;
+    }
+  }
+
   // 键盘按键
   Future<void> pressKey(String key, {List<String>? modifiers}) async {
     try {
@@ -42,6 +42,41 @@ class ScreenCaptureService {
     }
   }
 
+  // 订阅共享的抓屏编码流水线（仅 Linux）。多个观看会话各用自己的 session，
+  // 同一时刻只抓屏一次，每个画质档位只编码一次。tier: 0 完整，1 为 1/2，2 为 1/4
+  Future<bool> subscribeFrames(int session, {int tier = 0, int fps = 15}) async {
+    try {
+      await _channel.invokeMethod('subscribeFrames', {
+        'session': session,
+        'tier': tier,
+        'fps': fps,
+      });
+      return true;
+    } catch (e) {
+      debugPrint('订阅屏幕帧失败: $e');
+      return false;
+    }
+  }
+
+  Future<void> unsubscribeFrames(int session) async {
+    try {
+      await _channel.invokeMethod('unsubscribeFrames', {'session': session});
+    } catch (e) {
+      debugPrint('退订屏幕帧失败: $e');
+    }
+  }
+
+  // 取该会话还没拿到过的最新一帧（二进制协议消息），没有新帧时等到下一次抓屏。
+  // 抓屏失败、会话被退订或同一会话又发起了新请求时返回 null
+  Future<Uint8List?> nextFrame(int session) async {
+    try {
+      return await _channel.invokeMethod<Uint8List>('nextFrame', {'session': session});
+    } catch (e) {
+      debugPrint('获取屏幕帧失败: $e');
+      return null;
+    }
+  }
+
   // 获取屏幕尺寸
   Future<Map<String, int>?> getScreenSize() async {
     try {
@@ -59,6 +94,78 @@ class ScreenCaptureService {
     }
   }
 
+  // 开始录制会话，之后共享流水线和 captureFrame 抓到的帧都会写入录像文件
+  Future<bool> startRecording(String path) async {
+    try {
+      await _channel.invokeMethod('startRecording', {'path': path});
+      return true;
+    } catch (e) {
+      debugPrint('开始录制会话失败: $e');
+      return false;
+    }
+  }
+
+  // 停止录制，返回 frames、dropped
+  Future<Map<String, int>?> stopRecording() async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('stopRecording');
+      if (result != null) {
+        if (result['writeFailed'] == true) {
+          debugPrint('录像写入失败，只保存了失败前的部分');
+        }
+        return {
+          'frames': result['frames'] as int,
+          'dropped': result['dropped'] as int,
+        };
+      }
+      return null;
+    } catch (e) {
+      debugPrint('停止录制会话失败: $e');
+      return null;
+    }
+  }
+
+  // 打开录像，返回 frames、keyframes、durationMs
+  Future<Map<String, int>?> openPlayback(String path) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openPlayback', {'path': path});
+      if (result != null) {
+        return {
+          'frames': result['frames'] as int,
+          'keyframes': result['keyframes'] as int,
+          'durationMs': result['durationMs'] as int,
+        };
+      }
+      return null;
+    } catch (e) {
+      debugPrint('打开录像失败: $e');
+      return null;
+    }
+  }
+
+  // 定位到指定时间，返回从最近关键帧到目标时刻需要依次解码的帧
+  Future<List<Uint8List>> seekPlayback(int timestampMs) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('seekPlayback', {
+        'timestampMs': timestampMs,
+      });
+      final frames = result?['frames'] as List<Object?>?;
+      return frames?.cast<Uint8List>() ?? [];
+    } catch (e) {
+      debugPrint('定位录像失败: $e');
+      return [];
+    }
+  }
+
+  // 关闭录像
+  Future<void> closePlayback() async {
+    try {
+      await _channel.invokeMethod('closePlayback');
+    } catch (e) {
+      debugPrint('关闭录像失败: $e');
+    }
+  }
+
   // 开始周期性捕获（用于被控端）
   Stream<Uint8List>? startPeriodicCapture({int fps = 15}) {
     final controller = StreamController<Uint8List>();
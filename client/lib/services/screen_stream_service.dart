@@ -5,11 +5,27 @@ import 'package:flutter/foundation.dart';
 import 'package:web_socket_channel/web_socket_channel.dart';
 import 'screen_capture_service.dart';
 
+// 一个观看会话的推流状态
+class _ScreenViewer {
+  _ScreenViewer(this.channel, this.session);
+
+  final WebSocketChannel channel;
+  // 二进制消息头里的会话编号，也是订阅原生共享流水线时用的编号
+  final int session;
+  Timer? captureTimer;
+  bool wire = false;
+  // 上一帧还没取到时跳过本次定时，避免新请求顶掉未返回的请求
+  bool awaitingFrame = false;
+  bool stopped = false;
+}
+
 class ScreenStreamService {
   final ScreenCaptureService _screenService = ScreenCaptureService();
-  WebSocketChannel? _channel;
-  Timer? _captureTimer;
-  bool _isStreaming = false;
+  // 按观看方（服务器分配的 session_id）区分，每个观看方有自己的订阅和定时器。
+  // 已协商二进制协议时直接发送原生编码好的帧，不再经过 base64 和 JSON。
+  // 帧来自原生的共享流水线，多个观看会话不会重复抓屏和编码
+  final Map<String, _ScreenViewer> _viewers = {};
+  int _nextSession = 1;
   int _fps = 15; // 默认15帧/秒
 
   // 屏幕帧流（用于被控端发送）
@@ -18,14 +34,23 @@ class ScreenStreamService {
   // 接收屏幕帧的回调
   Function(Uint8List)? onFrameReceived;
 
-  bool get isStreaming => _isStreaming;
+  bool get isStreaming => _viewers.isNotEmpty;
 
-  // 开始发送屏幕流（被控端）
-  Future<void> startSendingScreen(WebSocketChannel channel) async {
-    if (_isStreaming) return;
+  // 开始向一个观看方发送屏幕流（被控端），同一观看方重复调用时忽略
+  Future<void> startSendingScreen(WebSocketChannel channel,
+      {String viewerId = '', int wireVersion = 0, int tier = 0}) async {
+    if (_viewers.containsKey(viewerId)) return;
 
-    _channel = channel;
-    _isStreaming = true;
+    final viewer = _ScreenViewer(channel, _nextSession++);
+    _viewers[viewerId] = viewer;
+    final wire = wireVersion > 0 &&
+        await _screenService.subscribeFrames(viewer.session, tier: tier, fps: _fps);
+    if (viewer.stopped) {
+      // 订阅期间已被停止
+      if (wire) _screenService.unsubscribeFrames(viewer.session);
+      return;
+    }
+    viewer.wire = wire;
 
     // 获取屏幕尺寸
     final screenSize = await _screenService.getScreenSize();
@@ -33,18 +58,30 @@ class ScreenStreamService {
       debugPrint('无法获取屏幕尺寸');
       return;
     }
+    if (viewer.stopped) return;
 
     // 开始周期性捕获
-    _captureTimer = Timer.periodic(
+    viewer.captureTimer = Timer.periodic(
       Duration(milliseconds: 1000 ~/ _fps),
       (timer) async {
-        if (!_isStreaming) {
+        if (viewer.stopped) {
           timer.cancel();
           return;
         }
 
+        if (viewer.wire) {
+          if (viewer.awaitingFrame) return;
+          viewer.awaitingFrame = true;
+          final message = await _screenService.nextFrame(viewer.session);
+          viewer.awaitingFrame = false;
+          if (message != null && !viewer.stopped) {
+            viewer.channel.sink.add(message);
+          }
+          return;
+        }
+
         final frame = await _screenService.captureFrame();
-        if (frame != null && _channel != null) {
+        if (frame != null && !viewer.stopped) {
           // 发送屏幕帧
           final message = {
             'type': 'screen_frame',
@@ -55,24 +92,32 @@ class ScreenStreamService {
               'height': screenSize['height'],
             },
           };
-          _channel!.sink.add(jsonEncode(message));
+          viewer.channel.sink.add(jsonEncode(message));
         }
       },
     );
   }
 
-  // 停止发送屏幕流
-  void stopSendingScreen() {
-    _isStreaming = false;
-    _captureTimer?.cancel();
-    _captureTimer = null;
+  // 停止向指定观看方发送屏幕流，不指定时全部停止
+  void stopSendingScreen([String? viewerId]) {
+    final ids = viewerId == null ? _viewers.keys.toList() : [viewerId];
+    for (final id in ids) {
+      final viewer = _viewers.remove(id);
+      if (viewer == null) continue;
+      viewer.stopped = true;
+      viewer.captureTimer?.cancel();
+      if (viewer.wire) {
+        _screenService.unsubscribeFrames(viewer.session);
+      }
+    }
   }
 
   // 处理接收到的屏幕帧（控制端）
   void handleScreenFrame(Map<String, dynamic> data) {
     try {
-      final frameDataBase64 = data['frame_data'] as String;
-      final frameData = base64Decode(frameDataBase64);
+      // 二进制协议的帧直接带原始字节，JSON 消息里是 base64
+      final frameData = data['frame_bytes'] as Uint8List? ??
+          base64Decode(data['frame_data'] as String);
       onFrameReceived?.call(frameData);
     } catch (e) {
       debugPrint('处理屏幕帧失败: $e');
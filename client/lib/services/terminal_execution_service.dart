@@ -1,22 +1,47 @@
+import 'dart:convert';
+import 'dart:typed_data';
+
 import 'package:flutter/foundation.dart';
 import 'package:flutter/services.dart';
 
 class TerminalExecutionService {
   static const MethodChannel _channel = MethodChannel('terminal');
+  static const EventChannel _outputChannel = EventChannel('terminal/output');
+  static const EventChannel _jobsChannel = EventChannel('terminal/jobs');
+
+  // 终端会话输出事件：{sessionId, data} 为一批输出（约 16 毫秒或 64 KB 合并一次），
+  // {sessionId, exited: true, exitCode} 表示 shell 已退出。有订阅者时 readSession 不再有数据。
+  // 屏幕模式的会话推送 {sessionId, screen} 屏幕差异（格式见 readScreen），不再推送原始输出
+  Stream<Map<String, dynamic>> get sessionOutput => _outputChannel
+      .receiveBroadcastStream()
+      .map((event) => (event as Map<Object?, Object?>).map((key, value) => MapEntry(key as String, value)));
+
+  // 批量命令的结果事件：每条命令完成时推送 {batchId, jobId, stdout, stderr, exit_code, timed_out,
+  // cancelled, truncated, duration_ms}，整批完成时推送 {batchId, done: true}
+  Stream<Map<String, dynamic>> get jobResults => _jobsChannel
+      .receiveBroadcastStream()
+      .map((event) => (event as Map<Object?, Object?>).map((key, value) => MapEntry(key as String, value)));
 
   // 执行命令
-  Future<Map<String, dynamic>> executeCommand(String command, {String? workingDir}) async {
+  Future<Map<String, dynamic>> executeCommand(String command, {String? workingDir, int? timeoutMs}) async {
     try {
       final result = await _channel.invokeMethod<Map<Object?, Object?>>('executeCommand', {
         'command': command,
         if (workingDir != null) 'workingDir': workingDir,
+        if (timeoutMs != null) 'timeoutMs': timeoutMs,
       });
       
       if (result != null) {
+        // segments 按到达顺序交错记录 stdout/stderr：{stream, time_ms, text}
+        final segments = (result['segments'] as List<Object?>? ?? [])
+            .map((segment) => Map<String, dynamic>.from(segment as Map))
+            .toList();
         return {
           'stdout': result['stdout'] as String? ?? '',
           'stderr': result['stderr'] as String? ?? '',
           'exit_code': result['exit_code'] as int? ?? -1,
+          'segments': segments,
+          'timed_out': result['timed_out'] as bool? ?? false,
         };
       }
       return {
@@ -33,5 +58,201 @@ class TerminalExecutionService {
       };
     }
   }
+
+  // 批量并行执行命令，立即返回 batchId。commands 的元素为命令字符串或
+  // {id, command, workingDir, timeoutMs, cpuSeconds, memoryBytes}，其余参数为各条命令的默认值
+  Future<int?> runBatch(
+    List<Object> commands, {
+    String? workingDir,
+    int? timeoutMs,
+    int? cpuSeconds,
+    int? memoryBytes,
+  }) async {
+    try {
+      return await _channel.invokeMethod<int>('runBatch', {
+        'commands': commands,
+        if (workingDir != null) 'workingDir': workingDir,
+        if (timeoutMs != null) 'timeoutMs': timeoutMs,
+        if (cpuSeconds != null) 'cpuSeconds': cpuSeconds,
+        if (memoryBytes != null) 'memoryBytes': memoryBytes,
+      });
+    } catch (e) {
+      debugPrint('批量执行命令失败: $e');
+      return null;
+    }
+  }
+
+  // 取消一批命令：排队中的不再执行，正在执行的终止整个进程组
+  Future<bool> cancelBatch(int batchId) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('cancelBatch', {'batchId': batchId});
+      return result ?? false;
+    } catch (e) {
+      debugPrint('取消批量命令失败: $e');
+      return false;
+    }
+  }
+
+  // 未订阅 jobResults 时取出暂存的结果，格式同 jobResults 事件
+  Future<List<Map<String, dynamic>>> readBatch(int batchId) async {
+    try {
+      final result = await _channel.invokeMethod<List<Object?>>('readBatch', {'batchId': batchId});
+      return (result ?? [])
+          .map((item) => (item as Map<Object?, Object?>).map((key, value) => MapEntry(key as String, value)))
+          .toList();
+    } catch (e) {
+      debugPrint('读取批量命令结果失败: $e');
+      return [];
+    }
+  }
+
+  // 打开常驻的终端会话（Linux 上基于伪终端），返回 sessionId、pid、shell、cols、rows
+  Future<Map<String, dynamic>?> openSession({
+    String? shell,
+    String? workingDir,
+    Map<String, String>? env,
+    bool login = false,
+    int cols = 80,
+    int rows = 24,
+    int? scrollbackBytes,
+    bool screen = false,
+    int? screenFps,
+    bool screenAck = false,
+  }) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('openSession', {
+        if (shell != null) 'shell': shell,
+        if (workingDir != null) 'workingDir': workingDir,
+        if (env != null) 'env': env,
+        'login': login,
+        'cols': cols,
+        'rows': rows,
+        if (scrollbackBytes != null) 'scrollbackBytes': scrollbackBytes,
+        'screen': screen,
+        if (screenFps != null) 'screenFps': screenFps,
+        'screenAck': screenAck,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('打开终端会话失败: $e');
+      return null;
+    }
+  }
+
+  // 向会话写入输入，按键和命令都原样发送，命令需要自带换行
+  Future<bool> writeSession(int sessionId, String input) async {
+    return writeSessionBytes(sessionId, Uint8List.fromList(utf8.encode(input)));
+  }
+
+  Future<bool> writeSessionBytes(int sessionId, Uint8List data) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('writeSession', {
+        'sessionId': sessionId,
+        'data': data,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('写入终端会话失败: $e');
+      return false;
+    }
+  }
+
+  Future<bool> resizeSession(int sessionId, int cols, int rows) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('resizeSession', {
+        'sessionId': sessionId,
+        'cols': cols,
+        'rows': rows,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('调整终端大小失败: $e');
+      return false;
+    }
+  }
+
+  // 取出会话的新输出，返回 data、dropped、exited、exitCode
+  Future<Map<String, dynamic>?> readSession(int sessionId) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('readSession', {
+        'sessionId': sessionId,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('读取终端会话失败: $e');
+      return null;
+    }
+  }
+
+  // 按行号回看会话历史，返回 data、firstLine、nextLine、oldestLine、totalLines。
+  // 重新连接时用上次的 nextLine 继续取；比 oldestLine 更早的历史已被丢弃
+  Future<Map<String, dynamic>?> readScrollback(int sessionId, {int fromLine = 0, int? maxLines, int? maxBytes}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('readScrollback', {
+        'sessionId': sessionId,
+        'fromLine': fromLine,
+        if (maxLines != null) 'maxLines': maxLines,
+        if (maxBytes != null) 'maxBytes': maxBytes,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('读取终端历史失败: $e');
+      return null;
+    }
+  }
+
+  // 屏幕模式下拉取屏幕差异，返回 revision、full、cols、rows、cursorRow、cursorCol、cursorVisible、
+  // title（有变化时）和 spans。spans 平铺为 [row, col, text, styles, ...]，
+  // styles 每 4 个整数一段：字符数、前景色、背景色、属性位，颜色 -1 为默认色
+  Future<Map<String, dynamic>?> readScreen(int sessionId, {bool full = false}) async {
+    try {
+      final result = await _channel.invokeMethod<Map<Object?, Object?>>('readScreen', {
+        'sessionId': sessionId,
+        'full': full,
+      });
+      return result?.map((key, value) => MapEntry(key as String, value));
+    } catch (e) {
+      debugPrint('读取终端屏幕失败: $e');
+      return null;
+    }
+  }
+
+  // 以 screenAck 打开的会话需要确认已应用的修订，之后的差异以它为基准
+  Future<bool> ackScreen(int sessionId, int revision) async {
+    try {
+      final result = await _channel.invokeMethod<bool>('ackScreen', {
+        'sessionId': sessionId,
+        'revision': revision,
+      });
+      return result ?? false;
+    } catch (e) {
+      debugPrint('确认终端屏幕失败: $e');
+      return false;
+    }
+  }
+
+  // 关闭会话，返回 shell 的退出码
+  Future<int?> closeSession(int sessionId) async {
+    try {
+      return await _channel.invokeMethod<int>('closeSession', {
+        'sessionId': sessionId,
+      });
+    } catch (e) {
+      debugPrint('关闭终端会话失败: $e');
+      return null;
+    }
+  }
+
+  Future<List<Map<String, dynamic>>> listSessions() async {
+    try {
+      final result = await _channel.invokeMethod<List<Object?>>('listSessions');
+      return (result ?? [])
+          .map((item) => (item as Map<Object?, Object?>).map((key, value) => MapEntry(key as String, value)))
+          .toList();
+    } catch (e) {
+      debugPrint('获取终端会话列表失败: $e');
+      return [];
+    }
+  }
 }
 
@@ -0,0 +1,82 @@
+#ifndef RUNNER_ASYNC_METHOD_H_
+#define RUNNER_ASYNC_METHOD_H_
+
+#include <flutter/encodable_value.h>
+#include <flutter/method_result.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "platform_thread.h"
+#include "task_executor.h"
+
+// 在工作线程上算出的方法调用结果，回到平台线程后再交给 MethodResult
+struct MethodOutcome {
+  bool ok = true;
+  flutter::EncodableValue value;
+  std::string code;
+  std::string message;
+  flutter::EncodableValue details;
+
+  static MethodOutcome Ok(flutter::EncodableValue value) {
+    MethodOutcome outcome;
+    outcome.value = std::move(value);
+    return outcome;
+  }
+  static MethodOutcome Fail(std::string code, std::string message,
+                            flutter::EncodableValue details = flutter::EncodableValue()) {
+    MethodOutcome outcome;
+    outcome.ok = false;
+    outcome.code = std::move(code);
+    outcome.message = std::move(message);
+    outcome.details = std::move(details);
+    return outcome;
+  }
+};
+
+// 把 work 和 finish 包装成工作池任务：work 的结果回到平台线程完成方法调用
+inline TaskExecutor::Task MakeMethodTask(
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+    std::function<MethodOutcome()> work, std::function<MethodOutcome(MethodOutcome outcome)> finish) {
+  std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+  return [shared_result, work = std::move(work), finish = std::move(finish)]() {
+    auto outcome = std::make_shared<MethodOutcome>(work());
+    PostToPlatformThread([shared_result, outcome, finish]() {
+      if (finish) {
+        *outcome = finish(std::move(*outcome));
+      }
+      if (outcome->ok) {
+        shared_result->Success(outcome->value);
+      } else if (outcome->details.IsNull()) {
+        shared_result->Error(outcome->code, outcome->message);
+      } else {
+        shared_result->Error(outcome->code, outcome->message, outcome->details);
+      }
+    });
+  };
+}
+
+// work 在共享工作池上执行，不能访问插件的成员状态，参数需要按值捕获，
+// 需要共享的状态通过 shared_ptr 捕获：工作池不随插件析构，任务可能比插件活得久。
+// 结果回到平台线程完成方法调用。需要更新插件状态（登记句柄、快照等）时传入 finish，
+// 它在平台线程上拿到 work 的结果，返回最终交给 MethodResult 的结果。
+// work 的中间产物可以放在两边共同捕获的 shared_ptr 里交给 finish
+inline void RunMethodAsync(TaskPriority priority,
+                           std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+                           std::function<MethodOutcome()> work,
+                           std::function<MethodOutcome(MethodOutcome outcome)> finish = nullptr) {
+  TaskExecutor::Shared().Submit(priority,
+                                MakeMethodTask(std::move(result), std::move(work), std::move(finish)));
+}
+
+// 同上，但在 queue 上按提交顺序执行，同一队列的调用不会并发
+inline void RunMethodAsync(SerialTaskQueue* queue,
+                           std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result,
+                           std::function<MethodOutcome()> work,
+                           std::function<MethodOutcome(MethodOutcome outcome)> finish = nullptr) {
+  queue->Submit(MakeMethodTask(std::move(result), std::move(work), std::move(finish)));
+}
+
+#endif  // RUNNER_ASYNC_METHOD_H_
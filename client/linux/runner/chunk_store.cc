@@ -0,0 +1,590 @@
+#include "chunk_store.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+// 分块长度范围和归一化分块的两个掩码：平均长度之前用更严格的掩码，之后用更宽松的，
+// 让块长集中在平均值附近
+const size_t kMinChunk = 16 * 1024;
+const size_t kAverageChunk = 64 * 1024;
+const size_t kMaxChunk = 256 * 1024;
+const uint64_t kMaskStrict = ~0ULL << (64 - 18);
+const uint64_t kMaskLoose = ~0ULL << (64 - 14);
+
+const int kMaxHashThreads = 8;
+// 分块时每批读入的数据量，内存占用与文件大小无关
+const size_t kReadBatch = 32 * 1024 * 1024;
+
+const uint32_t kSha256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline uint32_t Rotr(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+void Sha256Block(uint32_t state[8], const uint8_t* block) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t(block[i * 4]) << 24) | (uint32_t(block[i * 4 + 1]) << 16) |
+           (uint32_t(block[i * 4 + 2]) << 8) | block[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = Rotr(w[i - 15], 7) ^ Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = Rotr(w[i - 2], 17) ^ Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (Rotr(e, 6) ^ Rotr(e, 11) ^ Rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                  kSha256K[i] + w[i];
+    uint32_t t2 = (Rotr(a, 2) ^ Rotr(a, 13) ^ Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state[0] += a;
+  state[1] += b;
+  state[2] += c;
+  state[3] += d;
+  state[4] += e;
+  state[5] += f;
+  state[6] += g;
+  state[7] += h;
+}
+
+// gear 表：固定种子的 splitmix64 序列，两端生成的表相同
+struct GearTable {
+  uint64_t values[256];
+  GearTable() {
+    uint64_t seed = 0x9e3779b97f4a7c15ULL;
+    for (uint64_t& value : values) {
+      seed += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      value = z ^ (z >> 31);
+    }
+  }
+};
+
+const GearTable kGear;
+
+size_t FindBoundary(const uint8_t* data, size_t size) {
+  if (size <= kMinChunk) {
+    return size;
+  }
+  size_t limit = std::min(size, kMaxChunk);
+  size_t normal = std::min(limit, kAverageChunk);
+  // 小于最小长度的部分不可能切分，直接跳过
+  uint64_t hash = 0;
+  size_t i = kMinChunk;
+  for (; i < normal; i++) {
+    hash = (hash << 1) + kGear.values[data[i]];
+    if ((hash & kMaskStrict) == 0) {
+      return i + 1;
+    }
+  }
+  for (; i < limit; i++) {
+    hash = (hash << 1) + kGear.values[data[i]];
+    if ((hash & kMaskLoose) == 0) {
+      return i + 1;
+    }
+  }
+  return limit;
+}
+
+int HexDigit(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+bool ChunkHashFromHex(const std::string& hex, ChunkHash* hash) {
+  if (hex.size() != 64) {
+    return false;
+  }
+  for (size_t i = 0; i < 32; i++) {
+    int high = HexDigit(hex[i * 2]);
+    int low = HexDigit(hex[i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return false;
+    }
+    (*hash)[i] = static_cast<uint8_t>(high << 4 | low);
+  }
+  return true;
+}
+
+// 并行计算 chunks 中各块的哈希，data 对应文件偏移 base 处
+void HashChunks(const uint8_t* data, int64_t base, ContentChunk* chunks, size_t count) {
+  int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  threads = static_cast<int>(std::min<size_t>(std::min(threads, kMaxHashThreads), count));
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i = next++; i < count; i = next++) {
+      Sha256(data + (chunks[i].offset - base), chunks[i].length, chunks[i].hash.data());
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : pool) {
+    thread.join();
+  }
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+}  // namespace
+
+void Sha256(const void* data, size_t size, uint8_t out[32]) {
+  uint32_t state[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                       0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  size_t remaining = size;
+  for (; remaining >= 64; remaining -= 64, p += 64) {
+    Sha256Block(state, p);
+  }
+  // 末尾补 0x80、若干 0 和 64 位大端比特长度
+  uint8_t tail[128] = {};
+  memcpy(tail, p, remaining);
+  tail[remaining] = 0x80;
+  size_t tail_size = remaining < 56 ? 64 : 128;
+  uint64_t bits = static_cast<uint64_t>(size) * 8;
+  for (int i = 0; i < 8; i++) {
+    tail[tail_size - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+  }
+  for (size_t offset = 0; offset < tail_size; offset += 64) {
+    Sha256Block(state, tail + offset);
+  }
+  for (int i = 0; i < 8; i++) {
+    out[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+    out[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+    out[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+    out[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+  }
+}
+
+std::string ChunkHashToHex(const ChunkHash& hash) {
+  static const char kDigits[] = "0123456789abcdef";
+  std::string hex(64, '0');
+  for (size_t i = 0; i < hash.size(); i++) {
+    hex[i * 2] = kDigits[hash[i] >> 4];
+    hex[i * 2 + 1] = kDigits[hash[i] & 0xf];
+  }
+  return hex;
+}
+
+bool ChunkFileContent(const std::string& path, std::vector<ContentChunk>* chunks,
+                      std::string* error) {
+  chunks->clear();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  // buffer 里是文件偏移 base 起尚未切分的数据。每批先顺序找出边界，再并行计算这一批的哈希；
+  // 不足最大块长的尾部可能还会延长，留到下一批
+  std::vector<uint8_t> buffer;
+  int64_t base = 0;
+  bool eof = false;
+  while (true) {
+    size_t have = buffer.size();
+    buffer.resize(std::max(kReadBatch, have + kMaxChunk));
+    while (!eof && have < buffer.size()) {
+      ssize_t n = pread(fd, buffer.data() + have, buffer.size() - have, base + have);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        *error = strerror(errno);
+        close(fd);
+        return false;
+      }
+      eof = n == 0;
+      have += n;
+    }
+    buffer.resize(have);
+
+    size_t first = chunks->size();
+    size_t pos = 0;
+    while (pos < have && (eof || have - pos >= kMaxChunk)) {
+      size_t length = FindBoundary(buffer.data() + pos, have - pos);
+      ContentChunk chunk;
+      chunk.offset = base + static_cast<int64_t>(pos);
+      chunk.length = static_cast<uint32_t>(length);
+      chunks->push_back(chunk);
+      pos += length;
+    }
+    HashChunks(buffer.data(), base, chunks->data() + first, chunks->size() - first);
+    buffer.erase(buffer.begin(), buffer.begin() + pos);
+    base += static_cast<int64_t>(pos);
+    if (eof && buffer.empty()) {
+      break;
+    }
+  }
+  close(fd);
+  return true;
+}
+
+bool ChunkStore::Open(const std::string& directory, int64_t capacity, std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return OpenLocked(directory, capacity, error);
+}
+
+bool ChunkStore::EnsureOpen(const std::string& directory, int64_t capacity, std::string* error) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!directory_.empty()) {
+    return true;
+  }
+  return OpenLocked(directory, capacity, error);
+}
+
+bool ChunkStore::OpenLocked(const std::string& directory, int64_t capacity, std::string* error) {
+  directory_.clear();
+  lru_.clear();
+  entries_.clear();
+  bytes_ = 0;
+  capacity_ = capacity;
+
+  std::string root = directory;
+  while (root.size() > 1 && root.back() == '/') {
+    root.pop_back();
+  }
+  for (size_t pos = root.find('/', 1); pos != std::string::npos; pos = root.find('/', pos + 1)) {
+    mkdir(root.substr(0, pos).c_str(), 0700);
+  }
+  if (mkdir(root.c_str(), 0700) != 0 && errno != EEXIST) {
+    *error = strerror(errno);
+    return false;
+  }
+
+  // 扫描已有的块，按 mtime 恢复使用顺序，顺便清理上次中断留下的临时文件
+  struct Found {
+    int64_t mtime;
+    ChunkHash hash;
+    int64_t size;
+  };
+  std::vector<Found> found;
+  DIR* top = opendir(root.c_str());
+  if (!top) {
+    *error = strerror(errno);
+    return false;
+  }
+  while (struct dirent* sub = readdir(top)) {
+    if (strlen(sub->d_name) != 2) {
+      continue;
+    }
+    std::string sub_path = root + "/" + sub->d_name;
+    DIR* dir = opendir(sub_path.c_str());
+    if (!dir) {
+      continue;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+      std::string name = entry->d_name;
+      std::string file = sub_path + "/" + name;
+      ChunkHash hash;
+      struct stat st;
+      if (name.compare(0, 5, ".tmp-") == 0) {
+        unlink(file.c_str());
+      } else if (ChunkHashFromHex(name, &hash) && stat(file.c_str(), &st) == 0) {
+        found.push_back({static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec,
+                         hash, static_cast<int64_t>(st.st_size)});
+      }
+    }
+    closedir(dir);
+  }
+  closedir(top);
+  std::sort(found.begin(), found.end(),
+            [](const Found& a, const Found& b) { return a.mtime < b.mtime; });
+  directory_ = root;
+  for (const Found& item : found) {
+    lru_.push_front(item.hash);
+    entries_[item.hash] = {item.size, lru_.begin()};
+    bytes_ += item.size;
+  }
+  EvictLocked();
+  return true;
+}
+
+std::string ChunkStore::PathFor(const ChunkHash& hash) const {
+  std::string hex = ChunkHashToHex(hash);
+  return directory_ + "/" + hex.substr(0, 2) + "/" + hex;
+}
+
+bool ChunkStore::Has(const ChunkHash& hash) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.count(hash) > 0;
+}
+
+bool ChunkStore::Put(const ChunkHash& hash, const uint8_t* data, size_t size,
+                     std::string* error) {
+  ChunkHash actual;
+  Sha256(data, size, actual.data());
+  if (actual != hash) {
+    *error = "chunk hash mismatch";
+    return false;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return PutLocked(hash, data, size, error);
+}
+
+bool ChunkStore::PutLocked(const ChunkHash& hash, const uint8_t* data, size_t size,
+                           std::string* error) {
+  if (directory_.empty()) {
+    *error = "chunk store not open";
+    return false;
+  }
+  auto it = entries_.find(hash);
+  if (it != entries_.end()) {
+    TouchLocked(hash, &it->second);
+    return true;
+  }
+  std::string path = PathFor(hash);
+  std::string dir = path.substr(0, path.find_last_of('/'));
+  std::string temp = dir + "/.tmp-" + ChunkHashToHex(hash);
+  int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0 && errno == ENOENT) {
+    mkdir(dir.c_str(), 0700);
+    fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  }
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  bool ok = WriteAll(fd, data, size);
+  ok = close(fd) == 0 && ok;
+  if (!ok || rename(temp.c_str(), path.c_str()) != 0) {
+    *error = strerror(errno);
+    unlink(temp.c_str());
+    return false;
+  }
+  lru_.push_front(hash);
+  entries_[hash] = {static_cast<int64_t>(size), lru_.begin()};
+  bytes_ += size;
+  EvictLocked();
+  return true;
+}
+
+bool ChunkStore::Get(const ChunkHash& hash, std::vector<uint8_t>* data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(hash);
+  if (it == entries_.end()) {
+    misses_++;
+    return false;
+  }
+  std::string path = PathFor(hash);
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  bool ok = fd >= 0;
+  if (ok) {
+    data->resize(it->second.size);
+    size_t done = 0;
+    while (done < data->size()) {
+      ssize_t n = read(fd, data->data() + done, data->size() - done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n <= 0) {
+        break;
+      }
+      done += n;
+    }
+    close(fd);
+    ChunkHash actual;
+    Sha256(data->data(), data->size(), actual.data());
+    ok = done == data->size() && actual == hash;
+  }
+  if (!ok) {
+    // 块文件丢失或损坏，从缓存中去掉，由调用方重新获取
+    RemoveLocked(hash);
+    misses_++;
+    return false;
+  }
+  TouchLocked(hash, &it->second);
+  hits_++;
+  return true;
+}
+
+std::vector<int64_t> ChunkStore::Missing(const std::vector<ChunkHash>& hashes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int64_t> missing;
+  std::map<ChunkHash, bool> seen;
+  for (size_t i = 0; i < hashes.size(); i++) {
+    if (entries_.count(hashes[i]) == 0 && seen.emplace(hashes[i], true).second) {
+      missing.push_back(static_cast<int64_t>(i));
+    }
+  }
+  return missing;
+}
+
+bool ChunkStore::Assemble(const std::string& path, const std::vector<ChunkHash>& hashes,
+                          std::vector<int64_t>* missing, int64_t* bytes, std::string* error) {
+  *missing = Missing(hashes);
+  if (!missing->empty()) {
+    *error = "missing chunks";
+    return false;
+  }
+  // 临时文件名唯一，同一目标的并发拼接不会互相覆盖
+  std::string temp = path + ".rccache.XXXXXX";
+  int fd = mkostemp(&temp[0], O_CLOEXEC);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  fchmod(fd, 0644);
+  *bytes = 0;
+  std::vector<uint8_t> data;
+  bool ok = true;
+  for (size_t i = 0; ok && i < hashes.size(); i++) {
+    // 拼接期间块可能被淘汰或发现损坏，这时报告缺失让调用方补传
+    if (!Get(hashes[i], &data)) {
+      missing->push_back(static_cast<int64_t>(i));
+      *error = "missing chunks";
+      ok = false;
+    } else if (!WriteAll(fd, data.data(), data.size())) {
+      *error = strerror(errno);
+      ok = false;
+    }
+    *bytes += data.size();
+  }
+  if (ok && fsync(fd) != 0) {
+    *error = strerror(errno);
+    ok = false;
+  }
+  if (close(fd) != 0 && ok) {
+    *error = strerror(errno);
+    ok = false;
+  }
+  if (ok && rename(temp.c_str(), path.c_str()) != 0) {
+    *error = strerror(errno);
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp.c_str());
+  }
+  return ok;
+}
+
+bool ChunkStore::AddFile(const std::string& path, int64_t* added, std::string* error) {
+  std::vector<ContentChunk> chunks;
+  if (!ChunkFileContent(path, &chunks, error)) {
+    return false;
+  }
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  *added = 0;
+  std::vector<uint8_t> data;
+  bool ok = true;
+  for (const ContentChunk& chunk : chunks) {
+    if (Has(chunk.hash)) {
+      continue;
+    }
+    data.resize(chunk.length);
+    if (pread(fd, data.data(), data.size(), chunk.offset) != static_cast<ssize_t>(data.size())) {
+      *error = "file changed while reading";
+      ok = false;
+      break;
+    }
+    // 文件在分块后被修改时哈希对不上，Put 会拒绝
+    if (!Put(chunk.hash, data.data(), data.size(), error)) {
+      ok = false;
+      break;
+    }
+    (*added)++;
+  }
+  close(fd);
+  return ok;
+}
+
+void ChunkStore::SetCapacity(int64_t capacity) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = capacity;
+  EvictLocked();
+}
+
+void ChunkStore::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  while (!lru_.empty()) {
+    RemoveLocked(lru_.back());
+  }
+}
+
+int64_t ChunkStore::chunk_count() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return static_cast<int64_t>(entries_.size());
+}
+
+int64_t ChunkStore::bytes() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void ChunkStore::TouchLocked(const ChunkHash& hash, Entry* entry) {
+  if (entry->lru != lru_.begin()) {
+    lru_.splice(lru_.begin(), lru_, entry->lru);
+  }
+  // 更新 mtime 记录使用时间，重启后据此恢复顺序
+  utimensat(AT_FDCWD, PathFor(hash).c_str(), nullptr, 0);
+}
+
+void ChunkStore::RemoveLocked(const ChunkHash& hash) {
+  auto it = entries_.find(hash);
+  if (it == entries_.end()) {
+    return;
+  }
+  unlink(PathFor(hash).c_str());
+  bytes_ -= it->second.size;
+  lru_.erase(it->second.lru);
+  entries_.erase(it);
+}
+
+void ChunkStore::EvictLocked() {
+  while (bytes_ > capacity_ && !lru_.empty()) {
+    RemoveLocked(lru_.back());
+  }
+}
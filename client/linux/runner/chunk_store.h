@@ -0,0 +1,89 @@
+#ifndef RUNNER_CHUNK_STORE_H_
+#define RUNNER_CHUNK_STORE_H_
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using ChunkHash = std::array<uint8_t, 32>;
+
+void Sha256(const void* data, size_t size, uint8_t out[32]);
+std::string ChunkHashToHex(const ChunkHash& hash);
+
+// 内容定义分块的一块：边界由内容决定，文件中间插入或删除数据只影响附近的块
+struct ContentChunk {
+  int64_t offset = 0;
+  uint32_t length = 0;
+  ChunkHash hash;
+};
+
+// 用 gear 滚动哈希切分文件（FastCDC 的归一化分块，块长 16 KB～256 KB，平均约 64 KB），
+// 文件按批 pread 读入，每批各块的 SHA-256 多线程并行计算
+bool ChunkFileContent(const std::string& path, std::vector<ContentChunk>* chunks,
+                      std::string* error);
+
+// 本地内容寻址块缓存。每块以 SHA-256 命名存为单独文件（directory/ab/abcd...），
+// 总大小超过上限时按最近使用淘汰。使用时间记录在文件的 mtime 上，重启后顺序不丢。
+// 读取时重新校验哈希，损坏的块直接删除并视为缺失，因此写入不做 fsync。
+// 所有方法都可能访问磁盘，应在工作线程上调用。
+class ChunkStore {
+ public:
+  bool Open(const std::string& directory, int64_t capacity, std::string* error);
+  // 还没打开时才扫描目录打开，已打开时直接返回 true
+  bool EnsureOpen(const std::string& directory, int64_t capacity, std::string* error);
+  bool is_open() const { return !directory_.empty(); }
+
+  bool Has(const ChunkHash& hash);
+  // 校验内容与 hash 一致后存入
+  bool Put(const ChunkHash& hash, const uint8_t* data, size_t size, std::string* error);
+  bool Get(const ChunkHash& hash, std::vector<uint8_t>* data);
+  // 返回 hashes 中缓存里没有的序号，同一个哈希只报告第一次出现的位置
+  std::vector<int64_t> Missing(const std::vector<ChunkHash>& hashes);
+  // 按顺序用缓存的块拼出文件，先写临时文件再改名。有块缺失时返回 false 且 missing 非空
+  bool Assemble(const std::string& path, const std::vector<ChunkHash>& hashes,
+                std::vector<int64_t>* missing, int64_t* bytes, std::string* error);
+  // 把本地文件的各块放入缓存，之后传输相同或相似的文件时可以直接复用
+  bool AddFile(const std::string& path, int64_t* added, std::string* error);
+
+  void SetCapacity(int64_t capacity);
+  void Clear();
+
+  const std::string& directory() const { return directory_; }
+  int64_t capacity() const { return capacity_; }
+  int64_t chunk_count();
+  int64_t bytes();
+  int64_t hits() const { return hits_; }
+  int64_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    int64_t size = 0;
+    std::list<ChunkHash>::iterator lru;
+  };
+
+  bool OpenLocked(const std::string& directory, int64_t capacity, std::string* error);
+  std::string PathFor(const ChunkHash& hash) const;
+  bool PutLocked(const ChunkHash& hash, const uint8_t* data, size_t size, std::string* error);
+  void TouchLocked(const ChunkHash& hash, Entry* entry);
+  void RemoveLocked(const ChunkHash& hash);
+  void EvictLocked();
+
+  std::mutex mutex_;
+  std::string directory_;
+  int64_t capacity_ = 0;
+  int64_t bytes_ = 0;
+  // 头部为最近使用
+  std::list<ChunkHash> lru_;
+  std::map<ChunkHash, Entry> entries_;
+  // Get 在锁内更新，统计在锁外读取
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+};
+
+#endif  // RUNNER_CHUNK_STORE_H_
@@ -0,0 +1,205 @@
+#include "command_runner.h"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+extern char** environ;
+
+namespace {
+
+const size_t kReadChunk = 64 * 1024;
+// 每路每轮最多读这么多次，一路大量输出时另一路也能及时读到，时间戳才准确
+const int kReadsPerRound = 4;
+// 取消 fd 在 epoll 中的标识，0 和 1 是 stdout 和 stderr
+const int kCancelIndex = 2;
+
+void ClosePipe(int fds[2]) {
+  for (int i = 0; i < 2; i++) {
+    if (fds[i] >= 0) {
+      close(fds[i]);
+      fds[i] = -1;
+    }
+  }
+}
+
+}  // namespace
+
+bool RunCommand(const CommandOptions& options, CommandResult* result, std::string* error) {
+  int out_pipe[2] = {-1, -1};
+  int err_pipe[2] = {-1, -1};
+  if (pipe2(out_pipe, O_CLOEXEC) != 0 || pipe2(err_pipe, O_CLOEXEC) != 0) {
+    *error = strerror(errno);
+    ClosePipe(out_pipe);
+    ClosePipe(err_pipe);
+    return false;
+  }
+
+  // fork 之后的子进程只能调用异步信号安全的函数，参数提前准备好
+  char* argv[] = {const_cast<char*>("sh"), const_cast<char*>("-c"),
+                  const_cast<char*>(options.command.c_str()), nullptr};
+  const char* working_dir = options.working_dir.empty() ? nullptr : options.working_dir.c_str();
+  // CPU 超限先收到 SIGXCPU，再过一秒是 SIGKILL
+  struct rlimit cpu_limit = {static_cast<rlim_t>(options.cpu_seconds),
+                             static_cast<rlim_t>(options.cpu_seconds) + 1};
+  struct rlimit memory_limit = {static_cast<rlim_t>(options.memory_bytes),
+                                static_cast<rlim_t>(options.memory_bytes)};
+  auto start = std::chrono::steady_clock::now();
+
+  pid_t pid = fork();
+  if (pid < 0) {
+    *error = strerror(errno);
+    ClosePipe(out_pipe);
+    ClosePipe(err_pipe);
+    return false;
+  }
+  if (pid == 0) {
+    // 自成进程组，超时时连同它启动的子进程一起杀掉
+    setpgid(0, 0);
+    int null_fd = open("/dev/null", O_RDONLY);
+    if (null_fd >= 0) {
+      dup2(null_fd, STDIN_FILENO);
+    }
+    dup2(out_pipe[1], STDOUT_FILENO);
+    dup2(err_pipe[1], STDERR_FILENO);
+    if (working_dir && chdir(working_dir) != 0) {
+      static const char kMessage[] = "cannot change to working directory\n";
+      ssize_t ignored = write(STDERR_FILENO, kMessage, sizeof(kMessage) - 1);
+      (void)ignored;
+      _exit(126);
+    }
+    if (options.cpu_seconds > 0) {
+      setrlimit(RLIMIT_CPU, &cpu_limit);
+    }
+    if (options.memory_bytes > 0) {
+      setrlimit(RLIMIT_AS, &memory_limit);
+    }
+    for (int sig = 1; sig < NSIG; sig++) {
+      signal(sig, SIG_DFL);
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, nullptr);
+    execve("/bin/sh", argv, environ);
+    _exit(127);
+  }
+  // 父进程这边也设置一次，避免子进程还没执行 setpgid 时就要 kill(-pid)
+  setpgid(pid, pid);
+  close(out_pipe[1]);
+  close(err_pipe[1]);
+
+  int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  int fds[2] = {out_pipe[0], err_pipe[0]};
+  std::string* outputs[2] = {&result->stdout_text, &result->stderr_text};
+  int open_count = 0;
+  for (int i = 0; i < 2; i++) {
+    fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = static_cast<uint32_t>(i);
+    if (epoll_fd >= 0 && epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[i], &event) == 0) {
+      open_count++;
+    }
+  }
+  if (options.cancel_fd >= 0) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u32 = kCancelIndex;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, options.cancel_fd, &event);
+  }
+
+  auto deadline = start + std::chrono::milliseconds(options.timeout_ms);
+  std::vector<char> buffer(kReadChunk);
+  bool stopped = false;
+  while (open_count > 0 && !stopped) {
+    int timeout = -1;
+    if (options.timeout_ms > 0) {
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                           deadline - std::chrono::steady_clock::now())
+                           .count();
+      if (remaining <= 0) {
+        kill(-pid, SIGKILL);
+        result->timed_out = true;
+        break;
+      }
+      timeout = static_cast<int>(remaining);
+    }
+    struct epoll_event events[3];
+    int count = epoll_wait(epoll_fd, events, 3, timeout);
+    if (count < 0 && errno != EINTR) {
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      int index = static_cast<int>(events[i].data.u32);
+      if (index == kCancelIndex) {
+        kill(-pid, SIGKILL);
+        result->cancelled = true;
+        stopped = true;
+        break;
+      }
+      for (int round = 0; round < kReadsPerRound; round++) {
+        ssize_t n = read(fds[index], buffer.data(), buffer.size());
+        if (n < 0 && errno == EINTR) {
+          continue;
+        }
+        if (n < 0 && errno == EAGAIN) {
+          break;
+        }
+        if (n <= 0) {
+          epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fds[index], nullptr);
+          open_count--;
+          break;
+        }
+        // 超出上限的输出照常读走，只是不再保存
+        std::string* output = outputs[index];
+        size_t keep = output->size() < options.max_output
+                          ? std::min(static_cast<size_t>(n), options.max_output - output->size())
+                          : 0;
+        if (keep < static_cast<size_t>(n)) {
+          result->truncated = true;
+        }
+        if (keep == 0) {
+          continue;
+        }
+        output->append(buffer.data(), keep);
+        bool is_stderr = index == 1;
+        if (!result->segments.empty() && result->segments.back().is_stderr == is_stderr) {
+          result->segments.back().text.append(buffer.data(), keep);
+        } else {
+          CommandSegment segment;
+          segment.is_stderr = is_stderr;
+          segment.time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                                std::chrono::steady_clock::now() - start)
+                                .count();
+          segment.text.assign(buffer.data(), keep);
+          result->segments.push_back(std::move(segment));
+        }
+      }
+    }
+  }
+
+  if (epoll_fd >= 0) {
+    close(epoll_fd);
+  }
+  close(out_pipe[0]);
+  close(err_pipe[0]);
+
+  // 输出管道都关闭后 shell 通常已经退出；后台进程还拿着管道时超时分支已经杀掉了整个进程组
+  int status = 0;
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+  result->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+  result->duration_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+  return true;
+}
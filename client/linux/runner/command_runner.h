@@ -0,0 +1,45 @@
+#ifndef RUNNER_COMMAND_RUNNER_H_
+#define RUNNER_COMMAND_RUNNER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct CommandOptions {
+  std::string command;
+  std::string working_dir;
+  // 超时后杀掉整个进程组，0 表示不限时
+  int timeout_ms = 0;
+  // 每路输出最多保留的字节数，超出部分继续读取但丢弃，避免子进程因管道写满而阻塞
+  size_t max_output = 16 * 1024 * 1024;
+  // 子进程的 CPU 时间（秒）和地址空间（字节）上限，0 表示不限制
+  int cpu_seconds = 0;
+  size_t memory_bytes = 0;
+  // 该 fd 可读时终止命令的整个进程组，-1 表示不可取消；fd 由调用方负责
+  int cancel_fd = -1;
+};
+
+// 按到达顺序记录的一段输出，time_ms 为相对命令启动的毫秒数
+struct CommandSegment {
+  bool is_stderr = false;
+  int64_t time_ms = 0;
+  std::string text;
+};
+
+struct CommandResult {
+  std::string stdout_text;
+  std::string stderr_text;
+  std::vector<CommandSegment> segments;
+  int exit_code = -1;
+  bool timed_out = false;
+  bool cancelled = false;
+  bool truncated = false;
+  int64_t duration_ms = 0;
+};
+
+// 用 /bin/sh -c 执行一条命令直到结束。stdout 和 stderr 由同一个 epoll 循环同时读取，
+// 任何一路写满管道都不会卡住另一路；同一路连续到达的输出合并为一段。
+// 会阻塞调用线程，不要在平台线程上调用。
+bool RunCommand(const CommandOptions& options, CommandResult* result, std::string* error);
+
+#endif  // RUNNER_COMMAND_RUNNER_H_
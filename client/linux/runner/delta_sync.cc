@@ -0,0 +1,507 @@
+#include "delta_sync.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "transfer_engine.h"
+
+namespace {
+
+const char kSignatureMagic[4] = {'R', 'C', 'D', 'S'};
+const char kDeltaMagic[4] = {'R', 'C', 'D', 'D'};
+const uint32_t kDeltaVersion = 1;
+const size_t kSignatureHeaderSize = 24;
+const size_t kSignatureEntrySize = 12;
+const size_t kDeltaHeaderSize = 32;
+
+const uint8_t kOpCopy = 0x01;
+const uint8_t kOpLiteral = 0x02;
+
+// 每次 pread 的批量大小
+const size_t kReadBatch = 4 * 1024 * 1024;
+// 未匹配的字面数据攒到这么多就先输出，源文件读取窗口的大小因此有上限
+const size_t kMaxPendingLiteral = 4 * 1024 * 1024;
+
+bool PreadAll(int fd, uint8_t* data, size_t size, uint64_t offset) {
+  while (size > 0) {
+    ssize_t n = pread(fd, data, size, offset);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+    offset += n;
+  }
+  return true;
+}
+
+// 只读打开的普通文件，内容按需 pread
+class InputFile {
+ public:
+  ~InputFile() {
+    if (fd_ >= 0) {
+      close(fd_);
+    }
+  }
+
+  // allow_missing 为 true 时文件不存在视为空文件
+  bool Open(const std::string& path, bool allow_missing, std::string* error) {
+    fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd_ < 0) {
+      if (allow_missing && errno == ENOENT) {
+        return true;
+      }
+      *error = strerror(errno);
+      return false;
+    }
+    if (fstat(fd_, &st_) != 0 || !S_ISREG(st_.st_mode)) {
+      *error = "not a regular file";
+      return false;
+    }
+    size_ = st_.st_size;
+    if (size_ > 0) {
+      posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+    return true;
+  }
+
+  // 读取过程中文件被截短时失败
+  bool Read(uint64_t offset, uint8_t* data, size_t size, std::string* error) const {
+    errno = 0;
+    if (!PreadAll(fd_, data, size, offset)) {
+      *error = errno ? strerror(errno) : "file changed while reading";
+      return false;
+    }
+    return true;
+  }
+
+  uint64_t size() const { return size_; }
+  bool exists() const { return fd_ >= 0; }
+  mode_t mode() const { return st_.st_mode & 07777; }
+
+ private:
+  int fd_ = -1;
+  uint64_t size_ = 0;
+  struct stat st_ = {};
+};
+
+// 源文件的顺序读取窗口，缓冲 [start_, start_ + buffer_.size()) 这段数据。
+// 每个字节只读一次，按顺序计入整体哈希
+class SourceWindow {
+ public:
+  explicit SourceWindow(const InputFile& file) : file_(file) {}
+
+  // 保证 [from, to) 在窗口内，from 之前的数据可以丢弃
+  bool Fill(uint64_t from, uint64_t to, std::string* error) {
+    uint64_t end = start_ + buffer_.size();
+    if (to <= end) {
+      return true;
+    }
+    buffer_.erase(buffer_.begin(), buffer_.begin() + (from - start_));
+    start_ = from;
+    size_t length = static_cast<size_t>(std::min<uint64_t>(
+        std::max<uint64_t>(to - end, kReadBatch), file_.size() - end));
+    buffer_.resize(buffer_.size() + length);
+    uint8_t* target = buffer_.data() + (end - start_);
+    if (!file_.Read(end, target, length, error)) {
+      return false;
+    }
+    hash_.Update(target, length);
+    return true;
+  }
+
+  const uint8_t* At(uint64_t offset) const { return buffer_.data() + (offset - start_); }
+  uint64_t Digest() const { return hash_.Digest(); }
+
+ private:
+  const InputFile& file_;
+  std::vector<uint8_t> buffer_;
+  uint64_t start_ = 0;
+  Xxh64Stream hash_;
+};
+
+// rsync 的弱滚动校验：a 为字节和，b 为加权和，各取低 16 位
+struct RollingChecksum {
+  uint32_t a = 0;
+  uint32_t b = 0;
+  uint32_t length = 0;
+
+  void Reset(const uint8_t* data, uint32_t size) {
+    a = 0;
+    b = 0;
+    length = size;
+    for (uint32_t i = 0; i < size; i++) {
+      a += data[i];
+      b += (size - i) * data[i];
+    }
+  }
+
+  void Roll(uint8_t out, uint8_t in) {
+    a += in - out;
+    b += a - length * out;
+  }
+
+  uint32_t value() const { return (a & 0xffff) | (b << 16); }
+};
+
+void Put32(std::vector<uint8_t>* out, uint32_t value) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), p, p + 4);
+}
+
+void Put64(std::vector<uint8_t>* out, uint64_t value) {
+  const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+  out->insert(out->end(), p, p + 8);
+}
+
+uint32_t Get32(const uint8_t* p) {
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+uint64_t Get64(const uint8_t* p) {
+  uint64_t value;
+  memcpy(&value, p, 8);
+  return value;
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+}  // namespace
+
+uint32_t ChooseDeltaBlockSize(int64_t file_size) {
+  uint32_t size = static_cast<uint32_t>(std::sqrt(static_cast<double>(file_size)));
+  size = std::clamp<uint32_t>(size, 2048, 64 * 1024);
+  // 取 1 KB 的整数倍
+  return (size + 1023) & ~1023u;
+}
+
+bool ComputeSignature(const std::string& path, uint32_t block_size, std::vector<uint8_t>* signature,
+                      std::string* error) {
+  InputFile file;
+  if (!file.Open(path, true, error)) {
+    return false;
+  }
+  if (block_size == 0) {
+    block_size = ChooseDeltaBlockSize(file.size());
+  }
+  // 只对完整的块生成签名，末尾不足一块的数据在增量里作为字面数据
+  uint32_t count = static_cast<uint32_t>(file.size() / block_size);
+  signature->clear();
+  signature->reserve(kSignatureHeaderSize + count * kSignatureEntrySize);
+  signature->insert(signature->end(), kSignatureMagic, kSignatureMagic + 4);
+  Put32(signature, kDeltaVersion);
+  Put32(signature, block_size);
+  Put32(signature, count);
+  Put64(signature, file.size());
+  // 每批读入整数个块
+  const uint32_t batch_blocks = std::max<uint32_t>(1, kReadBatch / block_size);
+  std::vector<uint8_t> buffer(static_cast<size_t>(std::min(batch_blocks, count)) * block_size);
+  RollingChecksum rolling;
+  for (uint32_t first = 0; first < count; first += batch_blocks) {
+    uint32_t blocks = std::min(batch_blocks, count - first);
+    if (!file.Read(uint64_t(first) * block_size, buffer.data(), size_t(blocks) * block_size, error)) {
+      return false;
+    }
+    for (uint32_t i = 0; i < blocks; i++) {
+      const uint8_t* block = buffer.data() + static_cast<size_t>(i) * block_size;
+      rolling.Reset(block, block_size);
+      Put32(signature, rolling.value());
+      Put64(signature, XXH64(block, block_size));
+    }
+  }
+  return true;
+}
+
+bool ComputeDelta(const std::string& source_path, const std::vector<uint8_t>& signature,
+                  std::vector<uint8_t>* delta, DeltaStats* stats, std::string* error) {
+  if (signature.size() < kSignatureHeaderSize ||
+      memcmp(signature.data(), kSignatureMagic, 4) != 0 ||
+      Get32(signature.data() + 4) != kDeltaVersion) {
+    *error = "invalid signature";
+    return false;
+  }
+  uint32_t block_size = Get32(signature.data() + 8);
+  uint32_t count = Get32(signature.data() + 12);
+  if (block_size == 0 || signature.size() != kSignatureHeaderSize + size_t(count) * kSignatureEntrySize) {
+    *error = "invalid signature";
+    return false;
+  }
+  InputFile source;
+  if (!source.Open(source_path, false, error)) {
+    return false;
+  }
+  const uint64_t size = source.size();
+  SourceWindow window(source);
+
+  // 弱校验 -> 块序号，同一弱校验的块用 next 链起来；tags 用于快速排除绝大多数位置
+  std::vector<uint32_t> weak(count);
+  std::vector<uint64_t> strong(count);
+  std::vector<uint32_t> next(count, UINT32_MAX);
+  std::unordered_map<uint32_t, uint32_t> table;
+  table.reserve(count);
+  std::vector<uint8_t> tags(1 << 16, 0);
+  for (uint32_t i = count; i-- > 0;) {
+    const uint8_t* entry = signature.data() + kSignatureHeaderSize + size_t(i) * kSignatureEntrySize;
+    weak[i] = Get32(entry);
+    strong[i] = Get64(entry + 4);
+    auto it = table.find(weak[i]);
+    if (it != table.end()) {
+      next[i] = it->second;
+      it->second = i;
+    } else {
+      table.emplace(weak[i], i);
+    }
+    tags[(weak[i] ^ (weak[i] >> 16)) & 0xffff] = 1;
+  }
+
+  delta->clear();
+  delta->insert(delta->end(), kDeltaMagic, kDeltaMagic + 4);
+  Put32(delta, kDeltaVersion);
+  Put32(delta, block_size);
+  Put32(delta, 0);
+  Put64(delta, size);
+  // 整体哈希在读完源文件后回填
+  const size_t hash_offset = delta->size();
+  Put64(delta, 0);
+  *stats = DeltaStats();
+
+  // 相邻的匹配块合并成一条复制指令
+  uint32_t copy_start = 0;
+  uint32_t copy_count = 0;
+  auto flush_copy = [&]() {
+    if (copy_count > 0) {
+      delta->push_back(kOpCopy);
+      Put32(delta, copy_start);
+      Put32(delta, copy_count);
+      stats->copied_bytes += int64_t(copy_count) * block_size;
+      copy_count = 0;
+    }
+  };
+  auto emit_literal = [&](uint64_t begin, uint64_t end) {
+    while (begin < end) {
+      uint32_t length = static_cast<uint32_t>(std::min<uint64_t>(end - begin, kReadBatch));
+      if (!window.Fill(begin, begin + length, error)) {
+        return false;
+      }
+      const uint8_t* data = window.At(begin);
+      delta->push_back(kOpLiteral);
+      Put32(delta, length);
+      delta->insert(delta->end(), data, data + length);
+      stats->literal_bytes += length;
+      begin += length;
+    }
+    return true;
+  };
+
+  uint64_t literal_start = 0;
+  uint64_t pos = 0;
+  if (count > 0 && size >= block_size) {
+    RollingChecksum rolling;
+    if (!window.Fill(0, block_size, error)) {
+      return false;
+    }
+    rolling.Reset(window.At(0), block_size);
+    while (pos + block_size <= size) {
+      // 攒下的字面数据先输出，窗口只需保留当前块
+      if (pos - literal_start >= kMaxPendingLiteral) {
+        flush_copy();
+        if (!emit_literal(literal_start, pos)) {
+          return false;
+        }
+        literal_start = pos;
+      }
+      uint32_t value = rolling.value();
+      uint32_t matched = UINT32_MAX;
+      if (tags[(value ^ (value >> 16)) & 0xffff]) {
+        auto it = table.find(value);
+        if (it != table.end()) {
+          uint64_t hash = XXH64(window.At(pos), block_size);
+          // 优先延续上一条复制指令，便于合并
+          uint32_t expected = copy_start + copy_count;
+          if (copy_count > 0 && expected < count && weak[expected] == value &&
+              strong[expected] == hash) {
+            matched = expected;
+          } else {
+            for (uint32_t i = it->second; i != UINT32_MAX; i = next[i]) {
+              if (strong[i] == hash) {
+                matched = i;
+                break;
+              }
+            }
+          }
+        }
+      }
+      if (matched != UINT32_MAX) {
+        if (pos > literal_start) {
+          flush_copy();
+          if (!emit_literal(literal_start, pos)) {
+            return false;
+          }
+        }
+        if (copy_count > 0 && matched == copy_start + copy_count) {
+          copy_count++;
+        } else {
+          flush_copy();
+          copy_start = matched;
+          copy_count = 1;
+        }
+        pos += block_size;
+        literal_start = pos;
+        if (pos + block_size <= size) {
+          if (!window.Fill(literal_start, pos + block_size, error)) {
+            return false;
+          }
+          rolling.Reset(window.At(pos), block_size);
+        }
+      } else {
+        if (pos + block_size < size) {
+          if (!window.Fill(literal_start, pos + block_size + 1, error)) {
+            return false;
+          }
+          rolling.Roll(*window.At(pos), *window.At(pos + block_size));
+        }
+        pos++;
+      }
+    }
+  }
+  flush_copy();
+  if (!emit_literal(literal_start, size)) {
+    return false;
+  }
+  uint64_t hash = window.Digest();
+  memcpy(delta->data() + hash_offset, &hash, 8);
+  return true;
+}
+
+bool ApplyDelta(const std::string& target_path, const std::vector<uint8_t>& delta,
+                std::string* error) {
+  if (delta.size() < kDeltaHeaderSize || memcmp(delta.data(), kDeltaMagic, 4) != 0 ||
+      Get32(delta.data() + 4) != kDeltaVersion || Get32(delta.data() + 8) == 0) {
+    *error = "invalid delta";
+    return false;
+  }
+  const uint64_t block_size = Get32(delta.data() + 8);
+  const uint64_t expected_size = Get64(delta.data() + 16);
+  const uint64_t expected_hash = Get64(delta.data() + 24);
+
+  InputFile basis;
+  if (!basis.Open(target_path, true, error)) {
+    return false;
+  }
+  // 临时文件放在目标所在目录，改名才是原子的；名字唯一，并发应用同一目标互不干扰
+  size_t slash = target_path.find_last_of('/');
+  std::string dir = slash == std::string::npos ? "" : target_path.substr(0, slash + 1);
+  std::string temp_path = dir + "." + target_path.substr(dir.size()) + ".rcdelta.XXXXXX";
+  int fd = mkostemp(&temp_path[0], O_CLOEXEC);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  auto fail = [&](const std::string& message) {
+    *error = message;
+    close(fd);
+    unlink(temp_path.c_str());
+    return false;
+  };
+  if (fchmod(fd, basis.exists() ? basis.mode() : 0644) != 0) {
+    return fail(strerror(errno));
+  }
+
+  // 边写边计算整体哈希
+  Xxh64Stream hash;
+  auto write = [&](const uint8_t* data, size_t size) {
+    hash.Update(data, size);
+    return WriteAll(fd, data, size);
+  };
+  const uint64_t basis_blocks = basis.size() / block_size;
+  std::vector<uint8_t> buffer;
+  size_t pos = kDeltaHeaderSize;
+  uint64_t written = 0;
+  while (pos < delta.size()) {
+    uint8_t op = delta[pos++];
+    if (op == kOpCopy && pos + 8 <= delta.size()) {
+      uint64_t start = Get32(delta.data() + pos);
+      uint64_t blocks = Get32(delta.data() + pos + 4);
+      pos += 8;
+      // 先按块数比较，偏移和长度的乘法不会溢出
+      if (start > basis_blocks || blocks > basis_blocks - start) {
+        return fail("delta references data beyond the existing file");
+      }
+      uint64_t offset = start * block_size;
+      uint64_t length = blocks * block_size;
+      buffer.resize(std::min<uint64_t>(length, kReadBatch));
+      while (length > 0) {
+        size_t n = std::min<uint64_t>(length, buffer.size());
+        if (!basis.Read(offset, buffer.data(), n, error)) {
+          return fail(*error);
+        }
+        if (!write(buffer.data(), n)) {
+          return fail(strerror(errno));
+        }
+        offset += n;
+        length -= n;
+        written += n;
+      }
+    } else if (op == kOpLiteral && pos + 4 <= delta.size()) {
+      uint32_t length = Get32(delta.data() + pos);
+      pos += 4;
+      if (length > delta.size() - pos) {
+        return fail("truncated delta");
+      }
+      if (!write(delta.data() + pos, length)) {
+        return fail(strerror(errno));
+      }
+      pos += length;
+      written += length;
+    } else {
+      return fail("invalid delta");
+    }
+  }
+  if (written != expected_size) {
+    return fail("reconstructed size mismatch");
+  }
+  if (hash.Digest() != expected_hash) {
+    return fail("checksum mismatch after reconstruction");
+  }
+  if (fsync(fd) != 0) {
+    return fail(strerror(errno));
+  }
+  close(fd);
+  if (rename(temp_path.c_str(), target_path.c_str()) != 0) {
+    *error = strerror(errno);
+    unlink(temp_path.c_str());
+    return false;
+  }
+  int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  return true;
+}
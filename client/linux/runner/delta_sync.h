@@ -0,0 +1,37 @@
+#ifndef RUNNER_DELTA_SYNC_H_
+#define RUNNER_DELTA_SYNC_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// rsync 式增量同步，分三步：
+//   1. 目标端对现有文件按固定块大小计算签名（弱滚动校验 + xxHash64）
+//   2. 源端用签名扫描新文件，能在目标端找到的块记为复制指令，其余作为字面数据
+//   3. 目标端按增量重建到临时文件，校验整体哈希后 fsync 并改名替换
+//
+// 签名格式（小端）："RCDS"、u32 版本、u32 块大小、u32 块数、u64 文件大小，之后每块 u32 弱校验、u64 强校验
+// 增量格式：         "RCDD"、u32 版本、u32 块大小、u32 保留、u64 新文件大小、u64 新文件 xxHash64，之后是指令：
+//   0x01 复制：u32 起始块、u32 连续块数
+//   0x02 字面：u32 长度，再跟数据
+
+struct DeltaStats {
+  int64_t copied_bytes = 0;
+  int64_t literal_bytes = 0;
+};
+
+// 根据文件大小选择块大小：约为大小的平方根，限制在 2 KB 到 64 KB
+uint32_t ChooseDeltaBlockSize(int64_t file_size);
+
+// 文件不存在时生成空签名，增量会全部是字面数据。block_size 为 0 时自动选择
+bool ComputeSignature(const std::string& path, uint32_t block_size, std::vector<uint8_t>* signature,
+                      std::string* error);
+
+bool ComputeDelta(const std::string& source_path, const std::vector<uint8_t>& signature,
+                  std::vector<uint8_t>* delta, DeltaStats* stats, std::string* error);
+
+// 以 target_path 现有内容为基础应用增量，成功后原子替换 target_path
+bool ApplyDelta(const std::string& target_path, const std::vector<uint8_t>& delta,
+                std::string* error);
+
+#endif  // RUNNER_DELTA_SYNC_H_
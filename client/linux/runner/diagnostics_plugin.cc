@@ -0,0 +1,116 @@
+#include "diagnostics_plugin.h"
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_linux.h>
+#include <flutter/standard_method_codec.h>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+#include "async_method.h"
+#include "latency_probe.h"
+
+class DiagnosticsPlugin : public flutter::Plugin {
+ public:
+  static std::unique_ptr<DiagnosticsPlugin> Create(flutter::BinaryMessenger *messenger);
+
+  DiagnosticsPlugin();
+
+  virtual ~DiagnosticsPlugin();
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // 在工作线程上运行，使用自己的 X 连接，不访问插件状态
+  static flutter::EncodableValue RunProbe(const LatencyProbeOptions& options,
+                                          std::string* error);
+};
+
+// static
+std::unique_ptr<DiagnosticsPlugin> DiagnosticsPlugin::Create(
+    flutter::BinaryMessenger *messenger) {
+  auto channel =
+      std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+          messenger, "diagnostics",
+          &flutter::StandardMethodCodec::GetInstance());
+
+  auto plugin = std::make_unique<DiagnosticsPlugin>();
+
+  channel->SetMethodCallHandler(
+      [plugin_pointer = plugin.get()](const auto &call, auto result) {
+        plugin_pointer->HandleMethodCall(call, std::move(result));
+      });
+
+  return plugin;
+}
+
+DiagnosticsPlugin::DiagnosticsPlugin() {}
+
+DiagnosticsPlugin::~DiagnosticsPlugin() {}
+
+void DiagnosticsPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+
+  if (method_call.method_name().compare("runLatencyProbe") == 0) {
+    LatencyProbeOptions options;
+    if (args) {
+      auto samples = args->find(flutter::EncodableValue("samples"));
+      if (samples != args->end() && std::holds_alternative<int32_t>(samples->second)) {
+        options.samples = std::get<int32_t>(samples->second);
+      }
+      auto timeout = args->find(flutter::EncodableValue("timeoutMs"));
+      if (timeout != args->end() && std::holds_alternative<int32_t>(timeout->second)) {
+        options.timeout_ms = std::get<int32_t>(timeout->second);
+      }
+    }
+    // 每个样本都要等一次屏幕更新，整个探针放到共享工作池执行；限制采样数避免长时间占用工作线程
+    options.samples = std::max(1, std::min(options.samples, 200));
+
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [options]() {
+      std::string error;
+      auto report = RunProbe(options, &error);
+      if (!error.empty()) {
+        return MethodOutcome::Fail("PROBE_FAILED", error);
+      }
+      return MethodOutcome::Ok(report);
+    });
+  } else {
+    result->NotImplemented();
+  }
+}
+
+flutter::EncodableValue DiagnosticsPlugin::RunProbe(const LatencyProbeOptions& options,
+                                                    std::string* error) {
+  LatencyProbeReport report;
+  if (!RunLatencyProbe(options, &report)) {
+    *error = report.error;
+    return flutter::EncodableValue();
+  }
+
+  flutter::EncodableMap response;
+  response[flutter::EncodableValue("samples")] =
+      flutter::EncodableValue(static_cast<int32_t>(report.samples_ms.size()));
+  response[flutter::EncodableValue("timeouts")] = flutter::EncodableValue(report.timeouts);
+  response[flutter::EncodableValue("damage")] = flutter::EncodableValue(report.used_damage);
+  response[flutter::EncodableValue("minMs")] = flutter::EncodableValue(report.min_ms);
+  response[flutter::EncodableValue("meanMs")] = flutter::EncodableValue(report.mean_ms);
+  response[flutter::EncodableValue("p50Ms")] = flutter::EncodableValue(report.p50_ms);
+  response[flutter::EncodableValue("p90Ms")] = flutter::EncodableValue(report.p90_ms);
+  response[flutter::EncodableValue("p99Ms")] = flutter::EncodableValue(report.p99_ms);
+  response[flutter::EncodableValue("maxMs")] = flutter::EncodableValue(report.max_ms);
+  response[flutter::EncodableValue("samplesMs")] = flutter::EncodableValue(report.samples_ms);
+  return flutter::EncodableValue(response);
+}
+
+void RegisterDiagnosticsPlugin(flutter::PluginRegistrarLinux *registrar) {
+  registrar->AddPlugin(DiagnosticsPlugin::Create(registrar->messenger()));
+}
+
+std::unique_ptr<flutter::Plugin> CreateDiagnosticsPlugin(flutter::BinaryMessenger *messenger) {
+  return DiagnosticsPlugin::Create(messenger);
+}
@@ -0,0 +1,635 @@
+#include "dir_archive.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const size_t kBlockSize = 512;
+// 攒够这么多 tar 数据才交给压缩器，攒够这么多压缩数据才入队
+const size_t kTarBatch = 1024 * 1024;
+const size_t kQueueBlock = 256 * 1024;
+// 队列最多缓存的压缩块数
+const size_t kMaxQueuedBlocks = 8;
+const size_t kReadBuffer = 1024 * 1024;
+// ustar 的 size 字段是 11 位八进制
+const uint64_t kMaxUstarSize = 077777777777ULL;
+// PAX 扩展头和 GNU 长路径条目整体缓存在内存里，超过这个大小视为恶意
+const uint64_t kMaxExtensionSize = 1024 * 1024;
+
+void PutOctal(uint8_t* field, size_t width, uint64_t value) {
+  snprintf(reinterpret_cast<char*>(field), width, "%0*llo", static_cast<int>(width - 1),
+           static_cast<unsigned long long>(value));
+}
+
+uint64_t ParseOctal(const uint8_t* field, size_t width) {
+  uint64_t value = 0;
+  size_t i = 0;
+  while (i < width && field[i] == ' ') {
+    i++;
+  }
+  for (; i < width && field[i] >= '0' && field[i] <= '7'; i++) {
+    value = value * 8 + (field[i] - '0');
+  }
+  return value;
+}
+
+// PAX 记录格式为 "<长度> <键>=<值>\n"，长度包括自身的位数
+void AppendPaxRecord(std::string* data, const std::string& key, const std::string& value) {
+  size_t body = key.size() + value.size() + 3;
+  size_t length = body + std::to_string(body).size();
+  if (std::to_string(length).size() != std::to_string(body).size()) {
+    length++;
+  }
+  *data += std::to_string(length) + " " + key + "=" + value + "\n";
+}
+
+std::string JoinPath(const std::string& dir, const std::string& name) {
+  return !dir.empty() && dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+// 十进制无符号整数，必须整个字符串都是数字且不溢出
+bool ParseDecimal(const std::string& text, uint64_t* value) {
+  if (text.empty() || text.size() > 20) {
+    return false;
+  }
+  uint64_t result = 0;
+  for (char c : text) {
+    if (c < '0' || c > '9') {
+      return false;
+    }
+    uint64_t digit = c - '0';
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  *value = result;
+  return true;
+}
+
+// 符号链接目标只能以 ".." 开头向上，层数不超过链接所在目录在解压目录下的深度 depth，
+// 之后只能向下。链接所在的各级目录都是真实目录（条目路径不跟随链接），向下经过的链接也满足同样的规则，
+// 所以链接之间怎样串联都不会离开解压目录；"x/.." 这类先经过可能是链接的 x 再向上的目标一律拒绝
+bool SafeLinkTarget(const std::string& target, size_t depth) {
+  if (target.empty() || target[0] == '/') {
+    return false;
+  }
+  size_t ups = 0;
+  bool descending = false;
+  size_t pos = 0;
+  while (pos < target.size()) {
+    size_t slash = target.find('/', pos);
+    size_t end = slash == std::string::npos ? target.size() : slash;
+    std::string part = target.substr(pos, end - pos);
+    pos = end + 1;
+    if (part == "..") {
+      if (descending || ++ups > depth) {
+        return false;
+      }
+    } else if (!part.empty() && part != ".") {
+      descending = true;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+DirArchiveReader::DirArchiveReader() {}
+
+DirArchiveReader::~DirArchiveReader() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (producer_.joinable()) {
+    producer_.join();
+  }
+}
+
+bool DirArchiveReader::Start(const std::string& root, int level, std::string* error) {
+  struct stat st;
+  if (stat(root.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    *error = "not a directory";
+    return false;
+  }
+  compressor_ = std::make_unique<ZstdCompressor>(level);
+  level_ = compressor_->level();
+  producer_ = std::thread(&DirArchiveReader::Run, this, root);
+  return true;
+}
+
+bool DirArchiveReader::Next(std::vector<uint8_t>* block, std::string* error) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return !queue_.empty() || done_; });
+  block->clear();
+  if (!queue_.empty()) {
+    block->swap(queue_.front());
+    queue_.pop_front();
+    cv_.notify_all();
+    return true;
+  }
+  if (!error_.empty()) {
+    *error = error_;
+    return false;
+  }
+  return true;
+}
+
+void DirArchiveReader::Run(std::string root) {
+  while (root.size() > 1 && root.back() == '/') {
+    root.pop_back();
+  }
+  std::string base = root.substr(root.find_last_of('/') + 1);
+  if (base.empty()) {
+    base = "root";
+  }
+  read_buffer_.resize(kReadBuffer);
+
+  // 目录先于其内容写入，解包时可以直接创建
+  std::vector<std::pair<std::string, std::string>> stack = {{root, base}};
+  bool ok = true;
+  while (ok && !stack.empty()) {
+    std::string path = std::move(stack.back().first);
+    std::string name = std::move(stack.back().second);
+    stack.pop_back();
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) {
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      ok = WriteHeader(name + "/", '5', 0, st.st_mode & 07777, st.st_mtime, "");
+      DIR* dir = opendir(path.c_str());
+      if (!dir) {
+        continue;
+      }
+      while (struct dirent* entry = readdir(dir)) {
+        const char* child = entry->d_name;
+        if (child[0] == '.' && (child[1] == '\0' || (child[1] == '.' && child[2] == '\0'))) {
+          continue;
+        }
+        stack.emplace_back(JoinPath(path, child), name + "/" + child);
+      }
+      closedir(dir);
+    } else {
+      ok = AddEntry(path, name);
+    }
+  }
+  if (ok) {
+    // 两个全零块表示归档结束
+    std::vector<uint8_t> end(kBlockSize * 2, 0);
+    ok = Append(end.data(), end.size()) && Emit(ZstdCompressor::Mode::kEnd);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ok && error_.empty()) {
+    error_ = stopping_ ? "cancelled" : "compression failed";
+  }
+  done_ = true;
+  cv_.notify_all();
+}
+
+bool DirArchiveReader::AddEntry(const std::string& path, const std::string& name) {
+  struct stat st;
+  if (lstat(path.c_str(), &st) != 0) {
+    return true;
+  }
+  if (S_ISLNK(st.st_mode)) {
+    std::vector<char> link(st.st_size + 1, '\0');
+    ssize_t length = readlink(path.c_str(), link.data(), st.st_size);
+    if (length < 0) {
+      return true;
+    }
+    files_++;
+    return WriteHeader(name, '2', 0, st.st_mode & 07777, st.st_mtime,
+                       std::string(link.data(), length));
+  }
+  if (!S_ISREG(st.st_mode)) {
+    return true;
+  }
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    // 打不开的文件跳过，不影响其余内容
+    return true;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  uint64_t size = st.st_size;
+  if (!WriteHeader(name, '0', size, st.st_mode & 07777, st.st_mtime, "")) {
+    close(fd);
+    return false;
+  }
+  // 读取期间文件变短时补零，变长时只写声明的长度，保证归档结构完整
+  uint64_t written = 0;
+  while (written < size) {
+    ssize_t n = read(fd, read_buffer_.data(), std::min<uint64_t>(read_buffer_.size(), size - written));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    if (!Append(read_buffer_.data(), n)) {
+      close(fd);
+      return false;
+    }
+    written += n;
+  }
+  close(fd);
+  while (written < size) {
+    size_t n = std::min<uint64_t>(read_buffer_.size(), size - written);
+    std::fill(read_buffer_.begin(), read_buffer_.begin() + n, 0);
+    if (!Append(read_buffer_.data(), n)) {
+      return false;
+    }
+    written += n;
+  }
+  size_t padding = (kBlockSize - size % kBlockSize) % kBlockSize;
+  static const uint8_t kZeros[kBlockSize] = {};
+  files_++;
+  return Append(kZeros, padding);
+}
+
+bool DirArchiveReader::WriteHeader(const std::string& name, char type, uint64_t size,
+                                   uint32_t mode, int64_t mtime, const std::string& link) {
+  std::string pax;
+  if (name.size() > 100) {
+    AppendPaxRecord(&pax, "path", name);
+  }
+  if (link.size() > 100) {
+    AppendPaxRecord(&pax, "linkpath", link);
+  }
+  if (size > kMaxUstarSize) {
+    AppendPaxRecord(&pax, "size", std::to_string(size));
+  }
+  if (!pax.empty()) {
+    if (!WriteHeader("PaxHeader", 'x', pax.size(), 0644, mtime, "")) {
+      return false;
+    }
+    std::vector<uint8_t> data(pax.begin(), pax.end());
+    data.resize((data.size() + kBlockSize - 1) / kBlockSize * kBlockSize, 0);
+    if (!Append(data.data(), data.size())) {
+      return false;
+    }
+  }
+
+  uint8_t header[kBlockSize] = {};
+  memcpy(header, name.data(), std::min<size_t>(name.size(), 100));
+  PutOctal(header + 100, 8, mode);
+  PutOctal(header + 108, 8, 0);
+  PutOctal(header + 116, 8, 0);
+  PutOctal(header + 124, 12, size > kMaxUstarSize ? 0 : size);
+  PutOctal(header + 136, 12, mtime > 0 ? mtime : 0);
+  header[156] = type;
+  memcpy(header + 157, link.data(), std::min<size_t>(link.size(), 100));
+  memcpy(header + 257, "ustar", 6);
+  memcpy(header + 263, "00", 2);
+  memset(header + 148, ' ', 8);
+  unsigned int checksum = 0;
+  for (uint8_t byte : header) {
+    checksum += byte;
+  }
+  snprintf(reinterpret_cast<char*>(header + 148), 8, "%06o", checksum);
+  return Append(header, kBlockSize);
+}
+
+bool DirArchiveReader::Append(const uint8_t* data, size_t size) {
+  tar_buffer_.insert(tar_buffer_.end(), data, data + size);
+  bytes_in_ += size;
+  return tar_buffer_.size() < kTarBatch || Emit(ZstdCompressor::Mode::kContinue);
+}
+
+bool DirArchiveReader::Emit(ZstdCompressor::Mode mode) {
+  std::string error;
+  if (!compressor_->Compress(tar_buffer_.data(), tar_buffer_.size(), mode, &compressed_, &error)) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    error_ = error;
+    return false;
+  }
+  tar_buffer_.clear();
+  level_ = compressor_->level();
+  if (compressed_.size() < kQueueBlock && mode != ZstdCompressor::Mode::kEnd) {
+    return true;
+  }
+  // 队列满时等待读取方，等待时间会让自适应压缩提高级别
+  std::unique_lock<std::mutex> lock(mutex_);
+  cv_.wait(lock, [this]() { return queue_.size() < kMaxQueuedBlocks || stopping_; });
+  if (stopping_) {
+    return false;
+  }
+  bytes_out_ += compressed_.size();
+  queue_.push_back(std::move(compressed_));
+  compressed_ = std::vector<uint8_t>();
+  cv_.notify_all();
+  return true;
+}
+
+DirArchiveExtractor::~DirArchiveExtractor() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+  if (root_fd_ >= 0) {
+    close(root_fd_);
+  }
+}
+
+bool DirArchiveExtractor::Open(const std::string& destination, std::string* error) {
+  if (mkdir(destination.c_str(), 0755) != 0 && errno != EEXIST) {
+    *error = strerror(errno);
+    return false;
+  }
+  // 之后所有条目都相对这个目录逐级打开，不再按路径字符串访问
+  root_fd_ = open(destination.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (root_fd_ < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool DirArchiveExtractor::Write(const uint8_t* data, size_t size, std::string* error) {
+  // 分段解压，每段解出后立即写盘，高压缩比的数据不会在内存里整体展开
+  return decompressor_.Decompress(
+      data, size, [this, error](const uint8_t* plain, size_t n) { return Consume(plain, n, error); },
+      error);
+}
+
+bool DirArchiveExtractor::Consume(const uint8_t* data, size_t size, std::string* error) {
+  size_t pos = 0;
+  while (pos < size) {
+    switch (state_) {
+      case State::kHeader: {
+        size_t n = std::min(size - pos, kBlockSize - header_fill_);
+        memcpy(header_ + header_fill_, data + pos, n);
+        header_fill_ += n;
+        pos += n;
+        if (header_fill_ < kBlockSize) {
+          break;
+        }
+        header_fill_ = 0;
+        if (std::all_of(header_, header_ + kBlockSize, [](uint8_t b) { return b == 0; })) {
+          if (++zero_blocks_ == 2) {
+            state_ = State::kEnd;
+          }
+          break;
+        }
+        zero_blocks_ = 0;
+        if (!BeginEntry(error)) {
+          return false;
+        }
+        break;
+      }
+      case State::kData: {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(size - pos, remaining_));
+        if (type_ == 'x' || type_ == 'L' || type_ == 'K') {
+          pax_data_.append(reinterpret_cast<const char*>(data + pos), n);
+        } else if (fd_ >= 0) {
+          size_t written = 0;
+          while (written < n) {
+            ssize_t w = write(fd_, data + pos + written, n - written);
+            if (w < 0 && errno == EINTR) {
+              continue;
+            }
+            if (w < 0) {
+              *error = name_ + ": " + strerror(errno);
+              return false;
+            }
+            written += w;
+          }
+          bytes_out_ += n;
+        }
+        pos += n;
+        remaining_ -= n;
+        if (remaining_ == 0 && !FinishEntry(error)) {
+          return false;
+        }
+        break;
+      }
+      case State::kPadding: {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(size - pos, padding_));
+        pos += n;
+        padding_ -= n;
+        if (padding_ == 0) {
+          state_ = State::kHeader;
+        }
+        break;
+      }
+      case State::kEnd:
+        // 结束标记之后的填充数据忽略
+        return true;
+    }
+  }
+  return true;
+}
+
+bool DirArchiveExtractor::BeginEntry(std::string* error) {
+  unsigned int expected = static_cast<unsigned int>(ParseOctal(header_ + 148, 8));
+  unsigned int checksum = 0;
+  for (size_t i = 0; i < kBlockSize; i++) {
+    checksum += (i >= 148 && i < 156) ? ' ' : header_[i];
+  }
+  if (checksum != expected) {
+    *error = "corrupt archive header";
+    return false;
+  }
+
+  type_ = static_cast<char>(header_[156]);
+  std::string name(reinterpret_cast<const char*>(header_), strnlen(reinterpret_cast<const char*>(header_), 100));
+  std::string prefix(reinterpret_cast<const char*>(header_ + 345),
+                     strnlen(reinterpret_cast<const char*>(header_ + 345), 155));
+  if (!prefix.empty()) {
+    name = prefix + "/" + name;
+  }
+  link_ = std::string(reinterpret_cast<const char*>(header_ + 157),
+                      strnlen(reinterpret_cast<const char*>(header_ + 157), 100));
+  uint64_t size = ParseOctal(header_ + 124, 12);
+  mode_ = static_cast<uint32_t>(ParseOctal(header_ + 100, 8));
+  mtime_ = static_cast<int64_t>(ParseOctal(header_ + 136, 12));
+  bool extension = type_ == 'x' || type_ == 'g' || type_ == 'L' || type_ == 'K';
+  if (!extension) {
+    // PAX 扩展头的值覆盖本条目的对应字段
+    if (!pax_path_.empty()) {
+      name = pax_path_;
+    }
+    if (!pax_link_.empty()) {
+      link_ = pax_link_;
+    }
+    if (pax_size_set_) {
+      size = pax_size_;
+    }
+    pax_path_.clear();
+    pax_link_.clear();
+    pax_size_set_ = false;
+  }
+  if ((type_ == 'x' || type_ == 'L' || type_ == 'K') && size > kMaxExtensionSize) {
+    *error = "pax header too large";
+    return false;
+  }
+  name_ = name;
+  remaining_ = size;
+  padding_ = (kBlockSize - size % kBlockSize) % kBlockSize;
+
+  if (type_ == 'x' || type_ == 'L' || type_ == 'K') {
+    pax_data_.clear();
+  } else if (type_ == '5' || type_ == '0' || type_ == '\0' || type_ == '2') {
+    std::vector<std::string> parts;
+    if (!SafePath(name, &parts)) {
+      *error = "unsafe path in archive: " + name;
+      return false;
+    }
+    if (type_ == '2' && !SafeLinkTarget(link_, parts.size() - 1)) {
+      *error = "unsafe link in archive: " + name + " -> " + link_;
+      return false;
+    }
+    int parent = OpenParent(parts);
+    if (parent < 0) {
+      *error = name + ": " + strerror(errno);
+      return false;
+    }
+    const char* leaf = parts.back().c_str();
+    bool ok = true;
+    if (type_ == '5') {
+      // 不保留 setuid、setgid 和粘滞位
+      ok = mkdirat(parent, leaf, (mode_ & 0777) | 0700) == 0 || errno == EEXIST;
+    } else if (type_ == '2') {
+      unlinkat(parent, leaf, 0);
+      ok = symlinkat(link_.c_str(), parent, leaf) == 0;
+      files_++;
+    } else {
+      // O_NOFOLLOW：已存在的同名符号链接不会被跟随，而是先删除再创建普通文件
+      int flags = O_WRONLY | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC;
+      fd_ = openat(parent, leaf, flags, mode_ & 0777);
+      if (fd_ < 0 && errno == ELOOP && unlinkat(parent, leaf, 0) == 0) {
+        fd_ = openat(parent, leaf, flags, mode_ & 0777);
+      }
+      ok = fd_ >= 0;
+      files_++;
+    }
+    int saved_errno = errno;
+    if (parent != root_fd_) {
+      close(parent);
+    }
+    if (!ok) {
+      *error = name + ": " + strerror(saved_errno);
+      return false;
+    }
+  }
+  // 其余类型（设备文件等）只跳过数据
+  state_ = State::kData;
+  if (remaining_ == 0) {
+    return FinishEntry(error);
+  }
+  return true;
+}
+
+bool DirArchiveExtractor::FinishEntry(std::string* error) {
+  if (type_ == 'L' || type_ == 'K') {
+    // GNU tar 的长路径条目，数据就是以 NUL 结尾的路径
+    std::string value = pax_data_.substr(0, pax_data_.find('\0'));
+    (type_ == 'L' ? pax_path_ : pax_link_) = value;
+  } else if (type_ == 'x') {
+    size_t pos = 0;
+    while (pos < pax_data_.size()) {
+      size_t space = pax_data_.find(' ', pos);
+      uint64_t length = 0;
+      // 记录至少包含长度、空格、"k=" 和换行
+      if (space == std::string::npos || !ParseDecimal(pax_data_.substr(pos, space - pos), &length) ||
+          length < space - pos + 4 || length > pax_data_.size() - pos ||
+          pax_data_[pos + length - 1] != '\n') {
+        *error = "malformed pax header";
+        return false;
+      }
+      std::string record = pax_data_.substr(space + 1, pos + length - space - 2);
+      size_t equals = record.find('=');
+      if (equals == std::string::npos) {
+        *error = "malformed pax header";
+        return false;
+      }
+      std::string key = record.substr(0, equals);
+      std::string value = record.substr(equals + 1);
+      if (key == "path") {
+        pax_path_ = value;
+      } else if (key == "linkpath") {
+        pax_link_ = value;
+      } else if (key == "size") {
+        if (!ParseDecimal(value, &pax_size_)) {
+          *error = "malformed pax header";
+          return false;
+        }
+        pax_size_set_ = true;
+      }
+      pos += length;
+    }
+  } else if (fd_ >= 0) {
+    struct timespec times[2] = {{0, UTIME_OMIT}, {mtime_, 0}};
+    futimens(fd_, times);
+    if (close(fd_) != 0) {
+      fd_ = -1;
+      *error = name_ + ": " + strerror(errno);
+      return false;
+    }
+    fd_ = -1;
+  }
+  state_ = padding_ > 0 ? State::kPadding : State::kHeader;
+  return true;
+}
+
+bool DirArchiveExtractor::SafePath(const std::string& name,
+                                   std::vector<std::string>* parts) const {
+  size_t pos = 0;
+  while (pos < name.size()) {
+    size_t slash = name.find('/', pos);
+    std::string part = name.substr(pos, slash == std::string::npos ? std::string::npos : slash - pos);
+    pos = slash == std::string::npos ? name.size() : slash + 1;
+    if (part.empty() || part == ".") {
+      continue;
+    }
+    if (part == "..") {
+      return false;
+    }
+    parts->push_back(part);
+  }
+  return !parts->empty();
+}
+
+int DirArchiveExtractor::OpenParent(const std::vector<std::string>& parts) const {
+  int dir = root_fd_;
+  for (size_t i = 0; i + 1 < parts.size(); i++) {
+    const char* part = parts[i].c_str();
+    // 中间目录不存在时创建；是符号链接时 O_NOFOLLOW 让打开失败，不会被带出解压目录
+    int next = openat(dir, part, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (next < 0 && errno == ENOENT && (mkdirat(dir, part, 0755) == 0 || errno == EEXIST)) {
+      next = openat(dir, part, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    }
+    int saved_errno = errno;
+    if (dir != root_fd_) {
+      close(dir);
+    }
+    if (next < 0) {
+      errno = saved_errno;
+      return -1;
+    }
+    dir = next;
+  }
+  return dir;
+}
+
+bool DirArchiveExtractor::Finish(std::string* error) {
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  if (state_ != State::kEnd || !decompressor_.frame_complete()) {
+    *error = "archive truncated";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,118 @@
+#ifndef RUNNER_DIR_ARCHIVE_H_
+#define RUNNER_DIR_ARCHIVE_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "zstd_stream.h"
+
+// 把整个目录打包成 tar 并用 zstd 压缩，边遍历边读文件边压缩，不在磁盘上生成中间文件。
+// 后台线程产生压缩数据放入有界队列，队列满时等待读取方，内存占用固定。
+// 归档内的路径以目录名开头；超过 ustar 限制的路径和大小用 PAX 扩展头记录。
+class DirArchiveReader {
+ public:
+  DirArchiveReader();
+  ~DirArchiveReader();
+
+  // level 为 0 时自适应
+  bool Start(const std::string& root, int level, std::string* error);
+  // 取下一段压缩数据，必要时等待。归档结束返回 true 且 block 为空
+  bool Next(std::vector<uint8_t>* block, std::string* error);
+
+  int64_t files() const { return files_; }
+  int64_t bytes_in() const { return bytes_in_; }
+  int64_t bytes_out() const { return bytes_out_; }
+  int level() const { return level_; }
+
+ private:
+  void Run(std::string root);
+  bool AddEntry(const std::string& path, const std::string& name);
+  bool WriteHeader(const std::string& name, char type, uint64_t size, uint32_t mode,
+                   int64_t mtime, const std::string& link);
+  bool Append(const uint8_t* data, size_t size);
+  bool Emit(ZstdCompressor::Mode mode);
+
+  std::unique_ptr<ZstdCompressor> compressor_;
+  std::thread producer_;
+  // 待压缩的 tar 数据和已压缩待入队的数据，只由后台线程访问
+  std::vector<uint8_t> tar_buffer_;
+  std::vector<uint8_t> compressed_;
+  std::vector<uint8_t> read_buffer_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::vector<uint8_t>> queue_;
+  bool done_ = false;
+  bool stopping_ = false;
+  std::string error_;
+
+  std::atomic<int64_t> files_{0};
+  std::atomic<int64_t> bytes_in_{0};
+  std::atomic<int64_t> bytes_out_{0};
+  std::atomic<int> level_{0};
+};
+
+// DirArchiveReader 的逆过程：按顺序接收压缩数据，边解压边解出到目标目录。
+// 拒绝包含 ".." 的条目，以及指向绝对路径或可能离开目标目录的符号链接。
+// 每个条目都从目标目录的 fd 起逐级用 O_NOFOLLOW 打开，路径中途的符号链接不会被跟随。
+class DirArchiveExtractor {
+ public:
+  DirArchiveExtractor() {}
+  ~DirArchiveExtractor();
+
+  DirArchiveExtractor(const DirArchiveExtractor&) = delete;
+  DirArchiveExtractor& operator=(const DirArchiveExtractor&) = delete;
+
+  bool Open(const std::string& destination, std::string* error);
+  bool Write(const uint8_t* data, size_t size, std::string* error);
+  // 检查归档完整结束
+  bool Finish(std::string* error);
+
+  int64_t files() const { return files_; }
+  int64_t bytes_out() const { return bytes_out_; }
+
+ private:
+  bool Consume(const uint8_t* data, size_t size, std::string* error);
+  bool BeginEntry(std::string* error);
+  bool FinishEntry(std::string* error);
+  // 拆成路径各级名称，去掉空段和 "."
+  bool SafePath(const std::string& name, std::vector<std::string>* parts) const;
+  // 打开条目的上级目录，缺少的中间目录会被创建。返回 root_fd_ 时调用方不要关闭
+  int OpenParent(const std::vector<std::string>& parts) const;
+
+  int root_fd_ = -1;
+  ZstdDecompressor decompressor_;
+
+  // tar 解析状态
+  enum class State { kHeader, kData, kPadding, kEnd };
+  State state_ = State::kHeader;
+  uint8_t header_[512];
+  size_t header_fill_ = 0;
+  uint64_t remaining_ = 0;
+  uint64_t padding_ = 0;
+  char type_ = 0;
+  std::string name_;
+  std::string link_;
+  uint32_t mode_ = 0;
+  int64_t mtime_ = 0;
+  std::string pax_data_;
+  // 来自 PAX 扩展头或 GNU 长路径条目，作用于下一个条目
+  std::string pax_path_;
+  std::string pax_link_;
+  bool pax_size_set_ = false;
+  uint64_t pax_size_ = 0;
+  int fd_ = -1;
+  int zero_blocks_ = 0;
+
+  int64_t files_ = 0;
+  int64_t bytes_out_ = 0;
+};
+
+#endif  // RUNNER_DIR_ARCHIVE_H_
@@ -0,0 +1,186 @@
+#include "dir_lister.h"
+
+#include <fcntl.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <numeric>
+
+namespace {
+
+// getdents64 返回的目录项布局
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+const size_t kDirentBufferSize = 64 * 1024;
+
+bool ContainsIgnoreCase(const char* name, const std::string& needle) {
+  size_t length = strlen(name);
+  if (needle.size() > length) {
+    return false;
+  }
+  for (size_t i = 0; i + needle.size() <= length; i++) {
+    if (strncasecmp(name + i, needle.c_str(), needle.size()) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 取类型、大小和修改时间。符号链接按目标计算，与文件管理器的显示一致；悬空链接退回链接本身
+bool StatEntry(int dir_fd, const char* name, uint8_t* type, int64_t* size, int64_t* modified) {
+  // 列举会在多个工作线程上并行进行，只是一个提示标志，relaxed 即可
+  static std::atomic<bool> statx_supported{true};
+  if (statx_supported.load(std::memory_order_relaxed)) {
+    struct statx stx;
+    const unsigned int mask = STATX_TYPE | STATX_SIZE | STATX_MTIME;
+    int rc = statx(dir_fd, name, AT_STATX_DONT_SYNC, mask, &stx);
+    if (rc != 0 && errno == ENOENT) {
+      rc = statx(dir_fd, name, AT_SYMLINK_NOFOLLOW | AT_STATX_DONT_SYNC, mask, &stx);
+    }
+    if (rc == 0) {
+      *type = S_ISDIR(stx.stx_mode) ? static_cast<uint8_t>(DirEntryType::kDirectory)
+              : S_ISREG(stx.stx_mode) ? static_cast<uint8_t>(DirEntryType::kFile)
+                                      : static_cast<uint8_t>(DirEntryType::kOther);
+      *size = S_ISDIR(stx.stx_mode) ? 0 : static_cast<int64_t>(stx.stx_size);
+      *modified = stx.stx_mtime.tv_sec;
+      return true;
+    }
+    if (errno != ENOSYS) {
+      return false;
+    }
+    statx_supported.store(false, std::memory_order_relaxed);
+  }
+  struct stat st;
+  if (fstatat(dir_fd, name, &st, 0) != 0 &&
+      fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+    return false;
+  }
+  *type = S_ISDIR(st.st_mode) ? static_cast<uint8_t>(DirEntryType::kDirectory)
+          : S_ISREG(st.st_mode) ? static_cast<uint8_t>(DirEntryType::kFile)
+                                : static_cast<uint8_t>(DirEntryType::kOther);
+  *size = S_ISDIR(st.st_mode) ? 0 : static_cast<int64_t>(st.st_size);
+  *modified = st.st_mtime;
+  return true;
+}
+
+template <typename T>
+void ApplyOrder(const std::vector<uint32_t>& order, std::vector<T>* column) {
+  std::vector<T> sorted;
+  sorted.reserve(column->size());
+  for (uint32_t index : order) {
+    sorted.push_back(std::move((*column)[index]));
+  }
+  column->swap(sorted);
+}
+
+void SortListing(const DirListOptions& options, DirListing* listing) {
+  std::vector<uint32_t> order(listing->size());
+  std::iota(order.begin(), order.end(), 0);
+  auto compare_key = [&](uint32_t a, uint32_t b) -> int {
+    switch (options.sort) {
+      case DirListOptions::SortKey::kSize:
+        if (listing->sizes[a] != listing->sizes[b]) {
+          return listing->sizes[a] < listing->sizes[b] ? -1 : 1;
+        }
+        break;
+      case DirListOptions::SortKey::kModified:
+        if (listing->modified[a] != listing->modified[b]) {
+          return listing->modified[a] < listing->modified[b] ? -1 : 1;
+        }
+        break;
+      default:
+        break;
+    }
+    // 其余情况以及相等时按名称排序
+    const std::string& name_a = listing->names[a];
+    const std::string& name_b = listing->names[b];
+    int result = strcasecmp(name_a.c_str(), name_b.c_str());
+    return result != 0 ? result : name_a.compare(name_b);
+  };
+  std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    if (options.directories_first) {
+      bool dir_a = listing->types[a] == static_cast<uint8_t>(DirEntryType::kDirectory);
+      bool dir_b = listing->types[b] == static_cast<uint8_t>(DirEntryType::kDirectory);
+      if (dir_a != dir_b) {
+        return dir_a;
+      }
+    }
+    int result = compare_key(a, b);
+    return options.descending ? result > 0 : result < 0;
+  });
+  ApplyOrder(order, &listing->names);
+  ApplyOrder(order, &listing->types);
+  ApplyOrder(order, &listing->sizes);
+  ApplyOrder(order, &listing->modified);
+}
+
+}  // namespace
+
+bool ListDirectory(const std::string& path, const DirListOptions& options, DirListing* listing,
+                   std::string* error) {
+  *listing = DirListing();
+  int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+
+  std::vector<char> buffer(kDirentBufferSize);
+  while (true) {
+    long read_bytes = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+    if (read_bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      *error = strerror(errno);
+      close(dir_fd);
+      return false;
+    }
+    if (read_bytes == 0) {
+      break;
+    }
+    for (long pos = 0; pos < read_bytes;) {
+      const auto* entry = reinterpret_cast<const LinuxDirent64*>(buffer.data() + pos);
+      pos += entry->d_reclen;
+      const char* name = entry->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+      if (!options.show_hidden && name[0] == '.') {
+        continue;
+      }
+      if (!options.filter.empty() && !ContainsIgnoreCase(name, options.filter)) {
+        continue;
+      }
+      uint8_t type;
+      int64_t size;
+      int64_t modified;
+      // 列举期间被删除的条目直接跳过
+      if (!StatEntry(dir_fd, name, &type, &size, &modified)) {
+        continue;
+      }
+      listing->names.emplace_back(name);
+      listing->types.push_back(type);
+      listing->sizes.push_back(size);
+      listing->modified.push_back(modified);
+    }
+  }
+  close(dir_fd);
+
+  if (options.sort != DirListOptions::SortKey::kNone) {
+    SortListing(options, listing);
+  }
+  return true;
+}
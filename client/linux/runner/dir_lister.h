@@ -0,0 +1,41 @@
+#ifndef RUNNER_DIR_LISTER_H_
+#define RUNNER_DIR_LISTER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 目录列举：getdents64 批量读取目录项，再用 statx 相对目录 fd 取元数据，
+// 每个条目只有一次元数据系统调用，也不需要拼接完整路径。
+
+enum class DirEntryType : uint8_t {
+  kFile = 0,
+  kDirectory = 1,
+  kOther = 2,
+};
+
+struct DirListOptions {
+  enum class SortKey { kNone, kName, kSize, kModified };
+  SortKey sort = SortKey::kName;
+  bool descending = false;
+  bool directories_first = true;
+  bool show_hidden = true;
+  // 不区分大小写的名称子串过滤，为空时不过滤
+  std::string filter;
+};
+
+// 一次列举的结果，按列存放，便于分页时直接切片
+struct DirListing {
+  std::vector<std::string> names;
+  std::vector<uint8_t> types;
+  std::vector<int64_t> sizes;
+  // 修改时间，Unix 秒
+  std::vector<int64_t> modified;
+
+  size_t size() const { return names.size(); }
+};
+
+bool ListDirectory(const std::string& path, const DirListOptions& options, DirListing* listing,
+                   std::string* error);
+
+#endif  // RUNNER_DIR_LISTER_H_
@@ -0,0 +1,93 @@
+#ifndef RUNNER_ENCODABLE_ARGS_H_
+#define RUNNER_ENCODABLE_ARGS_H_
+
+#include <flutter/encodable_value.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 读取方法调用参数的辅助函数。
+// Dart 端的整数按大小编码为 int32 或 int64，数字参数也可能传成 double，这里统一处理。
+
+inline const flutter::EncodableValue* FindArg(const flutter::EncodableMap& map,
+                                              const char* key) {
+  auto it = map.find(flutter::EncodableValue(key));
+  return it == map.end() ? nullptr : &it->second;
+}
+
+inline bool GetNumber(const flutter::EncodableMap& map, const char* key, double* out) {
+  const flutter::EncodableValue* value = FindArg(map, key);
+  if (!value) {
+    return false;
+  }
+  if (const auto* d = std::get_if<double>(value)) {
+    *out = *d;
+  } else if (const auto* i = std::get_if<int32_t>(value)) {
+    *out = static_cast<double>(*i);
+  } else if (const auto* l = std::get_if<int64_t>(value)) {
+    *out = static_cast<double>(*l);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline bool GetInt64(const flutter::EncodableMap& map, const char* key, int64_t* out) {
+  const flutter::EncodableValue* value = FindArg(map, key);
+  if (!value) {
+    return false;
+  }
+  if (const auto* i = std::get_if<int32_t>(value)) {
+    *out = *i;
+  } else if (const auto* l = std::get_if<int64_t>(value)) {
+    *out = *l;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+inline std::string GetString(const flutter::EncodableMap& map, const char* key,
+                             const std::string& fallback) {
+  const flutter::EncodableValue* value = FindArg(map, key);
+  if (value) {
+    if (const auto* s = std::get_if<std::string>(value)) {
+      return *s;
+    }
+  }
+  return fallback;
+}
+
+inline bool GetBool(const flutter::EncodableMap& map, const char* key, bool fallback) {
+  const flutter::EncodableValue* value = FindArg(map, key);
+  if (value) {
+    if (const auto* b = std::get_if<bool>(value)) {
+      return *b;
+    }
+  }
+  return fallback;
+}
+
+// 字节数据，返回的指针指向参数内部，不拷贝
+inline const std::vector<uint8_t>* GetBytes(const flutter::EncodableMap& map,
+                                            const char* key) {
+  const flutter::EncodableValue* value = FindArg(map, key);
+  return value ? std::get_if<std::vector<uint8_t>>(value) : nullptr;
+}
+
+// 字符串列表，忽略其中非字符串的元素
+inline std::vector<std::string> GetStringList(const flutter::EncodableMap& map, const char* key) {
+  std::vector<std::string> values;
+  const flutter::EncodableValue* value = FindArg(map, key);
+  if (const auto* list = value ? std::get_if<flutter::EncodableList>(value) : nullptr) {
+    for (const auto& item : *list) {
+      if (const auto* s = std::get_if<std::string>(&item)) {
+        values.push_back(*s);
+      }
+    }
+  }
+  return values;
+}
+
+#endif  // RUNNER_ENCODABLE_ARGS_H_
@@ -0,0 +1,586 @@
+#include "file_index.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t kNoNode = UINT32_MAX;
+const uint8_t kNodeDirectory = 1;
+const uint8_t kNodeDeleted = 2;
+
+const uint32_t kWatchMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR |
+                            IN_DONT_FOLLOW | IN_EXCL_UNLINK;
+
+// 条目数少于这个值时单线程搜索
+const size_t kParallelSearchThreshold = 100000;
+
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+std::string JoinPath(const std::string& dir, const char* name) {
+  return dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+int WorkerCount() {
+  return static_cast<int>(std::clamp(std::thread::hardware_concurrency(), 1u, 8u));
+}
+
+}  // namespace
+
+FileIndex::FileIndex() {
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (inotify_fd_ >= 0 && wake_fd_ >= 0) {
+    watcher_ = std::thread(&FileIndex::WatcherLoop, this);
+  }
+}
+
+FileIndex::~FileIndex() {
+  stopping_ = true;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    pending_roots_.clear();
+  }
+  if (builder_.joinable()) {
+    builder_.join();
+  }
+  if (watcher_.joinable()) {
+    uint64_t one = 1;
+    if (write(wake_fd_, &one, sizeof(one)) < 0) {
+      // eventfd 计数溢出时线程已经处于唤醒状态
+    }
+    watcher_.join();
+  }
+  if (inotify_fd_ >= 0) {
+    close(inotify_fd_);
+  }
+  if (wake_fd_ >= 0) {
+    close(wake_fd_);
+  }
+}
+
+bool FileIndex::AddRoot(const std::string& root, std::string* error) {
+  struct stat st;
+  if (root.empty() || root[0] != '/') {
+    *error = "root must be an absolute path";
+    return false;
+  }
+  if (stat(root.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+    *error = "not a directory";
+    return false;
+  }
+  std::string normalized = root;
+  while (normalized.size() > 1 && normalized.back() == '/') {
+    normalized.pop_back();
+  }
+  std::lock_guard<std::mutex> lock(queue_mutex_);
+  pending_roots_.push_back(normalized);
+  StartBuilderLocked();
+  return true;
+}
+
+void FileIndex::StartBuilderLocked() {
+  if (building_) {
+    return;
+  }
+  // 上一个构建线程已经退出循环，join 不会等待
+  if (builder_.joinable()) {
+    builder_.join();
+  }
+  building_ = true;
+  builder_ = std::thread(&FileIndex::BuilderLoop, this);
+}
+
+void FileIndex::BuilderLoop() {
+  while (true) {
+    std::string root;
+    {
+      std::lock_guard<std::mutex> lock(queue_mutex_);
+      if (pending_roots_.empty() || cancel_build_ || stopping_) {
+        building_ = false;
+        return;
+      }
+      root = pending_roots_.front();
+      pending_roots_.pop_front();
+    }
+    // 已有的根重新遍历一遍，已存在的条目不会重复加入
+    uint32_t node = kNoNode;
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex_);
+      for (uint32_t existing : roots_) {
+        if (IsLiveLocked(existing) && PathLocked(existing) == root) {
+          node = existing;
+        }
+      }
+      if (node == kNoNode) {
+        node = AppendNodeLocked(kNoNode, root.c_str(), root.size(), true);
+        roots_.push_back(node);
+      }
+    }
+    Crawl(node, root, WorkerCount());
+  }
+}
+
+void FileIndex::Crawl(uint32_t node, const std::string& path, int threads) {
+  // 每个线程有自己的目录队列：自己从队尾取（深度优先、缓存友好），空了就从别的队列头部窃取
+  struct WorkQueue {
+    std::mutex mutex;
+    std::deque<WalkItem> items;
+  };
+  std::vector<std::unique_ptr<WorkQueue>> queues;
+  for (int i = 0; i < threads; i++) {
+    queues.push_back(std::make_unique<WorkQueue>());
+  }
+  queues[0]->items.push_back(WalkItem{node, path});
+  // 尚未处理完的目录数，为 0 时所有线程退出
+  std::atomic<int64_t> pending(1);
+
+  auto run = [&](int id) {
+    std::vector<WalkItem> subdirs;
+    int idle = 0;
+    while (pending > 0 && !cancel_build_ && !stopping_) {
+      WalkItem item;
+      bool found = false;
+      {
+        WorkQueue& own = *queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+          item = std::move(own.items.back());
+          own.items.pop_back();
+          found = true;
+        }
+      }
+      for (int k = 1; !found && k < threads; k++) {
+        WorkQueue& victim = *queues[(id + k) % threads];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+          item = std::move(victim.items.front());
+          victim.items.pop_front();
+          found = true;
+        }
+      }
+      if (!found) {
+        if (++idle > 64) {
+          std::this_thread::sleep_for(std::chrono::microseconds(100));
+        } else {
+          std::this_thread::yield();
+        }
+        continue;
+      }
+      idle = 0;
+      subdirs.clear();
+      ScanDirectory(item.node, item.path, &subdirs);
+      // 先加上新目录再减去当前目录，计数不会提前归零
+      pending += static_cast<int64_t>(subdirs.size());
+      {
+        WorkQueue& own = *queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        for (auto& subdir : subdirs) {
+          own.items.push_back(std::move(subdir));
+        }
+      }
+      pending--;
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++) {
+    pool.emplace_back(run, i);
+  }
+  run(0);
+  for (auto& thread : pool) {
+    thread.join();
+  }
+}
+
+void FileIndex::ScanDirectory(uint32_t node, const std::string& path,
+                              std::vector<WalkItem>* subdirs) {
+  int dir_fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (dir_fd < 0) {
+    return;
+  }
+  // 先加监视再读取，读取期间发生的变化不会丢失
+  int wd = -1;
+  bool limit_reached = false;
+  if (inotify_fd_ >= 0) {
+    wd = inotify_add_watch(inotify_fd_, path.c_str(), kWatchMask);
+    limit_reached = wd < 0 && errno == ENOSPC;
+  }
+
+  struct Entry {
+    size_t offset;
+    size_t length;
+    bool directory;
+  };
+  std::vector<Entry> entries;
+  std::vector<char> names;
+  std::vector<char> buffer(64 * 1024);
+  // 读取中途出错时列表不完整，不能据此删除条目
+  bool complete = true;
+  while (true) {
+    long read_bytes = syscall(SYS_getdents64, dir_fd, buffer.data(), buffer.size());
+    if (read_bytes < 0 && errno == EINTR) {
+      continue;
+    }
+    if (read_bytes <= 0) {
+      complete = read_bytes == 0;
+      break;
+    }
+    for (long pos = 0; pos < read_bytes;) {
+      const auto* dirent = reinterpret_cast<const LinuxDirent64*>(buffer.data() + pos);
+      pos += dirent->d_reclen;
+      const char* name = dirent->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+      // 符号链接不跟随，避免环路；文件系统不提供类型时才 stat
+      bool directory = dirent->d_type == DT_DIR;
+      if (dirent->d_type == DT_UNKNOWN) {
+        struct stat st;
+        directory = fstatat(dir_fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR(st.st_mode);
+      }
+      size_t length = strlen(name);
+      entries.push_back(Entry{names.size(), length, directory});
+      names.insert(names.end(), name, name + length + 1);
+    }
+  }
+  close(dir_fd);
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  if (limit_reached) {
+    watch_limit_reached_ = true;
+  }
+  if (!IsLiveLocked(node)) {
+    return;
+  }
+  if (wd >= 0) {
+    watches_[wd] = node;
+  }
+  // 重新扫描时与已有的子节点核对：仍然存在的保留，已有的子目录同样继续遍历，
+  // 类型变了或已经不存在的删除
+  std::unordered_map<std::string, uint32_t> existing;
+  for (uint32_t child = nodes_[node].first_child; child != kNoNode;
+       child = nodes_[child].next_sibling) {
+    if (!(nodes_[child].flags & kNodeDeleted)) {
+      existing.emplace(std::string(&names_[nodes_[child].name_offset], nodes_[child].name_length),
+                       child);
+    }
+  }
+  for (const Entry& entry : entries) {
+    const char* name = &names[entry.offset];
+    uint32_t child = kNoNode;
+    if (!existing.empty()) {
+      auto it = existing.find(std::string(name, entry.length));
+      if (it != existing.end()) {
+        if (((nodes_[it->second].flags & kNodeDirectory) != 0) == entry.directory) {
+          child = it->second;
+        } else {
+          RemoveNodeLocked(it->second);
+        }
+        existing.erase(it);
+      }
+    }
+    if (child == kNoNode) {
+      child = AppendNodeLocked(node, name, entry.length, entry.directory);
+    }
+    if (entry.directory) {
+      subdirs->push_back(WalkItem{child, JoinPath(path, name)});
+    }
+  }
+  if (complete) {
+    for (const auto& stale : existing) {
+      RemoveNodeLocked(stale.second);
+    }
+  }
+}
+
+uint32_t FileIndex::AppendNodeLocked(uint32_t parent, const char* name, size_t length,
+                                     bool directory) {
+  Node node;
+  node.parent = parent;
+  node.first_child = kNoNode;
+  node.next_sibling = parent == kNoNode ? kNoNode : nodes_[parent].first_child;
+  node.name_offset = static_cast<uint32_t>(names_.size());
+  node.name_length = static_cast<uint16_t>(std::min<size_t>(length, UINT16_MAX));
+  node.flags = directory ? kNodeDirectory : 0;
+  names_.insert(names_.end(), name, name + node.name_length);
+  names_.push_back('\0');
+  for (size_t i = 0; i < node.name_length; i++) {
+    lower_names_.push_back(static_cast<char>(tolower(static_cast<unsigned char>(name[i]))));
+  }
+  lower_names_.push_back('\0');
+
+  uint32_t id = static_cast<uint32_t>(nodes_.size());
+  nodes_.push_back(node);
+  if (parent != kNoNode) {
+    nodes_[parent].first_child = id;
+  }
+  live_entries_++;
+  if (directory) {
+    directories_++;
+  }
+  return id;
+}
+
+uint32_t FileIndex::FindChildLocked(uint32_t parent, const char* name) const {
+  size_t length = strlen(name);
+  for (uint32_t child = nodes_[parent].first_child; child != kNoNode;
+       child = nodes_[child].next_sibling) {
+    const Node& node = nodes_[child];
+    if (!(node.flags & kNodeDeleted) && node.name_length == length &&
+        memcmp(&names_[node.name_offset], name, length) == 0) {
+      return child;
+    }
+  }
+  return kNoNode;
+}
+
+void FileIndex::RemoveNodeLocked(uint32_t node) {
+  // 整棵子树标记为删除，名称区的空间在下次 Clear 时回收
+  std::vector<uint32_t> stack = {node};
+  while (!stack.empty()) {
+    uint32_t current = stack.back();
+    stack.pop_back();
+    Node& entry = nodes_[current];
+    if (entry.flags & kNodeDeleted) {
+      continue;
+    }
+    entry.flags |= kNodeDeleted;
+    live_entries_--;
+    if (entry.flags & kNodeDirectory) {
+      directories_--;
+    }
+    for (uint32_t child = entry.first_child; child != kNoNode; child = nodes_[child].next_sibling) {
+      stack.push_back(child);
+    }
+  }
+}
+
+bool FileIndex::IsLiveLocked(uint32_t node) const {
+  return node < nodes_.size() && !(nodes_[node].flags & kNodeDeleted);
+}
+
+std::string FileIndex::PathLocked(uint32_t node) const {
+  std::vector<uint32_t> chain;
+  for (uint32_t current = node; current != kNoNode; current = nodes_[current].parent) {
+    chain.push_back(current);
+  }
+  std::string path;
+  for (auto it = chain.rbegin(); it != chain.rend(); ++it) {
+    const Node& entry = nodes_[*it];
+    if (!path.empty() && path.back() != '/') {
+      path.push_back('/');
+    }
+    path.append(&names_[entry.name_offset], entry.name_length);
+  }
+  return path;
+}
+
+void FileIndex::Clear() {
+  // 只中止遍历，监视线程继续运行，之后加入的根仍能自动更新
+  cancel_build_ = true;
+  std::thread builder;
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    pending_roots_.clear();
+    builder = std::move(builder_);
+  }
+  // 构建线程退出前需要 queue_mutex_，不能持锁等待
+  if (builder.joinable()) {
+    builder.join();
+  }
+  cancel_build_ = false;
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  for (const auto& watch : watches_) {
+    inotify_rm_watch(inotify_fd_, watch.first);
+  }
+  watches_.clear();
+  nodes_.clear();
+  nodes_.shrink_to_fit();
+  names_.clear();
+  names_.shrink_to_fit();
+  lower_names_.clear();
+  lower_names_.shrink_to_fit();
+  roots_.clear();
+  directories_ = 0;
+  live_entries_ = 0;
+  watch_limit_reached_ = false;
+}
+
+FileIndex::SearchResult FileIndex::Search(const std::string& query,
+                                          const SearchOptions& options) const {
+  SearchResult result;
+  if (query.empty()) {
+    return result;
+  }
+  std::string needle = query;
+  if (!options.case_sensitive && options.mode != MatchMode::kGlob) {
+    std::transform(needle.begin(), needle.end(), needle.begin(),
+                   [](unsigned char c) { return static_cast<char>(tolower(c)); });
+  }
+
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  const std::vector<char>& names = options.case_sensitive ? names_ : lower_names_;
+  auto matches = [&](const Node& node) {
+    if ((node.flags & kNodeDeleted) || node.parent == kNoNode ||
+        (!options.include_directories && (node.flags & kNodeDirectory))) {
+      return false;
+    }
+    const char* name = &names[node.name_offset];
+    switch (options.mode) {
+      case MatchMode::kPrefix:
+        return node.name_length >= needle.size() && memcmp(name, needle.data(), needle.size()) == 0;
+      case MatchMode::kSubstring:
+        return memmem(name, node.name_length, needle.data(), needle.size()) != nullptr;
+      case MatchMode::kGlob:
+        return fnmatch(needle.c_str(), &names_[node.name_offset],
+                       options.case_sensitive ? 0 : FNM_CASEFOLD) == 0;
+    }
+    return false;
+  };
+
+  // 按节点区间切分给多个线程，每段最多保留 limit 条，合并后仍按节点顺序
+  size_t count = nodes_.size();
+  int threads = count < kParallelSearchThreshold ? 1 : WorkerCount();
+  std::vector<std::vector<uint32_t>> found(threads);
+  std::vector<size_t> totals(threads, 0);
+  auto scan = [&](int id) {
+    size_t begin = count * id / threads;
+    size_t end = count * (id + 1) / threads;
+    for (size_t i = begin; i < end; i++) {
+      if (matches(nodes_[i])) {
+        if (found[id].size() < options.limit) {
+          found[id].push_back(static_cast<uint32_t>(i));
+        }
+        totals[id]++;
+      }
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++) {
+    pool.emplace_back(scan, i);
+  }
+  scan(0);
+  for (auto& thread : pool) {
+    thread.join();
+  }
+
+  for (int i = 0; i < threads; i++) {
+    result.total += totals[i];
+    for (uint32_t node : found[i]) {
+      if (result.paths.size() >= options.limit) {
+        break;
+      }
+      result.paths.push_back(PathLocked(node));
+      result.is_directory.push_back((nodes_[node].flags & kNodeDirectory) ? 1 : 0);
+    }
+  }
+  return result;
+}
+
+FileIndex::Status FileIndex::GetStatus() const {
+  Status status;
+  status.building = building_;
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  status.entries = live_entries_;
+  status.directories = directories_;
+  status.watches = watches_.size();
+  status.watch_limit_reached = watch_limit_reached_;
+  for (uint32_t root : roots_) {
+    status.roots.push_back(PathLocked(root));
+  }
+  return status;
+}
+
+void FileIndex::WatcherLoop() {
+  alignas(struct inotify_event) char buffer[64 * 1024];
+  struct pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {wake_fd_, POLLIN, 0}};
+  while (!stopping_) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return;
+    }
+    if (fds[1].revents) {
+      return;
+    }
+    while (true) {
+      ssize_t length = read(inotify_fd_, buffer, sizeof(buffer));
+      if (length <= 0) {
+        break;
+      }
+      for (char* p = buffer; p < buffer + length;) {
+        const auto* event = reinterpret_cast<const struct inotify_event*>(p);
+        p += sizeof(struct inotify_event) + event->len;
+        if (event->mask & IN_Q_OVERFLOW) {
+          // 事件队列溢出，丢失的事件无从得知，已有的根整体重新核对一遍：
+          // 补上新增的条目、去掉已不存在的条目，并深入已有的子目录
+          std::vector<std::string> roots = GetStatus().roots;
+          std::lock_guard<std::mutex> lock(queue_mutex_);
+          pending_roots_.insert(pending_roots_.end(), roots.begin(), roots.end());
+          StartBuilderLocked();
+          continue;
+        }
+        HandleEvent(event->wd, event->mask, event->len ? event->name : "");
+      }
+    }
+  }
+}
+
+void FileIndex::HandleEvent(int wd, uint32_t mask, const char* name) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  auto it = watches_.find(wd);
+  if (it == watches_.end()) {
+    return;
+  }
+  if (mask & IN_IGNORED) {
+    watches_.erase(it);
+    return;
+  }
+  uint32_t parent = it->second;
+  if (!IsLiveLocked(parent) || name[0] == '\0') {
+    return;
+  }
+
+  if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+    uint32_t child = FindChildLocked(parent, name);
+    if (child != kNoNode) {
+      RemoveNodeLocked(child);
+    }
+  } else if (mask & (IN_CREATE | IN_MOVED_TO)) {
+    if (FindChildLocked(parent, name) != kNoNode) {
+      return;
+    }
+    bool directory = (mask & IN_ISDIR) != 0;
+    uint32_t child = AppendNodeLocked(parent, name, strlen(name), directory);
+    if (directory) {
+      // 新建或移入的目录可能已经有内容，单线程遍历一遍并加上监视
+      std::string path = PathLocked(child);
+      lock.unlock();
+      Crawl(child, path, 1);
+    }
+  }
+}
@@ -0,0 +1,109 @@
+#ifndef RUNNER_FILE_INDEX_H_
+#define RUNNER_FILE_INDEX_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// 内存中的文件名索引。每个条目只存父节点、名称在名称区中的位置和兄弟链，
+// 完整路径在返回结果时沿父节点拼出，百万级条目约占几十 MB。
+// 建立索引时多个线程以工作窃取方式并行遍历目录；建好后用 inotify 保持更新。
+class FileIndex {
+ public:
+  enum class MatchMode { kPrefix, kSubstring, kGlob };
+
+  struct SearchOptions {
+    MatchMode mode = MatchMode::kSubstring;
+    bool case_sensitive = false;
+    bool include_directories = true;
+    size_t limit = 200;
+  };
+
+  struct SearchResult {
+    std::vector<std::string> paths;
+    std::vector<uint8_t> is_directory;
+    // 匹配总数，可能大于返回的条数
+    size_t total = 0;
+  };
+
+  struct Status {
+    size_t entries = 0;
+    size_t directories = 0;
+    size_t watches = 0;
+    bool building = false;
+    // 达到 inotify 监视数量上限，部分目录不会自动更新
+    bool watch_limit_reached = false;
+    std::vector<std::string> roots;
+  };
+
+  FileIndex();
+  ~FileIndex();
+
+  // 在后台线程中遍历 root 并加入索引，立即返回
+  bool AddRoot(const std::string& root, std::string* error);
+  void Clear();
+
+  SearchResult Search(const std::string& query, const SearchOptions& options) const;
+  Status GetStatus() const;
+
+ private:
+  struct Node {
+    uint32_t parent;
+    uint32_t first_child;
+    uint32_t next_sibling;
+    uint32_t name_offset;
+    uint16_t name_length;
+    uint8_t flags;
+  };
+
+  struct WalkItem {
+    uint32_t node;
+    std::string path;
+  };
+
+  void StartBuilderLocked();
+  void BuilderLoop();
+  // 用 threads 个线程遍历以 node 为根的子树
+  void Crawl(uint32_t node, const std::string& path, int threads);
+  void ScanDirectory(uint32_t node, const std::string& path, std::vector<WalkItem>* subdirs);
+  uint32_t AppendNodeLocked(uint32_t parent, const char* name, size_t length, bool directory);
+  uint32_t FindChildLocked(uint32_t parent, const char* name) const;
+  void RemoveNodeLocked(uint32_t node);
+  bool IsLiveLocked(uint32_t node) const;
+  std::string PathLocked(uint32_t node) const;
+
+  void WatcherLoop();
+  void HandleEvent(int wd, uint32_t mask, const char* name);
+
+  mutable std::shared_mutex mutex_;
+  std::vector<Node> nodes_;
+  // 名称以 '\0' 结尾存放，便于直接交给 fnmatch；lower_names_ 是对应的小写副本
+  std::vector<char> names_;
+  std::vector<char> lower_names_;
+  std::vector<uint32_t> roots_;
+  std::unordered_map<int, uint32_t> watches_;
+  size_t directories_ = 0;
+  size_t live_entries_ = 0;
+  bool watch_limit_reached_ = false;
+
+  int inotify_fd_ = -1;
+  int wake_fd_ = -1;
+  std::thread watcher_;
+  std::thread builder_;
+  std::mutex queue_mutex_;
+  std::deque<std::string> pending_roots_;
+  std::atomic<bool> building_{false};
+  // Clear 时中止正在进行的遍历
+  std::atomic<bool> cancel_build_{false};
+  // 析构时中止遍历并让监视线程退出
+  std::atomic<bool> stopping_{false};
+};
+
+#endif  // RUNNER_FILE_INDEX_H_
@@ -0,0 +1,474 @@
+#include "file_jobs.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int64_t kReportIntervalMs = 100;
+// 每次 copy_file_range 的长度，也是取消和进度更新的粒度
+const size_t kCopyChunk = 8 * 1024 * 1024;
+const size_t kBufferSize = 1024 * 1024;
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now().time_since_epoch())
+      .count();
+}
+
+std::string BaseName(const std::string& path) {
+  std::string trimmed = path;
+  while (trimmed.size() > 1 && trimmed.back() == '/') {
+    trimmed.pop_back();
+  }
+  size_t slash = trimmed.find_last_of('/');
+  return slash == std::string::npos ? trimmed : trimmed.substr(slash + 1);
+}
+
+std::string JoinPath(const std::string& dir, const std::string& name) {
+  return !dir.empty() && dir.back() == '/' ? dir + name : dir + "/" + name;
+}
+
+}  // namespace
+
+struct FileJobManager::Job {
+  int64_t id = 0;
+  FileJobKind kind = FileJobKind::kCopy;
+  std::vector<std::string> sources;
+  std::string destination;
+  bool overwrite = false;
+  Clock::time_point started;
+
+  std::atomic<int64_t> files_done{0};
+  std::atomic<int64_t> files_total{0};
+  std::atomic<int64_t> bytes_done{0};
+  std::atomic<int64_t> bytes_total{0};
+  std::atomic<int64_t> errors{0};
+  // 尚未完成的子任务数，遍历阶段本身也算一个
+  std::atomic<int64_t> outstanding{1};
+  std::atomic<int64_t> last_report_ms{0};
+  std::atomic<bool> planning{true};
+  std::atomic<bool> cancelled{false};
+
+  std::mutex mutex;
+  std::string error;
+  // 结束时按逆序 rmdir 的目录（删除任务，以及跨文件系统移动后的源目录）
+  std::vector<std::string> cleanup_dirs;
+
+  void Fail(const std::string& path, int error_number) {
+    errors++;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error.empty()) {
+      error = path + ": " + strerror(error_number);
+    }
+  }
+};
+
+FileJobManager::FileJobManager(ProgressCallback callback) : callback_(std::move(callback)) {
+  unsigned int threads = std::clamp(std::thread::hardware_concurrency(), 2u, 4u);
+  for (unsigned int i = 0; i < threads; i++) {
+    workers_.emplace_back(&FileJobManager::WorkerLoop, this);
+  }
+}
+
+FileJobManager::~FileJobManager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& entry : jobs_) {
+      entry.second->cancelled = true;
+    }
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+int64_t FileJobManager::Start(FileJobKind kind, const std::vector<std::string>& sources,
+                              const std::string& destination, bool overwrite) {
+  auto job = std::make_shared<Job>();
+  job->kind = kind;
+  job->sources = sources;
+  job->destination = destination;
+  job->overwrite = overwrite;
+  job->started = Clock::now();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job->id = next_job_++;
+    jobs_[job->id] = job;
+  }
+  Enqueue([this, job]() { Plan(job); });
+  return job->id;
+}
+
+bool FileJobManager::Cancel(int64_t job_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = jobs_.find(job_id);
+  if (it == jobs_.end()) {
+    return false;
+  }
+  it->second->cancelled = true;
+  return true;
+}
+
+void FileJobManager::Enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+  }
+  cv_.notify_one();
+}
+
+void FileJobManager::WorkerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait(lock, [this]() { return stopping_ || !tasks_.empty(); });
+      if (stopping_) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+void FileJobManager::Plan(const std::shared_ptr<Job>& job) {
+  for (const std::string& source : job->sources) {
+    if (job->cancelled) {
+      break;
+    }
+    if (job->kind == FileJobKind::kDelete) {
+      PlanDelete(job, source);
+      continue;
+    }
+    std::string target = JoinPath(job->destination, BaseName(source));
+    struct stat st;
+    if (!job->overwrite && lstat(target.c_str(), &st) == 0) {
+      job->Fail(target, EEXIST);
+      continue;
+    }
+    if (job->kind == FileJobKind::kMove) {
+      // 同一文件系统内直接改名；跨文件系统时退回复制后删除源
+      if (rename(source.c_str(), target.c_str()) == 0) {
+        job->files_total++;
+        job->files_done++;
+        continue;
+      }
+      if (errno != EXDEV) {
+        job->Fail(source, errno);
+        continue;
+      }
+    }
+    PlanCopy(job, source, target, job->kind == FileJobKind::kMove);
+  }
+  job->planning = false;
+  TaskDone(job);
+}
+
+void FileJobManager::PlanCopy(const std::shared_ptr<Job>& job, const std::string& source,
+                              const std::string& target, bool remove_source) {
+  std::vector<std::pair<std::string, std::string>> stack = {{source, target}};
+  while (!stack.empty() && !job->cancelled) {
+    std::string from = std::move(stack.back().first);
+    std::string to = std::move(stack.back().second);
+    stack.pop_back();
+    struct stat st;
+    if (lstat(from.c_str(), &st) != 0) {
+      job->Fail(from, errno);
+      continue;
+    }
+    if (S_ISDIR(st.st_mode)) {
+      // 目录在遍历时就创建好，子文件的复制任务才能并行执行
+      if (mkdir(to.c_str(), st.st_mode & 07777) != 0 && errno != EEXIST) {
+        job->Fail(to, errno);
+        continue;
+      }
+      if (remove_source) {
+        std::lock_guard<std::mutex> lock(job->mutex);
+        job->cleanup_dirs.push_back(from);
+      }
+      DIR* dir = opendir(from.c_str());
+      if (!dir) {
+        job->Fail(from, errno);
+        continue;
+      }
+      while (struct dirent* entry = readdir(dir)) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+          continue;
+        }
+        stack.emplace_back(JoinPath(from, name), JoinPath(to, name));
+      }
+      closedir(dir);
+    } else if (S_ISLNK(st.st_mode)) {
+      // 符号链接复制链接本身
+      job->files_total++;
+      std::vector<char> link(st.st_size + 1);
+      ssize_t length = readlink(from.c_str(), link.data(), link.size());
+      if (length < 0) {
+        job->Fail(from, errno);
+        continue;
+      }
+      link[std::min<size_t>(length, st.st_size)] = '\0';
+      if (job->overwrite) {
+        unlink(to.c_str());
+      }
+      if (symlink(link.data(), to.c_str()) != 0) {
+        job->Fail(to, errno);
+        continue;
+      }
+      if (remove_source) {
+        unlink(from.c_str());
+      }
+      job->files_done++;
+    } else if (S_ISREG(st.st_mode)) {
+      job->files_total++;
+      job->bytes_total += st.st_size;
+      job->outstanding++;
+      Enqueue([this, job, from, to, remove_source]() {
+        CopyFile(job, from, to, remove_source);
+      });
+    } else {
+      job->Fail(from, ENOTSUP);
+    }
+  }
+}
+
+void FileJobManager::PlanDelete(const std::shared_ptr<Job>& job, const std::string& path) {
+  std::vector<std::string> stack = {path};
+  while (!stack.empty() && !job->cancelled) {
+    std::string current = std::move(stack.back());
+    stack.pop_back();
+    struct stat st;
+    if (lstat(current.c_str(), &st) != 0) {
+      job->Fail(current, errno);
+      continue;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+      job->files_total++;
+      job->bytes_total += st.st_size;
+      job->outstanding++;
+      Enqueue([this, job, current]() { DeleteFile(job, current); });
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      job->cleanup_dirs.push_back(current);
+    }
+    DIR* dir = opendir(current.c_str());
+    if (!dir) {
+      job->Fail(current, errno);
+      continue;
+    }
+    while (struct dirent* entry = readdir(dir)) {
+      const char* name = entry->d_name;
+      if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+        continue;
+      }
+      stack.push_back(JoinPath(current, name));
+    }
+    closedir(dir);
+  }
+}
+
+void FileJobManager::CopyFile(const std::shared_ptr<Job>& job, const std::string& source,
+                              const std::string& target, bool remove_source) {
+  if (job->cancelled) {
+    TaskDone(job);
+    return;
+  }
+  int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (in < 0 || fstat(in, &st) != 0) {
+    job->Fail(source, errno);
+    if (in >= 0) {
+      close(in);
+    }
+    TaskDone(job);
+    return;
+  }
+  int out = open(target.c_str(),
+                 O_WRONLY | O_CREAT | O_CLOEXEC | (job->overwrite ? O_TRUNC : O_EXCL),
+                 st.st_mode & 07777);
+  if (out < 0) {
+    job->Fail(target, errno);
+    close(in);
+    TaskDone(job);
+    return;
+  }
+
+  bool ok = false;
+  int error_number = 0;
+#ifdef FICLONE
+  // 支持引用链接的文件系统（btrfs、xfs 等）直接共享数据块，不复制数据
+  if (ioctl(out, FICLONE, in) == 0) {
+    ok = true;
+    job->bytes_done += st.st_size;
+  }
+#endif
+  int64_t copied = 0;
+  bool use_buffer = false;
+  while (!ok && copied < st.st_size && !job->cancelled) {
+    // 数据在内核内复制；跨文件系统或不支持时退回读写缓冲区
+    ssize_t n = copy_file_range(in, nullptr, out, nullptr,
+                                std::min<int64_t>(kCopyChunk, st.st_size - copied), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EXDEV || errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP ||
+                  errno == EPERM)) {
+      use_buffer = true;
+      break;
+    }
+    if (n < 0) {
+      error_number = errno;
+      break;
+    }
+    if (n == 0) {
+      // 部分伪文件系统报告的大小与实际内容不符
+      use_buffer = true;
+      break;
+    }
+    copied += n;
+    job->bytes_done += n;
+    Report(job, false);
+  }
+  if (!ok && use_buffer) {
+    std::vector<char> buffer(kBufferSize);
+    while (!job->cancelled) {
+      ssize_t n = pread(in, buffer.data(), buffer.size(), copied);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      if (n < 0) {
+        error_number = errno;
+        break;
+      }
+      if (n == 0) {
+        break;
+      }
+      ssize_t written = 0;
+      while (written < n) {
+        ssize_t w = pwrite(out, buffer.data() + written, n - written, copied + written);
+        if (w < 0 && errno == EINTR) {
+          continue;
+        }
+        if (w < 0) {
+          error_number = errno;
+          break;
+        }
+        written += w;
+      }
+      if (error_number != 0) {
+        break;
+      }
+      copied += n;
+      job->bytes_done += n;
+      Report(job, false);
+    }
+  }
+  if (!ok) {
+    ok = error_number == 0 && !job->cancelled && (use_buffer || copied >= st.st_size);
+  }
+  if (ok) {
+    struct timespec times[2] = {st.st_atim, st.st_mtim};
+    futimens(out, times);
+  }
+  if (close(out) != 0 && ok) {
+    ok = false;
+    error_number = errno;
+  }
+  close(in);
+
+  if (!ok) {
+    // 失败或取消时不留下不完整的文件
+    unlink(target.c_str());
+    if (error_number != 0) {
+      job->Fail(source, error_number);
+    }
+  } else {
+    if (remove_source && unlink(source.c_str()) != 0) {
+      job->Fail(source, errno);
+    }
+    job->files_done++;
+  }
+  Report(job, false);
+  TaskDone(job);
+}
+
+void FileJobManager::DeleteFile(const std::shared_ptr<Job>& job, const std::string& path) {
+  if (!job->cancelled) {
+    struct stat st;
+    int64_t size = lstat(path.c_str(), &st) == 0 ? st.st_size : 0;
+    if (unlink(path.c_str()) == 0) {
+      job->files_done++;
+      job->bytes_done += size;
+    } else {
+      job->Fail(path, errno);
+    }
+    Report(job, false);
+  }
+  TaskDone(job);
+}
+
+void FileJobManager::TaskDone(const std::shared_ptr<Job>& job) {
+  if (--job->outstanding > 0) {
+    return;
+  }
+  // 所有文件处理完后，从最深处开始删除目录
+  if (!job->cancelled) {
+    std::vector<std::string> dirs;
+    {
+      std::lock_guard<std::mutex> lock(job->mutex);
+      dirs.swap(job->cleanup_dirs);
+    }
+    for (auto it = dirs.rbegin(); it != dirs.rend(); ++it) {
+      if (rmdir(it->c_str()) != 0) {
+        job->Fail(*it, errno);
+      }
+    }
+  }
+  Report(job, true);
+  std::lock_guard<std::mutex> lock(mutex_);
+  jobs_.erase(job->id);
+}
+
+void FileJobManager::Report(const std::shared_ptr<Job>& job, bool force) {
+  int64_t now = NowMs();
+  int64_t last = job->last_report_ms;
+  if (!force && (now - last < kReportIntervalMs ||
+                 !job->last_report_ms.compare_exchange_strong(last, now))) {
+    return;
+  }
+  FileJobProgress progress;
+  progress.job_id = job->id;
+  progress.kind = job->kind;
+  progress.files_done = job->files_done;
+  progress.files_total = job->files_total;
+  progress.bytes_done = job->bytes_done;
+  progress.bytes_total = job->bytes_total;
+  progress.errors = job->errors;
+  progress.planning = job->planning;
+  progress.finished = force;
+  progress.cancelled = job->cancelled;
+  double seconds = std::chrono::duration<double>(Clock::now() - job->started).count();
+  progress.bytes_per_sec = seconds > 0 ? progress.bytes_done / seconds : 0;
+  {
+    std::lock_guard<std::mutex> lock(job->mutex);
+    progress.error = job->error;
+  }
+  callback_(progress);
+}
@@ -0,0 +1,78 @@
+#ifndef RUNNER_FILE_JOBS_H_
+#define RUNNER_FILE_JOBS_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class FileJobKind { kCopy, kMove, kDelete };
+
+struct FileJobProgress {
+  int64_t job_id = 0;
+  FileJobKind kind = FileJobKind::kCopy;
+  int64_t files_done = 0;
+  int64_t files_total = 0;
+  int64_t bytes_done = 0;
+  int64_t bytes_total = 0;
+  double bytes_per_sec = 0;
+  int64_t errors = 0;
+  // 仍在遍历源目录，files_total 和 bytes_total 还会增长
+  bool planning = false;
+  bool finished = false;
+  bool cancelled = false;
+  // 第一个错误的描述
+  std::string error;
+};
+
+// 后台文件任务：递归复制、移动和删除。所有任务共用一个固定大小的线程池，
+// 每个文件是一个独立的小任务，大目录树的多个文件并行处理，同时并发数有上限。
+// 进度回调在线程池线程上调用，同一任务最多每 100 毫秒一次，结束时必定调用一次。
+class FileJobManager {
+ public:
+  using ProgressCallback = std::function<void(const FileJobProgress&)>;
+
+  explicit FileJobManager(ProgressCallback callback);
+  ~FileJobManager();
+
+  // 复制或移动时 sources 放到 destination 目录下，保留原名；删除时忽略 destination
+  int64_t Start(FileJobKind kind, const std::vector<std::string>& sources,
+                const std::string& destination, bool overwrite);
+  bool Cancel(int64_t job_id);
+
+ private:
+  struct Job;
+
+  void Enqueue(std::function<void()> task);
+  void WorkerLoop();
+
+  void Plan(const std::shared_ptr<Job>& job);
+  void PlanCopy(const std::shared_ptr<Job>& job, const std::string& source,
+                const std::string& target, bool remove_source);
+  void PlanDelete(const std::shared_ptr<Job>& job, const std::string& path);
+  void CopyFile(const std::shared_ptr<Job>& job, const std::string& source,
+                const std::string& target, bool remove_source);
+  void DeleteFile(const std::shared_ptr<Job>& job, const std::string& path);
+  // 每个子任务结束时调用，最后一个子任务负责收尾
+  void TaskDone(const std::shared_ptr<Job>& job);
+  void Report(const std::shared_ptr<Job>& job, bool force);
+
+  ProgressCallback callback_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::function<void()>> tasks_;
+  bool stopping_ = false;
+  std::map<int64_t, std::shared_ptr<Job>> jobs_;
+  int64_t next_job_ = 1;
+};
+
+#endif  // RUNNER_FILE_JOBS_H_
@@ -0,0 +1,1518 @@
+#include "file_operation_plugin.h"
+
+#include <flutter/event_channel.h>
+#include <flutter/event_stream_handler_functions.h>
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_linux.h>
+#include <flutter/standard_method_codec.h>
+
+#include <fcntl.h>
+#include <glib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <vector>
+
+#include "async_method.h"
+#include "chunk_store.h"
+#include "delta_sync.h"
+#include "dir_archive.h"
+#include "dir_lister.h"
+#include "encodable_args.h"
+#include "file_index.h"
+#include "file_jobs.h"
+#include "file_sender.h"
+#include "platform_thread.h"
+#include "transfer_engine.h"
+#include "zstd_stream.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 分块传输的默认块大小和允许范围，内存占用只和块大小有关
+const int64_t kDefaultChunkSize = 256 * 1024;
+const int64_t kMinChunkSize = 4 * 1024;
+const int64_t kMaxChunkSize = 16 * 1024 * 1024;
+
+// 分页列举目录的默认页大小，以及同时保留的列举快照数
+const int64_t kDefaultPageSize = 1000;
+const size_t kMaxListingSnapshots = 8;
+
+// 块缓存默认上限
+const int64_t kDefaultCacheCapacity = 2LL * 1024 * 1024 * 1024;
+
+using Clock = std::chrono::steady_clock;
+
+}  // namespace
+
+class FileOperationPlugin : public flutter::Plugin {
+ public:
+  static std::unique_ptr<FileOperationPlugin> Create(flutter::BinaryMessenger *messenger);
+
+  FileOperationPlugin();
+
+  virtual ~FileOperationPlugin();
+
+ private:
+  // 一个打开的分块传输。读写按提交顺序在 queue 上执行，平台线程只读取打开后不再变化的字段和原子计数；
+  // 排队中的任务各自持有 shared_ptr，closeHandle 之后由最后一个任务释放
+  struct TransferHandle {
+    ~TransferHandle() {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+
+    std::shared_ptr<SerialTaskQueue> queue = SerialTaskQueue::Create(TaskPriority::kFile);
+    int fd = -1;
+    bool writing = false;
+    std::string path;
+    int64_t size = 0;
+    int64_t chunk_size = kDefaultChunkSize;
+    int64_t offset = 0;
+    std::atomic<int64_t> bytes{0};
+    Clock::time_point opened;
+    // 压缩传输：读取方压缩、写入方解压，wire_bytes 为通道上的压缩后字节数
+    std::unique_ptr<ZstdCompressor> compressor;
+    std::unique_ptr<ZstdDecompressor> decompressor;
+    bool compressed_eof = false;
+    std::atomic<int64_t> wire_bytes{0};
+    // 目录归档的读取或解包
+    std::unique_ptr<DirArchiveReader> archive;
+    std::unique_ptr<DirArchiveExtractor> extractor;
+    // 压缩器和归档内部的计数只在 queue 上访问，每次读写后同步到这里供统计
+    std::atomic<int> level{0};
+    std::atomic<int64_t> files{0};
+  };
+
+  // 工作池上的操作累加的字节数，任务按值捕获 shared_ptr
+  struct TransferTotals {
+    std::atomic<int64_t> bytes_read{0};
+    std::atomic<int64_t> bytes_written{0};
+  };
+
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // 以下在工作池上执行，不访问插件状态
+  static bool GetFileList(const std::string& path, flutter::EncodableList* fileList, std::string* error);
+  static bool UploadFile(const std::string& targetPath, const std::string& fileName, const std::vector<uint8_t>& fileData);
+  static std::vector<uint8_t> DownloadFile(const std::string& filePath);
+  static bool DeleteFile(const std::string& filePath);
+  static bool RenameFile(const std::string& oldPath, const std::string& newPath);
+  static bool MoveFile(const std::string& sourcePath, const std::string& targetPath);
+  static bool CreateDirectory(const std::string& path);
+
+  void HandleStreamCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  std::shared_ptr<TransferHandle> FindHandle(const flutter::EncodableMap* args);
+  // 以下在句柄的 queue 上执行
+  // 打开成功后在平台线程上登记句柄，返回值里加上句柄号
+  std::function<MethodOutcome(MethodOutcome)> RegisterHandle(std::shared_ptr<TransferHandle> handle);
+  static MethodOutcome OpenHandle(TransferHandle* handle, bool append, bool compress, int level);
+  static MethodOutcome ReadHandleChunk(TransferHandle* handle, bool positioned, int64_t offset,
+                                       TransferTotals* totals);
+  static MethodOutcome WriteHandleChunk(TransferHandle* handle, const std::vector<uint8_t>& data,
+                                        bool positioned, int64_t offset, TransferTotals* totals);
+  static MethodOutcome CloseHandle(TransferHandle* handle);
+  static flutter::EncodableValue HandleStats(const TransferHandle& handle);
+
+  void HandleResumableCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleDeltaCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleListCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  // 从 cursor 对应的快照切出一页，快照必须存在；最后一页送出后释放快照
+  flutter::EncodableValue ListingPage(int64_t cursor, int64_t offset, int64_t page_size);
+  void HandleIndexCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void HandleJobCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+  void SendJobProgress(const FileJobProgress& progress);
+  void HandleCacheCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  std::map<int64_t, std::shared_ptr<TransferHandle>> handles_;
+  int64_t next_handle_ = 1;
+  std::shared_ptr<TransferTotals> totals_ = std::make_shared<TransferTotals>();
+  // 插件析构后失效，工作池任务回到平台线程时据此判断还能否更新插件状态
+  std::shared_ptr<bool> alive_ = std::make_shared<bool>(true);
+
+  // 可续传的分块接收任务，读写都在工作池上进行，任务各自持有 shared_ptr。
+  // putChunk 持共享锁并发写入不同的块；finishTransfer 和 abortTransfer 持独占锁，
+  // 等已开始的写入结束，之后排到的写入看到 closed 直接失败
+  struct ResumableEntry {
+    ResumableTransfer transfer;
+    Clock::time_point started = Clock::now();
+    std::shared_mutex mutex;
+    bool closed = false;
+  };
+  std::map<int64_t, std::shared_ptr<ResumableEntry>> transfers_;
+  int64_t next_transfer_ = 1;
+
+  // 分页列举的目录快照，按游标取后续页
+  struct ListingSnapshot {
+    std::string path;
+    DirListing listing;
+  };
+  std::map<int64_t, ListingSnapshot> listings_;
+  int64_t next_cursor_ = 1;
+
+  // 文件名索引，第一次使用时创建。自身带锁，工作池上的添加和查询持有 shared_ptr
+  std::shared_ptr<FileIndex> index_;
+
+  // 后台复制、移动、删除任务，进度通过 file_operation/progress 事件通道推送
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> progress_channel_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> progress_sink_;
+  std::unique_ptr<FileJobManager> jobs_;
+
+  // 内容寻址块缓存，第一次使用时在用户缓存目录下打开
+  // 工作池上的操作持有 shared_ptr，换目录时旧缓存等它们结束后再释放
+  std::shared_ptr<ChunkStore> chunk_store_;
+  std::string cache_directory_;
+  int64_t cache_capacity_ = kDefaultCacheCapacity;
+};
+
+std::unique_ptr<FileOperationPlugin> FileOperationPlugin::Create(
+    flutter::BinaryMessenger *messenger) {
+  auto channel =
+      std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+          messenger, "file_operation",
+          &flutter::StandardMethodCodec::GetInstance());
+
+  auto plugin = std::make_unique<FileOperationPlugin>();
+
+  channel->SetMethodCallHandler(
+      [plugin_pointer = plugin.get()](const auto &call, auto result) {
+        plugin_pointer->HandleMethodCall(call, std::move(result));
+      });
+
+  plugin->progress_channel_ = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+      messenger, "file_operation/progress",
+      &flutter::StandardMethodCodec::GetInstance());
+  plugin->progress_channel_->SetStreamHandler(
+      std::make_unique<flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+          [plugin_pointer = plugin.get()](
+              const flutter::EncodableValue* arguments,
+              std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->progress_sink_ = std::move(events);
+            return nullptr;
+          },
+          [plugin_pointer = plugin.get()](const flutter::EncodableValue* arguments)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->progress_sink_.reset();
+            return nullptr;
+          }));
+
+  return plugin;
+}
+
+FileOperationPlugin::FileOperationPlugin() {}
+
+FileOperationPlugin::~FileOperationPlugin() {}
+
+void FileOperationPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const std::string& method = method_call.method_name();
+
+  if (method == "openRead" || method == "openWrite" || method == "readChunk" ||
+      method == "writeChunk" || method == "closeHandle" || method == "getTransferStats" ||
+      method == "sendFile" || method == "openArchive" || method == "openExtract") {
+    HandleStreamCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "beginTransfer" || method == "putChunk" || method == "finishTransfer" ||
+      method == "abortTransfer" || method == "getChunkHashes") {
+    HandleResumableCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "indexAddRoot" || method == "indexSearch" || method == "indexStatus" ||
+      method == "indexClear") {
+    HandleIndexCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "copyItems" || method == "moveItems" || method == "deleteItems" ||
+      method == "cancelJob") {
+    HandleJobCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "listDirectory" || method == "closeListing") {
+    HandleListCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "getSignature" || method == "computeDelta" || method == "applyDelta") {
+    HandleDeltaCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "chunkFile" || method == "readContentChunk" || method == "cacheMissing" ||
+      method == "cachePut" || method == "cacheAssemble" || method == "cacheAddFile" ||
+      method == "cacheStats" || method == "cacheConfigure" || method == "cacheClear") {
+    HandleCacheCall(method, args, std::move(result));
+    return;
+  }
+
+  // 以下一次性的文件操作不依赖插件状态，放到共享工作池执行，慢速磁盘或大目录不会卡住平台线程
+  if (method.compare("getFileList") == 0) {
+    if (args && args->find(flutter::EncodableValue("path")) != args->end()) {
+      std::string path = GetString(*args, "path", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [path]() {
+        flutter::EncodableList fileList;
+        std::string error;
+        if (!GetFileList(path, &fileList, &error)) {
+          return MethodOutcome::Fail("LIST_FAILED", error);
+        }
+        return MethodOutcome::Ok(flutter::EncodableValue(std::move(fileList)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("uploadFile") == 0) {
+    const flutter::EncodableValue* data = args ? FindArg(*args, "fileData") : nullptr;
+    if (args && data && FindArg(*args, "targetPath") && FindArg(*args, "fileName")) {
+      std::string targetPath = GetString(*args, "targetPath", "");
+      std::string fileName = GetString(*args, "fileName", "");
+      // 参数在本次调用返回后失效，数据需要复制一份交给工作线程
+      std::vector<uint8_t> fileData;
+      if (const auto* bytes = std::get_if<std::vector<uint8_t>>(data)) {
+        fileData = *bytes;
+      } else if (const auto* list = std::get_if<flutter::EncodableList>(data)) {
+        // 兼容旧版本按 List<int> 传入的数据
+        fileData.reserve(list->size());
+        for (const auto& item : *list) {
+          const auto* byte = std::get_if<int32_t>(&item);
+          // 超出 0..255 的值不是字节，截断会悄悄写入错误的数据
+          if (!byte || *byte < 0 || *byte > 255) {
+            result->Error("INVALID_ARGS", "Invalid arguments");
+            return;
+          }
+          fileData.push_back(static_cast<uint8_t>(*byte));
+        }
+      } else {
+        result->Success(flutter::EncodableValue(false));
+        return;
+      }
+      RunMethodAsync(TaskPriority::kFile, std::move(result),
+                     [targetPath, fileName, fileData = std::move(fileData)]() {
+                       return MethodOutcome::Ok(
+                           flutter::EncodableValue(UploadFile(targetPath, fileName, fileData)));
+                     });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("downloadFile") == 0) {
+    if (args && FindArg(*args, "filePath")) {
+      std::string filePath = GetString(*args, "filePath", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [filePath, totals = totals_]() {
+        std::vector<uint8_t> fileData = DownloadFile(filePath);
+        totals->bytes_read += fileData.size();
+        return MethodOutcome::Ok(flutter::EncodableValue(std::move(fileData)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("deleteFile") == 0) {
+    if (args && FindArg(*args, "filePath")) {
+      std::string filePath = GetString(*args, "filePath", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [filePath]() {
+        return MethodOutcome::Ok(flutter::EncodableValue(DeleteFile(filePath)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("renameFile") == 0) {
+    if (args && FindArg(*args, "oldPath") && FindArg(*args, "newPath")) {
+      std::string oldPath = GetString(*args, "oldPath", "");
+      std::string newPath = GetString(*args, "newPath", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [oldPath, newPath]() {
+        return MethodOutcome::Ok(flutter::EncodableValue(RenameFile(oldPath, newPath)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("moveFile") == 0) {
+    if (args && FindArg(*args, "sourcePath") && FindArg(*args, "targetPath")) {
+      std::string sourcePath = GetString(*args, "sourcePath", "");
+      std::string targetPath = GetString(*args, "targetPath", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [sourcePath, targetPath]() {
+        return MethodOutcome::Ok(flutter::EncodableValue(MoveFile(sourcePath, targetPath)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else if (method.compare("createDirectory") == 0) {
+    if (args && FindArg(*args, "path")) {
+      std::string path = GetString(*args, "path", "");
+      RunMethodAsync(TaskPriority::kFile, std::move(result), [path]() {
+        return MethodOutcome::Ok(flutter::EncodableValue(CreateDirectory(path)));
+      });
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+    }
+  } else {
+    result->NotImplemented();
+  }
+}
+
+void FileOperationPlugin::HandleStreamCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (method == "sendFile") {
+    // 直接把文件写到原生传输套接字，不经过方法通道和 Dart
+    std::string path = args ? GetString(*args, "filePath", "") : "";
+    std::string socketPath = args ? GetString(*args, "socketPath", "") : "";
+    std::string host = args ? GetString(*args, "host", "") : "";
+    int64_t port = 0, offset = 0, length = -1;
+    if (args) {
+      GetInt64(*args, "port", &port);
+      GetInt64(*args, "offset", &offset);
+      GetInt64(*args, "length", &length);
+    }
+    if (path.empty() || (socketPath.empty() && (host.empty() || port <= 0))) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    // 连接和发送整个文件都可能很慢，放到共享工作池执行
+    bool buffered = GetBool(*args, "buffered", false);
+    RunMethodAsync(TaskPriority::kFile, std::move(result),
+                   [totals = totals_, path, socketPath, host, port, offset, length, buffered]() {
+      std::string error;
+      int socket_fd = ConnectTransportSocket(host, static_cast<int>(port), socketPath, &error);
+      if (socket_fd < 0) {
+        return MethodOutcome::Fail("CONNECT_FAILED", error);
+      }
+      FileSendStats stats;
+      bool ok = SendFileToSocket(path, socket_fd, offset, length, buffered, &stats, &error);
+      close(socket_fd);
+      totals->bytes_read += stats.bytes;
+      if (!ok) {
+        return MethodOutcome::Fail("SEND_FAILED", error);
+      }
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("bytes")] = flutter::EncodableValue(stats.bytes);
+      response[flutter::EncodableValue("elapsedMs")] = flutter::EncodableValue(stats.elapsed_ms);
+      response[flutter::EncodableValue("mbPerSec")] = flutter::EncodableValue(
+          stats.elapsed_ms > 0 ? stats.bytes / (1024.0 * 1024.0) / (stats.elapsed_ms / 1000.0) : 0.0);
+      response[flutter::EncodableValue("zeroCopy")] = flutter::EncodableValue(stats.zero_copy);
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+  } else if (method == "openRead" || method == "openWrite") {
+    std::string path = args ? GetString(*args, "path", "") : "";
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    auto handle = std::make_shared<TransferHandle>();
+    handle->writing = method == "openWrite";
+    handle->path = path;
+    if (GetInt64(*args, "chunkSize", &handle->chunk_size)) {
+      handle->chunk_size = std::max(kMinChunkSize, std::min(handle->chunk_size, kMaxChunkSize));
+    }
+    bool append = GetBool(*args, "append", false);
+    bool compress = handle->writing ? GetBool(*args, "compressed", false) : GetBool(*args, "compress", false);
+    int64_t level = 0;
+    GetInt64(*args, "level", &level);
+    // 网络文件系统上 open 也可能阻塞，和之后的读写一样放到句柄的队列上
+    RunMethodAsync(handle->queue.get(), std::move(result),
+                   [handle, append, compress, level]() {
+                     return OpenHandle(handle.get(), append, compress, static_cast<int>(level));
+                   },
+                   RegisterHandle(handle));
+  } else if (method == "openArchive" || method == "openExtract") {
+    // 整个目录作为一个压缩归档流读取，或把这样的流解包到目录
+    std::string path = args ? GetString(*args, "path", "") : "";
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    auto handle = std::make_shared<TransferHandle>();
+    handle->path = path;
+    handle->writing = method == "openExtract";
+    int64_t level = 0;
+    GetInt64(*args, "level", &level);
+    RunMethodAsync(handle->queue.get(), std::move(result),
+                   [handle, level]() {
+                     std::string error;
+                     if (handle->writing) {
+                       handle->extractor = std::make_unique<DirArchiveExtractor>();
+                       if (!handle->extractor->Open(handle->path, &error)) {
+                         return MethodOutcome::Fail("OPEN_FAILED", error);
+                       }
+                     } else {
+                       handle->archive = std::make_unique<DirArchiveReader>();
+                       if (!handle->archive->Start(handle->path, static_cast<int>(level), &error)) {
+                         return MethodOutcome::Fail("OPEN_FAILED", error);
+                       }
+                       handle->level = handle->archive->level();
+                     }
+                     handle->opened = Clock::now();
+                     return MethodOutcome::Ok(flutter::EncodableValue(flutter::EncodableMap()));
+                   },
+                   RegisterHandle(handle));
+  } else if (method == "readChunk") {
+    std::shared_ptr<TransferHandle> handle = FindHandle(args);
+    if (!handle || handle->writing) {
+      result->Error("INVALID_HANDLE", "Invalid handle");
+      return;
+    }
+    int64_t offset = 0;
+    bool positioned = GetInt64(*args, "offset", &offset);
+    RunMethodAsync(handle->queue.get(), std::move(result),
+                   [handle, positioned, offset, totals = totals_]() {
+                     return ReadHandleChunk(handle.get(), positioned, offset, totals.get());
+                   });
+  } else if (method == "writeChunk") {
+    std::shared_ptr<TransferHandle> handle = FindHandle(args);
+    const std::vector<uint8_t>* data = args ? GetBytes(*args, "data") : nullptr;
+    if (!handle || !handle->writing || !data) {
+      result->Error("INVALID_HANDLE", "Invalid handle");
+      return;
+    }
+    int64_t offset = 0;
+    bool positioned = GetInt64(*args, "offset", &offset);
+    // 参数在本次调用返回后失效，数据复制一份交给队列
+    RunMethodAsync(handle->queue.get(), std::move(result),
+                   [handle, data = *data, positioned, offset, totals = totals_]() {
+                     return WriteHandleChunk(handle.get(), data, positioned, offset, totals.get());
+                   });
+  } else if (method == "closeHandle") {
+    std::shared_ptr<TransferHandle> handle = FindHandle(args);
+    if (!handle) {
+      result->Error("INVALID_HANDLE", "Invalid handle");
+      return;
+    }
+    // 立即从表中移除，之后的调用拿不到它；已排队的读写先于关闭执行
+    int64_t id = 0;
+    GetInt64(*args, "handle", &id);
+    handles_.erase(id);
+    RunMethodAsync(handle->queue.get(), std::move(result),
+                   [handle]() { return CloseHandle(handle.get()); });
+  } else {
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("openHandles")] =
+        flutter::EncodableValue(static_cast<int64_t>(handles_.size()));
+    response[flutter::EncodableValue("totalBytesRead")] =
+        flutter::EncodableValue(totals_->bytes_read.load());
+    response[flutter::EncodableValue("totalBytesWritten")] =
+        flutter::EncodableValue(totals_->bytes_written.load());
+    flutter::EncodableList transfers;
+    for (const auto& entry : handles_) {
+      transfers.push_back(HandleStats(*entry.second));
+    }
+    response[flutter::EncodableValue("transfers")] = flutter::EncodableValue(transfers);
+    result->Success(flutter::EncodableValue(response));
+  }
+}
+
+std::function<MethodOutcome(MethodOutcome)> FileOperationPlugin::RegisterHandle(
+    std::shared_ptr<TransferHandle> handle) {
+  return [this, alive = std::weak_ptr<bool>(alive_), handle](MethodOutcome outcome) {
+    if (!outcome.ok) {
+      return outcome;
+    }
+    if (!alive.lock()) {
+      return MethodOutcome::Fail("OPEN_FAILED", "Plugin destroyed");
+    }
+    int64_t id = next_handle_++;
+    handles_[id] = handle;
+    flutter::EncodableMap response = std::get<flutter::EncodableMap>(outcome.value);
+    response[flutter::EncodableValue("handle")] = flutter::EncodableValue(id);
+    return MethodOutcome::Ok(flutter::EncodableValue(response));
+  };
+}
+
+MethodOutcome FileOperationPlugin::OpenHandle(TransferHandle* handle, bool append, bool compress,
+                                              int level) {
+  int flags = O_CLOEXEC;
+  if (handle->writing) {
+    flags |= O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC);
+  } else {
+    flags |= O_RDONLY;
+  }
+  handle->fd = open(handle->path.c_str(), flags, 0644);
+  if (handle->fd < 0) {
+    return MethodOutcome::Fail("OPEN_FAILED", strerror(errno));
+  }
+  struct stat st;
+  if (fstat(handle->fd, &st) == 0) {
+    handle->size = st.st_size;
+  }
+  if (!handle->writing) {
+    // 顺序读取，提示内核加大预读
+    posix_fadvise(handle->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  }
+  if (!handle->writing && compress) {
+    handle->compressor = std::make_unique<ZstdCompressor>(level);
+    handle->level = handle->compressor->level();
+  } else if (handle->writing && compress) {
+    handle->decompressor = std::make_unique<ZstdDecompressor>();
+  }
+  handle->opened = Clock::now();
+
+  flutter::EncodableMap response;
+  response[flutter::EncodableValue("size")] = flutter::EncodableValue(handle->size);
+  response[flutter::EncodableValue("chunkSize")] = flutter::EncodableValue(handle->chunk_size);
+  return MethodOutcome::Ok(flutter::EncodableValue(response));
+}
+
+MethodOutcome FileOperationPlugin::ReadHandleChunk(TransferHandle* handle, bool positioned,
+                                                   int64_t offset, TransferTotals* totals) {
+  if (handle->archive) {
+    std::vector<uint8_t> block;
+    std::string error;
+    if (!handle->archive->Next(&block, &error)) {
+      return MethodOutcome::Fail("READ_FAILED", error);
+    }
+    handle->bytes = handle->archive->bytes_in();
+    handle->wire_bytes += block.size();
+    handle->files = handle->archive->files();
+    handle->level = handle->archive->level();
+    totals->bytes_read += block.size();
+    return MethodOutcome::Ok(flutter::EncodableValue(std::move(block)));
+  }
+  if (handle->compressed_eof) {
+    return MethodOutcome::Ok(flutter::EncodableValue(std::vector<uint8_t>()));
+  }
+  // 指定 offset 时随机读取，否则接着上次的位置。压缩流只能顺序读取
+  if (!positioned || handle->compressor) {
+    offset = handle->offset;
+  }
+  std::vector<uint8_t> chunk(handle->chunk_size);
+  ssize_t read_bytes;
+  do {
+    read_bytes = pread(handle->fd, chunk.data(), chunk.size(), offset);
+  } while (read_bytes < 0 && errno == EINTR);
+  if (read_bytes < 0) {
+    return MethodOutcome::Fail("READ_FAILED", strerror(errno));
+  }
+  chunk.resize(read_bytes);
+  handle->offset = offset + read_bytes;
+  handle->bytes += read_bytes;
+  totals->bytes_read += read_bytes;
+  if (handle->compressor) {
+    // 每块都 flush，对端收到即可解出；读到末尾时结束帧，下一次再返回空数据
+    std::vector<uint8_t> compressed;
+    std::string error;
+    ZstdCompressor::Mode mode =
+        read_bytes > 0 ? ZstdCompressor::Mode::kFlush : ZstdCompressor::Mode::kEnd;
+    if (!handle->compressor->Compress(chunk.data(), chunk.size(), mode, &compressed, &error)) {
+      return MethodOutcome::Fail("COMPRESS_FAILED", error);
+    }
+    handle->compressed_eof = read_bytes == 0;
+    handle->wire_bytes += compressed.size();
+    handle->level = handle->compressor->level();
+    return MethodOutcome::Ok(flutter::EncodableValue(std::move(compressed)));
+  }
+  // 到达文件末尾时返回空数据
+  return MethodOutcome::Ok(flutter::EncodableValue(std::move(chunk)));
+}
+
+MethodOutcome FileOperationPlugin::WriteHandleChunk(TransferHandle* handle,
+                                                    const std::vector<uint8_t>& data, bool positioned,
+                                                    int64_t offset, TransferTotals* totals) {
+  std::string error;
+  if (handle->extractor) {
+    if (!handle->extractor->Write(data.data(), data.size(), &error)) {
+      return MethodOutcome::Fail("WRITE_FAILED", error);
+    }
+    handle->wire_bytes += data.size();
+    totals->bytes_written += handle->extractor->bytes_out() - handle->bytes;
+    handle->bytes = handle->extractor->bytes_out();
+    handle->files = handle->extractor->files();
+    return MethodOutcome::Ok(flutter::EncodableValue(static_cast<int64_t>(data.size())));
+  }
+  const std::vector<uint8_t>* plain = &data;
+  std::vector<uint8_t> decompressed;
+  if (handle->decompressor) {
+    if (!handle->decompressor->Decompress(data.data(), data.size(), &decompressed, &error)) {
+      return MethodOutcome::Fail("DECOMPRESS_FAILED", error);
+    }
+    handle->wire_bytes += data.size();
+    plain = &decompressed;
+  }
+  if (!positioned) {
+    offset = handle->offset;
+  }
+  size_t written = 0;
+  while (written < plain->size()) {
+    ssize_t n = positioned
+        ? pwrite(handle->fd, plain->data() + written, plain->size() - written, offset + written)
+        : write(handle->fd, plain->data() + written, plain->size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return MethodOutcome::Fail("WRITE_FAILED", strerror(errno));
+    }
+    written += n;
+  }
+  handle->offset = offset + written;
+  handle->bytes += written;
+  totals->bytes_written += written;
+  return MethodOutcome::Ok(flutter::EncodableValue(static_cast<int64_t>(written)));
+}
+
+MethodOutcome FileOperationPlugin::CloseHandle(TransferHandle* handle) {
+  bool ok = true;
+  std::string error;
+  if (handle->fd >= 0) {
+    if (handle->writing) {
+      ok = fsync(handle->fd) == 0;
+    }
+    ok = close(handle->fd) == 0 && ok;
+    handle->fd = -1;
+    if (!ok) {
+      error = strerror(errno);
+    }
+  }
+  // 压缩流或归档没有完整结束说明数据被截断
+  if (ok && handle->extractor) {
+    ok = handle->extractor->Finish(&error);
+    handle->files = handle->extractor->files();
+  }
+  if (ok && handle->decompressor && !handle->decompressor->frame_complete()) {
+    ok = false;
+    error = "compressed stream truncated";
+  }
+  if (!ok) {
+    return MethodOutcome::Fail("CLOSE_FAILED", error);
+  }
+  return MethodOutcome::Ok(HandleStats(*handle));
+}
+
+void FileOperationPlugin::HandleResumableCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!args) {
+    result->Error("INVALID_ARGS", "Invalid arguments");
+    return;
+  }
+
+  if (method == "getChunkHashes") {
+    // 发送端：并行计算各块哈希，接收端据此校验每一块和整个文件
+    std::string path = GetString(*args, "filePath", "");
+    int64_t chunk_size = kDefaultChunkSize;
+    GetInt64(*args, "chunkSize", &chunk_size);
+    chunk_size = std::clamp(chunk_size, kMinChunkSize, kMaxChunkSize);
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [path, chunk_size]() {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return MethodOutcome::Fail("OPEN_FAILED", strerror(errno));
+      }
+      struct stat st;
+      std::vector<uint64_t> hashes;
+      bool ok = fstat(fd, &st) == 0 && HashFileChunks(fd, st.st_size, chunk_size, &hashes);
+      close(fd);
+      if (!ok) {
+        return MethodOutcome::Fail("READ_FAILED", "Failed to hash file");
+      }
+      flutter::EncodableList hash_list;
+      for (uint64_t hash : hashes) {
+        hash_list.push_back(flutter::EncodableValue(HashToHex(hash)));
+      }
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("size")] = flutter::EncodableValue(static_cast<int64_t>(st.st_size));
+      response[flutter::EncodableValue("chunkSize")] = flutter::EncodableValue(chunk_size);
+      response[flutter::EncodableValue("hashes")] = flutter::EncodableValue(hash_list);
+      response[flutter::EncodableValue("fileHash")] =
+          flutter::EncodableValue(HashToHex(CombineChunkHashes(hashes)));
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+    return;
+  }
+
+  if (method == "beginTransfer") {
+    std::string path = GetString(*args, "path", "");
+    int64_t size = -1;
+    int64_t chunk_size = kDefaultChunkSize;
+    GetInt64(*args, "size", &size);
+    GetInt64(*args, "chunkSize", &chunk_size);
+    if (path.empty() || size < 0) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    chunk_size = std::clamp(chunk_size, kMinChunkSize, kMaxChunkSize);
+    // 续传时要重新校验已完成的块，打开和校验都放到工作池上，成功后回到平台线程登记
+    auto entry = std::make_shared<ResumableEntry>();
+    RunMethodAsync(
+        TaskPriority::kFile, std::move(result),
+        [entry, path, size, chunk_size]() {
+          ResumableTransfer* transfer = &entry->transfer;
+          std::string error;
+          if (!transfer->Begin(path, size, chunk_size, &error)) {
+            return MethodOutcome::Fail("OPEN_FAILED", error);
+          }
+          flutter::EncodableList missing;
+          for (int64_t index : transfer->MissingChunks()) {
+            missing.push_back(flutter::EncodableValue(index));
+          }
+          flutter::EncodableMap response;
+          response[flutter::EncodableValue("chunkSize")] = flutter::EncodableValue(chunk_size);
+          response[flutter::EncodableValue("chunkCount")] = flutter::EncodableValue(transfer->chunk_count());
+          response[flutter::EncodableValue("resumed")] = flutter::EncodableValue(transfer->resumed());
+          response[flutter::EncodableValue("missing")] = flutter::EncodableValue(missing);
+          return MethodOutcome::Ok(flutter::EncodableValue(response));
+        },
+        [this, alive = std::weak_ptr<bool>(alive_), entry](MethodOutcome outcome) {
+          if (!outcome.ok) {
+            return outcome;
+          }
+          if (!alive.lock()) {
+            return MethodOutcome::Fail("OPEN_FAILED", "Plugin destroyed");
+          }
+          int64_t id = next_transfer_++;
+          entry->started = Clock::now();
+          transfers_[id] = entry;
+          flutter::EncodableMap response = std::get<flutter::EncodableMap>(outcome.value);
+          response[flutter::EncodableValue("transferId")] = flutter::EncodableValue(id);
+          return MethodOutcome::Ok(flutter::EncodableValue(response));
+        });
+    return;
+  }
+
+  int64_t id = 0;
+  GetInt64(*args, "transferId", &id);
+  auto it = transfers_.find(id);
+  if (it == transfers_.end()) {
+    result->Error("INVALID_HANDLE", "Invalid transfer");
+    return;
+  }
+  std::shared_ptr<ResumableEntry> entry = it->second;
+
+  if (method == "putChunk") {
+    const std::vector<uint8_t>* data = GetBytes(*args, "data");
+    int64_t index = -1;
+    uint64_t hash = 0;
+    if (!data || !GetInt64(*args, "index", &index) ||
+        !HashFromHex(GetString(*args, "hash", ""), &hash)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    // 参数在本次调用返回后失效，数据复制一份交给工作池
+    RunMethodAsync(TaskPriority::kFile, std::move(result),
+                   [entry, data = *data, index, hash, totals = totals_]() {
+                     std::shared_lock<std::shared_mutex> lock(entry->mutex);
+                     if (entry->closed) {
+                       return MethodOutcome::Fail("INVALID_HANDLE", "Invalid transfer");
+                     }
+                     std::string error;
+                     if (!entry->transfer.PutChunk(index, data.data(), data.size(), hash, &error)) {
+                       return MethodOutcome::Fail("CHUNK_FAILED", error);
+                     }
+                     totals->bytes_written += data.size();
+                     return MethodOutcome::Ok(flutter::EncodableValue(entry->transfer.completed_chunks()));
+                   });
+  } else if (method == "finishTransfer") {
+    uint64_t expected = 0;
+    bool has_expected = HashFromHex(GetString(*args, "fileHash", ""), &expected);
+    // 整个文件的校验期间任务不在 transfers_ 中，其他调用拿不到它；
+    // 校验失败时再放回去，调用方可以补传
+    transfers_.erase(it);
+    RunMethodAsync(
+        TaskPriority::kFile, std::move(result),
+        [entry, has_expected, expected]() {
+          std::unique_lock<std::shared_mutex> lock(entry->mutex);
+          ResumableTransfer* transfer = &entry->transfer;
+          uint64_t actual = 0;
+          std::string error;
+          if (!transfer->Finish(has_expected ? &expected : nullptr, &actual, &error)) {
+            // 校验失败的块重新变为缺失，返回给调用方补传
+            flutter::EncodableList missing;
+            for (int64_t index : transfer->MissingChunks()) {
+              missing.push_back(flutter::EncodableValue(index));
+            }
+            return MethodOutcome::Fail("VERIFY_FAILED", error, flutter::EncodableValue(missing));
+          }
+          entry->closed = true;
+          double elapsed_ms =
+              std::chrono::duration<double, std::milli>(Clock::now() - entry->started).count();
+          flutter::EncodableMap response;
+          response[flutter::EncodableValue("size")] = flutter::EncodableValue(transfer->size());
+          response[flutter::EncodableValue("fileHash")] = flutter::EncodableValue(HashToHex(actual));
+          response[flutter::EncodableValue("elapsedMs")] = flutter::EncodableValue(elapsed_ms);
+          response[flutter::EncodableValue("mbPerSec")] = flutter::EncodableValue(
+              elapsed_ms > 0 ? transfer->bytes_received() / (1024.0 * 1024.0) / (elapsed_ms / 1000.0)
+                             : 0.0);
+          return MethodOutcome::Ok(flutter::EncodableValue(response));
+        },
+        [this, alive = std::weak_ptr<bool>(alive_), id, entry](MethodOutcome outcome) {
+          if (!outcome.ok && alive.lock()) {
+            transfers_[id] = entry;
+          }
+          return outcome;
+        });
+  } else {
+    // 默认保留临时文件，之后可以续传
+    bool keep_partial = GetBool(*args, "keepPartial", true);
+    transfers_.erase(it);
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [entry, keep_partial]() {
+      std::unique_lock<std::shared_mutex> lock(entry->mutex);
+      entry->transfer.Abort(keep_partial);
+      entry->closed = true;
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  }
+}
+
+void FileOperationPlugin::HandleListCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  int64_t cursor = 0;
+  if (args) {
+    GetInt64(*args, "cursor", &cursor);
+  }
+  if (method == "closeListing") {
+    listings_.erase(cursor);
+    result->Success(flutter::EncodableValue(true));
+    return;
+  }
+
+  int64_t offset = 0;
+  int64_t page_size = kDefaultPageSize;
+  if (args) {
+    GetInt64(*args, "offset", &offset);
+    GetInt64(*args, "pageSize", &page_size);
+  }
+  if (cursor == 0) {
+    // 第一页：列举、过滤、排序后保存快照，后续页只做切片
+    std::string path = args ? GetString(*args, "path", "") : "";
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    DirListOptions options;
+    std::string sort = GetString(*args, "sort", "name");
+    options.sort = sort == "size"       ? DirListOptions::SortKey::kSize
+                   : sort == "modified" ? DirListOptions::SortKey::kModified
+                   : sort == "none"     ? DirListOptions::SortKey::kNone
+                                        : DirListOptions::SortKey::kName;
+    options.descending = GetBool(*args, "descending", false);
+    options.directories_first = GetBool(*args, "directoriesFirst", true);
+    options.show_hidden = GetBool(*args, "showHidden", true);
+    options.filter = GetString(*args, "filter", "");
+
+    // 列举大目录很慢，放到工作池执行，回到平台线程后再登记快照、切出第一页
+    auto snapshot = std::make_shared<ListingSnapshot>();
+    snapshot->path = path;
+    RunMethodAsync(
+        TaskPriority::kFile, std::move(result),
+        [snapshot, options]() {
+          std::string error;
+          if (!ListDirectory(snapshot->path, options, &snapshot->listing, &error)) {
+            return MethodOutcome::Fail("LIST_FAILED", error);
+          }
+          return MethodOutcome::Ok(flutter::EncodableValue());
+        },
+        [this, alive = std::weak_ptr<bool>(alive_), snapshot, offset, page_size](MethodOutcome outcome) {
+          if (!outcome.ok) {
+            return outcome;
+          }
+          if (!alive.lock()) {
+            return MethodOutcome::Fail("LIST_FAILED", "Plugin destroyed");
+          }
+          if (listings_.size() >= kMaxListingSnapshots) {
+            listings_.erase(listings_.begin());
+          }
+          int64_t cursor = next_cursor_++;
+          listings_.emplace(cursor, std::move(*snapshot));
+          return MethodOutcome::Ok(ListingPage(cursor, offset, page_size));
+        });
+    return;
+  }
+  if (listings_.find(cursor) == listings_.end()) {
+    result->Error("INVALID_CURSOR", "Listing expired");
+    return;
+  }
+  result->Success(ListingPage(cursor, offset, page_size));
+}
+
+flutter::EncodableValue FileOperationPlugin::ListingPage(int64_t cursor, int64_t offset,
+                                                         int64_t page_size) {
+  auto it = listings_.find(cursor);
+  const DirListing& listing = it->second.listing;
+  size_t begin = static_cast<size_t>(std::clamp<int64_t>(offset, 0, listing.size()));
+  size_t end = std::min(listing.size(), begin + static_cast<size_t>(std::max<int64_t>(page_size, 1)));
+
+  // 按列返回：名称列表加三个类型化数组，避免每个条目一个 map
+  flutter::EncodableList names;
+  names.reserve(end - begin);
+  for (size_t i = begin; i < end; i++) {
+    names.push_back(flutter::EncodableValue(listing.names[i]));
+  }
+  flutter::EncodableMap response;
+  response[flutter::EncodableValue("cursor")] = flutter::EncodableValue(cursor);
+  response[flutter::EncodableValue("path")] = flutter::EncodableValue(it->second.path);
+  response[flutter::EncodableValue("total")] = flutter::EncodableValue(static_cast<int64_t>(listing.size()));
+  response[flutter::EncodableValue("offset")] = flutter::EncodableValue(static_cast<int64_t>(begin));
+  response[flutter::EncodableValue("hasMore")] = flutter::EncodableValue(end < listing.size());
+  response[flutter::EncodableValue("names")] = flutter::EncodableValue(std::move(names));
+  response[flutter::EncodableValue("types")] = flutter::EncodableValue(
+      std::vector<uint8_t>(listing.types.begin() + begin, listing.types.begin() + end));
+  response[flutter::EncodableValue("sizes")] = flutter::EncodableValue(
+      std::vector<int64_t>(listing.sizes.begin() + begin, listing.sizes.begin() + end));
+  response[flutter::EncodableValue("modified")] = flutter::EncodableValue(
+      std::vector<int64_t>(listing.modified.begin() + begin, listing.modified.begin() + end));
+  if (end >= listing.size()) {
+    // 最后一页送出后释放快照
+    listings_.erase(it);
+  }
+  return flutter::EncodableValue(response);
+}
+
+void FileOperationPlugin::HandleJobCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!args) {
+    result->Error("INVALID_ARGS", "Invalid arguments");
+    return;
+  }
+  if (!jobs_) {
+    // 进度在线程池中产生，投递回平台线程后再发给 Dart
+    jobs_ = std::make_unique<FileJobManager>(
+        [this, alive = std::weak_ptr<bool>(alive_)](const FileJobProgress& progress) {
+          PostToPlatformThread([this, alive, progress]() {
+            if (alive.lock()) {
+              SendJobProgress(progress);
+            }
+          });
+        });
+  }
+
+  if (method == "cancelJob") {
+    int64_t job_id = 0;
+    GetInt64(*args, "jobId", &job_id);
+    result->Success(flutter::EncodableValue(jobs_->Cancel(job_id)));
+    return;
+  }
+
+  FileJobKind kind = method == "copyItems"   ? FileJobKind::kCopy
+                     : method == "moveItems" ? FileJobKind::kMove
+                                             : FileJobKind::kDelete;
+  std::vector<std::string> sources =
+      GetStringList(*args, kind == FileJobKind::kDelete ? "paths" : "sources");
+  std::string destination = GetString(*args, "destination", "");
+  if (sources.empty() || (kind != FileJobKind::kDelete && destination.empty())) {
+    result->Error("INVALID_ARGS", "Invalid arguments");
+    return;
+  }
+  int64_t job_id = jobs_->Start(kind, sources, destination, GetBool(*args, "overwrite", false));
+  result->Success(flutter::EncodableValue(job_id));
+}
+
+void FileOperationPlugin::SendJobProgress(const FileJobProgress& progress) {
+  if (!progress_sink_) {
+    return;
+  }
+  const char* kind = progress.kind == FileJobKind::kCopy   ? "copy"
+                     : progress.kind == FileJobKind::kMove ? "move"
+                                                           : "delete";
+  flutter::EncodableMap event;
+  event[flutter::EncodableValue("jobId")] = flutter::EncodableValue(progress.job_id);
+  event[flutter::EncodableValue("kind")] = flutter::EncodableValue(kind);
+  event[flutter::EncodableValue("filesDone")] = flutter::EncodableValue(progress.files_done);
+  event[flutter::EncodableValue("filesTotal")] = flutter::EncodableValue(progress.files_total);
+  event[flutter::EncodableValue("bytesDone")] = flutter::EncodableValue(progress.bytes_done);
+  event[flutter::EncodableValue("bytesTotal")] = flutter::EncodableValue(progress.bytes_total);
+  event[flutter::EncodableValue("bytesPerSec")] = flutter::EncodableValue(progress.bytes_per_sec);
+  event[flutter::EncodableValue("errors")] = flutter::EncodableValue(progress.errors);
+  event[flutter::EncodableValue("planning")] = flutter::EncodableValue(progress.planning);
+  event[flutter::EncodableValue("finished")] = flutter::EncodableValue(progress.finished);
+  event[flutter::EncodableValue("cancelled")] = flutter::EncodableValue(progress.cancelled);
+  if (!progress.error.empty()) {
+    event[flutter::EncodableValue("error")] = flutter::EncodableValue(progress.error);
+  }
+  progress_sink_->Success(flutter::EncodableValue(event));
+}
+
+void FileOperationPlugin::HandleIndexCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (!index_) {
+    index_ = std::make_shared<FileIndex>();
+  }
+
+  if (method == "indexAddRoot") {
+    // 在后台建立索引，进度通过 indexStatus 查询。检查根目录的 stat 也可能阻塞，放到工作池执行
+    std::string path = args ? GetString(*args, "path", "") : "";
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [index = index_, path]() {
+      std::string error;
+      if (!index->AddRoot(path, &error)) {
+        return MethodOutcome::Fail("INVALID_ARGS", error);
+      }
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  } else if (method == "indexSearch") {
+    std::string query = args ? GetString(*args, "query", "") : "";
+    if (query.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    FileIndex::SearchOptions options;
+    std::string mode = GetString(*args, "mode", "substring");
+    options.mode = mode == "prefix" ? FileIndex::MatchMode::kPrefix
+                   : mode == "glob" ? FileIndex::MatchMode::kGlob
+                                    : FileIndex::MatchMode::kSubstring;
+    options.case_sensitive = GetBool(*args, "caseSensitive", false);
+    options.include_directories = GetBool(*args, "includeDirectories", true);
+    int64_t limit = 200;
+    GetInt64(*args, "limit", &limit);
+    options.limit = static_cast<size_t>(std::clamp<int64_t>(limit, 1, 10000));
+
+    // 大索引上的通配符查询要扫描全部条目，放到工作池执行
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [index = index_, query, options]() {
+      Clock::time_point start = Clock::now();
+      FileIndex::SearchResult found = index->Search(query, options);
+      double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+      flutter::EncodableList paths;
+      for (auto& path : found.paths) {
+        paths.push_back(flutter::EncodableValue(std::move(path)));
+      }
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("paths")] = flutter::EncodableValue(std::move(paths));
+      response[flutter::EncodableValue("isDirectory")] =
+          flutter::EncodableValue(std::move(found.is_directory));
+      response[flutter::EncodableValue("total")] = flutter::EncodableValue(static_cast<int64_t>(found.total));
+      response[flutter::EncodableValue("elapsedMs")] = flutter::EncodableValue(elapsed_ms);
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+  } else if (method == "indexStatus") {
+    FileIndex::Status status = index_->GetStatus();
+    flutter::EncodableList roots;
+    for (const auto& root : status.roots) {
+      roots.push_back(flutter::EncodableValue(root));
+    }
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("entries")] = flutter::EncodableValue(static_cast<int64_t>(status.entries));
+    response[flutter::EncodableValue("directories")] =
+        flutter::EncodableValue(static_cast<int64_t>(status.directories));
+    response[flutter::EncodableValue("watches")] = flutter::EncodableValue(static_cast<int64_t>(status.watches));
+    response[flutter::EncodableValue("building")] = flutter::EncodableValue(status.building);
+    response[flutter::EncodableValue("watchLimitReached")] =
+        flutter::EncodableValue(status.watch_limit_reached);
+    response[flutter::EncodableValue("roots")] = flutter::EncodableValue(roots);
+    result->Success(flutter::EncodableValue(response));
+  } else {
+    // 要等构建线程退出，放到工作池执行
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [index = index_]() {
+      index->Clear();
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  }
+}
+
+void FileOperationPlugin::HandleDeltaCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  std::string path = args ? GetString(*args, "filePath", "") : "";
+  if (path.empty()) {
+    result->Error("INVALID_ARGS", "Invalid arguments");
+    return;
+  }
+  // 签名和增量都要读完整个文件，放到共享工作池执行；参数中的字节数组复制后交给工作线程
+  if (method == "getSignature") {
+    // 目标端：对现有文件生成块签名
+    int64_t block_size = 0;
+    GetInt64(*args, "blockSize", &block_size);
+    uint32_t size = static_cast<uint32_t>(std::clamp<int64_t>(block_size, 0, kMaxChunkSize));
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [path, size]() {
+      std::vector<uint8_t> signature;
+      std::string error;
+      if (!ComputeSignature(path, size, &signature, &error)) {
+        return MethodOutcome::Fail("READ_FAILED", error);
+      }
+      return MethodOutcome::Ok(flutter::EncodableValue(std::move(signature)));
+    });
+  } else if (method == "computeDelta") {
+    // 源端：根据目标端签名生成增量
+    const std::vector<uint8_t>* signature = GetBytes(*args, "signature");
+    if (!signature) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [totals = totals_, path, signature = *signature]() {
+      std::vector<uint8_t> delta;
+      DeltaStats stats;
+      std::string error;
+      if (!ComputeDelta(path, signature, &delta, &stats, &error)) {
+        return MethodOutcome::Fail("DELTA_FAILED", error);
+      }
+      totals->bytes_read += stats.copied_bytes + stats.literal_bytes;
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("copiedBytes")] = flutter::EncodableValue(stats.copied_bytes);
+      response[flutter::EncodableValue("literalBytes")] = flutter::EncodableValue(stats.literal_bytes);
+      response[flutter::EncodableValue("delta")] = flutter::EncodableValue(std::move(delta));
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+  } else {
+    // 目标端：重建文件并原子替换
+    const std::vector<uint8_t>* delta = GetBytes(*args, "delta");
+    if (!delta) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [totals = totals_, path, delta = *delta]() {
+      std::string error;
+      if (!ApplyDelta(path, delta, &error)) {
+        return MethodOutcome::Fail("APPLY_FAILED", error);
+      }
+      totals->bytes_written += delta.size();
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  }
+}
+
+namespace {
+
+// 哈希列表以 32 字节一项连续排列
+bool ParseChunkHashes(const std::vector<uint8_t>* data, std::vector<ChunkHash>* hashes) {
+  if (!data || data->size() % 32 != 0) {
+    return false;
+  }
+  hashes->resize(data->size() / 32);
+  for (size_t i = 0; i < hashes->size(); i++) {
+    std::copy(data->begin() + i * 32, data->begin() + (i + 1) * 32, (*hashes)[i].begin());
+  }
+  return true;
+}
+
+}  // namespace
+
+void FileOperationPlugin::HandleCacheCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (method == "chunkFile") {
+    // 发送端：按内容分块，返回各块哈希和长度，接收端据此只请求缓存里没有的块
+    std::string path = args ? GetString(*args, "filePath", "") : "";
+    if (path.empty()) {
+      result->Error("READ_FAILED", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [path]() {
+      std::vector<ContentChunk> chunks;
+      std::string error;
+      if (!ChunkFileContent(path, &chunks, &error)) {
+        return MethodOutcome::Fail("READ_FAILED", error);
+      }
+      std::vector<uint8_t> hashes;
+      std::vector<int64_t> lengths;
+      hashes.reserve(chunks.size() * 32);
+      lengths.reserve(chunks.size());
+      int64_t size = 0;
+      for (const ContentChunk& chunk : chunks) {
+        hashes.insert(hashes.end(), chunk.hash.begin(), chunk.hash.end());
+        lengths.push_back(chunk.length);
+        size += chunk.length;
+      }
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("size")] = flutter::EncodableValue(size);
+      response[flutter::EncodableValue("hashes")] = flutter::EncodableValue(std::move(hashes));
+      response[flutter::EncodableValue("lengths")] = flutter::EncodableValue(std::move(lengths));
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+    return;
+  }
+  if (method == "readContentChunk") {
+    // 发送端：按 chunkFile 给出的偏移和长度读取一块
+    std::string path = args ? GetString(*args, "filePath", "") : "";
+    int64_t offset = -1, length = -1;
+    if (path.empty() || !GetInt64(*args, "offset", &offset) || !GetInt64(*args, "length", &length) ||
+        offset < 0 || length < 0 || length > kMaxChunkSize) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [totals = totals_, path, offset, length]() {
+      int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return MethodOutcome::Fail("OPEN_FAILED", strerror(errno));
+      }
+      std::vector<uint8_t> data(length);
+      ssize_t read_bytes;
+      do {
+        read_bytes = pread(fd, data.data(), data.size(), offset);
+      } while (read_bytes < 0 && errno == EINTR);
+      int read_error = errno;
+      close(fd);
+      if (read_bytes < 0) {
+        return MethodOutcome::Fail("READ_FAILED", strerror(read_error));
+      }
+      data.resize(read_bytes);
+      totals->bytes_read += read_bytes;
+      return MethodOutcome::Ok(flutter::EncodableValue(std::move(data)));
+    });
+    return;
+  }
+
+  // 平台线程只记录配置，换目录时换一个新的缓存对象。第一次使用时的目录扫描和各项缓存操作都在工作池上进行，
+  // 任务持有 shared_ptr，期间 cacheConfigure 换掉缓存也不影响已提交的操作
+  if (!chunk_store_ || method == "cacheConfigure") {
+    std::string directory = chunk_store_ ? cache_directory_
+                                         : std::string(g_get_user_cache_dir()) + "/" APPLICATION_ID "/chunks";
+    int64_t capacity = chunk_store_ ? cache_capacity_ : kDefaultCacheCapacity;
+    if (method == "cacheConfigure" && args) {
+      directory = GetString(*args, "directory", directory);
+      GetInt64(*args, "capacityBytes", &capacity);
+    }
+    if (!chunk_store_ || directory != cache_directory_) {
+      chunk_store_ = std::make_shared<ChunkStore>();
+    }
+    cache_directory_ = directory;
+    cache_capacity_ = capacity;
+  }
+  std::shared_ptr<ChunkStore> store = chunk_store_;
+  std::string directory = cache_directory_;
+  int64_t capacity = cache_capacity_;
+
+  if (method == "cacheMissing") {
+    std::vector<ChunkHash> hashes;
+    if (!args || !ParseChunkHashes(GetBytes(*args, "hashes"), &hashes)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result),
+                   [store, directory, capacity, hashes = std::move(hashes)]() {
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      return MethodOutcome::Ok(flutter::EncodableValue(store->Missing(hashes)));
+    });
+  } else if (method == "cachePut") {
+    std::vector<ChunkHash> hash;
+    const std::vector<uint8_t>* data = args ? GetBytes(*args, "data") : nullptr;
+    if (!data || !ParseChunkHashes(GetBytes(*args, "hash"), &hash) || hash.size() != 1) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    // 参数在本次调用返回后失效，数据复制一份交给工作线程
+    RunMethodAsync(TaskPriority::kFile, std::move(result),
+                   [totals = totals_, store, directory, capacity, hash = hash[0], data = *data]() {
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      if (!store->Put(hash, data.data(), data.size(), &error)) {
+        return MethodOutcome::Fail("PUT_FAILED", error);
+      }
+      totals->bytes_written += data.size();
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  } else if (method == "cacheAssemble") {
+    // 接收端：全部块到齐后从缓存拼出文件；有块缺失时在 details 里返回缺失的序号
+    std::string path = args ? GetString(*args, "path", "") : "";
+    std::vector<ChunkHash> hashes;
+    if (path.empty() || !ParseChunkHashes(GetBytes(*args, "hashes"), &hashes)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result),
+                   [totals = totals_, store, directory, capacity, path, hashes = std::move(hashes)]() {
+      std::vector<int64_t> missing;
+      int64_t bytes = 0;
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      if (!store->Assemble(path, hashes, &missing, &bytes, &error)) {
+        if (!missing.empty()) {
+          return MethodOutcome::Fail("MISSING_CHUNKS", error,
+                                     flutter::EncodableValue(std::move(missing)));
+        }
+        return MethodOutcome::Fail("WRITE_FAILED", error);
+      }
+      totals->bytes_written += bytes;
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("bytes")] = flutter::EncodableValue(bytes);
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+  } else if (method == "cacheAddFile") {
+    std::string path = args ? GetString(*args, "filePath", "") : "";
+    if (path.empty()) {
+      result->Error("CACHE_FAILED", "Invalid arguments");
+      return;
+    }
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [store, directory, capacity, path]() {
+      int64_t added = 0;
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error) || !store->AddFile(path, &added, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      return MethodOutcome::Ok(flutter::EncodableValue(added));
+    });
+  } else if (method == "cacheClear") {
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [store, directory, capacity]() {
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      store->Clear();
+      return MethodOutcome::Ok(flutter::EncodableValue(true));
+    });
+  } else {
+    // cacheStats，以及返回新配置下统计的 cacheConfigure。容量变小时淘汰要删除文件
+    bool configure = method == "cacheConfigure";
+    RunMethodAsync(TaskPriority::kFile, std::move(result), [store, directory, capacity, configure]() {
+      std::string error;
+      if (!store->EnsureOpen(directory, capacity, &error)) {
+        return MethodOutcome::Fail("CACHE_FAILED", error);
+      }
+      if (configure) {
+        store->SetCapacity(capacity);
+      }
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("directory")] = flutter::EncodableValue(directory);
+      response[flutter::EncodableValue("chunks")] = flutter::EncodableValue(store->chunk_count());
+      response[flutter::EncodableValue("bytes")] = flutter::EncodableValue(store->bytes());
+      response[flutter::EncodableValue("capacityBytes")] = flutter::EncodableValue(store->capacity());
+      response[flutter::EncodableValue("hits")] = flutter::EncodableValue(store->hits());
+      response[flutter::EncodableValue("misses")] = flutter::EncodableValue(store->misses());
+      return MethodOutcome::Ok(flutter::EncodableValue(response));
+    });
+  }
+}
+
+std::shared_ptr<FileOperationPlugin::TransferHandle> FileOperationPlugin::FindHandle(
+    const flutter::EncodableMap* args) {
+  int64_t id = 0;
+  if (!args || !GetInt64(*args, "handle", &id)) {
+    return nullptr;
+  }
+  auto it = handles_.find(id);
+  return it == handles_.end() ? nullptr : it->second;
+}
+
+flutter::EncodableValue FileOperationPlugin::HandleStats(const TransferHandle& handle) {
+  double elapsed_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - handle.opened).count();
+  int64_t bytes = handle.bytes;
+  flutter::EncodableMap stats;
+  stats[flutter::EncodableValue("path")] = flutter::EncodableValue(handle.path);
+  stats[flutter::EncodableValue("bytes")] = flutter::EncodableValue(bytes);
+  stats[flutter::EncodableValue("elapsedMs")] = flutter::EncodableValue(elapsed_ms);
+  stats[flutter::EncodableValue("mbPerSec")] = flutter::EncodableValue(
+      elapsed_ms > 0 ? bytes / (1024.0 * 1024.0) / (elapsed_ms / 1000.0) : 0.0);
+  if (handle.compressor || handle.decompressor || handle.archive || handle.extractor) {
+    stats[flutter::EncodableValue("compressedBytes")] = flutter::EncodableValue(handle.wire_bytes.load());
+  }
+  if (handle.compressor || handle.archive) {
+    stats[flutter::EncodableValue("level")] = flutter::EncodableValue(handle.level.load());
+  }
+  if (handle.archive || handle.extractor) {
+    stats[flutter::EncodableValue("files")] = flutter::EncodableValue(handle.files.load());
+  }
+  return flutter::EncodableValue(stats);
+}
+
+bool FileOperationPlugin::GetFileList(const std::string& path, flutter::EncodableList* fileList,
+                                      std::string* error) {
+  DirListOptions options;
+  options.sort = DirListOptions::SortKey::kNone;
+  DirListing listing;
+  if (!ListDirectory(path, options, &listing, error)) {
+    return false;
+  }
+
+  fileList->reserve(listing.size());
+  for (size_t i = 0; i < listing.size(); i++) {
+    bool directory = listing.types[i] == static_cast<uint8_t>(DirEntryType::kDirectory);
+    flutter::EncodableMap fileInfo;
+    fileInfo[flutter::EncodableValue("name")] = flutter::EncodableValue(listing.names[i]);
+    fileInfo[flutter::EncodableValue("path")] =
+        flutter::EncodableValue((fs::path(path) / listing.names[i]).string());
+    fileInfo[flutter::EncodableValue("type")] = flutter::EncodableValue(directory ? "directory" : "file");
+    fileInfo[flutter::EncodableValue("size")] = flutter::EncodableValue(listing.sizes[i]);
+    fileInfo[flutter::EncodableValue("modified")] = flutter::EncodableValue(listing.modified[i]);
+    fileList->push_back(flutter::EncodableValue(fileInfo));
+  }
+  return true;
+}
+
+bool FileOperationPlugin::UploadFile(const std::string& targetPath, const std::string& fileName, const std::vector<uint8_t>& fileData) {
+  fs::path fullPath = fs::path(targetPath) / fileName;
+  int fd = open(fullPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  size_t written = 0;
+  while (written < fileData.size()) {
+    ssize_t n = write(fd, fileData.data() + written, fileData.size() - written);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      close(fd);
+      return false;
+    }
+    written += n;
+  }
+  return close(fd) == 0;
+}
+
+std::vector<uint8_t> FileOperationPlugin::DownloadFile(const std::string& filePath) {
+  std::vector<uint8_t> fileData;
+  ReadWholeFile(filePath, &fileData);
+  return fileData;
+}
+
+bool FileOperationPlugin::DeleteFile(const std::string& filePath) {
+  std::error_code ec;
+  if (!fs::exists(filePath, ec)) {
+    return false;
+  }
+  fs::remove_all(filePath, ec);
+  return !ec;
+}
+
+bool FileOperationPlugin::RenameFile(const std::string& oldPath, const std::string& newPath) {
+  std::error_code ec;
+  if (!fs::exists(oldPath, ec)) {
+    return false;
+  }
+  fs::rename(oldPath, newPath, ec);
+  return !ec;
+}
+
+bool FileOperationPlugin::MoveFile(const std::string& sourcePath, const std::string& targetPath) {
+  return RenameFile(sourcePath, targetPath);
+}
+
+bool FileOperationPlugin::CreateDirectory(const std::string& path) {
+  std::error_code ec;
+  if (fs::exists(path, ec)) {
+    return false;
+  }
+  fs::create_directories(path, ec);
+  return !ec;
+}
+
+void RegisterFileOperationPlugin(flutter::PluginRegistrarLinux *registrar) {
+  registrar->AddPlugin(FileOperationPlugin::Create(registrar->messenger()));
+}
+
+std::unique_ptr<flutter::Plugin> CreateFileOperationPlugin(flutter::BinaryMessenger *messenger) {
+  return FileOperationPlugin::Create(messenger);
+}
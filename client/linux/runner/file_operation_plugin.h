@@ -0,0 +1,14 @@
+#ifndef RUNNER_FILE_OPERATION_PLUGIN_H_
+#define RUNNER_FILE_OPERATION_PLUGIN_H_
+
+#include <flutter/binary_messenger.h>
+#include <flutter/plugin_registrar_linux.h>
+
+#include <memory>
+
+void RegisterFileOperationPlugin(flutter::PluginRegistrarLinux *registrar);
+
+// 无界面代理模式下不经过 Flutter 引擎，直接挂在 messenger 上
+std::unique_ptr<flutter::Plugin> CreateFileOperationPlugin(flutter::BinaryMessenger *messenger);
+
+#endif  // RUNNER_FILE_OPERATION_PLUGIN_H_
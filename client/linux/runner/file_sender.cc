@@ -0,0 +1,203 @@
+#include "file_sender.h"
+
+#include <fcntl.h>
+#include <netdb.h>
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// sendfile 单次最多传输约 2GB，分段调用
+const size_t kSendfileMax = 1 << 30;
+const size_t kBufferSize = 256 * 1024;
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+// 用 pread 把 [*pos, end) 写到 socket_fd。文件在读取过程中被截断时读到的字节会变少，
+// 按错误处理；映射后拷贝在这种情况下会收到 SIGBUS，整个进程崩溃
+bool CopyRange(int fd, int socket_fd, off_t* pos, int64_t end, std::string* error) {
+  std::vector<uint8_t> buffer(kBufferSize);
+  while (*pos < end) {
+    ssize_t n = pread(fd, buffer.data(), std::min<int64_t>(end - *pos, buffer.size()), *pos);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      *error = strerror(errno);
+      return false;
+    }
+    if (n == 0) {
+      *error = "文件在发送过程中被截断";
+      return false;
+    }
+    if (!WriteAll(socket_fd, buffer.data(), n)) {
+      *error = strerror(errno);
+      return false;
+    }
+    *pos += n;
+  }
+  return true;
+}
+
+}  // namespace
+
+int ConnectTransportSocket(const std::string& host, int port, const std::string& unix_path,
+                           std::string* error) {
+  if (!unix_path.empty()) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    if (unix_path.size() >= sizeof(addr.sun_path)) {
+      *error = "套接字路径过长";
+      return -1;
+    }
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, unix_path.c_str(), unix_path.size());
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0) {
+      return fd;
+    }
+    *error = strerror(errno);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo* addrs = nullptr;
+  std::string service = std::to_string(port);
+  int rc = getaddrinfo(host.c_str(), service.c_str(), &hints, &addrs);
+  if (rc != 0) {
+    *error = gai_strerror(rc);
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo* ai = addrs; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    *error = strerror(errno);
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  return fd;
+}
+
+bool SendFileToSocket(const std::string& path, int socket_fd, int64_t offset, int64_t length,
+                      bool buffered, FileSendStats* stats, std::string* error) {
+  auto start = std::chrono::steady_clock::now();
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || offset < 0 || offset > st.st_size) {
+    *error = "不是有效的文件";
+    close(fd);
+    return false;
+  }
+  int64_t end = length < 0 ? st.st_size : std::min<int64_t>(st.st_size, offset + length);
+  off_t pos = offset;
+  bool ok = true;
+
+  if (!buffered) {
+    stats->zero_copy = true;
+    while (pos < end) {
+      ssize_t n = sendfile(socket_fd, fd, &pos, std::min<int64_t>(end - pos, kSendfileMax));
+      if (n < 0) {
+        if (errno == EINTR || errno == EAGAIN) {
+          continue;
+        }
+        if (errno == EINVAL || errno == ENOSYS) {
+          // 文件系统不支持 sendfile，剩余部分改用缓冲路径
+          stats->zero_copy = false;
+          break;
+        }
+        *error = strerror(errno);
+        ok = false;
+        break;
+      }
+      if (n == 0) {
+        // 还没到 end 就读到文件末尾，说明文件在发送过程中被截断
+        *error = "文件在发送过程中被截断";
+        ok = false;
+        break;
+      }
+    }
+    if (ok && pos < end) {
+      ok = CopyRange(fd, socket_fd, &pos, end, error);
+    }
+  } else {
+    posix_fadvise(fd, offset, end - offset, POSIX_FADV_SEQUENTIAL);
+    ok = CopyRange(fd, socket_fd, &pos, end, error);
+  }
+
+  close(fd);
+  stats->bytes = pos - offset;
+  stats->elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - start).count();
+  return ok;
+}
+
+bool ReadWholeFile(const std::string& path, std::vector<uint8_t>* data) {
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+  posix_fadvise(fd, 0, st.st_size, POSIX_FADV_SEQUENTIAL);
+  data->resize(st.st_size);
+  size_t done = 0;
+  bool ok = true;
+  while (done < data->size()) {
+    ssize_t n = pread(fd, data->data() + done, data->size() - done, done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      // 读取过程中被截断
+      ok = false;
+      break;
+    }
+    done += n;
+  }
+  close(fd);
+  if (!ok) {
+    data->clear();
+  }
+  return ok;
+}
@@ -0,0 +1,29 @@
+#ifndef RUNNER_FILE_SENDER_H_
+#define RUNNER_FILE_SENDER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct FileSendStats {
+  int64_t bytes = 0;
+  double elapsed_ms = 0;
+  // 是否走了 sendfile 内核零拷贝路径
+  bool zero_copy = false;
+};
+
+// 连接原生传输通道：unix_path 非空时连接 Unix 域套接字，否则连接 host:port
+int ConnectTransportSocket(const std::string& host, int port, const std::string& unix_path,
+                           std::string* error);
+
+// 把文件的 [offset, offset + length) 写到已连接的套接字，length < 0 表示到文件末尾。
+// 默认用 sendfile 在内核内完成拷贝（内部基于 splice），不支持时退回 pread/write 缓冲路径；
+// buffered 为 true 时强制使用缓冲路径，便于对比。没发完就读到文件末尾（文件被截断）时返回 false。
+bool SendFileToSocket(const std::string& path, int socket_fd, int64_t offset, int64_t length,
+                      bool buffered, FileSendStats* stats, std::string* error);
+
+// 按打开时的大小把整个文件读入 data，只做一次从页缓存到结果的拷贝。
+// 不使用映射，文件在读取过程中被截断时返回 false 而不是触发 SIGBUS
+bool ReadWholeFile(const std::string& path, std::vector<uint8_t>* data);
+
+#endif  // RUNNER_FILE_SENDER_H_
@@ -0,0 +1,264 @@
+#include "frame_distributor.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "platform_thread.h"
+#include "task_executor.h"
+#include "wire_protocol.h"
+
+namespace {
+
+const int kMinFps = 1;
+const int kMaxFps = 30;
+
+}  // namespace
+
+FrameDistributor::FrameDistributor(CaptureFunction capture, EncodeFunction encode)
+    : capture_(std::move(capture)),
+      encode_(std::move(encode)),
+      alive_(std::make_shared<bool>(true)) {}
+
+FrameDistributor::~FrameDistributor() {
+  alive_.reset();
+  std::vector<FrameCallback> waiting;
+  for (auto& entry : sessions_) {
+    if (entry.second.waiting) {
+      waiting.push_back(std::move(entry.second.waiting));
+    }
+  }
+  sessions_.clear();
+  for (auto& callback : waiting) {
+    callback(nullptr);
+  }
+}
+
+bool FrameDistributor::Subscribe(uint32_t session, FrameTier tier, int fps) {
+  if (static_cast<int>(tier) >= kFrameTierCount) {
+    return false;
+  }
+  Session& entry = sessions_[session];
+  entry.tier = tier;
+  entry.fps = std::clamp(fps, kMinFps, kMaxFps);
+  return true;
+}
+
+void FrameDistributor::Unsubscribe(uint32_t session) {
+  auto it = sessions_.find(session);
+  if (it == sessions_.end()) {
+    return;
+  }
+  FrameCallback waiting = std::move(it->second.waiting);
+  sessions_.erase(it);
+  if (waiting) {
+    waiting(nullptr);
+  }
+}
+
+bool FrameDistributor::NextFrame(uint32_t session, FrameCallback callback) {
+  auto it = sessions_.find(session);
+  if (it == sessions_.end()) {
+    return false;
+  }
+  Session& entry = it->second;
+  FrameCallback previous = std::move(entry.waiting);
+  entry.waiting = nullptr;
+
+  // 其他会话刚触发的抓屏还在一个间隔内，直接共用，不再抓一次
+  const TierFrame& latest = latest_[static_cast<int>(entry.tier)];
+  if (latest.message && latest.sequence != entry.cursor &&
+      Clock::now() - latest.captured < Interval()) {
+    entry.cursor = latest.sequence;
+    EncodedFrame message = latest.message;
+    if (previous) {
+      previous(nullptr);
+    }
+    callback(message);
+    return true;
+  }
+
+  entry.waiting = std::move(callback);
+  ScheduleCapture();
+  if (previous) {
+    previous(nullptr);
+  }
+  return true;
+}
+
+void FrameDistributor::SetCaptureObserver(FrameTier tier, CaptureObserver observer) {
+  observer_tier_ = tier;
+  observer_ = std::move(observer);
+}
+
+FrameDistributor::Clock::duration FrameDistributor::Interval() const {
+  int fps = kMinFps;
+  for (const auto& entry : sessions_) {
+    fps = std::max(fps, entry.second.fps);
+  }
+  return std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / fps;
+}
+
+void FrameDistributor::ScheduleCapture() {
+  if (capturing_ || capture_scheduled_) {
+    return;
+  }
+  auto wait = last_capture_ + Interval() - Clock::now();
+  if (capture_count_ == 0 || wait <= Clock::duration::zero()) {
+    StartCapture();
+    return;
+  }
+  capture_scheduled_ = true;
+  auto delay_ms = std::chrono::ceil<std::chrono::milliseconds>(wait).count();
+  std::weak_ptr<bool> alive = alive_;
+  PostToPlatformThreadDelayed(static_cast<int>(delay_ms), [this, alive]() {
+    if (!alive.lock()) {
+      return;
+    }
+    capture_scheduled_ = false;
+    for (const auto& entry : sessions_) {
+      if (entry.second.waiting) {
+        StartCapture();
+        return;
+      }
+    }
+  });
+}
+
+void FrameDistributor::StartCapture() {
+  // 所有已订阅的档位都编码，没在等待的会话下次来取时可以直接用
+  unsigned tiers = 0;
+  for (const auto& entry : sessions_) {
+    tiers |= 1u << static_cast<int>(entry.second.tier);
+  }
+  if (observer_) {
+    tiers |= 1u << static_cast<int>(observer_tier_);
+  }
+  capturing_ = true;
+  last_capture_ = Clock::now();
+  capture_count_++;
+  uint32_t sequence = next_sequence_++;
+  if (next_sequence_ == 0) {
+    next_sequence_ = 1;
+  }
+
+  std::weak_ptr<bool> alive = alive_;
+  TaskExecutor::Shared().Submit(TaskPriority::kCapture, [this, alive, tiers, sequence,
+                                                         capture = capture_, encode = encode_]() {
+    Clock::time_point captured = Clock::now();
+    RgbImage image;
+    bool ok = capture(&image) && image.width > 0 && image.height > 0 &&
+              image.pixels.size() == static_cast<size_t>(image.width) * image.height * 3;
+    TierFrames frames;
+    if (ok) {
+      WireHeader header;
+      header.sequence = sequence;
+      header.timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count();
+      for (int tier = 0; tier < kFrameTierCount; tier++) {
+        if (!(tiers & (1u << tier))) {
+          continue;
+        }
+        RgbImage scaled;
+        const RgbImage* source = &image;
+        if (tier != static_cast<int>(FrameTier::kFull)) {
+          scaled = ScaleRgbImage(image, static_cast<FrameTier>(tier));
+          source = &scaled;
+        }
+        std::vector<uint8_t> encoded = encode(*source);
+        if (encoded.empty()) {
+          continue;
+        }
+        WireScreenFrame frame;
+        frame.width = static_cast<uint16_t>(std::min(source->width, 0xFFFF));
+        frame.height = static_cast<uint16_t>(std::min(source->height, 0xFFFF));
+        frame.data = encoded.data();
+        frame.size = encoded.size();
+        auto message = std::make_shared<std::vector<uint8_t>>();
+        if (EncodeWireScreenFrame(header, frame, message.get())) {
+          frames[tier] = std::move(message);
+        }
+      }
+    }
+    PostToPlatformThread([this, alive, sequence, captured, ok, tiers, frames]() {
+      if (!alive.lock()) {
+        return;
+      }
+      OnCaptured(sequence, captured, ok, tiers, frames);
+    });
+  });
+}
+
+void FrameDistributor::OnCaptured(uint32_t sequence, Clock::time_point captured, bool ok,
+                                  unsigned tiers, TierFrames frames) {
+  capturing_ = false;
+  for (int tier = 0; tier < kFrameTierCount; tier++) {
+    if (frames[tier]) {
+      latest_[tier] = {sequence, captured, frames[tier]};
+      encode_count_++;
+    }
+  }
+  if (observer_ && frames[static_cast<int>(observer_tier_)]) {
+    CaptureObserver observer = observer_;
+    observer(captured, frames[static_cast<int>(observer_tier_)]);
+  }
+
+  // 回调可能再次调用分发器，先收集再逐个调用
+  std::vector<std::pair<FrameCallback, EncodedFrame>> ready;
+  bool still_waiting = false;
+  for (auto& entry : sessions_) {
+    Session& session = entry.second;
+    if (!session.waiting) {
+      continue;
+    }
+    int tier = static_cast<int>(session.tier);
+    if (frames[tier]) {
+      session.cursor = sequence;
+      ready.emplace_back(std::move(session.waiting), frames[tier]);
+    } else if (ok && !(tiers & (1u << tier))) {
+      // 抓屏期间才订阅或换了档位，等下一次
+      still_waiting = true;
+      continue;
+    } else {
+      ready.emplace_back(std::move(session.waiting), nullptr);
+    }
+    session.waiting = nullptr;
+  }
+  if (still_waiting) {
+    ScheduleCapture();
+  }
+  for (auto& item : ready) {
+    item.first(item.second);
+  }
+}
+
+RgbImage ScaleRgbImage(const RgbImage& image, FrameTier tier) {
+  int factor = 1 << static_cast<int>(tier);
+  RgbImage scaled;
+  scaled.width = std::max(1, image.width / factor);
+  scaled.height = std::max(1, image.height / factor);
+  scaled.pixels.resize(static_cast<size_t>(scaled.width) * scaled.height * 3);
+  std::vector<uint32_t> sums(static_cast<size_t>(scaled.width) * 3);
+  std::vector<uint32_t> counts(scaled.width);
+  for (int y = 0; y < scaled.height; y++) {
+    std::fill(sums.begin(), sums.end(), 0);
+    std::fill(counts.begin(), counts.end(), 0);
+    int row_end = y == scaled.height - 1 ? image.height : std::min(image.height, (y + 1) * factor);
+    for (int source_y = y * factor; source_y < row_end; source_y++) {
+      const uint8_t* row = image.pixels.data() + static_cast<size_t>(source_y) * image.width * 3;
+      for (int source_x = 0; source_x < image.width; source_x++) {
+        int x = std::min(source_x / factor, scaled.width - 1);
+        sums[x * 3] += row[source_x * 3];
+        sums[x * 3 + 1] += row[source_x * 3 + 1];
+        sums[x * 3 + 2] += row[source_x * 3 + 2];
+        counts[x]++;
+      }
+    }
+    uint8_t* out = scaled.pixels.data() + static_cast<size_t>(y) * scaled.width * 3;
+    for (int x = 0; x < scaled.width; x++) {
+      for (int c = 0; c < 3; c++) {
+        out[x * 3 + c] = static_cast<uint8_t>(sums[x * 3 + c] / counts[x]);
+      }
+    }
+  }
+  return scaled;
+}
@@ -0,0 +1,108 @@
+#ifndef RUNNER_FRAME_DISTRIBUTOR_H_
+#define RUNNER_FRAME_DISTRIBUTOR_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+
+// 画质档位，按边长缩小：完整、1/2、1/4
+enum class FrameTier : uint8_t { kFull = 0, kHalf, kQuarter };
+const int kFrameTierCount = 3;
+
+// 抓屏得到的 RGB888 像素，按行连续存放
+struct RgbImage {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> pixels;
+};
+
+// 编码好的二进制协议屏幕帧消息（见 wire_protocol.h），所有会话共享同一份，不可修改。
+// 头里的会话编号为 0，交付时由调用方在复制出的消息里用 SetWireSession 填写
+using EncodedFrame = std::shared_ptr<const std::vector<uint8_t>>;
+
+// 多个观看会话共用一条抓屏和编码流水线。每次抓屏只做一次，再按订阅中出现的档位
+// 各缩放、编码一次，编码结果以共享指针交给该档位的所有会话，观看者再多也不会重复编码。
+// 每个会话记录最后取到的帧序号，NextFrame 只返回比它更新的帧；没有时等待下一次抓屏，
+// 抓屏间隔取订阅中最高的帧率，跟不上的会话直接跳到最新帧。
+// 除构造外的方法都在平台线程上调用，抓屏和编码在共享工作池上进行。
+class FrameDistributor {
+ public:
+  using Clock = std::chrono::steady_clock;
+  using CaptureFunction = std::function<bool(RgbImage* image)>;
+  using EncodeFunction = std::function<std::vector<uint8_t>(const RgbImage& image)>;
+  // 在平台线程上调用，frame 为空表示抓屏或编码失败
+  using FrameCallback = std::function<void(EncodedFrame frame)>;
+  // 在平台线程上调用，captured 为抓屏时间
+  using CaptureObserver = std::function<void(Clock::time_point captured, EncodedFrame frame)>;
+
+  // capture 和 encode 在工作线程上调用，需可并发执行
+  FrameDistributor(CaptureFunction capture, EncodeFunction encode);
+  ~FrameDistributor();
+
+  FrameDistributor(const FrameDistributor&) = delete;
+  FrameDistributor& operator=(const FrameDistributor&) = delete;
+
+  // 重复订阅只更新档位和帧率，保留取帧进度
+  bool Subscribe(uint32_t session, FrameTier tier, int fps);
+  // 正在等待的 NextFrame 以空帧结束
+  void Unsubscribe(uint32_t session);
+  // 会话未订阅时返回 false，不调用 callback。同一会话上一次尚未返回的请求以空帧结束
+  bool NextFrame(uint32_t session, FrameCallback callback);
+  // 录制等旁路：设置后每次抓屏都编码 tier 档位并交给 observer，但不会因此触发抓屏；
+  // 传 nullptr 取消
+  void SetCaptureObserver(FrameTier tier, CaptureObserver observer);
+
+  size_t session_count() const { return sessions_.size(); }
+  uint64_t capture_count() const { return capture_count_; }
+  uint64_t encode_count() const { return encode_count_; }
+
+ private:
+  struct Session {
+    FrameTier tier = FrameTier::kFull;
+    int fps = 15;
+    // 最后交给该会话的帧序号，0 表示还没有取过
+    uint32_t cursor = 0;
+    FrameCallback waiting;
+  };
+
+  struct TierFrame {
+    uint32_t sequence = 0;
+    Clock::time_point captured;
+    EncodedFrame message;
+  };
+
+  using TierFrames = std::array<EncodedFrame, kFrameTierCount>;
+
+  Clock::duration Interval() const;
+  // 有会话在等待时安排下一次抓屏，距上次不足一个间隔的延后执行
+  void ScheduleCapture();
+  void StartCapture();
+  // tiers 是这次抓屏要编码的档位
+  void OnCaptured(uint32_t sequence, Clock::time_point captured, bool ok, unsigned tiers,
+                  TierFrames frames);
+
+  CaptureFunction capture_;
+  EncodeFunction encode_;
+  std::map<uint32_t, Session> sessions_;
+  std::array<TierFrame, kFrameTierCount> latest_;
+  FrameTier observer_tier_ = FrameTier::kFull;
+  CaptureObserver observer_;
+  uint32_t next_sequence_ = 1;
+  Clock::time_point last_capture_;
+  bool capturing_ = false;
+  bool capture_scheduled_ = false;
+  uint64_t capture_count_ = 0;
+  uint64_t encode_count_ = 0;
+  // 投递回平台线程的任务据此判断分发器是否还在
+  std::shared_ptr<bool> alive_;
+};
+
+// 按档位缩小，每个输出像素取对应方块的平均值
+RgbImage ScaleRgbImage(const RgbImage& image, FrameTier tier);
+
+#endif  // RUNNER_FRAME_DISTRIBUTOR_H_
@@ -0,0 +1,61 @@
+#include "headless_agent.h"
+
+#include <glib-unix.h>
+#include <glib.h>
+#include <signal.h>
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "diagnostics_plugin.h"
+#include "file_operation_plugin.h"
+#include "input_control_plugin.h"
+#include "screen_capture_plugin.h"
+#include "socket_messenger.h"
+#include "terminal_plugin.h"
+
+namespace {
+
+gboolean QuitLoop(gpointer data) {
+  g_main_loop_quit(static_cast<GMainLoop*>(data));
+  return G_SOURCE_CONTINUE;
+}
+
+}  // namespace
+
+std::string DefaultAgentSocketPath() {
+  return std::string(g_get_user_runtime_dir()) + "/" APPLICATION_ID ".sock";
+}
+
+int RunHeadlessAgent(const std::string& socket_path) {
+  // 插件的结果都经 PostToPlatformThread 投递到默认主循环，这里跑的就是它
+  GMainLoop* loop = g_main_loop_new(nullptr, FALSE);
+  int exit_code = 0;
+  {
+    SocketMessenger messenger;
+    std::string error;
+    if (!messenger.Listen(socket_path, &error)) {
+      fprintf(stderr, "agent: %s\n", error.c_str());
+      exit_code = 1;
+    } else {
+      // 插件持有 messenger 的指针，要先于它销毁
+      std::vector<std::unique_ptr<flutter::Plugin>> plugins;
+      plugins.push_back(CreateScreenCapturePlugin(&messenger));
+      plugins.push_back(CreateInputControlPlugin(&messenger));
+      plugins.push_back(CreateDiagnosticsPlugin(&messenger));
+      plugins.push_back(CreateFileOperationPlugin(&messenger));
+      plugins.push_back(CreateTerminalPlugin(&messenger));
+
+      guint sigint = g_unix_signal_add(SIGINT, QuitLoop, loop);
+      guint sigterm = g_unix_signal_add(SIGTERM, QuitLoop, loop);
+      g_message("agent: listening on %s", socket_path.c_str());
+      g_main_loop_run(loop);
+      g_source_remove(sigint);
+      g_source_remove(sigterm);
+      plugins.clear();
+    }
+  }
+  g_main_loop_unref(loop);
+  return exit_code;
+}
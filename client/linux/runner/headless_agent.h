@@ -0,0 +1,15 @@
+#ifndef RUNNER_HEADLESS_AGENT_H_
+#define RUNNER_HEADLESS_AGENT_H_
+
+#include <string>
+
+// 无界面代理模式：不创建 GTK 窗口和 Flutter 引擎，截屏、输入、文件、终端和诊断插件
+// 直接挂在 Unix 域套接字上（见 SocketMessenger），由本机的控制端进程连接后按原来的
+// 通道名和 StandardMethodCodec 编码调用，语义与 Flutter 界面里完全相同。
+// 收到 SIGINT/SIGTERM 时退出，返回进程退出码。
+int RunHeadlessAgent(const std::string& socket_path);
+
+// $XDG_RUNTIME_DIR/<APPLICATION_ID>.sock
+std::string DefaultAgentSocketPath();
+
+#endif  // RUNNER_HEADLESS_AGENT_H_
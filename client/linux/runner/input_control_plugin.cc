@@ -6,14 +6,53 @@
 
 #include <memory>
 #include <X11/Xlib.h>
-#include <X11/extensions/XTest.h>
+#include <X11/keysym.h>
 #include <string>
 #include <map>
 #include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "encodable_args.h"
+#include "input_injector.h"
+#include "input_recorder.h"
+#include "wire_protocol.h"
+
+// X.h 把 Success 定义成宏，会和 MethodResult::Success 冲突
+#ifdef Success
+#undef Success
+#endif
+
+namespace {
+
+// 与 Windows 的 WHEEL_DELTA 一致，一格滚轮等于 120
+const int kWheelDelta = 120;
+
+// 二进制协议的修饰键位对应的键，按下时按此顺序，抬起时反序
+struct WireModifierKey {
+  uint8_t bit;
+  KeySym keysym;
+};
+const WireModifierKey kWireModifierKeys[] = {
+    {kWireModifierCtrl, XK_Control_L},
+    {kWireModifierShift, XK_Shift_L},
+    {kWireModifierAlt, XK_Alt_L},
+    {kWireModifierMeta, XK_Super_L},
+};
+
+// 坐标来自对端，先限制在 [0, limit) 内再取整；NaN 或超出 int32 的浮点数直接转换是未定义行为
+int32_t ClampCoordinate(double value, int32_t limit) {
+  if (!(value >= 0)) {
+    return 0;
+  }
+  return static_cast<int32_t>(std::min(value, static_cast<double>(limit - 1)));
+}
+
+}  // namespace
 
 class InputControlPlugin : public flutter::Plugin {
  public:
-  static void RegisterWithRegistrar(flutter::PluginRegistrarLinux *registrar);
+  static std::unique_ptr<InputControlPlugin> Create(flutter::BinaryMessenger *messenger);
 
   InputControlPlugin();
 
@@ -23,16 +62,43 @@ class InputControlPlugin : public flutter::Plugin {
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
-  
+
+  void MoveMouse(double x, double y);
+  void MoveMouseRelative(int dx, int dy);
+  void ButtonEvent(const std::string& button, bool down);
+  void ClickMouse(double x, double y, const std::string& button);
+  void ScrollMouse(int deltaX, int deltaY);
+  bool PressKey(const std::string& key);
+  void TypeText(const std::string& text);
+
+  // 执行一条批量事件，不刷新连接
+  bool InjectEvent(const flutter::EncodableMap& event);
+  // 执行一条二进制协议的输入消息，不刷新连接
+  bool InjectWire(const std::vector<uint8_t>& message, std::string* error);
+  // 按下或抬起 modifiers 中的修饰键
+  void WireModifiers(uint8_t modifiers, bool down);
+
+  void HandleRecordingCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
   KeyCode getKeyCode(Display* display, const std::string& key);
+
+  // 复用同一个 X 连接，避免每次调用都 XOpenDisplay
+  InputInjector injector_;
+  InputRecorder recorder_;
+  InputReplayer replayer_;
+  // 高精度滚轮增量不足一格时的余量
+  int scroll_remainder_x_ = 0;
+  int scroll_remainder_y_ = 0;
 };
 
 // static
-void InputControlPlugin::RegisterWithRegistrar(
-    flutter::PluginRegistrarLinux *registrar) {
+std::unique_ptr<InputControlPlugin> InputControlPlugin::Create(
+    flutter::BinaryMessenger *messenger) {
   auto channel =
       std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-          registrar->messenger(), "input_control",
+          messenger, "input_control",
           &flutter::StandardMethodCodec::GetInstance());
 
   auto plugin = std::make_unique<InputControlPlugin>();
@@ -42,60 +108,124 @@ void InputControlPlugin::RegisterWithRegistrar(
         plugin_pointer->HandleMethodCall(call, std::move(result));
       });
 
-  registrar->AddPlugin(std::move(plugin));
+  return plugin;
 }
 
 InputControlPlugin::InputControlPlugin() {}
 
-InputControlPlugin::~InputControlPlugin() {}
+InputControlPlugin::~InputControlPlugin() {
+  injector_.SetRecorder(nullptr);
+  recorder_.Close();
+  replayer_.Stop();
+}
 
 void InputControlPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  Display* display = XOpenDisplay(NULL);
-  if (!display) {
+  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const std::string& method = method_call.method_name();
+  if (method == "startRecording" || method == "stopRecording" ||
+      method == "startReplay" || method == "stopReplay" || method == "getReplayStatus") {
+    HandleRecordingCall(method, args, std::move(result));
+    return;
+  }
+
+  if (!injector_.GetDisplay()) {
     result->Error("NO_DISPLAY", "无法打开显示", nullptr);
     return;
   }
-  
-  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
-  
+  double x = 0, y = 0;
+
   if (method_call.method_name().compare("moveMouse") == 0) {
-    if (args && args->find(flutter::EncodableValue("x")) != args->end() &&
-        args->find(flutter::EncodableValue("y")) != args->end()) {
-      double x = std::get<double>(args->at(flutter::EncodableValue("x")));
-      double y = std::get<double>(args->at(flutter::EncodableValue("y")));
-      XTestFakeMotionEvent(display, -1, static_cast<int>(x), static_cast<int>(y), CurrentTime);
-      XFlush(display);
+    if (args && GetNumber(*args, "x", &x) && GetNumber(*args, "y", &y)) {
+      MoveMouse(x, y);
+      injector_.Flush();
+      result->Success();
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    }
+  } else if (method_call.method_name().compare("moveMouseRelative") == 0) {
+    double dx = 0, dy = 0;
+    if (args && GetNumber(*args, "dx", &dx) && GetNumber(*args, "dy", &dy)) {
+      MoveMouseRelative(static_cast<int>(dx), static_cast<int>(dy));
+      injector_.Flush();
       result->Success();
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
     }
   } else if (method_call.method_name().compare("clickMouse") == 0) {
-    if (args && args->find(flutter::EncodableValue("x")) != args->end() &&
-        args->find(flutter::EncodableValue("y")) != args->end() &&
+    if (args && GetNumber(*args, "x", &x) && GetNumber(*args, "y", &y) &&
         args->find(flutter::EncodableValue("button")) != args->end()) {
-      double x = std::get<double>(args->at(flutter::EncodableValue("x")));
-      double y = std::get<double>(args->at(flutter::EncodableValue("y")));
-      std::string button = std::get<std::string>(args->at(flutter::EncodableValue("button")));
-      
-      unsigned int buttonCode = (button == "right") ? Button3 : Button1;
-      XTestFakeMotionEvent(display, -1, static_cast<int>(x), static_cast<int>(y), CurrentTime);
-      XTestFakeButtonEvent(display, buttonCode, True, CurrentTime);
-      XTestFakeButtonEvent(display, buttonCode, False, CurrentTime);
-      XFlush(display);
+      ClickMouse(x, y, GetString(*args, "button", "left"));
+      injector_.Flush();
+      result->Success();
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    }
+  } else if (method_call.method_name().compare("mouseDown") == 0 ||
+             method_call.method_name().compare("mouseUp") == 0) {
+    if (args) {
+      // 坐标可选，拖拽时先移动再按下/抬起
+      if (GetNumber(*args, "x", &x) && GetNumber(*args, "y", &y)) {
+        MoveMouse(x, y);
+      }
+      ButtonEvent(GetString(*args, "button", "left"),
+                  method_call.method_name().compare("mouseDown") == 0);
+      injector_.Flush();
+      result->Success();
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    }
+  } else if (method_call.method_name().compare("scrollMouse") == 0) {
+    double delta = 0, deltaX = 0;
+    if (args && GetNumber(*args, "x", &x) && GetNumber(*args, "y", &y) &&
+        GetNumber(*args, "delta", &delta)) {
+      GetNumber(*args, "deltaX", &deltaX);
+      MoveMouse(x, y);
+      ScrollMouse(static_cast<int>(deltaX), static_cast<int>(delta));
+      injector_.Flush();
       result->Success();
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
     }
+  } else if (method_call.method_name().compare("injectEvents") == 0) {
+    // 一次调用注入一串事件，只在最后刷新一次
+    const flutter::EncodableList* events = nullptr;
+    if (args) {
+      auto it = args->find(flutter::EncodableValue("events"));
+      if (it != args->end()) {
+        events = std::get_if<flutter::EncodableList>(&it->second);
+      }
+    }
+    if (events) {
+      int injected = 0;
+      for (const auto& item : *events) {
+        const auto* event = std::get_if<flutter::EncodableMap>(&item);
+        if (event && InjectEvent(*event)) {
+          injected++;
+        }
+      }
+      injector_.Flush();
+      result->Success(flutter::EncodableValue(injected));
+    } else {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    }
+  } else if (method == "injectWire") {
+    // 服务器转发来的二进制输入消息直接在这里解码，Dart 端不用再解析
+    const std::vector<uint8_t>* data = args ? GetBytes(*args, "data") : nullptr;
+    std::string error;
+    if (!data) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    } else if (InjectWire(*data, &error)) {
+      injector_.Flush();
+      result->Success();
+    } else {
+      result->Error("INVALID_MESSAGE", error, nullptr);
+    }
   } else if (method_call.method_name().compare("pressKey") == 0) {
     if (args && args->find(flutter::EncodableValue("key")) != args->end()) {
-      std::string key = std::get<std::string>(args->at(flutter::EncodableValue("key")));
-      KeyCode keyCode = getKeyCode(display, key);
-      if (keyCode != 0) {
-        XTestFakeKeyEvent(display, keyCode, True, CurrentTime);
-        XTestFakeKeyEvent(display, keyCode, False, CurrentTime);
-        XFlush(display);
+      if (PressKey(GetString(*args, "key", ""))) {
+        injector_.Flush();
         result->Success();
       } else {
         result->Error("INVALID_KEY", "Invalid key", nullptr);
@@ -105,15 +235,8 @@ void InputControlPlugin::HandleMethodCall(
     }
   } else if (method_call.method_name().compare("typeText") == 0) {
     if (args && args->find(flutter::EncodableValue("text")) != args->end()) {
-      std::string text = std::get<std::string>(args->at(flutter::EncodableValue("text")));
-      for (char c : text) {
-        KeyCode keyCode = XKeysymToKeycode(display, static_cast<KeySym>(c));
-        if (keyCode != 0) {
-          XTestFakeKeyEvent(display, keyCode, True, CurrentTime);
-          XTestFakeKeyEvent(display, keyCode, False, CurrentTime);
-        }
-      }
-      XFlush(display);
+      TypeText(GetString(*args, "text", ""));
+      injector_.Flush();
       result->Success();
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
@@ -121,8 +244,277 @@ void InputControlPlugin::HandleMethodCall(
   } else {
     result->NotImplemented();
   }
-  
-  XCloseDisplay(display);
+}
+
+void InputControlPlugin::HandleRecordingCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (method == "startRecording") {
+    std::string path = args ? GetString(*args, "path", "") : "";
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    } else if (recorder_.Open(path)) {
+      injector_.SetRecorder(&recorder_);
+      result->Success();
+    } else {
+      result->Error("RECORD_FAILED", "无法创建输入日志", nullptr);
+    }
+  } else if (method == "stopRecording") {
+    injector_.SetRecorder(nullptr);
+    result->Success(flutter::EncodableValue(static_cast<int64_t>(recorder_.Close())));
+  } else if (method == "startReplay") {
+    std::string path = args ? GetString(*args, "path", "") : "";
+    double speed = 1.0;
+    if (args) {
+      GetNumber(*args, "speed", &speed);
+    }
+    std::string error;
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    } else if (replayer_.Start(path, speed, &error)) {
+      result->Success();
+    } else {
+      result->Error("REPLAY_FAILED", error, nullptr);
+    }
+  } else if (method == "stopReplay") {
+    replayer_.Stop();
+    result->Success();
+  } else {
+    ReplayStats stats = replayer_.stats();
+    flutter::EncodableMap status;
+    status[flutter::EncodableValue("running")] = flutter::EncodableValue(replayer_.IsRunning());
+    status[flutter::EncodableValue("events")] =
+        flutter::EncodableValue(static_cast<int64_t>(stats.events));
+    status[flutter::EncodableValue("durationMs")] = flutter::EncodableValue(stats.duration_ms);
+    status[flutter::EncodableValue("maxLagMs")] = flutter::EncodableValue(stats.max_lag_ms);
+    result->Success(flutter::EncodableValue(status));
+  }
+}
+
+bool InputControlPlugin::InjectEvent(const flutter::EncodableMap& event) {
+  std::string type = GetString(event, "type", "");
+  double x = 0, y = 0;
+  bool hasPosition = GetNumber(event, "x", &x) && GetNumber(event, "y", &y);
+
+  if (type == "move") {
+    if (!hasPosition) return false;
+    MoveMouse(x, y);
+  } else if (type == "moveRelative") {
+    double dx = 0, dy = 0;
+    if (!GetNumber(event, "dx", &dx) || !GetNumber(event, "dy", &dy)) return false;
+    MoveMouseRelative(static_cast<int>(dx), static_cast<int>(dy));
+  } else if (type == "down" || type == "up") {
+    if (hasPosition) MoveMouse(x, y);
+    ButtonEvent(GetString(event, "button", "left"), type == "down");
+  } else if (type == "click") {
+    if (!hasPosition) return false;
+    ClickMouse(x, y, GetString(event, "button", "left"));
+  } else if (type == "scroll") {
+    double delta = 0, deltaX = 0;
+    GetNumber(event, "delta", &delta);
+    GetNumber(event, "deltaX", &deltaX);
+    if (hasPosition) MoveMouse(x, y);
+    ScrollMouse(static_cast<int>(deltaX), static_cast<int>(delta));
+  } else if (type == "key") {
+    return PressKey(GetString(event, "key", ""));
+  } else if (type == "text") {
+    TypeText(GetString(event, "text", ""));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool InputControlPlugin::InjectWire(const std::vector<uint8_t>& message, std::string* error) {
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  if (!DecodeWireHeader(message.data(), message.size(), &header, &payload, error)) {
+    return false;
+  }
+  if (header.type == WireType::kInputMouse) {
+    WireMouseInput mouse;
+    if (!DecodeWireMouseInput(payload, header.payload_length, &mouse, error)) {
+      return false;
+    }
+    static const char* const kButtons[] = {"left", "right", "middle"};
+    std::string button = kButtons[static_cast<int>(mouse.button)];
+    switch (mouse.action) {
+      case WireMouseAction::kMove:
+        MoveMouse(mouse.x, mouse.y);
+        break;
+      case WireMouseAction::kClick:
+        ClickMouse(mouse.x, mouse.y, button);
+        break;
+      case WireMouseAction::kScroll:
+        MoveMouse(mouse.x, mouse.y);
+        ScrollMouse(0, mouse.delta);
+        break;
+      case WireMouseAction::kDown:
+      case WireMouseAction::kUp:
+        MoveMouse(mouse.x, mouse.y);
+        ButtonEvent(button, mouse.action == WireMouseAction::kDown);
+        break;
+    }
+    return true;
+  }
+  if (header.type == WireType::kInputKeyboard) {
+    WireKeyInput key;
+    if (!DecodeWireKeyInput(payload, header.payload_length, &key, error)) {
+      return false;
+    }
+    // 每条消息都带着当时的修饰键状态：按键前按下，按键后抬起
+    if (key.action == WireKeyAction::kPress) {
+      WireModifiers(key.modifiers, true);
+      TypeText(key.key);
+      WireModifiers(key.modifiers, false);
+      return true;
+    }
+    // 二进制协议分开传按下和抬起
+    KeyCode keyCode = getKeyCode(injector_.GetDisplay(), key.key);
+    if (keyCode == 0) {
+      *error = "invalid key";
+      return false;
+    }
+    InputEvent event;
+    event.type = InputEventType::kKey;
+    event.code = keyCode;
+    event.down = key.action == WireKeyAction::kDown;
+    if (event.down) {
+      WireModifiers(key.modifiers, true);
+    }
+    injector_.Inject(event);
+    if (!event.down) {
+      WireModifiers(key.modifiers, false);
+    }
+    return true;
+  }
+  *error = "not an input message";
+  return false;
+}
+
+void InputControlPlugin::WireModifiers(uint8_t modifiers, bool down) {
+  Display* display = injector_.GetDisplay();
+  if (!display || modifiers == 0) {
+    return;
+  }
+  const int count = sizeof(kWireModifierKeys) / sizeof(kWireModifierKeys[0]);
+  InputEvent event;
+  event.type = InputEventType::kKey;
+  event.down = down;
+  for (int i = 0; i < count; i++) {
+    const WireModifierKey& modifier = kWireModifierKeys[down ? i : count - 1 - i];
+    if (!(modifiers & modifier.bit)) {
+      continue;
+    }
+    event.code = XKeysymToKeycode(display, modifier.keysym);
+    if (event.code != 0) {
+      injector_.Inject(event);
+    }
+  }
+}
+
+void InputControlPlugin::MoveMouse(double x, double y) {
+  Display* display = injector_.GetDisplay();
+  int32_t width = std::numeric_limits<int32_t>::max();
+  int32_t height = width;
+  if (display) {
+    width = DisplayWidth(display, DefaultScreen(display));
+    height = DisplayHeight(display, DefaultScreen(display));
+  }
+  InputEvent event;
+  event.type = InputEventType::kMotion;
+  event.x = ClampCoordinate(x, width);
+  event.y = ClampCoordinate(y, height);
+  injector_.Inject(event);
+}
+
+void InputControlPlugin::MoveMouseRelative(int dx, int dy) {
+  InputEvent event;
+  event.type = InputEventType::kRelativeMotion;
+  event.x = dx;
+  event.y = dy;
+  injector_.Inject(event);
+}
+
+void InputControlPlugin::ButtonEvent(const std::string& button, bool down) {
+  unsigned int buttonCode = Button1;
+  if (button == "right") {
+    buttonCode = Button3;
+  } else if (button == "middle") {
+    buttonCode = Button2;
+  }
+  InputEvent event;
+  event.type = InputEventType::kButton;
+  event.code = buttonCode;
+  event.down = down;
+  injector_.Inject(event);
+}
+
+void InputControlPlugin::ClickMouse(double x, double y, const std::string& button) {
+  MoveMouse(x, y);
+  ButtonEvent(button, true);
+  ButtonEvent(button, false);
+}
+
+// delta 与 Windows 一致：120 为一格，正数向上/向右。
+// 触控板等高精度设备会发来不足一格的增量，先累积，够一格再发滚轮按钮。
+// XTest 只能注入核心协议的按钮事件，XInput2 的平滑滚动轴无法直接伪造。
+void InputControlPlugin::ScrollMouse(int deltaX, int deltaY) {
+  scroll_remainder_y_ += deltaY;
+  scroll_remainder_x_ += deltaX;
+
+  int stepsY = scroll_remainder_y_ / kWheelDelta;
+  int stepsX = scroll_remainder_x_ / kWheelDelta;
+  scroll_remainder_y_ -= stepsY * kWheelDelta;
+  scroll_remainder_x_ -= stepsX * kWheelDelta;
+
+  // Button4/5 为上/下，6/7 为左/右
+  InputEvent event;
+  event.type = InputEventType::kButton;
+  event.code = stepsY > 0 ? 4 : 5;
+  for (int i = 0; i < std::abs(stepsY); i++) {
+    event.down = true;
+    injector_.Inject(event);
+    event.down = false;
+    injector_.Inject(event);
+  }
+  event.code = stepsX > 0 ? 7 : 6;
+  for (int i = 0; i < std::abs(stepsX); i++) {
+    event.down = true;
+    injector_.Inject(event);
+    event.down = false;
+    injector_.Inject(event);
+  }
+}
+
+bool InputControlPlugin::PressKey(const std::string& key) {
+  KeyCode keyCode = getKeyCode(injector_.GetDisplay(), key);
+  if (keyCode == 0) {
+    return false;
+  }
+  InputEvent event;
+  event.type = InputEventType::kKey;
+  event.code = keyCode;
+  event.down = true;
+  injector_.Inject(event);
+  event.down = false;
+  injector_.Inject(event);
+  return true;
+}
+
+void InputControlPlugin::TypeText(const std::string& text) {
+  InputEvent event;
+  event.type = InputEventType::kKey;
+  for (char c : text) {
+    KeyCode keyCode = XKeysymToKeycode(injector_.GetDisplay(), static_cast<KeySym>(c));
+    if (keyCode != 0) {
+      event.code = keyCode;
+      event.down = true;
+      injector_.Inject(event);
+      event.down = false;
+      injector_.Inject(event);
+    }
+  }
 }
 
 KeyCode InputControlPlugin::getKeyCode(Display* display, const std::string& key) {
@@ -134,17 +526,17 @@ KeyCode InputControlPlugin::getKeyCode(Display* display, const std::string& key)
     {"escape", XK_Escape},
     {"backspace", XK_BackSpace},
   };
-  
+
   std::string lowerKey = key;
   std::transform(lowerKey.begin(), lowerKey.end(), lowerKey.begin(), ::tolower);
-  
+
   KeySym keysym = 0;
   if (keyMap.find(lowerKey) != keyMap.end()) {
     keysym = keyMap[lowerKey];
   } else if (key.length() == 1) {
     keysym = static_cast<KeySym>(key[0]);
   }
-  
+
   if (keysym != 0) {
     return XKeysymToKeycode(display, keysym);
   }
@@ -152,6 +544,9 @@ KeyCode InputControlPlugin::getKeyCode(Display* display, const std::string& key)
 }
 
 void RegisterInputControlPlugin(flutter::PluginRegistrarLinux *registrar) {
-  InputControlPlugin::RegisterWithRegistrar(registrar);
+  registrar->AddPlugin(InputControlPlugin::Create(registrar->messenger()));
 }
 
+std::unique_ptr<flutter::Plugin> CreateInputControlPlugin(flutter::BinaryMessenger *messenger) {
+  return InputControlPlugin::Create(messenger);
+}
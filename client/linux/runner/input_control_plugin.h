@@ -1,14 +1,14 @@
 #ifndef RUNNER_INPUT_CONTROL_PLUGIN_H_
 #define RUNNER_INPUT_CONTROL_PLUGIN_H_
 
+#include <flutter/binary_messenger.h>
 #include <flutter/plugin_registrar_linux.h>
-#include <X11/Xlib.h>
-#include <X11/keysym.h>
-#include <string>
 
-typedef unsigned char KeyCode;
+#include <memory>
 
 void RegisterInputControlPlugin(flutter::PluginRegistrarLinux *registrar);
 
-#endif  // RUNNER_INPUT_CONTROL_PLUGIN_H_
+// 无界面代理模式下不经过 Flutter 引擎，直接挂在 messenger 上
+std::unique_ptr<flutter::Plugin> CreateInputControlPlugin(flutter::BinaryMessenger *messenger);
 
+#endif  // RUNNER_INPUT_CONTROL_PLUGIN_H_
@@ -0,0 +1,58 @@
+#include "input_injector.h"
+
+#include <X11/extensions/XTest.h>
+
+#include "input_recorder.h"
+
+InputInjector::InputInjector() {}
+
+InputInjector::~InputInjector() {
+  if (display_) {
+    XCloseDisplay(display_);
+  }
+}
+
+Display* InputInjector::GetDisplay() {
+  if (!display_) {
+    display_ = XOpenDisplay(NULL);
+    if (display_) {
+      int event_base, error_base, major, minor;
+      if (!XTestQueryExtension(display_, &event_base, &error_base, &major, &minor)) {
+        XCloseDisplay(display_);
+        display_ = nullptr;
+      }
+    }
+  }
+  return display_;
+}
+
+void InputInjector::Inject(const InputEvent& event) {
+  if (!GetDisplay()) {
+    return;
+  }
+
+  switch (event.type) {
+    case InputEventType::kMotion:
+      XTestFakeMotionEvent(display_, -1, event.x, event.y, CurrentTime);
+      break;
+    case InputEventType::kRelativeMotion:
+      XTestFakeRelativeMotionEvent(display_, event.x, event.y, CurrentTime);
+      break;
+    case InputEventType::kButton:
+      XTestFakeButtonEvent(display_, event.code, event.down ? True : False, CurrentTime);
+      break;
+    case InputEventType::kKey:
+      XTestFakeKeyEvent(display_, event.code, event.down ? True : False, CurrentTime);
+      break;
+  }
+
+  if (recorder_) {
+    recorder_->Record(event);
+  }
+}
+
+void InputInjector::Flush() {
+  if (display_) {
+    XFlush(display_);
+  }
+}
@@ -0,0 +1,46 @@
+#ifndef RUNNER_INPUT_INJECTOR_H_
+#define RUNNER_INPUT_INJECTOR_H_
+
+#include <X11/Xlib.h>
+#include <cstdint>
+
+class InputRecorder;
+
+// 最底层的输入原语，点击、滚轮、打字都会拆成这几种事件。
+// 录制和回放也以它为单位，保证回放与原始注入完全一致。
+enum class InputEventType : uint8_t {
+  kMotion = 1,          // 绝对坐标移动
+  kRelativeMotion = 2,  // 相对移动
+  kButton = 3,          // 鼠标按钮，滚轮为 4~7 号按钮
+  kKey = 4,             // 键盘 keycode
+};
+
+struct InputEvent {
+  InputEventType type;
+  int32_t x = 0;
+  int32_t y = 0;
+  uint32_t code = 0;
+  bool down = false;
+};
+
+// 通过 XTest 注入输入事件，每个实例持有自己的 X 连接，只能在一个线程内使用
+class InputInjector {
+ public:
+  InputInjector();
+  ~InputInjector();
+
+  // 首次调用时打开显示并检查 XTest 扩展
+  Display* GetDisplay();
+
+  void Inject(const InputEvent& event);
+  void Flush();
+
+  // 设置后每个注入的事件都会写入录制器，传 nullptr 停止录制
+  void SetRecorder(InputRecorder* recorder) { recorder_ = recorder; }
+
+ private:
+  Display* display_ = nullptr;
+  InputRecorder* recorder_ = nullptr;
+};
+
+#endif  // RUNNER_INPUT_INJECTOR_H_
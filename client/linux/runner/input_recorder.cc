@@ -0,0 +1,250 @@
+#include "input_recorder.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char kMagic[4] = {'R', 'C', 'I', 'N'};
+const uint8_t kVersion = 1;
+const size_t kFlushThreshold = 64 * 1024;
+const uint8_t kDownFlag = 0x10;
+
+void PutVarint(std::vector<uint8_t>* out, uint64_t value) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+void PutSigned(std::vector<uint8_t>* out, int32_t value) {
+  uint32_t zigzag = (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+  PutVarint(out, zigzag);
+}
+
+bool GetVarint(const uint8_t** p, const uint8_t* end, uint64_t* value) {
+  uint64_t result = 0;
+  for (int shift = 0; shift < 64 && *p < end; shift += 7) {
+    uint8_t byte = *(*p)++;
+    result |= static_cast<uint64_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool GetSigned(const uint8_t** p, const uint8_t* end, int32_t* value) {
+  uint64_t zigzag;
+  if (!GetVarint(p, end, &zigzag)) {
+    return false;
+  }
+  uint32_t v = static_cast<uint32_t>(zigzag);
+  *value = static_cast<int32_t>((v >> 1) ^ (~(v & 1) + 1));
+  return true;
+}
+
+}  // namespace
+
+InputRecorder::InputRecorder() {}
+
+InputRecorder::~InputRecorder() {
+  Close();
+}
+
+bool InputRecorder::Open(const std::string& path) {
+  Close();
+  file_ = fopen(path.c_str(), "wb");
+  if (!file_) {
+    return false;
+  }
+  uint8_t header[8] = {0};
+  memcpy(header, kMagic, sizeof(kMagic));
+  header[4] = kVersion;
+  fwrite(header, 1, sizeof(header), file_);
+  last_ = Clock::now();
+  count_ = 0;
+  return true;
+}
+
+void InputRecorder::Record(const InputEvent& event) {
+  if (!file_) {
+    return;
+  }
+
+  Clock::time_point now = Clock::now();
+  uint64_t delta_us =
+      std::chrono::duration_cast<std::chrono::microseconds>(now - last_).count();
+  last_ = now;
+
+  PutVarint(&buffer_, delta_us);
+  buffer_.push_back(static_cast<uint8_t>(event.type) | (event.down ? kDownFlag : 0));
+  switch (event.type) {
+    case InputEventType::kMotion:
+    case InputEventType::kRelativeMotion:
+      PutSigned(&buffer_, event.x);
+      PutSigned(&buffer_, event.y);
+      break;
+    case InputEventType::kButton:
+    case InputEventType::kKey:
+      PutVarint(&buffer_, event.code);
+      break;
+  }
+  count_++;
+
+  if (buffer_.size() >= kFlushThreshold) {
+    FlushBuffer();
+  }
+}
+
+void InputRecorder::FlushBuffer() {
+  if (file_ && !buffer_.empty()) {
+    fwrite(buffer_.data(), 1, buffer_.size(), file_);
+  }
+  buffer_.clear();
+}
+
+uint64_t InputRecorder::Close() {
+  if (file_) {
+    FlushBuffer();
+    fclose(file_);
+    file_ = nullptr;
+  }
+  return count_;
+}
+
+bool ReadInputLog(const std::string& path, std::vector<TimedInputEvent>* events,
+                  std::string* error) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    *error = "无法打开输入日志";
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[64 * 1024];
+  size_t read;
+  while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    data.insert(data.end(), chunk, chunk + read);
+  }
+  fclose(file);
+
+  if (data.size() < 8 || memcmp(data.data(), kMagic, sizeof(kMagic)) != 0 ||
+      data[4] != kVersion) {
+    *error = "输入日志格式不正确";
+    return false;
+  }
+
+  const uint8_t* p = data.data() + 8;
+  const uint8_t* end = data.data() + data.size();
+  uint64_t time_us = 0;
+  while (p < end) {
+    uint64_t delta;
+    if (!GetVarint(&p, end, &delta) || p >= end) {
+      *error = "输入日志被截断";
+      return false;
+    }
+    uint8_t tag = *p++;
+    TimedInputEvent timed;
+    time_us += delta;
+    timed.time_us = time_us;
+    timed.event.type = static_cast<InputEventType>(tag & 0x0F);
+    timed.event.down = (tag & kDownFlag) != 0;
+
+    bool ok = false;
+    uint64_t code = 0;
+    switch (timed.event.type) {
+      case InputEventType::kMotion:
+      case InputEventType::kRelativeMotion:
+        ok = GetSigned(&p, end, &timed.event.x) && GetSigned(&p, end, &timed.event.y);
+        break;
+      case InputEventType::kButton:
+      case InputEventType::kKey:
+        ok = GetVarint(&p, end, &code);
+        timed.event.code = static_cast<uint32_t>(code);
+        break;
+    }
+    if (!ok) {
+      *error = "输入日志包含无效记录";
+      return false;
+    }
+    events->push_back(timed);
+  }
+  return true;
+}
+
+InputReplayer::InputReplayer() {}
+
+InputReplayer::~InputReplayer() {
+  Stop();
+}
+
+bool InputReplayer::Start(const std::string& path, double speed, std::string* error) {
+  Stop();
+
+  std::vector<TimedInputEvent> events;
+  if (!ReadInputLog(path, &events, error)) {
+    return false;
+  }
+
+  cancel_ = false;
+  running_ = true;
+  thread_ = std::thread([this, events = std::move(events), speed]() {
+    ReplayStats stats;
+    Replay(events, speed, &cancel_, &stats);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stats_ = stats;
+    }
+    running_ = false;
+  });
+  return true;
+}
+
+void InputReplayer::Stop() {
+  cancel_ = true;
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+ReplayStats InputReplayer::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+// static
+void InputReplayer::Replay(const std::vector<TimedInputEvent>& events, double speed,
+                           const std::atomic<bool>* cancel, ReplayStats* stats) {
+  InputInjector injector;
+  if (!injector.GetDisplay()) {
+    return;
+  }
+
+  // 按录制开始时间统一排期，而不是逐条 sleep，避免误差累积
+  Clock::time_point start = Clock::now();
+  for (const auto& timed : events) {
+    if (cancel && *cancel) {
+      break;
+    }
+    if (speed > 0) {
+      auto scheduled = start + std::chrono::microseconds(
+                                   static_cast<int64_t>(timed.time_us / speed));
+      if (scheduled > Clock::now()) {
+        // 等待前把已注入的事件发出去
+        injector.Flush();
+        std::this_thread::sleep_until(scheduled);
+      }
+      double lag = std::chrono::duration<double, std::milli>(Clock::now() - scheduled).count();
+      stats->max_lag_ms = std::max(stats->max_lag_ms, lag);
+    }
+    injector.Inject(timed.event);
+    stats->events++;
+  }
+  injector.Flush();
+  stats->duration_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
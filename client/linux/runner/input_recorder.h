@@ -0,0 +1,81 @@
+#ifndef RUNNER_INPUT_RECORDER_H_
+#define RUNNER_INPUT_RECORDER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "input_injector.h"
+
+// 输入日志格式：
+//   文件头 8 字节："RCIN"、版本号 1 字节、3 字节保留
+//   每条记录：varint 与上一条的时间差（微秒，单调时钟）、1 字节类型（低 4 位类型，
+//   第 4 位表示按下），之后按类型追加 zigzag varint 坐标或 varint 键码/按钮号。
+// 一次普通的鼠标移动通常只占 4~6 字节。
+
+struct TimedInputEvent {
+  // 相对录制开始的时间
+  uint64_t time_us = 0;
+  InputEvent event;
+};
+
+class InputRecorder {
+ public:
+  InputRecorder();
+  ~InputRecorder();
+
+  bool Open(const std::string& path);
+  void Record(const InputEvent& event);
+  // 写出缓冲并关闭文件，返回录制的事件数
+  uint64_t Close();
+  bool IsOpen() const { return file_ != nullptr; }
+
+ private:
+  void FlushBuffer();
+
+  FILE* file_ = nullptr;
+  std::vector<uint8_t> buffer_;
+  std::chrono::steady_clock::time_point last_;
+  uint64_t count_ = 0;
+};
+
+bool ReadInputLog(const std::string& path, std::vector<TimedInputEvent>* events,
+                  std::string* error);
+
+struct ReplayStats {
+  uint64_t events = 0;
+  double duration_ms = 0;
+  // 实际注入时间相对计划时间的最大延后
+  double max_lag_ms = 0;
+};
+
+// 回放输入日志。speed 为倍速，1 为原始节奏，0 表示不等待、尽快注入。
+class InputReplayer {
+ public:
+  InputReplayer();
+  ~InputReplayer();
+
+  // 在后台线程用独立的 X 连接回放
+  bool Start(const std::string& path, double speed, std::string* error);
+  void Stop();
+  bool IsRunning() const { return running_; }
+  ReplayStats stats() const;
+
+  // 在当前线程同步回放，供命令行无界面运行使用
+  static void Replay(const std::vector<TimedInputEvent>& events, double speed,
+                     const std::atomic<bool>* cancel, ReplayStats* stats);
+
+ private:
+  std::thread thread_;
+  std::atomic<bool> cancel_{false};
+  std::atomic<bool> running_{false};
+  mutable std::mutex mutex_;
+  ReplayStats stats_;
+};
+
+#endif  // RUNNER_INPUT_RECORDER_H_
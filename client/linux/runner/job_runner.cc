@@ -0,0 +1,134 @@
+#include "job_runner.h"
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+JobRunner::JobRunner(int max_workers) : max_workers_(std::max(max_workers, 1)) {}
+
+JobRunner::~JobRunner() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+    queue_.clear();
+    // 正在执行的命令一并终止，工作线程才能尽快退出
+    for (auto& entry : batches_) {
+      for (int fd : entry.second.cancel_fds) {
+        eventfd_write(fd, 1);
+      }
+    }
+  }
+  cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+int64_t JobRunner::Submit(std::vector<JobSpec> jobs, JobHandler on_job, BatchHandler on_batch) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  int64_t id = next_batch_++;
+  if (jobs.empty()) {
+    lock.unlock();
+    on_batch(id);
+    return id;
+  }
+  Batch& batch = batches_[id];
+  batch.on_job = std::move(on_job);
+  batch.on_batch = std::move(on_batch);
+  batch.remaining = jobs.size();
+  for (auto& spec : jobs) {
+    queue_.push_back({id, std::move(spec)});
+  }
+  // 空闲线程不够时按需补充，直到上限
+  int wanted = static_cast<int>(std::min<size_t>(queue_.size(), max_workers_));
+  while (idle_workers_ < wanted && static_cast<int>(workers_.size()) < max_workers_) {
+    workers_.emplace_back(&JobRunner::Worker, this);
+    idle_workers_++;
+  }
+  lock.unlock();
+  cv_.notify_all();
+  return id;
+}
+
+bool JobRunner::Cancel(int64_t batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = batches_.find(batch);
+  if (it == batches_.end()) {
+    return false;
+  }
+  it->second.cancelled = true;
+  for (int fd : it->second.cancel_fds) {
+    eventfd_write(fd, 1);
+  }
+  // 排队中的命令不必等空闲线程，直接以已取消结束
+  std::vector<Task> cancelled;
+  for (auto task = queue_.begin(); task != queue_.end();) {
+    if (task->batch == batch) {
+      cancelled.push_back(std::move(*task));
+      task = queue_.erase(task);
+    } else {
+      ++task;
+    }
+  }
+  CommandResult result;
+  result.cancelled = true;
+  for (const auto& task : cancelled) {
+    Finish(task.batch, task.spec.id, result, "");
+  }
+  return true;
+}
+
+void JobRunner::Worker() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    cv_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+    if (stopping_) {
+      return;
+    }
+    Task task = std::move(queue_.front());
+    queue_.pop_front();
+    idle_workers_--;
+
+    auto it = batches_.find(task.batch);
+    CommandResult result;
+    std::string error;
+    if (it->second.cancelled) {
+      result.cancelled = true;
+    } else {
+      int cancel_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      it->second.cancel_fds.push_back(cancel_fd);
+      task.spec.options.cancel_fd = cancel_fd;
+      lock.unlock();
+      if (cancel_fd < 0) {
+        error = "eventfd failed";
+      } else {
+        RunCommand(task.spec.options, &result, &error);
+      }
+      lock.lock();
+      // 批次在所有命令结束前不会被移除
+      auto& fds = batches_[task.batch].cancel_fds;
+      fds.erase(std::remove(fds.begin(), fds.end(), cancel_fd), fds.end());
+      if (cancel_fd >= 0) {
+        close(cancel_fd);
+      }
+    }
+    Finish(task.batch, task.spec.id, result, error);
+    idle_workers_++;
+  }
+}
+
+void JobRunner::Finish(int64_t batch, const std::string& job_id, const CommandResult& result,
+                       const std::string& error) {
+  // 持有锁时回调，保证整批完成的回调在该批最后一条结果之后
+  if (stopping_) {
+    return;
+  }
+  auto it = batches_.find(batch);
+  it->second.on_job(batch, job_id, result, error);
+  if (--it->second.remaining == 0) {
+    BatchHandler on_batch = std::move(it->second.on_batch);
+    batches_.erase(it);
+    on_batch(batch);
+  }
+}
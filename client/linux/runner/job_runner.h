@@ -0,0 +1,74 @@
+#ifndef RUNNER_JOB_RUNNER_H_
+#define RUNNER_JOB_RUNNER_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "command_runner.h"
+
+struct JobSpec {
+  // 调用方给的标识，原样带回结果里
+  std::string id;
+  CommandOptions options;
+};
+
+// 批量执行命令的有界工作池。一批命令提交后立即返回，各条命令在最多 max_workers 个
+// 工作线程上并行执行，每条完成时单独回调，整批耗时取决于最慢的一条而不是总和。
+// 取消一批时尚未开始的命令直接以已取消结束，正在执行的杀掉整个进程组。
+// 工作线程在第一次提交时才创建。回调在工作线程上持有锁调用，不能再调用 JobRunner 的方法，
+// 一般只把结果投递到平台线程。
+class JobRunner {
+ public:
+  using JobHandler = std::function<void(int64_t batch, const std::string& job_id,
+                                        const CommandResult& result, const std::string& error)>;
+  using BatchHandler = std::function<void(int64_t batch)>;
+
+  explicit JobRunner(int max_workers);
+  ~JobRunner();
+
+  JobRunner(const JobRunner&) = delete;
+  JobRunner& operator=(const JobRunner&) = delete;
+
+  // 返回批次编号；一批里每条命令完成时调用 on_job，全部完成后调用 on_batch
+  int64_t Submit(std::vector<JobSpec> jobs, JobHandler on_job, BatchHandler on_batch);
+  bool Cancel(int64_t batch);
+
+ private:
+  struct Batch {
+    JobHandler on_job;
+    BatchHandler on_batch;
+    size_t remaining = 0;
+    bool cancelled = false;
+    // 正在执行的命令的取消 eventfd
+    std::vector<int> cancel_fds;
+  };
+
+  struct Task {
+    int64_t batch = 0;
+    JobSpec spec;
+  };
+
+  void Worker();
+  // 持有 mutex_ 时调用
+  void Finish(int64_t batch, const std::string& job_id, const CommandResult& result,
+              const std::string& error);
+
+  const int max_workers_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> queue_;
+  std::map<int64_t, Batch> batches_;
+  std::vector<std::thread> workers_;
+  int idle_workers_ = 0;
+  int64_t next_batch_ = 1;
+  bool stopping_ = false;
+};
+
+#endif  // RUNNER_JOB_RUNNER_H_
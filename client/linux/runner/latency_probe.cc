@@ -0,0 +1,188 @@
+#include "latency_probe.h"
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/extensions/XTest.h>
+#include <X11/extensions/Xdamage.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const int kProbeSize = 8;
+
+double ElapsedMs(Clock::time_point since) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+unsigned long ReadPixel(Display* display, Window root, int x, int y) {
+  XImage* image = XGetImage(display, root, x, y, 1, 1, AllPlanes, ZPixmap);
+  if (!image) {
+    return ~0UL;
+  }
+  unsigned long pixel = XGetPixel(image, 0, 0);
+  XDestroyImage(image);
+  return pixel;
+}
+
+double Percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+}  // namespace
+
+bool RunLatencyProbe(const LatencyProbeOptions& options, LatencyProbeReport* report) {
+  Display* display = XOpenDisplay(NULL);
+  if (!display) {
+    report->error = "无法打开显示";
+    return false;
+  }
+
+  int event_base, error_base, major, minor;
+  if (!XTestQueryExtension(display, &event_base, &error_base, &major, &minor)) {
+    XCloseDisplay(display);
+    report->error = "XTest 扩展不可用";
+    return false;
+  }
+
+  int screen = DefaultScreen(display);
+  Window root = RootWindow(display, screen);
+  int probe_x = DisplayWidth(display, screen) - kProbeSize;
+  int probe_y = DisplayHeight(display, screen) - kProbeSize;
+  unsigned long colors[2] = {BlackPixel(display, screen), WhitePixel(display, screen)};
+
+  // 记录指针位置，结束后还原
+  Window root_return, child_return;
+  int pointer_x = 0, pointer_y = 0, win_x, win_y;
+  unsigned int mask;
+  XQueryPointer(display, root, &root_return, &child_return, &pointer_x, &pointer_y,
+                &win_x, &win_y, &mask);
+
+  // 探针窗口不经过窗口管理器，保证位置固定且在最上层
+  XSetWindowAttributes attrs;
+  attrs.override_redirect = True;
+  attrs.background_pixel = colors[0];
+  attrs.event_mask = ButtonPressMask | ExposureMask | StructureNotifyMask;
+  Window window = XCreateWindow(display, root, probe_x, probe_y, kProbeSize, kProbeSize, 0,
+                                CopyFromParent, InputOutput, CopyFromParent,
+                                CWOverrideRedirect | CWBackPixel | CWEventMask, &attrs);
+  XMapRaised(display, window);
+
+  int damage_event_base = 0, damage_error_base = 0;
+  Damage damage = 0;
+  if (XDamageQueryExtension(display, &damage_event_base, &damage_error_base)) {
+    damage = XDamageCreate(display, window, XDamageReportNonEmpty);
+    report->used_damage = true;
+  }
+
+  // 等待窗口映射完成
+  Clock::time_point map_start = Clock::now();
+  bool mapped = false;
+  while (!mapped && ElapsedMs(map_start) < options.timeout_ms) {
+    XEvent event;
+    while (XPending(display)) {
+      XNextEvent(display, &event);
+      if (event.type == MapNotify && event.xmap.window == window) {
+        mapped = true;
+      }
+    }
+    if (!mapped) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  XSync(display, False);
+
+  int current = 0;
+  for (int i = 0; i < options.samples; i++) {
+    int target = 1 - current;
+
+    Clock::time_point start = Clock::now();
+    XTestFakeMotionEvent(display, -1, probe_x + kProbeSize / 2, probe_y + kProbeSize / 2,
+                         CurrentTime);
+    XTestFakeButtonEvent(display, Button1, True, CurrentTime);
+    XTestFakeButtonEvent(display, Button1, False, CurrentTime);
+    XFlush(display);
+
+    bool done = false;
+    while (!done && ElapsedMs(start) < options.timeout_ms) {
+      bool check = damage == 0;
+      while (XPending(display)) {
+        XEvent event;
+        XNextEvent(display, &event);
+        if (event.type == ButtonPress && event.xbutton.window == window) {
+          // 模拟被控应用对输入的响应：重绘成另一种颜色
+          XSetWindowBackground(display, window, colors[target]);
+          XClearWindow(display, window);
+          XFlush(display);
+        } else if (damage && event.type == damage_event_base + XDamageNotify) {
+          XDamageSubtract(display, damage, None, None);
+          check = true;
+        }
+      }
+
+      if (check && ReadPixel(display, root, probe_x, probe_y) == colors[target]) {
+        report->samples_ms.push_back(ElapsedMs(start));
+        current = target;
+        done = true;
+        break;
+      }
+
+      if (damage) {
+        // 有 damage 时阻塞等待事件，超时后也读一次像素兜底
+        struct pollfd pfd = {ConnectionNumber(display), POLLIN, 0};
+        if (poll(&pfd, 1, 2) == 0 &&
+            ReadPixel(display, root, probe_x, probe_y) == colors[target]) {
+          report->samples_ms.push_back(ElapsedMs(start));
+          current = target;
+          done = true;
+        }
+      } else {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+      }
+    }
+
+    if (!done) {
+      report->timeouts++;
+      // 超时后强制同步颜色状态，避免后续采样错位
+      XSetWindowBackground(display, window, colors[target]);
+      XClearWindow(display, window);
+      XSync(display, False);
+      current = target;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(options.interval_ms));
+  }
+
+  XTestFakeMotionEvent(display, -1, pointer_x, pointer_y, CurrentTime);
+  if (damage) {
+    XDamageDestroy(display, damage);
+  }
+  XDestroyWindow(display, window);
+  XCloseDisplay(display);
+
+  std::vector<double> sorted = report->samples_ms;
+  std::sort(sorted.begin(), sorted.end());
+  if (!sorted.empty()) {
+    double sum = 0;
+    for (double v : sorted) {
+      sum += v;
+    }
+    report->min_ms = sorted.front();
+    report->max_ms = sorted.back();
+    report->mean_ms = sum / sorted.size();
+    report->p50_ms = Percentile(sorted, 50);
+    report->p90_ms = Percentile(sorted, 90);
+    report->p99_ms = Percentile(sorted, 99);
+  }
+  return true;
+}
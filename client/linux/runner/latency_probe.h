@@ -0,0 +1,35 @@
+#ifndef RUNNER_LATENCY_PROBE_H_
+#define RUNNER_LATENCY_PROBE_H_
+
+#include <string>
+#include <vector>
+
+struct LatencyProbeOptions {
+  int samples = 20;
+  // 单次采样等待像素变化的上限
+  int timeout_ms = 1000;
+  // 两次采样之间的间隔
+  int interval_ms = 50;
+};
+
+struct LatencyProbeReport {
+  int timeouts = 0;
+  // 是否使用 XDamage 通知代替轮询读像素
+  bool used_damage = false;
+  double min_ms = 0;
+  double mean_ms = 0;
+  double p50_ms = 0;
+  double p90_ms = 0;
+  double p99_ms = 0;
+  double max_ms = 0;
+  std::vector<double> samples_ms;
+  std::string error;
+};
+
+// 输入到像素的端到端延迟探针：
+// 在屏幕角落放一个小探针窗口，用 XTest 向它注入点击（与输入插件相同的注入路径），
+// 窗口收到点击后切换颜色，再用 XGetImage 读回该区域（与截屏插件相同的读取路径），
+// 从注入到读到新颜色的时间即一次采样。只依赖 X 服务器，可在 Xvfb 下无界面运行。
+bool RunLatencyProbe(const LatencyProbeOptions& options, LatencyProbeReport* report);
+
+#endif  // RUNNER_LATENCY_PROBE_H_
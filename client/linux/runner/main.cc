@@ -1,6 +1,81 @@
 #include "my_application.h"
 
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "headless_agent.h"
+#include "input_recorder.h"
+#include "latency_probe.h"
+
+// --latency-probe[=N]：不启动界面，只测量输入到像素的延迟，可在 Xvfb 下运行
+static int run_latency_probe(const char* arg) {
+  LatencyProbeOptions options;
+  const char* value = strchr(arg, '=');
+  if (value && atoi(value + 1) > 0) {
+    options.samples = atoi(value + 1);
+  }
+
+  LatencyProbeReport report;
+  if (!RunLatencyProbe(options, &report)) {
+    fprintf(stderr, "latency probe failed: %s\n", report.error.c_str());
+    return 1;
+  }
+  printf("samples=%zu timeouts=%d damage=%s\n", report.samples_ms.size(),
+         report.timeouts, report.used_damage ? "yes" : "no");
+  printf("min=%.3fms mean=%.3fms p50=%.3fms p90=%.3fms p99=%.3fms max=%.3fms\n",
+         report.min_ms, report.mean_ms, report.p50_ms, report.p90_ms,
+         report.p99_ms, report.max_ms);
+  return report.samples_ms.empty() ? 1 : 0;
+}
+
+// --replay-input=PATH [--replay-speed=X]：无界面回放输入日志，用于在 Xvfb 下
+// 以可重复的交互负载压测截屏和编码
+static int run_input_replay(const char* path, double speed) {
+  std::vector<TimedInputEvent> events;
+  std::string error;
+  if (!ReadInputLog(path, &events, &error)) {
+    fprintf(stderr, "input replay failed: %s\n", error.c_str());
+    return 1;
+  }
+
+  ReplayStats stats;
+  InputReplayer::Replay(events, speed, nullptr, &stats);
+  printf("events=%llu duration=%.3fms max_lag=%.3fms\n",
+         static_cast<unsigned long long>(stats.events), stats.duration_ms,
+         stats.max_lag_ms);
+  return stats.events == events.size() ? 0 : 1;
+}
+
 int main(int argc, char** argv) {
+  const char* replay_path = nullptr;
+  double replay_speed = 1.0;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "--latency-probe", strlen("--latency-probe")) == 0) {
+      return run_latency_probe(argv[i]);
+    } else if (strncmp(argv[i], "--agent", strlen("--agent")) == 0) {
+      // --agent[=SOCKET]：无界面代理模式，插件经 Unix 域套接字提供给本机的控制端
+      const char* value = strchr(argv[i], '=');
+      return RunHeadlessAgent(value ? value + 1 : DefaultAgentSocketPath());
+    } else if (strncmp(argv[i], "--replay-input=", strlen("--replay-input=")) == 0) {
+      replay_path = argv[i] + strlen("--replay-input=");
+    } else if (strncmp(argv[i], "--replay-speed=", strlen("--replay-speed=")) == 0) {
+      const char* value = argv[i] + strlen("--replay-speed=");
+      char* end = nullptr;
+      replay_speed = strtod(value, &end);
+      // 0、负数、NaN 和无穷大都无法换算回放间隔
+      if (end == value || *end != '\0' || !std::isfinite(replay_speed) || replay_speed <= 0) {
+        fprintf(stderr, "usage: --replay-speed=X, X must be a positive number, got \"%s\"\n",
+                value);
+        return 2;
+      }
+    }
+  }
+  if (replay_path) {
+    return run_input_replay(replay_path, replay_speed);
+  }
+
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
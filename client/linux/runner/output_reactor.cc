@@ -0,0 +1,202 @@
+#include "output_reactor.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace {
+
+// 唤醒 eventfd 在 epoll 中的标识，stream 编号从 1 开始不会与之冲突
+const uint64_t kWakeId = 0;
+const size_t kReadChunk = 64 * 1024;
+// 每个 fd 每轮最多读这么多，避免一路大量输出饿死其他 fd
+const int kReadsPerRound = 4;
+const int kMaxEvents = 32;
+
+}  // namespace
+
+OutputReactor::OutputReactor(size_t batch_bytes, int batch_ms, size_t max_unacked)
+    : batch_bytes_(batch_bytes),
+      batch_window_(batch_ms),
+      max_unacked_(max_unacked),
+      read_buffer_(kReadChunk) {
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = kWakeId;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+  thread_ = std::thread(&OutputReactor::Run, this);
+}
+
+OutputReactor::~OutputReactor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  uint64_t one = 1;
+  ssize_t ignored = write(wake_fd_, &one, sizeof(one));
+  (void)ignored;
+  thread_.join();
+  close(wake_fd_);
+  close(epoll_fd_);
+}
+
+bool OutputReactor::Add(int64_t stream, int fd, OutputHandler on_output,
+                        ClosedHandler on_closed) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  struct epoll_event event = {};
+  event.events = EPOLLIN;
+  event.data.u64 = static_cast<uint64_t>(stream);
+  if (stream <= 0 || streams_.count(stream) || epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0) {
+    return false;
+  }
+  Stream& entry = streams_[stream];
+  entry.fd = fd;
+  entry.on_output = std::move(on_output);
+  entry.on_closed = std::move(on_closed);
+  return true;
+}
+
+void OutputReactor::Remove(int64_t stream) {
+  // 回调都在持有 mutex_ 时调用，拿到锁即说明没有正在进行的回调
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(stream);
+  if (it == streams_.end()) {
+    return;
+  }
+  if (!it->second.paused) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  }
+  streams_.erase(it);
+}
+
+void OutputReactor::Ack(int64_t stream, size_t bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = streams_.find(stream);
+  if (it == streams_.end()) {
+    return;
+  }
+  Stream& entry = it->second;
+  entry.unacked -= std::min(entry.unacked, bytes);
+  if (entry.paused && entry.unacked <= max_unacked_ / 2) {
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(stream);
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, entry.fd, &event);
+    entry.paused = false;
+  }
+}
+
+void OutputReactor::Run() {
+  struct epoll_event events[kMaxEvents];
+  while (true) {
+    int timeout = -1;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stopping_) {
+        break;
+      }
+      // 等待到最早的批次截止时间
+      Clock::time_point now = Clock::now();
+      for (const auto& entry : streams_) {
+        if (entry.second.batch.empty()) {
+          continue;
+        }
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        entry.second.deadline - now + std::chrono::microseconds(999))
+                        .count();
+        int ms = static_cast<int>(std::max<int64_t>(0, wait));
+        timeout = timeout < 0 ? ms : std::min(timeout, ms);
+      }
+    }
+    int count = epoll_wait(epoll_fd_, events, kMaxEvents, timeout);
+    if (count < 0 && errno != EINTR) {
+      break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stopping_) {
+      break;
+    }
+    for (int i = 0; i < count; i++) {
+      if (events[i].data.u64 == kWakeId) {
+        uint64_t value;
+        ssize_t ignored = read(wake_fd_, &value, sizeof(value));
+        (void)ignored;
+        continue;
+      }
+      int64_t id = static_cast<int64_t>(events[i].data.u64);
+      auto it = streams_.find(id);
+      if (it != streams_.end() && !it->second.paused) {
+        ReadStream(id, &it->second);
+      }
+    }
+    Clock::time_point now = Clock::now();
+    for (auto& entry : streams_) {
+      if (!entry.second.batch.empty() && entry.second.deadline <= now) {
+        Flush(entry.first, &entry.second);
+      }
+    }
+  }
+}
+
+void OutputReactor::ReadStream(int64_t id, Stream* stream) {
+  for (int i = 0; i < kReadsPerRound && !stream->paused; i++) {
+    ssize_t n = read(stream->fd, read_buffer_.data(), read_buffer_.size());
+    if (n > 0) {
+      if (stream->batch.empty()) {
+        stream->deadline = Clock::now() + batch_window_;
+      }
+      stream->batch.insert(stream->batch.end(), read_buffer_.begin(), read_buffer_.begin() + n);
+      if (stream->batch.size() >= batch_bytes_) {
+        Flush(id, stream);
+      }
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno == EAGAIN) {
+      return;
+    }
+    // EOF，或者伪终端另一端全部关闭时的 EIO
+    Flush(id, stream);
+    CloseStream(id);
+    return;
+  }
+}
+
+void OutputReactor::Flush(int64_t id, Stream* stream) {
+  if (stream->batch.empty()) {
+    return;
+  }
+  stream->unacked += stream->batch.size();
+  std::vector<uint8_t> batch;
+  batch.swap(stream->batch);
+  stream->on_output(id, std::move(batch));
+  if (stream->unacked > max_unacked_ && !stream->paused) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, stream->fd, nullptr);
+    stream->paused = true;
+  }
+}
+
+void OutputReactor::CloseStream(int64_t id) {
+  auto it = streams_.find(id);
+  if (it == streams_.end()) {
+    return;
+  }
+  if (!it->second.paused) {
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, nullptr);
+  }
+  ClosedHandler on_closed = std::move(it->second.on_closed);
+  streams_.erase(it);
+  if (on_closed) {
+    on_closed(id);
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef RUNNER_OUTPUT_REACTOR_H_
+#define RUNNER_OUTPUT_REACTOR_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 用一个 epoll 线程读取多路输出 fd，把输出合并成批次再交给回调：
+// 批次攒够 batch_bytes 立即交付，否则在收到第一个字节 batch_ms 毫秒后交付，
+// 大量输出时每秒最多产生 1000 / batch_ms 个批次，而不是成千上万个小块。
+// 回调在 reactor 线程上调用，不能再调用 reactor 的方法，一般只把数据投递到平台线程。
+// 交付后尚未 Ack 的字节超过上限时暂停读取该 fd，由内核缓冲区让写入方阻塞，输出不会丢失。
+class OutputReactor {
+ public:
+  using OutputHandler = std::function<void(int64_t stream, std::vector<uint8_t> data)>;
+  // fd 读到 EOF 或出错，最后一批输出交付之后调用
+  using ClosedHandler = std::function<void(int64_t stream)>;
+
+  OutputReactor(size_t batch_bytes, int batch_ms, size_t max_unacked);
+  ~OutputReactor();
+
+  OutputReactor(const OutputReactor&) = delete;
+  OutputReactor& operator=(const OutputReactor&) = delete;
+
+  // fd 需为非阻塞，仍由调用方负责关闭
+  bool Add(int64_t stream, int fd, OutputHandler on_output, ClosedHandler on_closed);
+  // 返回后不会再有该 stream 的回调，尚未交付的输出被丢弃
+  void Remove(int64_t stream);
+  void Ack(int64_t stream, size_t bytes);
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  struct Stream {
+    int fd = -1;
+    OutputHandler on_output;
+    ClosedHandler on_closed;
+    std::vector<uint8_t> batch;
+    Clock::time_point deadline;
+    size_t unacked = 0;
+    bool paused = false;
+  };
+
+  void Run();
+  // 以下在持有 mutex_ 时调用
+  void ReadStream(int64_t id, Stream* stream);
+  void Flush(int64_t id, Stream* stream);
+  void CloseStream(int64_t id);
+
+  const size_t batch_bytes_;
+  const std::chrono::milliseconds batch_window_;
+  const size_t max_unacked_;
+
+  int epoll_fd_ = -1;
+  int wake_fd_ = -1;
+  bool stopping_ = false;
+  std::thread thread_;
+  std::mutex mutex_;
+  std::map<int64_t, Stream> streams_;
+  std::vector<uint8_t> read_buffer_;
+};
+
+#endif  // RUNNER_OUTPUT_REACTOR_H_
@@ -0,0 +1,28 @@
+#include "platform_thread.h"
+
+#include <glib.h>
+
+void PostToPlatformThread(std::function<void()> task) {
+  auto* pending = new std::function<void()>(std::move(task));
+  g_idle_add(
+      [](gpointer data) -> gboolean {
+        auto* callback = static_cast<std::function<void()>*>(data);
+        (*callback)();
+        delete callback;
+        return G_SOURCE_REMOVE;
+      },
+      pending);
+}
+
+void PostToPlatformThreadDelayed(int delay_ms, std::function<void()> task) {
+  auto* pending = new std::function<void()>(std::move(task));
+  g_timeout_add(
+      delay_ms > 0 ? static_cast<guint>(delay_ms) : 0,
+      [](gpointer data) -> gboolean {
+        auto* callback = static_cast<std::function<void()>*>(data);
+        (*callback)();
+        delete callback;
+        return G_SOURCE_REMOVE;
+      },
+      pending);
+}
@@ -0,0 +1,13 @@
+#ifndef RUNNER_PLATFORM_THREAD_H_
+#define RUNNER_PLATFORM_THREAD_H_
+
+#include <functional>
+
+// 把任务投递到 GTK 主循环执行。方法结果和 EventSink 只能在平台线程上调用，
+// 后台线程产生的结果都经由这里送回。可以从任意线程调用。
+void PostToPlatformThread(std::function<void()> task);
+
+// 至少 delay_ms 毫秒之后在平台线程上执行，用于限制刷新频率
+void PostToPlatformThreadDelayed(int delay_ms, std::function<void()> task);
+
+#endif  // RUNNER_PLATFORM_THREAD_H_
@@ -0,0 +1,233 @@
+#include "pty_session.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <pty.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+extern char** environ;
+
+namespace {
+
+// 待取输出的上限，控制端长时间不读取时只保留最新的部分
+const size_t kMaxPendingOutput = 4 * 1024 * 1024;
+// 回滚历史按块压缩，块越大压缩率越高，回看时需要解压的也越多
+const size_t kScrollbackBlockBytes = 64 * 1024;
+// 写入时终端输入缓冲区满，最多等待这么久
+const int kWriteTimeoutMs = 1000;
+// 挂断后等待 shell 自行退出的时间
+const int kHangupGraceMs = 1000;
+
+std::string ResolveShell(const std::string& requested) {
+  std::string shell = requested;
+  if (shell.empty()) {
+    const char* env_shell = getenv("SHELL");
+    shell = env_shell && *env_shell ? env_shell : "/bin/sh";
+  }
+  if (shell.find('/') != std::string::npos) {
+    return shell;
+  }
+  // 在父进程里按 PATH 查找，子进程 fork 之后只做 execve
+  const char* path = getenv("PATH");
+  std::string dirs = path ? path : "/usr/bin:/bin";
+  size_t start = 0;
+  while (start <= dirs.size()) {
+    size_t end = dirs.find(':', start);
+    std::string dir = dirs.substr(start, end == std::string::npos ? std::string::npos : end - start);
+    std::string candidate = (dir.empty() ? "." : dir) + "/" + shell;
+    if (access(candidate.c_str(), X_OK) == 0) {
+      return candidate;
+    }
+    if (end == std::string::npos) {
+      break;
+    }
+    start = end + 1;
+  }
+  return shell;
+}
+
+}  // namespace
+
+PtySession::PtySession() {}
+
+PtySession::~PtySession() { Close(); }
+
+bool PtySession::Start(const PtySessionOptions& options, std::string* error) {
+  shell_ = ResolveShell(options.shell);
+  cols_ = options.cols > 0 ? options.cols : 80;
+  rows_ = options.rows > 0 ? options.rows : 24;
+  scrollback_ = std::make_unique<ScrollbackBuffer>(kScrollbackBlockBytes, options.scrollback_bytes);
+  if (options.screen) {
+    screen_ = std::make_unique<TerminalScreen>(cols_, rows_);
+  }
+
+  // fork 之后的子进程只能调用异步信号安全的函数，参数和环境变量提前准备好
+  std::string base = shell_.substr(shell_.find_last_of('/') + 1);
+  std::string arg0 = options.login ? "-" + base : base;
+  char* argv[] = {const_cast<char*>(arg0.c_str()), nullptr};
+  std::map<std::string, std::string> env;
+  for (char** item = environ; item && *item; item++) {
+    const char* equals = strchr(*item, '=');
+    if (equals) {
+      env[std::string(*item, equals - *item)] = equals + 1;
+    }
+  }
+  env["TERM"] = "xterm-256color";
+  for (const auto& item : options.env) {
+    env[item.first] = item.second;
+  }
+  std::vector<std::string> env_strings;
+  for (const auto& item : env) {
+    env_strings.push_back(item.first + "=" + item.second);
+  }
+  std::vector<char*> envp;
+  for (auto& item : env_strings) {
+    envp.push_back(const_cast<char*>(item.c_str()));
+  }
+  envp.push_back(nullptr);
+  const char* working_dir = options.working_dir.empty() ? nullptr : options.working_dir.c_str();
+
+  struct winsize size = {};
+  size.ws_col = static_cast<unsigned short>(cols_);
+  size.ws_row = static_cast<unsigned short>(rows_);
+  pid_ = forkpty(&master_fd_, nullptr, nullptr, &size);
+  if (pid_ < 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  if (pid_ == 0) {
+    if (working_dir && chdir(working_dir) != 0) {
+      static const char kMessage[] = "cannot change to working directory\r\n";
+      ssize_t ignored = write(STDERR_FILENO, kMessage, sizeof(kMessage) - 1);
+      (void)ignored;
+    }
+    // GTK 进程里被忽略或屏蔽的信号不能带进 shell
+    for (int sig = 1; sig < NSIG; sig++) {
+      signal(sig, SIG_DFL);
+    }
+    sigset_t mask;
+    sigemptyset(&mask);
+    sigprocmask(SIG_SETMASK, &mask, nullptr);
+    execve(shell_.c_str(), argv, envp.data());
+    _exit(127);
+  }
+
+  fcntl(master_fd_, F_SETFD, FD_CLOEXEC);
+  fcntl(master_fd_, F_SETFL, fcntl(master_fd_, F_GETFL) | O_NONBLOCK);
+  return true;
+}
+
+bool PtySession::Write(const uint8_t* data, size_t size, std::string* error) {
+  if (master_fd_ < 0 || exited_) {
+    *error = "session closed";
+    return false;
+  }
+  size_t written = 0;
+  while (written < size) {
+    ssize_t n = write(master_fd_, data + written, size - written);
+    if (n > 0) {
+      written += n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && errno == EAGAIN) {
+      // 前台程序暂时不读输入，短暂等待，避免长时间卡住平台线程
+      struct pollfd item = {master_fd_, POLLOUT, 0};
+      if (poll(&item, 1, kWriteTimeoutMs) > 0) {
+        continue;
+      }
+      *error = "terminal input buffer full";
+      return false;
+    }
+    *error = strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool PtySession::Resize(int cols, int rows) {
+  if (master_fd_ < 0 || cols <= 0 || rows <= 0) {
+    return false;
+  }
+  struct winsize size = {};
+  size.ws_col = static_cast<unsigned short>(cols);
+  size.ws_row = static_cast<unsigned short>(rows);
+  if (ioctl(master_fd_, TIOCSWINSZ, &size) != 0) {
+    return false;
+  }
+  cols_ = cols;
+  rows_ = rows;
+  if (screen_) {
+    screen_->Resize(cols, rows);
+  }
+  return true;
+}
+
+void PtySession::AppendOutput(const uint8_t* data, size_t size, bool pending) {
+  if (scrollback_) {
+    scrollback_->Append(data, size);
+  }
+  if (screen_) {
+    screen_->Feed(data, size);
+  }
+  if (!pending) {
+    return;
+  }
+  pending_.insert(pending_.end(), data, data + size);
+  if (pending_.size() > kMaxPendingOutput) {
+    size_t excess = pending_.size() - kMaxPendingOutput;
+    pending_.erase(pending_.begin(), pending_.begin() + excess);
+    dropped_ += excess;
+  }
+}
+
+std::vector<uint8_t> PtySession::TakeOutput(int64_t* dropped) {
+  std::vector<uint8_t> output;
+  output.swap(pending_);
+  *dropped = dropped_;
+  dropped_ = 0;
+  return output;
+}
+
+void PtySession::Reap(int wait_ms) {
+  // 主端读到 EIO 时 shell 可能还没变成僵尸进程，短暂轮询等待
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+  while (pid_ > 0 && !exited_) {
+    int status = 0;
+    pid_t reaped = waitpid(pid_, &status, WNOHANG);
+    if (reaped == pid_) {
+      exit_code_ = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+      exited_ = true;
+    } else if (reaped < 0 || std::chrono::steady_clock::now() >= deadline) {
+      break;
+    } else {
+      usleep(5 * 1000);
+    }
+  }
+}
+
+void PtySession::Close() {
+  if (master_fd_ >= 0) {
+    // 关闭主端即挂断终端，内核向会话首进程发送 SIGHUP
+    close(master_fd_);
+    master_fd_ = -1;
+  }
+  if (pid_ > 0 && !exited_) {
+    kill(-pid_, SIGHUP);
+    Reap(kHangupGraceMs);
+    if (!exited_) {
+      kill(-pid_, SIGKILL);
+      Reap(kHangupGraceMs);
+    }
+  }
+}
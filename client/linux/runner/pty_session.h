@@ -0,0 +1,82 @@
+#ifndef RUNNER_PTY_SESSION_H_
+#define RUNNER_PTY_SESSION_H_
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "scrollback_buffer.h"
+#include "terminal_screen.h"
+
+struct PtySessionOptions {
+  // 为空时使用 $SHELL，再退回 /bin/sh
+  std::string shell;
+  std::string working_dir;
+  std::map<std::string, std::string> env;
+  bool login = false;
+  int cols = 80;
+  int rows = 24;
+  // 回滚历史压缩后最多占用的内存
+  size_t scrollback_bytes = 2 * 1024 * 1024;
+  // 在本地维护屏幕状态，控制端只接收屏幕差异而不是原始输出
+  bool screen = false;
+};
+
+// 一个常驻的伪终端 shell 会话。shell 在 forkpty 创建的终端里运行，自成会话和进程组，
+// 交互程序、作业控制和工作目录等状态在多次输入之间保持。
+// 主端 fd 由 OutputReactor 统一读取；没有输出订阅者时输出暂存在待取缓冲区，
+// 缓冲区超过上限时丢弃最旧的数据。全部输出另外记入固定内存的回滚历史，供重新连接时回看。
+// 除 Reap 外只在平台线程上调用。
+class PtySession {
+ public:
+  PtySession();
+  ~PtySession();
+
+  PtySession(const PtySession&) = delete;
+  PtySession& operator=(const PtySession&) = delete;
+
+  bool Start(const PtySessionOptions& options, std::string* error);
+  bool Write(const uint8_t* data, size_t size, std::string* error);
+  // 调整终端大小，内核会给前台进程组发送 SIGWINCH
+  bool Resize(int cols, int rows);
+  // 记入回滚历史和屏幕状态；pending 为 true 时同时放进待取缓冲区
+  void AppendOutput(const uint8_t* data, size_t size, bool pending);
+  // 取出待取缓冲区的输出，dropped 返回因缓冲区溢出丢弃的字节数
+  std::vector<uint8_t> TakeOutput(int64_t* dropped);
+  // 挂断会话：先发 SIGHUP，shell 不退出时再 SIGKILL 整个进程组。调用前需先从 reactor 移除
+  void Close();
+  // 回收已退出的 shell，wait_ms 为最多等待的毫秒数。在 reactor 线程上只能传 0
+  void Reap(int wait_ms);
+
+  int master_fd() const { return master_fd_; }
+  pid_t pid() const { return pid_; }
+  const std::string& shell() const { return shell_; }
+  int cols() const { return cols_; }
+  int rows() const { return rows_; }
+  bool exited() const { return exited_; }
+  int exit_code() const { return exit_code_; }
+  ScrollbackBuffer* scrollback() { return scrollback_.get(); }
+  // 未开启屏幕模式时为空
+  TerminalScreen* screen() { return screen_.get(); }
+
+ private:
+  int master_fd_ = -1;
+  pid_t pid_ = -1;
+  std::string shell_;
+  int cols_ = 80;
+  int rows_ = 24;
+
+  std::unique_ptr<ScrollbackBuffer> scrollback_;
+  std::unique_ptr<TerminalScreen> screen_;
+  std::vector<uint8_t> pending_;
+  int64_t dropped_ = 0;
+  std::atomic<bool> exited_{false};
+  std::atomic<int> exit_code_{-1};
+};
+
+#endif  // RUNNER_PTY_SESSION_H_
@@ -4,6 +4,8 @@
 #include <flutter/plugin_registrar_linux.h>
 #include <flutter/standard_method_codec.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <X11/Xlib.h>
@@ -11,9 +13,105 @@
 #include <png.h>
 #include <cstring>
 
+#include "session_recorder.h"
+
+// X.h 把 Success 定义成宏，会和 MethodResult::Success 冲突
+#ifdef Success
+#undef Success
+#endif
+
+#include "encodable_args.h"
+#include "frame_distributor.h"
+#include "platform_thread.h"
+#include "task_executor.h"
+#include "wire_protocol.h"
+
+namespace {
+
+// 抓取整个根窗口，转换为 RGB888。每次使用独立的 X 连接，可在工作线程上并发调用
+bool GrabScreen(RgbImage* out) {
+  Display* display = XOpenDisplay(NULL);
+  if (!display) {
+    return false;
+  }
+  
+  int screen = DefaultScreen(display);
+  Window root = RootWindow(display, screen);
+  int width = DisplayWidth(display, screen);
+  int height = DisplayHeight(display, screen);
+  
+  XImage* image = XGetImage(display, root, 0, 0, width, height, AllPlanes, ZPixmap);
+  if (!image) {
+    XCloseDisplay(display);
+    return false;
+  }
+  
+  out->width = width;
+  out->height = height;
+  out->pixels.resize(static_cast<size_t>(width) * height * 3);
+  for (int y = 0; y < height; y++) {
+    uint8_t* row = out->pixels.data() + static_cast<size_t>(y) * width * 3;
+    for (int x = 0; x < width; x++) {
+      unsigned long pixel = XGetPixel(image, x, y);
+      row[x * 3] = (pixel >> 16) & 0xFF;     // R
+      row[x * 3 + 1] = (pixel >> 8) & 0xFF;  // G
+      row[x * 3 + 2] = pixel & 0xFF;         // B
+    }
+  }
+  
+  XDestroyImage(image);
+  XCloseDisplay(display);
+  return true;
+}
+
+std::vector<uint8_t> EncodePng(const RgbImage& image) {
+  std::vector<uint8_t> pngData;
+  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+  if (!png) {
+    return std::vector<uint8_t>();
+  }
+  
+  png_infop info = png_create_info_struct(png);
+  if (!info) {
+    png_destroy_write_struct(&png, NULL);
+    return std::vector<uint8_t>();
+  }
+  
+  // 使用内存写入 PNG
+  struct PngWriteData {
+    std::vector<uint8_t>* data;
+  };
+  PngWriteData writeData;
+  writeData.data = &pngData;
+  
+  png_set_write_fn(png, &writeData, [](png_structp png, png_bytep data, png_size_t length) {
+    PngWriteData* wd = static_cast<PngWriteData*>(png_get_io_ptr(png));
+    wd->data->insert(wd->data->end(), data, data + length);
+  }, NULL);
+  
+  png_set_IHDR(png, info, image.width, image.height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
+                PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+  
+  png_write_info(png, info);
+  
+  std::vector<png_bytep> rowPointers(image.height);
+  for (int y = 0; y < image.height; y++) {
+    rowPointers[y] = const_cast<png_bytep>(image.pixels.data()) +
+                     static_cast<size_t>(y) * image.width * 3;
+  }
+  
+  png_write_image(png, rowPointers.data());
+  png_write_end(png, NULL);
+  png_destroy_write_struct(&png, &info);
+  
+  return pngData;
+}
+
+}  // namespace
+
 class ScreenCapturePlugin : public flutter::Plugin {
  public:
-  static void RegisterWithRegistrar(flutter::PluginRegistrarLinux *registrar);
+  static std::unique_ptr<ScreenCapturePlugin> Create(flutter::BinaryMessenger *messenger);
 
   ScreenCapturePlugin();
 
@@ -24,15 +122,39 @@ class ScreenCapturePlugin : public flutter::Plugin {
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
   
+  void HandleRecordingCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  void HandleDistributorCall(
+      const std::string& method, const flutter::EncodableMap* args,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
   std::vector<uint8_t> captureScreen();
+
+  // 录制期间让流水线每次抓屏都把完整画质的帧交给录制器，停止后取消
+  void UpdateRecordingObserver();
+  // 写入一帧 PNG，captured 为抓屏时间；比已写入的帧更早的直接丢弃
+  void RecordFrame(std::chrono::steady_clock::time_point captured, const uint8_t* data,
+                   size_t size);
+
+  // 多个观看会话共用的抓屏编码流水线，第一次订阅时创建
+  std::unique_ptr<FrameDistributor> distributor_;
+
+  // 录制的每一帧都是完整的 PNG，因此都标记为关键帧。
+  // 帧来自共享流水线和 captureScreen 两处，时间戳需保持递增
+  SessionRecorder recorder_;
+  std::chrono::steady_clock::time_point recording_start_;
+  uint64_t last_recorded_us_ = 0;
+  SessionPlayback playback_;
 };
 
 // static
-void ScreenCapturePlugin::RegisterWithRegistrar(
-    flutter::PluginRegistrarLinux *registrar) {
+std::unique_ptr<ScreenCapturePlugin> ScreenCapturePlugin::Create(
+    flutter::BinaryMessenger *messenger) {
   auto channel =
       std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-          registrar->messenger(), "screen_capture",
+          messenger, "screen_capture",
           &flutter::StandardMethodCodec::GetInstance());
 
   auto plugin = std::make_unique<ScreenCapturePlugin>();
@@ -42,16 +164,30 @@ void ScreenCapturePlugin::RegisterWithRegistrar(
         plugin_pointer->HandleMethodCall(call, std::move(result));
       });
 
-  registrar->AddPlugin(std::move(plugin));
+  return plugin;
 }
 
 ScreenCapturePlugin::ScreenCapturePlugin() {}
 
-ScreenCapturePlugin::~ScreenCapturePlugin() {}
+ScreenCapturePlugin::~ScreenCapturePlugin() {
+  recorder_.Close();
+}
 
 void ScreenCapturePlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const std::string& method = method_call.method_name();
+  if (method == "startRecording" || method == "stopRecording" ||
+      method == "openPlayback" || method == "seekPlayback" || method == "closePlayback") {
+    HandleRecordingCall(method, args, std::move(result));
+    return;
+  }
+  if (method == "subscribeFrames" || method == "unsubscribeFrames" || method == "nextFrame") {
+    HandleDistributorCall(method, args, std::move(result));
+    return;
+  }
+
   if (method_call.method_name().compare("getScreenSize") == 0) {
     Display* display = XOpenDisplay(NULL);
     if (display) {
@@ -67,95 +203,215 @@ void ScreenCapturePlugin::HandleMethodCall(
     } else {
       result->Error("NO_DISPLAY", "无法打开显示", nullptr);
     }
-  } else if (method_call.method_name().compare("captureScreen") == 0) {
-    std::vector<uint8_t> imageData = captureScreen();
-    if (!imageData.empty()) {
-      result->Success(flutter::EncodableValue(imageData));
+  } else if (method == "captureScreen") {
+    // 未协商二进制协议的连接使用。二进制协议的帧走 subscribeFrames/nextFrame 共享流水线。
+    // 抓屏和 PNG 编码在共享工作池上进行，每次使用独立的 X 连接；录制写入回到平台线程
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    TaskExecutor::Shared().Submit(TaskPriority::kCapture, [this, shared_result]() {
+      auto imageData = std::make_shared<std::vector<uint8_t>>(captureScreen());
+      auto captured = std::chrono::steady_clock::now();
+      PostToPlatformThread([this, shared_result, imageData, captured]() {
+        if (imageData->empty()) {
+          shared_result->Error("CAPTURE_FAILED", "屏幕捕获失败", nullptr);
+          return;
+        }
+        RecordFrame(captured, imageData->data(), imageData->size());
+        shared_result->Success(flutter::EncodableValue(std::move(*imageData)));
+      });
+    });
+  } else {
+    result->NotImplemented();
+  }
+}
+
+void ScreenCapturePlugin::HandleDistributorCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  int64_t session = 0;
+  if (!args || !GetInt64(*args, "session", &session) || session < 0 || session > UINT32_MAX) {
+    result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    return;
+  }
+
+  if (method == "subscribeFrames") {
+    int64_t tier = 0, fps = 15;
+    GetInt64(*args, "tier", &tier);
+    GetInt64(*args, "fps", &fps);
+    if (tier < 0 || tier >= kFrameTierCount) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+      return;
+    }
+    if (!distributor_) {
+      distributor_ = std::make_unique<FrameDistributor>(GrabScreen, EncodePng);
+      UpdateRecordingObserver();
+    }
+    distributor_->Subscribe(static_cast<uint32_t>(session), static_cast<FrameTier>(tier),
+                            static_cast<int>(std::min<int64_t>(fps, 1000)));
+    result->Success();
+  } else if (method == "unsubscribeFrames") {
+    if (distributor_) {
+      distributor_->Unsubscribe(static_cast<uint32_t>(session));
+    }
+    result->Success();
+  } else {
+    // 返回编码好的二进制协议消息，所有会话共用同一份编码结果，
+    // 只在交给 Dart 时复制一次，并在副本里填上本会话的编号
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    uint32_t wire_session = static_cast<uint32_t>(session);
+    if (!distributor_ ||
+        !distributor_->NextFrame(wire_session, [shared_result, wire_session](EncodedFrame frame) {
+          if (frame) {
+            std::vector<uint8_t> message(*frame);
+            SetWireSession(wire_session, &message);
+            shared_result->Success(flutter::EncodableValue(std::move(message)));
+          } else {
+            shared_result->Success();
+          }
+        })) {
+      shared_result->Error("NOT_SUBSCRIBED", "会话未订阅屏幕帧", nullptr);
+    }
+  }
+}
+
+void ScreenCapturePlugin::HandleRecordingCall(
+    const std::string& method, const flutter::EncodableMap* args,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  std::string path;
+  if (args) {
+    auto it = args->find(flutter::EncodableValue("path"));
+    if (it != args->end() && std::holds_alternative<std::string>(it->second)) {
+      path = std::get<std::string>(it->second);
+    }
+  }
+
+  if (method == "startRecording") {
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    } else if (recorder_.Open(path)) {
+      recording_start_ = std::chrono::steady_clock::now();
+      last_recorded_us_ = 0;
+      UpdateRecordingObserver();
+      result->Success();
+    } else {
+      result->Error("RECORD_FAILED", "无法创建录像文件", nullptr);
+    }
+  } else if (method == "stopRecording") {
+    recorder_.Close();
+    UpdateRecordingObserver();
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("frames")] =
+        flutter::EncodableValue(static_cast<int64_t>(recorder_.frames_written()));
+    response[flutter::EncodableValue("dropped")] =
+        flutter::EncodableValue(static_cast<int64_t>(recorder_.frames_dropped()));
+    // 写盘失败时文件只保留到最后一个完整的数据块，仍可回放
+    response[flutter::EncodableValue("writeFailed")] =
+        flutter::EncodableValue(recorder_.write_failed());
+    result->Success(flutter::EncodableValue(response));
+  } else if (method == "openPlayback") {
+    std::string error;
+    if (path.empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments", nullptr);
+    } else if (playback_.Open(path, &error)) {
+      flutter::EncodableMap response;
+      response[flutter::EncodableValue("frames")] =
+          flutter::EncodableValue(static_cast<int64_t>(playback_.frame_count()));
+      response[flutter::EncodableValue("keyframes")] =
+          flutter::EncodableValue(static_cast<int64_t>(playback_.keyframe_count()));
+      response[flutter::EncodableValue("durationMs")] =
+          flutter::EncodableValue(static_cast<int64_t>(playback_.duration_us() / 1000));
+      result->Success(flutter::EncodableValue(response));
     } else {
-      result->Error("CAPTURE_FAILED", "屏幕捕获失败", nullptr);
+      result->Error("PLAYBACK_FAILED", error, nullptr);
+    }
+  } else if (method == "seekPlayback") {
+    int64_t timestamp_ms = 0;
+    if (args) {
+      auto it = args->find(flutter::EncodableValue("timestampMs"));
+      if (it != args->end()) {
+        if (const auto* v = std::get_if<int32_t>(&it->second)) {
+          timestamp_ms = *v;
+        } else if (const auto* l = std::get_if<int64_t>(&it->second)) {
+          timestamp_ms = *l;
+        }
+      }
     }
+    size_t first = 0, last = 0;
+    if (!playback_.IsOpen() ||
+        !playback_.Seek(static_cast<uint64_t>(std::max<int64_t>(0, timestamp_ms)) * 1000,
+                        &first, &last)) {
+      result->Error("PLAYBACK_FAILED", "无法定位录像", nullptr);
+      return;
+    }
+    // 只返回从最近关键帧到目标帧所需的数据，由调用方按顺序解码
+    flutter::EncodableList frames;
+    flutter::EncodableList timestamps;
+    for (size_t i = first; i <= last; i++) {
+      const SessionIndexEntry& entry = playback_.entry(i);
+      const uint8_t* data = playback_.frame_data(i);
+      frames.push_back(flutter::EncodableValue(std::vector<uint8_t>(data, data + entry.size)));
+      timestamps.push_back(
+          flutter::EncodableValue(static_cast<int64_t>(entry.timestamp_us / 1000)));
+    }
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("frames")] = flutter::EncodableValue(frames);
+    response[flutter::EncodableValue("timestampsMs")] = flutter::EncodableValue(timestamps);
+    result->Success(flutter::EncodableValue(response));
   } else {
-    result->NotImplemented();
+    playback_.Close();
+    result->Success();
   }
 }
 
-std::vector<uint8_t> ScreenCapturePlugin::captureScreen() {
-  Display* display = XOpenDisplay(NULL);
-  if (!display) {
-    return std::vector<uint8_t>();
+void ScreenCapturePlugin::UpdateRecordingObserver() {
+  if (!distributor_) {
+    return;
   }
-  
-  int screen = DefaultScreen(display);
-  Window root = RootWindow(display, screen);
-  int width = DisplayWidth(display, screen);
-  int height = DisplayHeight(display, screen);
-  
-  XImage* image = XGetImage(display, root, 0, 0, width, height, AllPlanes, ZPixmap);
-  if (!image) {
-    XCloseDisplay(display);
-    return std::vector<uint8_t>();
+  if (!recorder_.IsOpen()) {
+    distributor_->SetCaptureObserver(FrameTier::kFull, nullptr);
+    return;
   }
-  
-  // 转换为 PNG
-  std::vector<uint8_t> pngData;
-  png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
-  if (!png) {
-    XDestroyImage(image);
-    XCloseDisplay(display);
-    return std::vector<uint8_t>();
+  distributor_->SetCaptureObserver(
+      FrameTier::kFull, [this](std::chrono::steady_clock::time_point captured, EncodedFrame frame) {
+        // 录像里存的是 PNG 本身，从二进制协议消息中取出
+        WireHeader header;
+        const uint8_t* payload = nullptr;
+        WireScreenFrame screen;
+        std::string error;
+        if (DecodeWireHeader(frame->data(), frame->size(), &header, &payload, &error) &&
+            DecodeWireScreenFrame(payload, header.payload_length, &screen, &error)) {
+          RecordFrame(captured, screen.data, screen.size);
+        }
+      });
+}
+
+void ScreenCapturePlugin::RecordFrame(std::chrono::steady_clock::time_point captured,
+                                      const uint8_t* data, size_t size) {
+  if (!recorder_.IsOpen()) {
+    return;
   }
-  
-  png_infop info = png_create_info_struct(png);
-  if (!info) {
-    png_destroy_write_struct(&png, NULL);
-    XDestroyImage(image);
-    XCloseDisplay(display);
-    return std::vector<uint8_t>();
+  auto elapsed = std::max(captured - recording_start_, std::chrono::steady_clock::duration::zero());
+  uint64_t timestamp_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+  // 两处抓屏的结果回到平台线程的顺序不一定和抓屏顺序一致
+  if (timestamp_us < last_recorded_us_) {
+    return;
   }
-  
-  // 使用内存写入 PNG
-  struct PngWriteData {
-    std::vector<uint8_t>* data;
-  };
-  PngWriteData writeData;
-  writeData.data = &pngData;
-  
-  png_set_write_fn(png, &writeData, [](png_structp png, png_bytep data, png_size_t length) {
-    PngWriteData* wd = static_cast<PngWriteData*>(png_get_io_ptr(png));
-    wd->data->insert(wd->data->end(), data, data + length);
-  }, NULL);
-  
-  png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB, PNG_INTERLACE_NONE,
-                PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
-  
-  png_write_info(png, info);
-  
-  // 转换 XImage 数据为 RGB
-  std::vector<png_bytep> rowPointers(height);
-  std::vector<std::vector<uint8_t>> rowData(height);
-  
-  for (int y = 0; y < height; y++) {
-    rowData[y].resize(width * 3);
-    for (int x = 0; x < width; x++) {
-      unsigned long pixel = XGetPixel(image, x, y);
-      rowData[y][x * 3] = (pixel >> 16) & 0xFF;     // R
-      rowData[y][x * 3 + 1] = (pixel >> 8) & 0xFF;  // G
-      rowData[y][x * 3 + 2] = pixel & 0xFF;         // B
-    }
-    rowPointers[y] = rowData[y].data();
+  last_recorded_us_ = timestamp_us;
+  recorder_.Append(timestamp_us, true, data, size);
+}
+
+std::vector<uint8_t> ScreenCapturePlugin::captureScreen() {
+  RgbImage image;
+  if (!GrabScreen(&image)) {
+    return std::vector<uint8_t>();
   }
-  
-  png_write_image(png, rowPointers.data());
-  png_write_end(png, NULL);
-  png_destroy_write_struct(&png, &info);
-  
-  XDestroyImage(image);
-  XCloseDisplay(display);
-  
-  return pngData;
+  return EncodePng(image);
 }
 
 void RegisterScreenCapturePlugin(flutter::PluginRegistrarLinux *registrar) {
-  ScreenCapturePlugin::RegisterWithRegistrar(registrar);
+  registrar->AddPlugin(ScreenCapturePlugin::Create(registrar->messenger()));
+}
+
+std::unique_ptr<flutter::Plugin> CreateScreenCapturePlugin(flutter::BinaryMessenger *messenger) {
+  return ScreenCapturePlugin::Create(messenger);
 }
 
@@ -1,10 +1,16 @@
 #ifndef RUNNER_SCREEN_CAPTURE_PLUGIN_H_
 #define RUNNER_SCREEN_CAPTURE_PLUGIN_H_
 
+#include <flutter/binary_messenger.h>
 #include <flutter/plugin_registrar_linux.h>
+
+#include <memory>
 #include <vector>
 
 void RegisterScreenCapturePlugin(flutter::PluginRegistrarLinux *registrar);
 
+// 无界面代理模式下不经过 Flutter 引擎，直接挂在 messenger 上
+std::unique_ptr<flutter::Plugin> CreateScreenCapturePlugin(flutter::BinaryMessenger *messenger);
+
 #endif  // RUNNER_SCREEN_CAPTURE_PLUGIN_H_
 
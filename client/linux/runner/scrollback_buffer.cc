@@ -0,0 +1,147 @@
+#include "scrollback_buffer.h"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+
+// 回滚历史里文本居多，中等级别已经能压到原来的几分之一
+const int kCompressionLevel = 3;
+
+}  // namespace
+
+ScrollbackBuffer::ScrollbackBuffer(size_t block_bytes, size_t max_compressed_bytes)
+    : block_bytes_(std::max<size_t>(block_bytes, 1024)),
+      max_compressed_bytes_(max_compressed_bytes),
+      compressor_(kCompressionLevel) {
+  active_.reserve(block_bytes_);
+}
+
+void ScrollbackBuffer::Append(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    size_t n = std::min(size, block_bytes_ - active_.size());
+    active_.insert(active_.end(), data, data + n);
+    newlines_ += std::count(data, data + n, '\n');
+    data += n;
+    size -= n;
+    if (active_.size() >= block_bytes_) {
+      Archive();
+    }
+  }
+}
+
+void ScrollbackBuffer::Archive() {
+  Block block;
+  block.byte_base = byte_base_;
+  block.line_base = line_base_;
+  block.newlines = newlines_ - line_base_;
+  block.raw_size = active_.size();
+  std::string error;
+  if (!compressor_.Compress(active_.data(), active_.size(), ZstdCompressor::Mode::kEnd,
+                            &block.compressed, &error)) {
+    // 压缩失败时这一块直接丢弃，行号和字节偏移照常推进
+    block.compressed.clear();
+    block.raw_size = 0;
+  }
+  block.compressed.shrink_to_fit();
+  compressed_bytes_ += block.compressed.size();
+  byte_base_ += static_cast<int64_t>(active_.size());
+  line_base_ = newlines_;
+  active_.clear();
+  if (block.raw_size > 0) {
+    blocks_.push_back(std::move(block));
+  }
+
+  while (!blocks_.empty() && compressed_bytes_ > max_compressed_bytes_) {
+    compressed_bytes_ -= blocks_.front().compressed.size();
+    if (blocks_.front().byte_base == cached_base_) {
+      cached_base_ = -1;
+      cached_.clear();
+    }
+    blocks_.pop_front();
+  }
+}
+
+const std::vector<uint8_t>& ScrollbackBuffer::BlockData(size_t index) {
+  if (index >= blocks_.size()) {
+    return active_;
+  }
+  const Block& block = blocks_[index];
+  if (block.byte_base != cached_base_) {
+    cached_.clear();
+    cached_.reserve(block.raw_size);
+    std::string error;
+    if (!decompressor_.Decompress(block.compressed.data(), block.compressed.size(), &cached_,
+                                  &error) ||
+        cached_.size() != block.raw_size) {
+      // 保持长度一致，偏移计算不受影响
+      cached_.assign(block.raw_size, ' ');
+    }
+    cached_base_ = block.byte_base;
+  }
+  return cached_;
+}
+
+int64_t ScrollbackBuffer::first_line() const {
+  // 最早的块从会话开头开始时第 0 行完整；否则第一行残缺，从块里第一个换行之后算起
+  if (blocks_.empty()) {
+    return byte_base_ == 0 ? 0 : line_base_ + 1;
+  }
+  return blocks_.front().byte_base == 0 ? 0 : blocks_.front().line_base + 1;
+}
+
+std::vector<uint8_t> ScrollbackBuffer::Read(int64_t from_line, int64_t max_lines,
+                                            size_t max_bytes, int64_t* first_line_out,
+                                            int64_t* next_line) {
+  std::vector<uint8_t> output;
+  int64_t line = std::max(from_line, first_line());
+  *first_line_out = line;
+  *next_line = line;
+  if (line > newlines_ || max_lines <= 0) {
+    return output;
+  }
+
+  // 找到起始行所在的块：第 line 行从第 line 个换行之后开始
+  size_t count = blocks_.size() + 1;
+  size_t index = 0;
+  size_t offset = 0;
+  if (line > 0) {
+    for (index = 0; index < count; index++) {
+      int64_t base = index < blocks_.size() ? blocks_[index].line_base : line_base_;
+      int64_t newlines = index < blocks_.size() ? blocks_[index].newlines : newlines_ - line_base_;
+      if (line > base && line <= base + newlines) {
+        const std::vector<uint8_t>& data = BlockData(index);
+        int64_t skip = line - base;
+        while (offset < data.size()) {
+          if (data[offset++] == '\n' && --skip == 0) {
+            break;
+          }
+        }
+        break;
+      }
+    }
+  }
+
+  // 逐块复制，直到取够行数或字节数；末尾尚未结束的行也会返回，但不计入 next_line
+  int64_t lines = 0;
+  for (; index < count; index++, offset = 0) {
+    const std::vector<uint8_t>& data = BlockData(index);
+    while (offset < data.size()) {
+      const uint8_t* start = data.data() + offset;
+      const uint8_t* end = data.data() + data.size();
+      const uint8_t* newline = std::find(start, end, '\n');
+      bool complete = newline != end;
+      output.insert(output.end(), start, complete ? newline + 1 : end);
+      offset = (complete ? newline + 1 : end) - data.data();
+      if (complete) {
+        lines++;
+        if (lines >= max_lines || output.size() >= max_bytes) {
+          *next_line = line + lines;
+          return output;
+        }
+      }
+    }
+  }
+  *next_line = line + lines;
+  return output;
+}
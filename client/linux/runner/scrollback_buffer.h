@@ -0,0 +1,69 @@
+#ifndef RUNNER_SCROLLBACK_BUFFER_H_
+#define RUNNER_SCROLLBACK_BUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#include "zstd_stream.h"
+
+// 终端会话的回滚历史。输出先写进一个未压缩的活动块，写满后整块用 zstd 压缩归档；
+// 归档块的压缩后总大小超过上限时丢弃最旧的块，所以内存占用只取决于配置而与运行时长无关。
+// 行号从会话开始累计、不会因丢弃而改变，重新连接的控制端可以从上次看到的行号继续取。
+// 只在平台线程上使用。
+class ScrollbackBuffer {
+ public:
+  ScrollbackBuffer(size_t block_bytes, size_t max_compressed_bytes);
+
+  ScrollbackBuffer(const ScrollbackBuffer&) = delete;
+  ScrollbackBuffer& operator=(const ScrollbackBuffer&) = delete;
+
+  void Append(const uint8_t* data, size_t size);
+
+  // 从 from_line 行开始最多取 max_lines 行、约 max_bytes 字节（总会取完当前行）。
+  // from_line 早于最早保留的行时从最早保留的行开始，first_line 返回实际的起始行，
+  // next_line 返回下一次应请求的行号
+  std::vector<uint8_t> Read(int64_t from_line, int64_t max_lines, size_t max_bytes,
+                            int64_t* first_line, int64_t* next_line);
+
+  // 最早仍保留的完整行
+  int64_t first_line() const;
+  // 已经开始的行数，最后一行可能尚未结束
+  int64_t total_lines() const { return newlines_ + 1; }
+  int64_t total_bytes() const { return byte_base_ + static_cast<int64_t>(active_.size()); }
+  size_t memory_bytes() const { return compressed_bytes_ + active_.capacity(); }
+
+ private:
+  struct Block {
+    // 块之前的总字节数和换行数
+    int64_t byte_base = 0;
+    int64_t line_base = 0;
+    int64_t newlines = 0;
+    size_t raw_size = 0;
+    std::vector<uint8_t> compressed;
+  };
+
+  void Archive();
+  // 块 index（等于 blocks_.size() 时为活动块）解压后的内容
+  const std::vector<uint8_t>& BlockData(size_t index);
+
+  const size_t block_bytes_;
+  const size_t max_compressed_bytes_;
+
+  std::deque<Block> blocks_;
+  size_t compressed_bytes_ = 0;
+  std::vector<uint8_t> active_;
+  // 活动块之前的总字节数、总换行数，以及整个会话的换行数
+  int64_t byte_base_ = 0;
+  int64_t line_base_ = 0;
+  int64_t newlines_ = 0;
+
+  ZstdCompressor compressor_;
+  ZstdDecompressor decompressor_;
+  // 最近解压的一个块，按 byte_base 识别，连续翻页时不必重复解压
+  int64_t cached_base_ = -1;
+  std::vector<uint8_t> cached_;
+};
+
+#endif  // RUNNER_SCROLLBACK_BUFFER_H_
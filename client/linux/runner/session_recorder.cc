@@ -0,0 +1,448 @@
+#include "session_recorder.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+const char kFileMagic[4] = {'R', 'C', 'S', 'R'};
+const char kChunkMagic[4] = {'C', 'H', 'N', 'K'};
+const char kFooterMagic[4] = {'R', 'C', 'I', 'X'};
+const uint32_t kVersion = 1;
+
+const size_t kFileHeaderSize = 16;
+const size_t kChunkHeaderSize = 16;
+const size_t kFrameHeaderSize = 16;
+const size_t kFooterSize = 40;
+
+// 数据块攒到这个大小或超过一秒没有新帧就写盘
+const size_t kChunkBytes = 4 * 1024 * 1024;
+
+void PutU32(uint8_t* p, uint32_t v) { memcpy(p, &v, sizeof(v)); }
+void PutU64(uint8_t* p, uint64_t v) { memcpy(p, &v, sizeof(v)); }
+uint32_t GetU32(const uint8_t* p) { uint32_t v; memcpy(&v, p, sizeof(v)); return v; }
+uint64_t GetU64(const uint8_t* p) { uint64_t v; memcpy(&v, p, sizeof(v)); return v; }
+
+}  // namespace
+
+SessionRecorder::SessionRecorder() {}
+
+SessionRecorder::~SessionRecorder() {
+  Close();
+}
+
+bool SessionRecorder::Open(const std::string& path, size_t max_queued_bytes) {
+  Close();
+
+  fd_ = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    return false;
+  }
+  uint8_t header[kFileHeaderSize] = {0};
+  memcpy(header, kFileMagic, sizeof(kFileMagic));
+  PutU32(header + 4, kVersion);
+  file_offset_ = 0;
+  if (!WriteAll(header, sizeof(header))) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  max_queued_bytes_ = max_queued_bytes;
+  queue_.clear();
+  queued_bytes_ = 0;
+  closing_ = false;
+  waiting_for_keyframe_ = true;
+  frames_written_ = 0;
+  frames_dropped_ = 0;
+  write_failed_ = false;
+  index_.clear();
+  keyframes_.clear();
+  writer_ = std::thread(&SessionRecorder::WriterLoop, this);
+  return true;
+}
+
+bool SessionRecorder::Append(uint64_t timestamp_us, bool keyframe, const uint8_t* data,
+                             size_t size) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (fd_ < 0 || closing_) {
+      return false;
+    }
+    if (write_failed_) {
+      frames_dropped_++;
+      return false;
+    }
+    // 差分帧依赖前面的帧，一旦丢过帧就要等到下一个关键帧再继续
+    if ((waiting_for_keyframe_ && !keyframe) || queued_bytes_ + size > max_queued_bytes_) {
+      waiting_for_keyframe_ = true;
+      frames_dropped_++;
+      return false;
+    }
+    waiting_for_keyframe_ = false;
+    queued_bytes_ += size;
+  }
+
+  // 拷贝放在锁外，避免写线程等待
+  PendingFrame frame;
+  frame.timestamp_us = timestamp_us;
+  frame.keyframe = keyframe;
+  frame.data.assign(data, data + size);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    queue_.push_back(std::move(frame));
+  }
+  cv_.notify_one();
+  return true;
+}
+
+void SessionRecorder::Close() {
+  if (fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closing_ = true;
+  }
+  cv_.notify_one();
+  if (writer_.joinable()) {
+    writer_.join();
+  }
+  fsync(fd_);
+  close(fd_);
+  std::lock_guard<std::mutex> lock(mutex_);
+  fd_ = -1;
+}
+
+uint64_t SessionRecorder::frames_written() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_written_;
+}
+
+uint64_t SessionRecorder::frames_dropped() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return frames_dropped_;
+}
+
+bool SessionRecorder::write_failed() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return write_failed_;
+}
+
+void SessionRecorder::WriterLoop() {
+  std::vector<uint8_t> chunk;
+  chunk.reserve(kChunkBytes + kChunkBytes / 4);
+  uint32_t chunk_frames = 0;
+  bool ok = true;
+
+  for (;;) {
+    PendingFrame frame;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cv_.wait_for(lock, std::chrono::seconds(1),
+                   [this] { return closing_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        if (closing_) {
+          break;
+        }
+        // 空闲时把攒着的数据写出去，崩溃时最多丢一秒
+        lock.unlock();
+        ok = WriteChunk(&chunk, chunk_frames);
+        chunk_frames = 0;
+        if (!ok) {
+          break;
+        }
+        continue;
+      }
+      frame = std::move(queue_.front());
+      queue_.pop_front();
+      queued_bytes_ -= frame.data.size();
+    }
+
+    SessionIndexEntry entry;
+    entry.timestamp_us = frame.timestamp_us;
+    entry.offset = file_offset_ + kChunkHeaderSize + chunk.size() + kFrameHeaderSize;
+    entry.size = static_cast<uint32_t>(frame.data.size());
+    entry.flags = frame.keyframe ? kSessionFrameKeyframe : 0;
+    if (frame.keyframe) {
+      keyframes_.push_back(static_cast<uint32_t>(index_.size()));
+    }
+    index_.push_back(entry);
+
+    uint8_t header[kFrameHeaderSize];
+    PutU64(header, entry.timestamp_us);
+    PutU32(header + 8, entry.size);
+    PutU32(header + 12, entry.flags);
+    chunk.insert(chunk.end(), header, header + sizeof(header));
+    chunk.insert(chunk.end(), frame.data.begin(), frame.data.end());
+    chunk_frames++;
+
+    if (chunk.size() >= kChunkBytes) {
+      ok = WriteChunk(&chunk, chunk_frames);
+      chunk_frames = 0;
+      if (!ok) {
+        break;
+      }
+    }
+  }
+
+  // 写失败后只留下完整的数据块，不写索引，读取端扫描数据块即可回放已写入的部分
+  if (ok && WriteChunk(&chunk, chunk_frames)) {
+    WriteIndex();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  frames_dropped_ += queue_.size();
+  queue_.clear();
+  queued_bytes_ = 0;
+}
+
+bool SessionRecorder::WriteChunk(std::vector<uint8_t>* chunk, uint32_t frame_count) {
+  if (frame_count == 0) {
+    return true;
+  }
+  uint64_t chunk_offset = file_offset_;
+  uint8_t header[kChunkHeaderSize] = {0};
+  memcpy(header, kChunkMagic, sizeof(kChunkMagic));
+  PutU32(header + 4, frame_count);
+  PutU32(header + 8, static_cast<uint32_t>(chunk->size()));
+  bool ok = WriteAll(header, sizeof(header)) && WriteAll(chunk->data(), chunk->size());
+  chunk->clear();
+  if (!ok) {
+    TruncateTo(chunk_offset);
+    std::lock_guard<std::mutex> lock(mutex_);
+    frames_dropped_ += frame_count;
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  frames_written_ += frame_count;
+  return true;
+}
+
+bool SessionRecorder::WriteIndex() {
+  // 索引按 8 字节对齐，读取端可以直接把映射区域当作数组使用
+  static const uint8_t kPadding[8] = {0};
+  uint64_t data_end = file_offset_;
+  bool ok = true;
+  if (file_offset_ % 8 != 0) {
+    ok = WriteAll(kPadding, 8 - file_offset_ % 8);
+  }
+  uint64_t index_offset = file_offset_;
+  ok = ok && WriteAll(index_.data(), index_.size() * sizeof(SessionIndexEntry));
+  uint64_t keyframe_offset = file_offset_;
+  ok = ok && WriteAll(keyframes_.data(), keyframes_.size() * sizeof(uint32_t));
+
+  uint8_t footer[kFooterSize];
+  PutU64(footer, index_offset);
+  PutU64(footer + 8, index_.size());
+  PutU64(footer + 16, keyframe_offset);
+  PutU64(footer + 24, keyframes_.size());
+  memcpy(footer + 32, kFooterMagic, sizeof(kFooterMagic));
+  PutU32(footer + 36, kVersion);
+  ok = ok && WriteAll(footer, sizeof(footer));
+  if (!ok) {
+    // 数据块都已完整写入，去掉半截索引后读取端会扫描重建
+    TruncateTo(data_end);
+  }
+  return ok;
+}
+
+void SessionRecorder::TruncateTo(uint64_t offset) {
+  if (ftruncate(fd_, static_cast<off_t>(offset)) == 0) {
+    lseek(fd_, static_cast<off_t>(offset), SEEK_SET);
+    file_offset_ = offset;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  write_failed_ = true;
+}
+
+bool SessionRecorder::WriteAll(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    ssize_t written = write(fd_, p, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    p += written;
+    size -= written;
+    file_offset_ += written;
+  }
+  return true;
+}
+
+SessionPlayback::SessionPlayback() {}
+
+SessionPlayback::~SessionPlayback() {
+  Close();
+}
+
+bool SessionPlayback::Open(const std::string& path, std::string* error) {
+  Close();
+
+  fd_ = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0) {
+    *error = "无法打开录像文件";
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || static_cast<size_t>(st.st_size) < kFileHeaderSize) {
+    *error = "录像文件不完整";
+    Close();
+    return false;
+  }
+  size_ = st.st_size;
+  void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+  if (mapped == MAP_FAILED) {
+    *error = "无法映射录像文件";
+    Close();
+    return false;
+  }
+  data_ = static_cast<const uint8_t*>(mapped);
+  // 拖动进度条是随机访问，关闭预读以减小常驻内存
+  madvise(mapped, size_, MADV_RANDOM);
+
+  if (memcmp(data_, kFileMagic, sizeof(kFileMagic)) != 0) {
+    *error = "不是录像文件";
+    Close();
+    return false;
+  }
+  if (!LoadFooter() && !RebuildIndex()) {
+    *error = "录像索引损坏";
+    Close();
+    return false;
+  }
+  return true;
+}
+
+void SessionPlayback::Close() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+  index_ = nullptr;
+  keyframes_ = nullptr;
+  frame_count_ = 0;
+  keyframe_count_ = 0;
+  rebuilt_index_.clear();
+  rebuilt_keyframes_.clear();
+}
+
+uint64_t SessionPlayback::duration_us() const {
+  if (frame_count_ == 0) {
+    return 0;
+  }
+  return index_[frame_count_ - 1].timestamp_us - index_[0].timestamp_us;
+}
+
+bool SessionPlayback::LoadFooter() {
+  if (size_ < kFileHeaderSize + kFooterSize) {
+    return false;
+  }
+  const uint8_t* footer = data_ + size_ - kFooterSize;
+  if (memcmp(footer + 32, kFooterMagic, sizeof(kFooterMagic)) != 0) {
+    return false;
+  }
+  uint64_t index_offset = GetU64(footer);
+  uint64_t frame_count = GetU64(footer + 8);
+  uint64_t keyframe_offset = GetU64(footer + 16);
+  uint64_t keyframe_count = GetU64(footer + 24);
+  uint64_t limit = size_ - kFooterSize;
+  if (index_offset % 8 != 0 || index_offset > limit ||
+      frame_count > (limit - index_offset) / sizeof(SessionIndexEntry) ||
+      keyframe_offset > limit ||
+      keyframe_count > (limit - keyframe_offset) / sizeof(uint32_t)) {
+    return false;
+  }
+  index_ = reinterpret_cast<const SessionIndexEntry*>(data_ + index_offset);
+  keyframes_ = reinterpret_cast<const uint32_t*>(data_ + keyframe_offset);
+  frame_count_ = frame_count;
+  keyframe_count_ = keyframe_count;
+  return true;
+}
+
+bool SessionPlayback::RebuildIndex() {
+  size_t pos = kFileHeaderSize;
+  while (pos + kChunkHeaderSize <= size_ &&
+         memcmp(data_ + pos, kChunkMagic, sizeof(kChunkMagic)) == 0) {
+    uint32_t frames = GetU32(data_ + pos + 4);
+    uint32_t payload = GetU32(data_ + pos + 8);
+    size_t end = pos + kChunkHeaderSize + payload;
+    if (end > size_) {
+      // 最后一个数据块没写完
+      break;
+    }
+    size_t p = pos + kChunkHeaderSize;
+    for (uint32_t i = 0; i < frames && p + kFrameHeaderSize <= end; i++) {
+      SessionIndexEntry entry;
+      entry.timestamp_us = GetU64(data_ + p);
+      entry.size = GetU32(data_ + p + 8);
+      entry.flags = GetU32(data_ + p + 12);
+      entry.offset = p + kFrameHeaderSize;
+      if (entry.offset + entry.size > end) {
+        break;
+      }
+      if (entry.flags & kSessionFrameKeyframe) {
+        rebuilt_keyframes_.push_back(static_cast<uint32_t>(rebuilt_index_.size()));
+      }
+      rebuilt_index_.push_back(entry);
+      p = entry.offset + entry.size;
+    }
+    pos = end;
+  }
+
+  index_ = rebuilt_index_.data();
+  keyframes_ = rebuilt_keyframes_.data();
+  frame_count_ = rebuilt_index_.size();
+  keyframe_count_ = rebuilt_keyframes_.size();
+  return true;
+}
+
+bool SessionPlayback::Seek(uint64_t timestamp_us, size_t* first, size_t* last) const {
+  if (frame_count_ == 0) {
+    return false;
+  }
+  // 映射之后文件被截短时，再访问映射区域会收到 SIGBUS
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || static_cast<uint64_t>(st.st_size) < size_) {
+    return false;
+  }
+
+  const SessionIndexEntry* end = index_ + frame_count_;
+  const SessionIndexEntry* it = std::upper_bound(
+      index_, end, timestamp_us,
+      [](uint64_t ts, const SessionIndexEntry& e) { return ts < e.timestamp_us; });
+  size_t target = it == index_ ? 0 : static_cast<size_t>(it - index_) - 1;
+
+  const uint32_t* kf_end = keyframes_ + keyframe_count_;
+  const uint32_t* kf = std::upper_bound(keyframes_, kf_end, static_cast<uint32_t>(target));
+  size_t start = kf == keyframes_ ? 0 : *(kf - 1);
+  if (start > target) {
+    return false;
+  }
+
+  // 索引来自文件，使用前确认帧数据没有越界
+  for (size_t i = start; i <= target; i++) {
+    if (index_[i].offset > size_ || index_[i].size > size_ - index_[i].offset) {
+      return false;
+    }
+  }
+  *first = start;
+  *last = target;
+  return true;
+}
@@ -0,0 +1,125 @@
+#ifndef RUNNER_SESSION_RECORDER_H_
+#define RUNNER_SESSION_RECORDER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 会话录像容器格式（小端）：
+//   文件头 16 字节："RCSR"、u32 版本、8 字节保留
+//   数据块：块头 16 字节（"CHNK"、u32 帧数、u32 负载字节数、u32 保留），之后是帧记录：
+//           u64 时间戳（微秒）、u32 长度、u32 标志，再跟编码后的帧数据
+//   索引：每帧一条 SessionIndexEntry，按时间排序；之后是关键帧序号表（u32）
+//   文件尾 40 字节：u64 索引偏移、u64 帧数、u64 关键帧表偏移、u64 关键帧数、"RCIX"、u32 版本
+// 写入中途崩溃没有索引时，读取端会顺序扫描数据块重建索引。
+
+struct SessionIndexEntry {
+  uint64_t timestamp_us;
+  // 帧数据（不含帧记录头）在文件中的偏移
+  uint64_t offset;
+  uint32_t size;
+  uint32_t flags;
+};
+
+const uint32_t kSessionFrameKeyframe = 1;
+
+// 录制器：Append 只把帧放进有界队列，由后台线程攒成数据块写盘，不阻塞实时推流。
+class SessionRecorder {
+ public:
+  SessionRecorder();
+  ~SessionRecorder();
+
+  // max_queued_bytes 限制尚未写盘的数据量，超出后丢帧直到下一个关键帧
+  bool Open(const std::string& path, size_t max_queued_bytes = 64 * 1024 * 1024);
+  bool Append(uint64_t timestamp_us, bool keyframe, const uint8_t* data, size_t size);
+  // 写完剩余数据和索引后关闭
+  void Close();
+  bool IsOpen() const { return fd_ >= 0; }
+
+  uint64_t frames_written() const;
+  uint64_t frames_dropped() const;
+  // 写盘失败（如磁盘已满）后不再接收新帧，文件截断到最后一个完整的数据块
+  bool write_failed() const;
+
+ private:
+  struct PendingFrame {
+    uint64_t timestamp_us;
+    bool keyframe;
+    std::vector<uint8_t> data;
+  };
+
+  void WriterLoop();
+  bool WriteChunk(std::vector<uint8_t>* chunk, uint32_t frame_count);
+  bool WriteIndex();
+  // 写失败时丢掉 offset 之后写了一半的内容
+  void TruncateTo(uint64_t offset);
+  bool WriteAll(const void* data, size_t size);
+
+  int fd_ = -1;
+  uint64_t file_offset_ = 0;
+  size_t max_queued_bytes_ = 0;
+
+  std::thread writer_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<PendingFrame> queue_;
+  size_t queued_bytes_ = 0;
+  bool closing_ = false;
+  bool waiting_for_keyframe_ = true;
+  uint64_t frames_written_ = 0;
+  uint64_t frames_dropped_ = 0;
+  bool write_failed_ = false;
+
+  // 只由写线程访问
+  std::vector<SessionIndexEntry> index_;
+  std::vector<uint32_t> keyframes_;
+};
+
+// 回放读取器：整个文件只读映射，索引直接指向映射区域，定位只做二分查找，
+// 只有被请求的帧才会被访问，常驻内存与录像长度无关。
+// 文件在回放期间被截短时，访问映射区域超出文件末尾的部分会触发 SIGBUS，
+// 所以每次定位前都重新检查文件大小。
+class SessionPlayback {
+ public:
+  SessionPlayback();
+  ~SessionPlayback();
+
+  bool Open(const std::string& path, std::string* error);
+  void Close();
+  bool IsOpen() const { return data_ != nullptr; }
+
+  size_t frame_count() const { return frame_count_; }
+  size_t keyframe_count() const { return keyframe_count_; }
+  uint64_t duration_us() const;
+
+  // 找到显示 timestamp_us 时刻画面所需的帧区间 [first, last]：
+  // last 是时间不晚于目标的最后一帧，first 是它之前最近的关键帧
+  bool Seek(uint64_t timestamp_us, size_t* first, size_t* last) const;
+
+  const SessionIndexEntry& entry(size_t i) const { return index_[i]; }
+  const uint8_t* frame_data(size_t i) const { return data_ + index_[i].offset; }
+
+ private:
+  bool LoadFooter();
+  bool RebuildIndex();
+
+  int fd_ = -1;
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+
+  const SessionIndexEntry* index_ = nullptr;
+  const uint32_t* keyframes_ = nullptr;
+  size_t frame_count_ = 0;
+  size_t keyframe_count_ = 0;
+  // 没有文件尾索引时扫描得到的索引
+  std::vector<SessionIndexEntry> rebuilt_index_;
+  std::vector<uint32_t> rebuilt_keyframes_;
+};
+
+#endif  // RUNNER_SESSION_RECORDER_H_
@@ -0,0 +1,353 @@
+#include "socket_messenger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+
+namespace {
+
+const uint8_t kKindMessage = 0;
+const uint8_t kKindReply = 1;
+// u8 类型 + u32 编号 + u16 通道名长度
+const size_t kFrameHeaderBytes = 7;
+const size_t kMaxFrameBytes = 64 * 1024 * 1024;
+// 控制端长时间不读时断开，避免发送缓冲无限增长
+const size_t kMaxOutboxBytes = 256 * 1024 * 1024;
+const size_t kReadChunk = 64 * 1024;
+
+void PutU16(std::vector<uint8_t>* out, uint16_t value) {
+  out->push_back(static_cast<uint8_t>(value));
+  out->push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+uint16_t GetU16(const uint8_t* data) {
+  return static_cast<uint16_t>(data[0] | (data[1] << 8));
+}
+
+uint32_t GetU32(const uint8_t* data) {
+  return static_cast<uint32_t>(data[0]) | (static_cast<uint32_t>(data[1]) << 8) |
+         (static_cast<uint32_t>(data[2]) << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+}  // namespace
+
+SocketMessenger::SocketMessenger() {}
+
+SocketMessenger::~SocketMessenger() {
+  Disconnect();
+  if (listen_source_) {
+    g_source_remove(listen_source_);
+  }
+  if (listen_fd_ >= 0) {
+    close(listen_fd_);
+    unlink(path_.c_str());
+  }
+}
+
+bool SocketMessenger::Listen(const std::string& path, std::string* error) {
+  sockaddr_un addr = {};
+  if (path.empty() || path.size() >= sizeof(addr.sun_path)) {
+    *error = "invalid socket path";
+    return false;
+  }
+  addr.sun_family = AF_UNIX;
+  memcpy(addr.sun_path, path.c_str(), path.size());
+
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (fd < 0) {
+    *error = std::string("socket: ") + strerror(errno);
+    return false;
+  }
+  // 上次异常退出留下的套接字文件
+  struct stat st;
+  if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+    unlink(path.c_str());
+  }
+  // 终端和输入注入都经由这个套接字，只允许当前用户连接
+  mode_t old_mask = umask(0077);
+  int bound = bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+  umask(old_mask);
+  if (bound != 0 || listen(fd, 4) != 0) {
+    *error = path + ": " + strerror(errno);
+    close(fd);
+    return false;
+  }
+  path_ = path;
+  listen_fd_ = fd;
+  listen_source_ = g_unix_fd_add(fd, G_IO_IN, &SocketMessenger::OnListenReady, this);
+  return true;
+}
+
+void SocketMessenger::Send(const std::string& channel, const uint8_t* message,
+                           size_t message_size, flutter::BinaryReply reply) const {
+  if (client_fd_ < 0) {
+    return;
+  }
+  uint32_t id = 0;
+  if (reply) {
+    id = next_id_++;
+    if (next_id_ == 0) {
+      next_id_ = 1;
+    }
+    pending_replies_[id] = std::move(reply);
+  }
+  Enqueue(kKindMessage, id, channel, message, message_size);
+}
+
+void SocketMessenger::SetMessageHandler(const std::string& channel,
+                                        flutter::BinaryMessageHandler handler) {
+  if (handler) {
+    handlers_[channel] = std::move(handler);
+  } else {
+    handlers_.erase(channel);
+  }
+}
+
+// static
+gboolean SocketMessenger::OnListenReady(gint fd, GIOCondition condition, gpointer data) {
+  static_cast<SocketMessenger*>(data)->Accept();
+  return G_SOURCE_CONTINUE;
+}
+
+// static
+gboolean SocketMessenger::OnClientReady(gint fd, GIOCondition condition, gpointer data) {
+  auto* self = static_cast<SocketMessenger*>(data);
+  bool ok = true;
+  if (condition & G_IO_OUT) {
+    ok = self->Flush();
+  }
+  if (ok && (condition & (G_IO_IN | G_IO_HUP | G_IO_ERR))) {
+    ok = self->ReadAvailable();
+  }
+  if (!ok) {
+    self->Disconnect();
+    return G_SOURCE_REMOVE;
+  }
+  self->UpdateWatch();
+  return G_SOURCE_CONTINUE;
+}
+
+void SocketMessenger::Accept() {
+  int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+  if (fd < 0) {
+    return;
+  }
+  struct ucred cred = {};
+  socklen_t length = sizeof(cred);
+  if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) != 0 || cred.uid != getuid()) {
+    g_warning("agent: rejected connection from uid %d", static_cast<int>(cred.uid));
+    close(fd);
+    return;
+  }
+  Disconnect();
+  client_fd_ = fd;
+  generation_++;
+  UpdateWatch();
+  g_message("agent: controller connected");
+}
+
+bool SocketMessenger::ReadAvailable() {
+  // 一次最多读几块，给其他事件源留出时间
+  for (int i = 0; i < 4; i++) {
+    size_t used = inbox_.size();
+    inbox_.resize(used + kReadChunk);
+    ssize_t n = read(client_fd_, inbox_.data() + used, kReadChunk);
+    inbox_.resize(used + (n > 0 ? n : 0));
+    if (n == 0) {
+      return false;
+    }
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    if (!ParseFrames()) {
+      g_warning("agent: malformed frame, closing connection");
+      return false;
+    }
+    // 处理过程中可能断开了连接
+    if (client_fd_ < 0) {
+      return true;
+    }
+  }
+  return true;
+}
+
+bool SocketMessenger::ParseFrames() {
+  size_t offset = 0;
+  uint64_t generation = generation_;
+  while (inbox_.size() - offset >= 4) {
+    size_t length = GetU32(inbox_.data() + offset);
+    if (length < kFrameHeaderBytes || length > kMaxFrameBytes) {
+      return false;
+    }
+    if (inbox_.size() - offset - 4 < length) {
+      break;
+    }
+    const uint8_t* frame = inbox_.data() + offset + 4;
+    uint8_t kind = frame[0];
+    uint32_t id = GetU32(frame + 1);
+    size_t channel_length = GetU16(frame + 5);
+    if (kind > kKindReply || kFrameHeaderBytes + channel_length > length) {
+      return false;
+    }
+    std::string channel(reinterpret_cast<const char*>(frame + kFrameHeaderBytes), channel_length);
+    const uint8_t* payload = frame + kFrameHeaderBytes + channel_length;
+    size_t payload_size = length - kFrameHeaderBytes - channel_length;
+    // 处理器可能同步发送消息，但不会改动 inbox_，指针在这期间有效
+    Dispatch(kind, id, channel, payload, payload_size);
+    if (generation != generation_ || client_fd_ < 0) {
+      return true;
+    }
+    offset += 4 + length;
+  }
+  inbox_.erase(inbox_.begin(), inbox_.begin() + offset);
+  return true;
+}
+
+void SocketMessenger::Dispatch(uint8_t kind, uint32_t id, const std::string& channel,
+                               const uint8_t* payload, size_t size) {
+  if (kind == kKindReply) {
+    auto it = pending_replies_.find(id);
+    if (it != pending_replies_.end()) {
+      flutter::BinaryReply reply = std::move(it->second);
+      pending_replies_.erase(it);
+      reply(payload, size);
+    }
+    return;
+  }
+
+  flutter::BinaryReply reply;
+  if (id != 0) {
+    uint64_t generation = generation_;
+    // 和 Flutter 引擎一样，每个请求只回复一次；异步完成时连接可能已经换了
+    reply = [this, generation, id](const uint8_t* data, size_t data_size) {
+      if (generation == generation_) {
+        Enqueue(kKindReply, id, std::string(), data, data_size);
+      }
+    };
+  }
+  auto handler = handlers_.find(channel);
+  if (handler == handlers_.end()) {
+    // 空回复表示通道没有处理器，对端会当作未实现
+    if (reply) {
+      reply(nullptr, 0);
+    }
+    return;
+  }
+  handler->second(payload, size, std::move(reply));
+}
+
+void SocketMessenger::Disconnect() {
+  if (client_source_) {
+    g_source_remove(client_source_);
+    client_source_ = 0;
+  }
+  if (client_fd_ < 0) {
+    return;
+  }
+  close(client_fd_);
+  client_fd_ = -1;
+  watching_output_ = false;
+  generation_++;
+  inbox_.clear();
+  outbox_.clear();
+  outbox_offset_ = 0;
+  // 等待中的请求以空回复结束，免得调用方一直挂着
+  auto pending = std::move(pending_replies_);
+  pending_replies_.clear();
+  for (auto& entry : pending) {
+    entry.second(nullptr, 0);
+  }
+  g_message("agent: controller disconnected");
+}
+
+void SocketMessenger::Enqueue(uint8_t kind, uint32_t id, const std::string& channel,
+                              const uint8_t* payload, size_t size) const {
+  if (client_fd_ < 0) {
+    return;
+  }
+  if (channel.size() > 0xFFFF || kFrameHeaderBytes + channel.size() + size > kMaxFrameBytes) {
+    g_warning("agent: message on %s too large (%zu bytes), dropped", channel.c_str(), size);
+    return;
+  }
+  PutU32(&outbox_, static_cast<uint32_t>(kFrameHeaderBytes + channel.size() + size));
+  outbox_.push_back(kind);
+  PutU32(&outbox_, id);
+  PutU16(&outbox_, static_cast<uint16_t>(channel.size()));
+  outbox_.insert(outbox_.end(), channel.begin(), channel.end());
+  if (size > 0) {
+    outbox_.insert(outbox_.end(), payload, payload + size);
+  }
+  if (outbox_.size() - outbox_offset_ > kMaxOutboxBytes) {
+    g_warning("agent: controller is not reading, closing connection");
+    // 读回调会看到 HUP 并断开
+    shutdown(client_fd_, SHUT_RDWR);
+    outbox_.clear();
+    outbox_offset_ = 0;
+    return;
+  }
+  if (!Flush()) {
+    shutdown(client_fd_, SHUT_RDWR);
+  }
+  UpdateWatch();
+}
+
+bool SocketMessenger::Flush() const {
+  while (outbox_offset_ < outbox_.size()) {
+    ssize_t n = send(client_fd_, outbox_.data() + outbox_offset_,
+                     outbox_.size() - outbox_offset_, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        break;
+      }
+      outbox_.clear();
+      outbox_offset_ = 0;
+      return false;
+    }
+    outbox_offset_ += n;
+  }
+  if (outbox_offset_ == outbox_.size()) {
+    outbox_.clear();
+    outbox_offset_ = 0;
+  } else if (outbox_offset_ > kMaxFrameBytes) {
+    // 已发出的部分过多时再整理，避免每次都搬移
+    outbox_.erase(outbox_.begin(), outbox_.begin() + outbox_offset_);
+    outbox_offset_ = 0;
+  }
+  return true;
+}
+
+void SocketMessenger::UpdateWatch() const {
+  if (client_fd_ < 0) {
+    return;
+  }
+  bool want_output = outbox_offset_ < outbox_.size();
+  if (client_source_ && want_output == watching_output_) {
+    return;
+  }
+  if (client_source_) {
+    g_source_remove(client_source_);
+  }
+  GIOCondition condition = static_cast<GIOCondition>(
+      G_IO_IN | G_IO_HUP | G_IO_ERR | (want_output ? G_IO_OUT : 0));
+  client_source_ = g_unix_fd_add(client_fd_, condition, &SocketMessenger::OnClientReady,
+                                 const_cast<SocketMessenger*>(this));
+  watching_output_ = want_output;
+}
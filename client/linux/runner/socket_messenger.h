@@ -0,0 +1,75 @@
+#ifndef RUNNER_SOCKET_MESSENGER_H_
+#define RUNNER_SOCKET_MESSENGER_H_
+
+#include <flutter/binary_messenger.h>
+#include <glib.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// 用 Unix 域套接字代替 Flutter 引擎收发平台通道消息，供无界面代理模式使用。
+// 每条消息一帧（小端）：
+//   u32 帧长（不含这 4 字节）| u8 类型 | u32 编号 | u16 通道名长度 | 通道名 | 消息内容
+// 类型 0 是消息，编号非 0 表示需要回复；类型 1 是回复，编号对应请求，通道名为空。
+// 消息内容就是 StandardMethodCodec 的编码，方法调用、EventChannel 的 listen/cancel
+// 和事件都原样经过这里，所以插件不需要任何改动。
+// 同时只接受一个控制端连接，新连接替换旧连接；没有连接时发出的消息直接丢弃。
+// 只在平台线程（GLib 默认主循环）上使用。
+class SocketMessenger : public flutter::BinaryMessenger {
+ public:
+  SocketMessenger();
+  ~SocketMessenger() override;
+
+  SocketMessenger(const SocketMessenger&) = delete;
+  SocketMessenger& operator=(const SocketMessenger&) = delete;
+
+  // 在 path 上监听，套接字只允许当前用户访问
+  bool Listen(const std::string& path, std::string* error);
+
+  // flutter::BinaryMessenger:
+  void Send(const std::string& channel, const uint8_t* message, size_t message_size,
+            flutter::BinaryReply reply = nullptr) const override;
+  void SetMessageHandler(const std::string& channel,
+                         flutter::BinaryMessageHandler handler) override;
+
+  bool connected() const { return client_fd_ >= 0; }
+
+ private:
+  static gboolean OnListenReady(gint fd, GIOCondition condition, gpointer data);
+  static gboolean OnClientReady(gint fd, GIOCondition condition, gpointer data);
+
+  void Accept();
+  // 读到对端关闭或出错时返回 false
+  bool ReadAvailable();
+  bool ParseFrames();
+  void Dispatch(uint8_t kind, uint32_t id, const std::string& channel,
+                const uint8_t* payload, size_t size);
+  void Disconnect();
+
+  // 发送相关的状态在 const 的 Send 里也要修改
+  void Enqueue(uint8_t kind, uint32_t id, const std::string& channel,
+               const uint8_t* payload, size_t size) const;
+  bool Flush() const;
+  void UpdateWatch() const;
+
+  std::string path_;
+  int listen_fd_ = -1;
+  guint listen_source_ = 0;
+  mutable int client_fd_ = -1;
+  mutable guint client_source_ = 0;
+  mutable bool watching_output_ = false;
+  // 每次接受新连接加一，旧连接上的请求不再回复
+  uint64_t generation_ = 0;
+
+  std::map<std::string, flutter::BinaryMessageHandler> handlers_;
+  std::vector<uint8_t> inbox_;
+  mutable std::vector<uint8_t> outbox_;
+  mutable size_t outbox_offset_ = 0;
+  mutable uint32_t next_id_ = 1;
+  mutable std::map<uint32_t, flutter::BinaryReply> pending_replies_;
+};
+
+#endif  // RUNNER_SOCKET_MESSENGER_H_
@@ -0,0 +1,134 @@
+#include "task_executor.h"
+
+#include <algorithm>
+
+namespace {
+
+const int kMinThreads = 2;
+const int kMaxThreads = 16;
+
+// 当前线程所属的工作池和序号，非工作线程为空
+thread_local TaskExecutor* current_executor = nullptr;
+thread_local size_t current_index = 0;
+
+}  // namespace
+
+// static
+TaskExecutor& TaskExecutor::Shared() {
+  // 有意不析构：退出时可能还有命令在执行，等待它们会拖住进程退出
+  static TaskExecutor* executor = new TaskExecutor(std::clamp(
+      static_cast<int>(std::thread::hardware_concurrency()), kMinThreads, kMaxThreads));
+  return *executor;
+}
+
+TaskExecutor::TaskExecutor(int threads) {
+  threads = std::max(threads, 1);
+  for (int i = 0; i < threads; i++) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < workers_.size(); i++) {
+    workers_[i]->thread = std::thread(&TaskExecutor::Run, this, i);
+  }
+}
+
+TaskExecutor::~TaskExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+    stopping_ = true;
+  }
+  idle_cv_.notify_all();
+  for (auto& worker : workers_) {
+    worker->thread.join();
+  }
+}
+
+void TaskExecutor::Submit(TaskPriority priority, Task task) {
+  size_t index = current_executor == this ? current_index
+                                          : next_worker_.fetch_add(1) % workers_.size();
+  {
+    std::lock_guard<std::mutex> lock(workers_[index]->mutex);
+    workers_[index]->queues[static_cast<int>(priority)].push_back(std::move(task));
+  }
+  pending_++;
+  {
+    std::lock_guard<std::mutex> lock(idle_mutex_);
+  }
+  idle_cv_.notify_one();
+}
+
+bool TaskExecutor::TakeTask(size_t index, Task* task) {
+  for (int priority = 0; priority < kPriorityCount; priority++) {
+    // 先取自己的，再从其他线程的队尾窃取
+    for (size_t offset = 0; offset < workers_.size(); offset++) {
+      Worker& worker = *workers_[(index + offset) % workers_.size()];
+      std::lock_guard<std::mutex> lock(worker.mutex);
+      std::deque<Task>& queue = worker.queues[priority];
+      if (queue.empty()) {
+        continue;
+      }
+      if (offset == 0) {
+        *task = std::move(queue.front());
+        queue.pop_front();
+      } else {
+        *task = std::move(queue.back());
+        queue.pop_back();
+      }
+      pending_--;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TaskExecutor::Run(size_t index) {
+  current_executor = this;
+  current_index = index;
+  while (true) {
+    Task task;
+    if (TakeTask(index, &task)) {
+      task();
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(idle_mutex_);
+    idle_cv_.wait(lock, [this]() { return stopping_ || pending_ > 0; });
+    if (stopping_) {
+      return;
+    }
+  }
+}
+
+// static
+std::shared_ptr<SerialTaskQueue> SerialTaskQueue::Create(TaskPriority priority) {
+  return std::shared_ptr<SerialTaskQueue>(new SerialTaskQueue(priority));
+}
+
+void SerialTaskQueue::Submit(TaskExecutor::Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    if (running_) {
+      return;
+    }
+    running_ = true;
+  }
+  TaskExecutor::Shared().Submit(priority_, [self = shared_from_this()]() { self->RunNext(); });
+}
+
+void SerialTaskQueue::RunNext() {
+  TaskExecutor::Task task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task = std::move(tasks_.front());
+    tasks_.pop_front();
+  }
+  task();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tasks_.empty()) {
+      running_ = false;
+      return;
+    }
+  }
+  // 每次只交一个任务，其他队列和更高优先级的任务可以插进来
+  TaskExecutor::Shared().Submit(priority_, [self = shared_from_this()]() { self->RunNext(); });
+}
@@ -0,0 +1,80 @@
+#ifndef RUNNER_TASK_EXECUTOR_H_
+#define RUNNER_TASK_EXECUTOR_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 任务优先级，数值越小越先执行。优先级只决定取任务的顺序，不会打断已在执行的任务
+enum class TaskPriority { kInput = 0, kCapture, kFile, kTerminal };
+
+// 各插件共用的工作池，把耗时的方法调用移出平台线程。
+// 每个工作线程有自己的各优先级队列，空闲时先按优先级从高到低取自己的任务，
+// 同一优先级自己没有时再从其他线程的队尾窃取，保证高优先级的任务总是先被取走。
+// 工作线程上提交的任务进入本线程的队列，其余线程提交的轮流分给各线程。
+class TaskExecutor {
+ public:
+  using Task = std::function<void()>;
+
+  // 所有插件共用的实例，第一次使用时创建，线程数取 CPU 核数
+  static TaskExecutor& Shared();
+
+  explicit TaskExecutor(int threads);
+  ~TaskExecutor();
+
+  TaskExecutor(const TaskExecutor&) = delete;
+  TaskExecutor& operator=(const TaskExecutor&) = delete;
+
+  // 可以从任意线程调用
+  void Submit(TaskPriority priority, Task task);
+
+  int thread_count() const { return static_cast<int>(workers_.size()); }
+
+ private:
+  static constexpr int kPriorityCount = 4;
+
+  struct Worker {
+    std::mutex mutex;
+    std::deque<Task> queues[kPriorityCount];
+    std::thread thread;
+  };
+
+  void Run(size_t index);
+  bool TakeTask(size_t index, Task* task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<size_t> next_worker_{0};
+  // 已提交未取走的任务数，空闲线程据此等待
+  std::atomic<int64_t> pending_{0};
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  bool stopping_ = false;
+};
+
+// 按提交顺序把任务逐个交给共享工作池，同一队列上的任务不会并发执行，
+// 用于同一个传输句柄上的连续读写。用 Create 创建，排队中的任务持有队列
+class SerialTaskQueue : public std::enable_shared_from_this<SerialTaskQueue> {
+ public:
+  static std::shared_ptr<SerialTaskQueue> Create(TaskPriority priority);
+
+  // 可以从任意线程调用
+  void Submit(TaskExecutor::Task task);
+
+ private:
+  explicit SerialTaskQueue(TaskPriority priority) : priority_(priority) {}
+  void RunNext();
+
+  TaskPriority priority_;
+  std::mutex mutex_;
+  std::deque<TaskExecutor::Task> tasks_;
+  // 已有任务交给工作池时为 true，后来的任务只排队
+  bool running_ = false;
+};
+
+#endif  // RUNNER_TASK_EXECUTOR_H_
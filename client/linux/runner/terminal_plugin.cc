@@ -0,0 +1,636 @@
+#include "terminal_plugin.h"
+
+#include <flutter/event_channel.h>
+#include <flutter/event_stream_handler_functions.h>
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_linux.h>
+#include <flutter/standard_method_codec.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "async_method.h"
+#include "command_runner.h"
+#include "encodable_args.h"
+#include "job_runner.h"
+#include "output_reactor.h"
+#include "platform_thread.h"
+#include "pty_session.h"
+
+namespace {
+
+// 输出批次：攒够 64 KB 或 16 毫秒交付一次；已投递但还没发出的输出超过 8 MB 时暂停读取
+const size_t kOutputBatchBytes = 64 * 1024;
+const int kOutputBatchMs = 16;
+const size_t kMaxUnackedOutput = 8 * 1024 * 1024;
+// 主端读到 EIO 后等待 shell 退出的时间，期间每隔 kExitPollMs 在平台线程上非阻塞地检查一次
+const int kExitReapMs = 200;
+const int kExitPollMs = 10;
+// readScrollback 默认每次返回的行数和字节数
+const int64_t kScrollbackPageLines = 1000;
+const int64_t kScrollbackPageBytes = 1024 * 1024;
+// 屏幕模式默认每秒最多推送的差异次数
+const int kDefaultScreenFps = 20;
+// 批量命令最多同时执行的条数
+const int kMinJobWorkers = 2;
+const int kMaxJobWorkers = 8;
+
+// 读取命令参数，未给出的字段保留 options 里原有的值
+bool ParseCommandOptions(const flutter::EncodableMap& args, CommandOptions* options) {
+  options->command = GetString(args, "command", options->command);
+  options->working_dir = GetString(args, "workingDir", options->working_dir);
+  int64_t value = 0;
+  if (GetInt64(args, "timeoutMs", &value)) {
+    options->timeout_ms = static_cast<int>(std::max<int64_t>(value, 0));
+  }
+  if (GetInt64(args, "cpuSeconds", &value)) {
+    options->cpu_seconds = static_cast<int>(std::max<int64_t>(value, 0));
+  }
+  if (GetInt64(args, "memoryBytes", &value)) {
+    options->memory_bytes = static_cast<size_t>(std::max<int64_t>(value, 0));
+  }
+  return !options->command.empty();
+}
+
+// 与 Windows 端 executeCommand 保持相同的字段
+flutter::EncodableMap EncodeCommandResult(const CommandResult& output, bool with_segments) {
+  flutter::EncodableMap response;
+  response[flutter::EncodableValue("stdout")] = flutter::EncodableValue(output.stdout_text);
+  response[flutter::EncodableValue("stderr")] = flutter::EncodableValue(output.stderr_text);
+  response[flutter::EncodableValue("exit_code")] = flutter::EncodableValue(output.exit_code);
+  response[flutter::EncodableValue("timed_out")] = flutter::EncodableValue(output.timed_out);
+  response[flutter::EncodableValue("cancelled")] = flutter::EncodableValue(output.cancelled);
+  response[flutter::EncodableValue("truncated")] = flutter::EncodableValue(output.truncated);
+  response[flutter::EncodableValue("duration_ms")] = flutter::EncodableValue(output.duration_ms);
+  if (with_segments) {
+    flutter::EncodableList segments;
+    for (const auto& segment : output.segments) {
+      flutter::EncodableMap item;
+      item[flutter::EncodableValue("stream")] = flutter::EncodableValue(segment.is_stderr ? "stderr" : "stdout");
+      item[flutter::EncodableValue("time_ms")] = flutter::EncodableValue(segment.time_ms);
+      item[flutter::EncodableValue("text")] = flutter::EncodableValue(segment.text);
+      segments.push_back(flutter::EncodableValue(item));
+    }
+    response[flutter::EncodableValue("segments")] = flutter::EncodableValue(segments);
+  }
+  return response;
+}
+
+// 差异编码成事件：spans 平铺为 [row, col, text, styles, row, col, ...]，省掉每段的键名
+flutter::EncodableValue EncodeScreenUpdate(const ScreenUpdate& update) {
+  flutter::EncodableList spans;
+  spans.reserve(update.spans.size() * 4);
+  for (const auto& span : update.spans) {
+    spans.push_back(flutter::EncodableValue(span.row));
+    spans.push_back(flutter::EncodableValue(span.col));
+    spans.push_back(flutter::EncodableValue(span.text));
+    spans.push_back(flutter::EncodableValue(span.styles));
+  }
+  flutter::EncodableMap map;
+  map[flutter::EncodableValue("revision")] = flutter::EncodableValue(update.revision);
+  map[flutter::EncodableValue("full")] = flutter::EncodableValue(update.full);
+  map[flutter::EncodableValue("cols")] = flutter::EncodableValue(update.cols);
+  map[flutter::EncodableValue("rows")] = flutter::EncodableValue(update.rows);
+  map[flutter::EncodableValue("cursorRow")] = flutter::EncodableValue(update.cursor_row);
+  map[flutter::EncodableValue("cursorCol")] = flutter::EncodableValue(update.cursor_col);
+  map[flutter::EncodableValue("cursorVisible")] = flutter::EncodableValue(update.cursor_visible);
+  if (update.title_changed) {
+    map[flutter::EncodableValue("title")] = flutter::EncodableValue(update.title);
+  }
+  map[flutter::EncodableValue("spans")] = flutter::EncodableValue(spans);
+  return flutter::EncodableValue(map);
+}
+
+}  // namespace
+
+class TerminalPlugin : public flutter::Plugin {
+ public:
+  static std::unique_ptr<TerminalPlugin> Create(flutter::BinaryMessenger *messenger);
+
+  TerminalPlugin();
+
+  virtual ~TerminalPlugin();
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue> &method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  PtySession* FindSession(const flutter::EncodableMap* args, int64_t* id);
+  flutter::EncodableValue SessionInfo(int64_t id, PtySession& session);
+  void DeliverOutput(int64_t id, const std::vector<uint8_t>& data);
+  // 到 deadline 之前 shell 还没退出时稍后再查，之后退出码由 readSession/closeSession 取得
+  void SessionExited(int64_t id, std::chrono::steady_clock::time_point deadline);
+  void DeliverJobEvent(int64_t batch, const flutter::EncodableMap& event);
+  void EnsureJobRunner();
+  void ScheduleScreenUpdate(int64_t id);
+  void EmitScreenUpdate(int64_t id);
+
+  // 屏幕模式会话的推送状态：两次推送至少间隔 interval，期间的变化合并进下一次差异
+  struct ScreenStream {
+    std::chrono::milliseconds interval{1000 / kDefaultScreenFps};
+    // 为 false 时每次推送即视为已确认，否则等控制端 ackScreen
+    bool ack = false;
+    bool scheduled = false;
+    std::chrono::steady_clock::time_point last_emit;
+  };
+
+  // 常驻的终端会话，按 sessionId 索引
+  std::map<int64_t, std::unique_ptr<PtySession>> sessions_;
+  int64_t next_session_ = 1;
+  std::map<int64_t, ScreenStream> screen_streams_;
+
+  // 命令的工作线程，第一次 executeCommand 或 runBatch 时创建；没有 terminal/jobs 订阅者时结果暂存在这里
+  std::unique_ptr<JobRunner> job_runner_;
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> jobs_channel_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> jobs_sink_;
+  std::map<int64_t, flutter::EncodableList> pending_job_events_;
+
+  // 所有会话的输出由一个 epoll 线程读取，有订阅者时经 terminal/output 事件通道推送，
+  // 否则暂存在会话里等 readSession 取走。第一次打开会话时才创建
+  std::unique_ptr<OutputReactor> reactor_;
+  std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> output_channel_;
+  std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> output_sink_;
+};
+
+// static
+std::unique_ptr<TerminalPlugin> TerminalPlugin::Create(
+    flutter::BinaryMessenger *messenger) {
+  auto channel =
+      std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+          messenger, "terminal",
+          &flutter::StandardMethodCodec::GetInstance());
+
+  auto plugin = std::make_unique<TerminalPlugin>();
+
+  channel->SetMethodCallHandler(
+      [plugin_pointer = plugin.get()](const auto &call, auto result) {
+        plugin_pointer->HandleMethodCall(call, std::move(result));
+      });
+
+  plugin->output_channel_ = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+      messenger, "terminal/output",
+      &flutter::StandardMethodCodec::GetInstance());
+  plugin->output_channel_->SetStreamHandler(
+      std::make_unique<flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+          [plugin_pointer = plugin.get()](
+              const flutter::EncodableValue* arguments,
+              std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->output_sink_ = std::move(events);
+            return nullptr;
+          },
+          [plugin_pointer = plugin.get()](const flutter::EncodableValue* arguments)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->output_sink_.reset();
+            return nullptr;
+          }));
+
+  plugin->jobs_channel_ = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
+      messenger, "terminal/jobs",
+      &flutter::StandardMethodCodec::GetInstance());
+  plugin->jobs_channel_->SetStreamHandler(
+      std::make_unique<flutter::StreamHandlerFunctions<flutter::EncodableValue>>(
+          [plugin_pointer = plugin.get()](
+              const flutter::EncodableValue* arguments,
+              std::unique_ptr<flutter::EventSink<flutter::EncodableValue>>&& events)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->jobs_sink_ = std::move(events);
+            return nullptr;
+          },
+          [plugin_pointer = plugin.get()](const flutter::EncodableValue* arguments)
+              -> std::unique_ptr<flutter::StreamHandlerError<flutter::EncodableValue>> {
+            plugin_pointer->jobs_sink_.reset();
+            return nullptr;
+          }));
+
+  return plugin;
+}
+
+TerminalPlugin::TerminalPlugin() {}
+
+TerminalPlugin::~TerminalPlugin() {
+  // 先停掉读取线程和工作池，再挂断各个会话
+  job_runner_.reset();
+  reactor_.reset();
+  sessions_.clear();
+}
+
+void TerminalPlugin::EnsureJobRunner() {
+  if (!job_runner_) {
+    int workers = static_cast<int>(std::thread::hardware_concurrency());
+    job_runner_ = std::make_unique<JobRunner>(std::clamp(workers, kMinJobWorkers, kMaxJobWorkers));
+  }
+}
+
+void TerminalPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue> &method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+  const std::string& method = method_call.method_name();
+
+  if (method == "executeCommand") {
+    CommandOptions options;
+    if (!args || !ParseCommandOptions(*args, &options)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    // 命令可能长时间不结束（timeoutMs 默认不限时），作为单条批次交给 JobRunner 的线程执行，
+    // 不占用输入和截屏共用的工作池；插件析构时随 JobRunner 一起终止。结果回到平台线程再答复
+    EnsureJobRunner();
+    std::shared_ptr<flutter::MethodResult<flutter::EncodableValue>> shared_result = std::move(result);
+    JobSpec job;
+    job.id = "0";
+    job.options = options;
+    std::vector<JobSpec> jobs;
+    jobs.push_back(std::move(job));
+    job_runner_->Submit(
+        std::move(jobs),
+        [shared_result](int64_t batch, const std::string& job_id, const CommandResult& output,
+                        const std::string& error) {
+          auto outcome = std::make_shared<MethodOutcome>(
+              error.empty() ? MethodOutcome::Ok(flutter::EncodableValue(EncodeCommandResult(output, true)))
+                            : MethodOutcome::Fail("EXECUTE_FAILED", error));
+          PostToPlatformThread([shared_result, outcome]() {
+            if (outcome->ok) {
+              shared_result->Success(outcome->value);
+            } else {
+              shared_result->Error(outcome->code, outcome->message);
+            }
+          });
+        },
+        [](int64_t batch) {});
+  } else if (method == "runBatch") {
+    // commands 为命令字符串或 {id, command, workingDir, timeoutMs, cpuSeconds, memoryBytes} 的列表，
+    // 顶层的同名参数作为各条命令的默认值。立即返回 batchId，结果经 terminal/jobs 事件逐条推送
+    const flutter::EncodableValue* commands = args ? FindArg(*args, "commands") : nullptr;
+    const auto* list = commands ? std::get_if<flutter::EncodableList>(commands) : nullptr;
+    if (!list || list->empty()) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    CommandOptions defaults;
+    ParseCommandOptions(*args, &defaults);
+    std::vector<JobSpec> jobs;
+    for (size_t i = 0; i < list->size(); i++) {
+      JobSpec job;
+      job.id = std::to_string(i);
+      job.options = defaults;
+      const flutter::EncodableValue& item = (*list)[i];
+      if (const auto* command = std::get_if<std::string>(&item)) {
+        job.options.command = *command;
+      } else if (const auto* map = std::get_if<flutter::EncodableMap>(&item)) {
+        job.options.command.clear();
+        ParseCommandOptions(*map, &job.options);
+        job.id = GetString(*map, "id", job.id);
+      }
+      if (job.options.command.empty()) {
+        result->Error("INVALID_ARGS", "Invalid arguments");
+        return;
+      }
+      jobs.push_back(std::move(job));
+    }
+    EnsureJobRunner();
+    int64_t batch = job_runner_->Submit(
+        std::move(jobs),
+        [this](int64_t batch, const std::string& job_id, const CommandResult& output,
+               const std::string& error) {
+          flutter::EncodableMap event = EncodeCommandResult(output, false);
+          event[flutter::EncodableValue("batchId")] = flutter::EncodableValue(batch);
+          event[flutter::EncodableValue("jobId")] = flutter::EncodableValue(job_id);
+          if (!error.empty()) {
+            event[flutter::EncodableValue("error")] = flutter::EncodableValue(error);
+          }
+          PostToPlatformThread([this, batch, event = std::move(event)]() { DeliverJobEvent(batch, event); });
+        },
+        [this](int64_t batch) {
+          flutter::EncodableMap event;
+          event[flutter::EncodableValue("batchId")] = flutter::EncodableValue(batch);
+          event[flutter::EncodableValue("done")] = flutter::EncodableValue(true);
+          PostToPlatformThread([this, batch, event = std::move(event)]() { DeliverJobEvent(batch, event); });
+        });
+    result->Success(flutter::EncodableValue(batch));
+  } else if (method == "cancelBatch") {
+    int64_t batch = 0;
+    if (!args || !GetInt64(*args, "batchId", &batch)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    result->Success(flutter::EncodableValue(job_runner_ && job_runner_->Cancel(batch)));
+  } else if (method == "readBatch") {
+    // 没有订阅 terminal/jobs 时取出暂存的结果；最后一项带 done 表示整批已完成
+    int64_t batch = 0;
+    if (!args || !GetInt64(*args, "batchId", &batch)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    flutter::EncodableList events;
+    auto it = pending_job_events_.find(batch);
+    if (it != pending_job_events_.end()) {
+      events.swap(it->second);
+      pending_job_events_.erase(it);
+    }
+    result->Success(flutter::EncodableValue(events));
+  } else if (method == "openSession") {
+    PtySessionOptions options;
+    if (args) {
+      options.shell = GetString(*args, "shell", "");
+      options.working_dir = GetString(*args, "workingDir", "");
+      options.login = GetBool(*args, "login", false);
+      options.screen = GetBool(*args, "screen", false);
+      int64_t scrollback_bytes = 0;
+      if (GetInt64(*args, "scrollbackBytes", &scrollback_bytes) && scrollback_bytes > 0) {
+        options.scrollback_bytes = static_cast<size_t>(scrollback_bytes);
+      }
+      int64_t cols = options.cols, rows = options.rows;
+      GetInt64(*args, "cols", &cols);
+      GetInt64(*args, "rows", &rows);
+      options.cols = static_cast<int>(cols);
+      options.rows = static_cast<int>(rows);
+      const flutter::EncodableValue* env = FindArg(*args, "env");
+      if (const auto* map = env ? std::get_if<flutter::EncodableMap>(env) : nullptr) {
+        for (const auto& item : *map) {
+          const auto* key = std::get_if<std::string>(&item.first);
+          const auto* value = std::get_if<std::string>(&item.second);
+          if (key && value) {
+            options.env[*key] = *value;
+          }
+        }
+      }
+    }
+    auto session = std::make_unique<PtySession>();
+    std::string error;
+    if (!session->Start(options, &error)) {
+      result->Error("OPEN_FAILED", error);
+      return;
+    }
+    int64_t id = next_session_++;
+    if (options.screen) {
+      ScreenStream& stream = screen_streams_[id];
+      int64_t fps = kDefaultScreenFps;
+      GetInt64(*args, "screenFps", &fps);
+      stream.interval = std::chrono::milliseconds(1000 / std::clamp<int64_t>(fps, 1, 60));
+      stream.ack = GetBool(*args, "screenAck", false);
+    }
+    PtySession* session_pointer = session.get();
+    if (!reactor_) {
+      reactor_ = std::make_unique<OutputReactor>(kOutputBatchBytes, kOutputBatchMs,
+                                                 kMaxUnackedOutput);
+    }
+    reactor_->Add(
+        id, session->master_fd(),
+        [this](int64_t stream, std::vector<uint8_t> data) {
+          PostToPlatformThread([this, stream, data = std::move(data)]() { DeliverOutput(stream, data); });
+        },
+        [this, session_pointer](int64_t stream) {
+          // 会话在从 reactor 移除之前不会被销毁，这里可以直接使用。
+          // 这里在 reactor 线程上，只做不等待的回收，shell 还没退出时由平台线程稍后再查
+          session_pointer->Reap(0);
+          auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kExitReapMs);
+          PostToPlatformThread([this, stream, deadline]() { SessionExited(stream, deadline); });
+        });
+    flutter::EncodableValue info = SessionInfo(id, *session);
+    sessions_[id] = std::move(session);
+    result->Success(info);
+  } else if (method == "writeSession") {
+    int64_t id = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session) {
+      result->Error("INVALID_SESSION", "Invalid session");
+      return;
+    }
+    // 接受 Uint8List 或字符串（按 UTF-8 原样写入）
+    const std::vector<uint8_t>* bytes = GetBytes(*args, "data");
+    std::string text = bytes ? "" : GetString(*args, "data", "");
+    std::string error;
+    bool ok = bytes ? session->Write(bytes->data(), bytes->size(), &error)
+                    : session->Write(reinterpret_cast<const uint8_t*>(text.data()), text.size(), &error);
+    if (!ok) {
+      result->Error("WRITE_FAILED", error);
+      return;
+    }
+    result->Success(flutter::EncodableValue(true));
+  } else if (method == "resizeSession") {
+    int64_t id = 0, cols = 0, rows = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session || !GetInt64(*args, "cols", &cols) || !GetInt64(*args, "rows", &rows)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    bool resized = session->Resize(static_cast<int>(cols), static_cast<int>(rows));
+    if (resized && session->screen()) {
+      ScheduleScreenUpdate(id);
+    }
+    result->Success(flutter::EncodableValue(resized));
+  } else if (method == "readSession") {
+    // 取出目前为止的输出，没有新输出时 data 为空；exited 为 true 且 data 为空时会话已结束
+    int64_t id = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session) {
+      result->Error("INVALID_SESSION", "Invalid session");
+      return;
+    }
+    session->Reap(0);
+    bool exited = session->exited();
+    int64_t dropped = 0;
+    std::vector<uint8_t> data = session->TakeOutput(&dropped);
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("data")] = flutter::EncodableValue(std::move(data));
+    response[flutter::EncodableValue("dropped")] = flutter::EncodableValue(dropped);
+    response[flutter::EncodableValue("exited")] = flutter::EncodableValue(exited);
+    response[flutter::EncodableValue("exitCode")] = flutter::EncodableValue(session->exit_code());
+    result->Success(flutter::EncodableValue(response));
+  } else if (method == "readScrollback") {
+    // 按行号回看历史，行号从会话开始累计；较早的历史可能已经因内存上限被丢弃
+    int64_t id = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session) {
+      result->Error("INVALID_SESSION", "Invalid session");
+      return;
+    }
+    int64_t from_line = 0, max_lines = kScrollbackPageLines, max_bytes = kScrollbackPageBytes;
+    GetInt64(*args, "fromLine", &from_line);
+    GetInt64(*args, "maxLines", &max_lines);
+    GetInt64(*args, "maxBytes", &max_bytes);
+    ScrollbackBuffer* scrollback = session->scrollback();
+    int64_t first_line = 0, next_line = 0;
+    std::vector<uint8_t> data = scrollback->Read(
+        from_line, max_lines, static_cast<size_t>(std::max<int64_t>(max_bytes, 1)), &first_line,
+        &next_line);
+    flutter::EncodableMap response;
+    response[flutter::EncodableValue("data")] = flutter::EncodableValue(std::move(data));
+    response[flutter::EncodableValue("firstLine")] = flutter::EncodableValue(first_line);
+    response[flutter::EncodableValue("nextLine")] = flutter::EncodableValue(next_line);
+    response[flutter::EncodableValue("oldestLine")] = flutter::EncodableValue(scrollback->first_line());
+    response[flutter::EncodableValue("totalLines")] = flutter::EncodableValue(scrollback->total_lines());
+    result->Success(flutter::EncodableValue(response));
+  } else if (method == "readScreen") {
+    // 没有订阅输出事件的控制端主动拉取屏幕差异；full 为 true 时返回整屏
+    int64_t id = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session || !session->screen()) {
+      result->Error("INVALID_SESSION", "Invalid session");
+      return;
+    }
+    if (GetBool(*args, "full", false)) {
+      session->screen()->Invalidate();
+    }
+    ScreenUpdate update = session->screen()->Diff();
+    if (!screen_streams_[id].ack) {
+      session->screen()->Ack(update.revision);
+    }
+    result->Success(EncodeScreenUpdate(update));
+  } else if (method == "ackScreen") {
+    int64_t id = 0, revision = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session || !session->screen() || !GetInt64(*args, "revision", &revision)) {
+      result->Error("INVALID_ARGS", "Invalid arguments");
+      return;
+    }
+    session->screen()->Ack(revision);
+    result->Success(flutter::EncodableValue(true));
+  } else if (method == "closeSession") {
+    int64_t id = 0;
+    PtySession* session = FindSession(args, &id);
+    if (!session) {
+      result->Error("INVALID_SESSION", "Invalid session");
+      return;
+    }
+    reactor_->Remove(id);
+    session->Close();
+    int exit_code = session->exit_code();
+    sessions_.erase(id);
+    screen_streams_.erase(id);
+    result->Success(flutter::EncodableValue(exit_code));
+  } else if (method == "listSessions") {
+    flutter::EncodableList list;
+    for (const auto& entry : sessions_) {
+      list.push_back(SessionInfo(entry.first, *entry.second));
+    }
+    result->Success(flutter::EncodableValue(list));
+  } else {
+    result->NotImplemented();
+  }
+}
+
+PtySession* TerminalPlugin::FindSession(const flutter::EncodableMap* args, int64_t* id) {
+  if (!args || !GetInt64(*args, "sessionId", id)) {
+    return nullptr;
+  }
+  auto it = sessions_.find(*id);
+  return it == sessions_.end() ? nullptr : it->second.get();
+}
+
+flutter::EncodableValue TerminalPlugin::SessionInfo(int64_t id, PtySession& session) {
+  flutter::EncodableMap info;
+  info[flutter::EncodableValue("sessionId")] = flutter::EncodableValue(id);
+  info[flutter::EncodableValue("pid")] = flutter::EncodableValue(static_cast<int64_t>(session.pid()));
+  info[flutter::EncodableValue("shell")] = flutter::EncodableValue(session.shell());
+  info[flutter::EncodableValue("cols")] = flutter::EncodableValue(session.cols());
+  info[flutter::EncodableValue("rows")] = flutter::EncodableValue(session.rows());
+  info[flutter::EncodableValue("exited")] = flutter::EncodableValue(session.exited());
+  info[flutter::EncodableValue("screen")] = flutter::EncodableValue(session.screen() != nullptr);
+  return flutter::EncodableValue(info);
+}
+
+void TerminalPlugin::DeliverOutput(int64_t id, const std::vector<uint8_t>& data) {
+  auto it = sessions_.find(id);
+  if (it == sessions_.end()) {
+    return;
+  }
+  PtySession* session = it->second.get();
+  TerminalScreen* screen = session->screen();
+  session->AppendOutput(data.data(), data.size(), !output_sink_ && !screen);
+  if (screen) {
+    // 程序的查询（光标位置等）由这里的屏幕模型应答
+    std::string replies = screen->TakeReplies();
+    std::string error;
+    if (!replies.empty()) {
+      session->Write(reinterpret_cast<const uint8_t*>(replies.data()), replies.size(), &error);
+    }
+    ScheduleScreenUpdate(id);
+  } else if (output_sink_) {
+    flutter::EncodableMap event;
+    event[flutter::EncodableValue("sessionId")] = flutter::EncodableValue(id);
+    event[flutter::EncodableValue("data")] = flutter::EncodableValue(data);
+    output_sink_->Success(flutter::EncodableValue(event));
+  }
+  reactor_->Ack(id, data.size());
+}
+
+void TerminalPlugin::SessionExited(int64_t id, std::chrono::steady_clock::time_point deadline) {
+  auto it = sessions_.find(id);
+  if (it == sessions_.end()) {
+    return;
+  }
+  it->second->Reap(0);
+  if (!it->second->exited() && std::chrono::steady_clock::now() < deadline) {
+    PostToPlatformThreadDelayed(kExitPollMs, [this, id, deadline]() { SessionExited(id, deadline); });
+    return;
+  }
+  if (!output_sink_) {
+    return;
+  }
+  flutter::EncodableMap event;
+  event[flutter::EncodableValue("sessionId")] = flutter::EncodableValue(id);
+  event[flutter::EncodableValue("exited")] = flutter::EncodableValue(true);
+  event[flutter::EncodableValue("exitCode")] = flutter::EncodableValue(it->second->exit_code());
+  output_sink_->Success(flutter::EncodableValue(event));
+}
+
+void TerminalPlugin::DeliverJobEvent(int64_t batch, const flutter::EncodableMap& event) {
+  if (jobs_sink_) {
+    jobs_sink_->Success(flutter::EncodableValue(event));
+  } else {
+    pending_job_events_[batch].push_back(flutter::EncodableValue(event));
+  }
+}
+
+void TerminalPlugin::ScheduleScreenUpdate(int64_t id) {
+  auto it = screen_streams_.find(id);
+  if (it == screen_streams_.end() || it->second.scheduled) {
+    return;
+  }
+  ScreenStream& stream = it->second;
+  auto elapsed = std::chrono::steady_clock::now() - stream.last_emit;
+  auto delay = std::chrono::duration_cast<std::chrono::milliseconds>(stream.interval - elapsed);
+  stream.scheduled = true;
+  PostToPlatformThreadDelayed(static_cast<int>(std::max<int64_t>(0, delay.count())),
+                              [this, id]() { EmitScreenUpdate(id); });
+}
+
+void TerminalPlugin::EmitScreenUpdate(int64_t id) {
+  auto stream = screen_streams_.find(id);
+  auto it = sessions_.find(id);
+  if (stream == screen_streams_.end() || it == sessions_.end()) {
+    return;
+  }
+  stream->second.scheduled = false;
+  TerminalScreen* screen = it->second->screen();
+  // 没有订阅者时变化留在屏幕模型里，等 readScreen 拉取
+  if (!output_sink_ || !screen->dirty()) {
+    return;
+  }
+  ScreenUpdate update = screen->Diff();
+  if (!stream->second.ack) {
+    screen->Ack(update.revision);
+  }
+  stream->second.last_emit = std::chrono::steady_clock::now();
+  flutter::EncodableMap event;
+  event[flutter::EncodableValue("sessionId")] = flutter::EncodableValue(id);
+  event[flutter::EncodableValue("screen")] = EncodeScreenUpdate(update);
+  output_sink_->Success(flutter::EncodableValue(event));
+}
+
+void RegisterTerminalPlugin(flutter::PluginRegistrarLinux *registrar) {
+  registrar->AddPlugin(TerminalPlugin::Create(registrar->messenger()));
+}
+
+std::unique_ptr<flutter::Plugin> CreateTerminalPlugin(flutter::BinaryMessenger *messenger) {
+  return TerminalPlugin::Create(messenger);
+}
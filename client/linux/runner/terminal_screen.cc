@@ -0,0 +1,872 @@
+#include "terminal_screen.h"
+
+#include <algorithm>
+
+namespace {
+
+// 同一行里两处变化之间相隔不超过这么多个未变的字符时合并成一段，省掉一段的开销
+const int kMaxSpanGap = 6;
+// 已发出未确认的修订最多保留这么多个，更早的确认直接忽略
+const size_t kMaxUnackedRevisions = 8;
+const size_t kMaxStringBytes = 4096;
+// 宽字符的第二列
+const uint32_t kWideTail = 0;
+
+// DEC 特殊图形字符集 0x60~0x7E 对应的字符，用于画线
+const uint32_t kDecGraphics[] = {
+    0x25C6, 0x2592, 0x2409, 0x240C, 0x240D, 0x240A, 0x00B0, 0x00B1, 0x2424, 0x240B, 0x2518,
+    0x2510, 0x250C, 0x2514, 0x253C, 0x23BA, 0x23BB, 0x2500, 0x23BC, 0x23BD, 0x251C, 0x2524,
+    0x2534, 0x252C, 0x2502, 0x2264, 0x2265, 0x03C0, 0x2260, 0x00A3, 0x00B7,
+};
+
+bool IsWide(uint32_t ch) {
+  return (ch >= 0x1100 && ch <= 0x115F) || (ch >= 0x2E80 && ch <= 0x303E) ||
+         (ch >= 0x3041 && ch <= 0x33FF) || (ch >= 0x3400 && ch <= 0x4DBF) ||
+         (ch >= 0x4E00 && ch <= 0x9FFF) || (ch >= 0xA000 && ch <= 0xA4CF) ||
+         (ch >= 0xAC00 && ch <= 0xD7A3) || (ch >= 0xF900 && ch <= 0xFAFF) ||
+         (ch >= 0xFE30 && ch <= 0xFE4F) || (ch >= 0xFF00 && ch <= 0xFF60) ||
+         (ch >= 0xFFE0 && ch <= 0xFFE6) || (ch >= 0x1F300 && ch <= 0x1F64F) ||
+         (ch >= 0x1F900 && ch <= 0x1F9FF) || (ch >= 0x20000 && ch <= 0x3FFFD);
+}
+
+bool IsZeroWidth(uint32_t ch) {
+  return (ch >= 0x0300 && ch <= 0x036F) || (ch >= 0x200B && ch <= 0x200F) || ch == 0xFE0F;
+}
+
+void AppendUtf8(uint32_t ch, std::string* out) {
+  if (ch < 0x80) {
+    out->push_back(static_cast<char>(ch));
+  } else if (ch < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (ch >> 6)));
+    out->push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+  } else if (ch < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (ch >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (ch >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((ch >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((ch >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (ch & 0x3F)));
+  }
+}
+
+// UTF-8 首字节表示的序列长度；续字节、F5 以上等不能作为首字节的返回 0
+int Utf8Length(uint8_t byte) {
+  if (byte < 0x80) {
+    return 1;
+  }
+  if ((byte & 0xE0) == 0xC0) {
+    return 2;
+  }
+  if ((byte & 0xF0) == 0xE0) {
+    return 3;
+  }
+  if (byte >= 0xF0 && byte <= 0xF4) {
+    return 4;
+  }
+  return 0;
+}
+
+// 解出的码点必须是该长度的最短编码，且是 Unicode 标量值（不超过 0x10FFFF、不是代理项）
+bool ValidUtf8(uint32_t ch, int length) {
+  static const uint32_t kMinimum[] = {0, 0, 0x80, 0x800, 0x10000};
+  return ch >= kMinimum[length] && ch <= 0x10FFFF && (ch < 0xD800 || ch > 0xDFFF);
+}
+
+// 按与屏幕输出相同的规则重新编码，非法序列替换为 U+FFFD
+std::string SanitizeUtf8(const std::string& text) {
+  std::string out;
+  out.reserve(text.size());
+  size_t i = 0;
+  while (i < text.size()) {
+    uint8_t byte = static_cast<uint8_t>(text[i]);
+    int length = Utf8Length(byte);
+    uint32_t ch = 0xFFFD;
+    size_t next = i + 1;
+    if (length == 1) {
+      ch = byte;
+    } else if (length > 1) {
+      uint32_t value = byte & (0xFF >> (length + 1));
+      while (next < text.size() && next < i + length && (text[next] & 0xC0) == 0x80) {
+        value = (value << 6) | (text[next] & 0x3F);
+        next++;
+      }
+      if (next == i + length && ValidUtf8(value, length)) {
+        ch = value;
+      }
+    }
+    AppendUtf8(ch, &out);
+    i = next;
+  }
+  return out;
+}
+
+}  // namespace
+
+TerminalScreen::TerminalScreen(int cols, int rows)
+    : cols_(std::max(cols, 1)), rows_(std::max(rows, 1)) {
+  Reset();
+}
+
+void TerminalScreen::Reset() {
+  grid_.assign(static_cast<size_t>(cols_) * rows_, Cell());
+  saved_grid_.clear();
+  alternate_ = false;
+  cursor_ = Cursor();
+  saved_cursor_ = Cursor();
+  scroll_top_ = 0;
+  scroll_bottom_ = rows_ - 1;
+  autowrap_ = true;
+  insert_mode_ = false;
+  cursor_visible_ = true;
+  state_ = State::kGround;
+  utf8_remaining_ = 0;
+  dirty_ = true;
+}
+
+void TerminalScreen::Feed(const uint8_t* data, size_t size) {
+  if (size > 0) {
+    dirty_ = true;
+  }
+  for (size_t i = 0; i < size; i++) {
+    uint8_t byte = data[i];
+    switch (state_) {
+      case State::kGround:
+        if (utf8_remaining_ > 0) {
+          if ((byte & 0xC0) == 0x80) {
+            utf8_char_ = (utf8_char_ << 6) | (byte & 0x3F);
+            if (--utf8_remaining_ == 0) {
+              Print(ValidUtf8(utf8_char_, utf8_length_) ? utf8_char_ : 0xFFFD);
+            }
+            continue;
+          }
+          // 序列不完整，替换后按新字节处理
+          utf8_remaining_ = 0;
+          Print(0xFFFD);
+        }
+        if (byte < 0x20 || byte == 0x7F) {
+          Control(byte);
+        } else if (byte < 0x80) {
+          Print(byte);
+        } else if (Utf8Length(byte) > 1) {
+          utf8_length_ = Utf8Length(byte);
+          utf8_char_ = byte & (0xFF >> (utf8_length_ + 1));
+          utf8_remaining_ = utf8_length_ - 1;
+        } else {
+          Print(0xFFFD);
+        }
+        break;
+      case State::kEscape:
+        Escape(byte);
+        break;
+      case State::kCharset:
+        if (intermediate_ == '(' || intermediate_ == ')') {
+          cursor_.g[intermediate_ == '(' ? 0 : 1] = static_cast<char>(byte);
+        }
+        state_ = State::kGround;
+        break;
+      case State::kCsi:
+        if (byte >= '0' && byte <= '9') {
+          if (!param_started_) {
+            params_.push_back(0);
+            param_started_ = true;
+          }
+          params_.back() = std::min(params_.back() * 10 + (byte - '0'), 65535);
+        } else if (byte == ';' || byte == ':') {
+          if (!param_started_) {
+            params_.push_back(0);
+          }
+          param_started_ = false;
+        } else if (byte >= '<' && byte <= '?') {
+          private_marker_ = static_cast<char>(byte);
+        } else if (byte >= 0x20 && byte <= 0x2F) {
+          intermediate_ = static_cast<char>(byte);
+        } else if (byte >= 0x40 && byte <= 0x7E) {
+          state_ = State::kGround;
+          CsiDispatch(byte);
+        } else if (byte == 0x1B) {
+          state_ = State::kEscape;
+        } else if (byte < 0x20) {
+          Control(byte);
+        }
+        break;
+      case State::kString:
+        if (byte == 0x07) {
+          state_ = State::kGround;
+          StringDispatch();
+        } else if (byte == 0x1B) {
+          state_ = State::kStringEscape;
+        } else if (string_.size() < kMaxStringBytes) {
+          string_.push_back(static_cast<char>(byte));
+        }
+        break;
+      case State::kStringEscape:
+        state_ = State::kGround;
+        StringDispatch();
+        if (byte != '\\') {
+          Escape(byte);
+        }
+        break;
+    }
+  }
+}
+
+void TerminalScreen::Control(uint8_t byte) {
+  switch (byte) {
+    case 0x08:
+      if (cursor_.col > 0) {
+        cursor_.col--;
+      }
+      cursor_.pending_wrap = false;
+      break;
+    case 0x09:
+      cursor_.col = std::min(cols_ - 1, (cursor_.col / 8 + 1) * 8);
+      cursor_.pending_wrap = false;
+      break;
+    case 0x0A:
+    case 0x0B:
+    case 0x0C:
+      LineFeed();
+      break;
+    case 0x0D:
+      cursor_.col = 0;
+      cursor_.pending_wrap = false;
+      break;
+    case 0x0E:
+      cursor_.charset = 1;
+      break;
+    case 0x0F:
+      cursor_.charset = 0;
+      break;
+    case 0x1B:
+      state_ = State::kEscape;
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::Escape(uint8_t byte) {
+  state_ = State::kGround;
+  switch (byte) {
+    case '[':
+      params_.clear();
+      param_started_ = false;
+      private_marker_ = 0;
+      intermediate_ = 0;
+      state_ = State::kCsi;
+      break;
+    case ']':
+    case 'P':
+    case '^':
+    case '_':
+    case 'X':
+      string_kind_ = static_cast<char>(byte);
+      string_.clear();
+      state_ = State::kString;
+      break;
+    case '(':
+    case ')':
+    case '#':
+    case '%':
+    case ' ':
+      // 后面还跟一个字节，只有字符集选择需要处理
+      intermediate_ = static_cast<char>(byte);
+      state_ = State::kCharset;
+      break;
+    case '7':
+      saved_cursor_ = cursor_;
+      break;
+    case '8':
+      cursor_ = saved_cursor_;
+      MoveTo(cursor_.row, cursor_.col);
+      break;
+    case 'D':
+      LineFeed();
+      break;
+    case 'E':
+      cursor_.col = 0;
+      LineFeed();
+      break;
+    case 'M':
+      ReverseIndex();
+      break;
+    case 'c':
+      Reset();
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::Print(uint32_t ch) {
+  if (ch >= 0x60 && ch <= 0x7E && cursor_.g[cursor_.charset] == '0') {
+    ch = kDecGraphics[ch - 0x60];
+  }
+  if (IsZeroWidth(ch)) {
+    return;
+  }
+  int width = IsWide(ch) ? 2 : 1;
+  if (width > cols_) {
+    return;
+  }
+  if (cursor_.pending_wrap && autowrap_) {
+    cursor_.col = 0;
+    LineFeed();
+  }
+  cursor_.pending_wrap = false;
+  if (cursor_.col + width > cols_) {
+    if (autowrap_) {
+      cursor_.col = 0;
+      LineFeed();
+    } else {
+      cursor_.col = cols_ - width;
+    }
+  }
+
+  Cell* row = Row(cursor_.row);
+  int col = cursor_.col;
+  if (insert_mode_) {
+    std::copy_backward(row + col, row + cols_ - width, row + cols_);
+  }
+  // 覆盖了宽字符的一半时把另一半变成空格
+  if (row[col].ch == kWideTail && col > 0) {
+    row[col - 1].ch = ' ';
+  }
+  Cell cell = cursor_.pen;
+  cell.ch = ch;
+  row[col] = cell;
+  if (width == 2) {
+    cell.ch = kWideTail;
+    row[col + 1] = cell;
+  }
+  if (col + width < cols_ && row[col + width].ch == kWideTail) {
+    row[col + width].ch = ' ';
+  }
+  cursor_.col += width;
+  if (cursor_.col >= cols_) {
+    cursor_.col = cols_ - 1;
+    cursor_.pending_wrap = true;
+  }
+}
+
+void TerminalScreen::CsiDispatch(uint8_t final_byte) {
+  if (private_marker_ == '>' || private_marker_ == '=') {
+    if (final_byte == 'c' && private_marker_ == '>') {
+      replies_ += "\x1b[>0;0;0c";
+    }
+    return;
+  }
+  if (private_marker_ == '?' && final_byte != 'h' && final_byte != 'l' && final_byte != 'J' &&
+      final_byte != 'K') {
+    return;
+  }
+  int n = std::max(1, Param(0, 1));
+  int row = cursor_.row;
+  int col = cursor_.col;
+  // 在滚动区域内时光标上下移动不越过区域边界
+  int top = row >= scroll_top_ ? scroll_top_ : 0;
+  int bottom = row <= scroll_bottom_ ? scroll_bottom_ : rows_ - 1;
+  int origin = cursor_.origin ? scroll_top_ : 0;
+  switch (final_byte) {
+    case '@': {
+      Cell* cells = Row(row);
+      n = std::min(n, cols_ - col);
+      std::copy_backward(cells + col, cells + cols_ - n, cells + cols_);
+      ClearCells(row, col, col + n);
+      break;
+    }
+    case 'A':
+      MoveTo(std::max(top, row - n), col);
+      break;
+    case 'B':
+    case 'e':
+      MoveTo(std::min(bottom, row + n), col);
+      break;
+    case 'C':
+    case 'a':
+      MoveTo(row, col + n);
+      break;
+    case 'D':
+      MoveTo(row, col - n);
+      break;
+    case 'E':
+      MoveTo(std::min(bottom, row + n), 0);
+      break;
+    case 'F':
+      MoveTo(std::max(top, row - n), 0);
+      break;
+    case 'G':
+    case '`':
+      MoveTo(row, n - 1);
+      break;
+    case 'H':
+    case 'f':
+      MoveTo(origin + std::max(1, Param(0, 1)) - 1, std::max(1, Param(1, 1)) - 1);
+      break;
+    case 'd':
+      MoveTo(origin + n - 1, col);
+      break;
+    case 'J': {
+      int mode = Param(0, 0);
+      if (mode == 0) {
+        ClearCells(row, col, cols_);
+        for (int r = row + 1; r < rows_; r++) {
+          ClearCells(r, 0, cols_);
+        }
+      } else if (mode == 1) {
+        for (int r = 0; r < row; r++) {
+          ClearCells(r, 0, cols_);
+        }
+        ClearCells(row, 0, col + 1);
+      } else {
+        for (int r = 0; r < rows_; r++) {
+          ClearCells(r, 0, cols_);
+        }
+      }
+      break;
+    }
+    case 'K': {
+      int mode = Param(0, 0);
+      if (mode == 0) {
+        ClearCells(row, col, cols_);
+      } else if (mode == 1) {
+        ClearCells(row, 0, col + 1);
+      } else {
+        ClearCells(row, 0, cols_);
+      }
+      break;
+    }
+    case 'L':
+      if (row >= scroll_top_ && row <= scroll_bottom_) {
+        ScrollDown(row, scroll_bottom_, n);
+        cursor_.col = 0;
+      }
+      break;
+    case 'M':
+      if (row >= scroll_top_ && row <= scroll_bottom_) {
+        ScrollUp(row, scroll_bottom_, n);
+        cursor_.col = 0;
+      }
+      break;
+    case 'P': {
+      Cell* cells = Row(row);
+      n = std::min(n, cols_ - col);
+      std::copy(cells + col + n, cells + cols_, cells + col);
+      ClearCells(row, cols_ - n, cols_);
+      break;
+    }
+    case 'S':
+      ScrollUp(scroll_top_, scroll_bottom_, n);
+      break;
+    case 'T':
+      if (params_.size() <= 1) {
+        ScrollDown(scroll_top_, scroll_bottom_, n);
+      }
+      break;
+    case 'X':
+      ClearCells(row, col, std::min(cols_, col + n));
+      break;
+    case 'm':
+      SelectGraphicRendition();
+      break;
+    case 'h':
+    case 'l':
+      for (size_t i = 0; i < params_.size(); i++) {
+        if (private_marker_ == '?') {
+          SetMode(params_[i], final_byte == 'h');
+        } else if (params_[i] == 4) {
+          insert_mode_ = final_byte == 'h';
+        }
+      }
+      break;
+    case 'r': {
+      int new_top = std::max(1, Param(0, 1)) - 1;
+      int new_bottom = std::min(rows_, Param(1, rows_)) - 1;
+      if (new_top < new_bottom) {
+        scroll_top_ = new_top;
+        scroll_bottom_ = new_bottom;
+        MoveTo(cursor_.origin ? scroll_top_ : 0, 0);
+      }
+      break;
+    }
+    case 's':
+      saved_cursor_ = cursor_;
+      break;
+    case 'u':
+      cursor_ = saved_cursor_;
+      MoveTo(cursor_.row, cursor_.col);
+      break;
+    case 'n':
+      if (Param(0, 0) == 5) {
+        replies_ += "\x1b[0n";
+      } else if (Param(0, 0) == 6) {
+        replies_ += "\x1b[" + std::to_string(row - origin + 1) + ";" + std::to_string(col + 1) + "R";
+      }
+      break;
+    case 'c':
+      replies_ += "\x1b[?1;2c";
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::SetMode(int mode, bool enabled) {
+  switch (mode) {
+    case 6:
+      cursor_.origin = enabled;
+      MoveTo(enabled ? scroll_top_ : 0, 0);
+      break;
+    case 7:
+      autowrap_ = enabled;
+      break;
+    case 25:
+      cursor_visible_ = enabled;
+      break;
+    case 47:
+    case 1047:
+      SwitchScreen(enabled);
+      break;
+    case 1048:
+      if (enabled) {
+        saved_cursor_ = cursor_;
+      } else {
+        cursor_ = saved_cursor_;
+        MoveTo(cursor_.row, cursor_.col);
+      }
+      break;
+    case 1049:
+      if (enabled) {
+        saved_cursor_ = cursor_;
+        SwitchScreen(true);
+      } else {
+        SwitchScreen(false);
+        cursor_ = saved_cursor_;
+        MoveTo(cursor_.row, cursor_.col);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+void TerminalScreen::SelectGraphicRendition() {
+  Cell& pen = cursor_.pen;
+  if (params_.empty()) {
+    pen = Cell();
+    return;
+  }
+  for (size_t i = 0; i < params_.size(); i++) {
+    int p = params_[i];
+    if (p == 0) {
+      pen = Cell();
+    } else if (p == 1) {
+      pen.flags |= kBold;
+    } else if (p == 2) {
+      pen.flags |= kDim;
+    } else if (p == 3) {
+      pen.flags |= kItalic;
+    } else if (p == 4 || p == 21) {
+      pen.flags |= kUnderline;
+    } else if (p == 5 || p == 6) {
+      pen.flags |= kBlink;
+    } else if (p == 7) {
+      pen.flags |= kInverse;
+    } else if (p == 8) {
+      pen.flags |= kHidden;
+    } else if (p == 9) {
+      pen.flags |= kStrike;
+    } else if (p == 22) {
+      pen.flags &= ~(kBold | kDim);
+    } else if (p == 23) {
+      pen.flags &= ~kItalic;
+    } else if (p == 24) {
+      pen.flags &= ~kUnderline;
+    } else if (p == 25) {
+      pen.flags &= ~kBlink;
+    } else if (p == 27) {
+      pen.flags &= ~kInverse;
+    } else if (p == 28) {
+      pen.flags &= ~kHidden;
+    } else if (p == 29) {
+      pen.flags &= ~kStrike;
+    } else if (p >= 30 && p <= 37) {
+      pen.fg = p - 30;
+    } else if (p >= 40 && p <= 47) {
+      pen.bg = p - 40;
+    } else if (p >= 90 && p <= 97) {
+      pen.fg = p - 90 + 8;
+    } else if (p >= 100 && p <= 107) {
+      pen.bg = p - 100 + 8;
+    } else if (p == 39) {
+      pen.fg = -1;
+    } else if (p == 49) {
+      pen.bg = -1;
+    } else if (p == 38 || p == 48) {
+      // 38;5;n 调色板，38;2;r;g;b 真彩色
+      int32_t color = -1;
+      if (Param(i + 1, 0) == 5 && i + 2 < params_.size()) {
+        color = std::min(Param(i + 2, 0), 255);
+        i += 2;
+      } else if (Param(i + 1, 0) == 2 && i + 4 < params_.size()) {
+        color = 0x1000000 | (std::min(Param(i + 2, 0), 255) << 16) |
+                (std::min(Param(i + 3, 0), 255) << 8) | std::min(Param(i + 4, 0), 255);
+        i += 4;
+      } else {
+        break;
+      }
+      (p == 38 ? pen.fg : pen.bg) = color;
+    }
+  }
+}
+
+void TerminalScreen::StringDispatch() {
+  // 只处理 OSC 0/2 设置窗口标题
+  if (string_kind_ != ']') {
+    return;
+  }
+  size_t separator = string_.find(';');
+  if (separator == std::string::npos) {
+    return;
+  }
+  std::string command = string_.substr(0, separator);
+  if (command == "0" || command == "2") {
+    // 标题原样转发给控制端，先去掉非法的 UTF-8
+    title_ = SanitizeUtf8(string_.substr(separator + 1));
+    title_changed_ = true;
+  }
+}
+
+TerminalScreen::Cell TerminalScreen::Blank() const {
+  // 擦除的区域使用当前背景色
+  Cell cell;
+  cell.bg = cursor_.pen.bg;
+  return cell;
+}
+
+void TerminalScreen::MoveTo(int row, int col) {
+  int min_row = cursor_.origin ? scroll_top_ : 0;
+  int max_row = cursor_.origin ? scroll_bottom_ : rows_ - 1;
+  cursor_.row = std::clamp(row, min_row, max_row);
+  cursor_.col = std::clamp(col, 0, cols_ - 1);
+  cursor_.pending_wrap = false;
+}
+
+void TerminalScreen::LineFeed() {
+  if (cursor_.row == scroll_bottom_) {
+    ScrollUp(scroll_top_, scroll_bottom_, 1);
+  } else if (cursor_.row < rows_ - 1) {
+    cursor_.row++;
+  }
+  cursor_.pending_wrap = false;
+}
+
+void TerminalScreen::ReverseIndex() {
+  if (cursor_.row == scroll_top_) {
+    ScrollDown(scroll_top_, scroll_bottom_, 1);
+  } else if (cursor_.row > 0) {
+    cursor_.row--;
+  }
+  cursor_.pending_wrap = false;
+}
+
+void TerminalScreen::ScrollUp(int top, int bottom, int count) {
+  count = std::min(count, bottom - top + 1);
+  if (count <= 0) {
+    return;
+  }
+  std::copy(Row(top + count), Row(bottom) + cols_, Row(top));
+  for (int r = bottom - count + 1; r <= bottom; r++) {
+    std::fill(Row(r), Row(r) + cols_, Blank());
+  }
+}
+
+void TerminalScreen::ScrollDown(int top, int bottom, int count) {
+  count = std::min(count, bottom - top + 1);
+  if (count <= 0) {
+    return;
+  }
+  std::copy_backward(Row(top), Row(bottom - count) + cols_, Row(bottom) + cols_);
+  for (int r = top; r < top + count; r++) {
+    std::fill(Row(r), Row(r) + cols_, Blank());
+  }
+}
+
+void TerminalScreen::ClearCells(int row, int from, int to) {
+  from = std::max(from, 0);
+  to = std::min(to, cols_);
+  if (from >= to) {
+    return;
+  }
+  Cell* cells = Row(row);
+  if (from > 0 && cells[from].ch == kWideTail) {
+    cells[from - 1].ch = ' ';
+  }
+  if (to < cols_ && cells[to].ch == kWideTail) {
+    cells[to].ch = ' ';
+  }
+  std::fill(cells + from, cells + to, Blank());
+}
+
+void TerminalScreen::SwitchScreen(bool alternate) {
+  if (alternate == alternate_) {
+    return;
+  }
+  if (alternate) {
+    saved_grid_ = grid_;
+    std::fill(grid_.begin(), grid_.end(), Cell());
+  } else {
+    if (saved_grid_.size() == grid_.size()) {
+      grid_.swap(saved_grid_);
+    }
+    saved_grid_.clear();
+  }
+  alternate_ = alternate;
+}
+
+int TerminalScreen::Param(size_t index, int fallback) const {
+  return index < params_.size() && params_[index] > 0 ? params_[index] : fallback;
+}
+
+void TerminalScreen::Resize(int cols, int rows) {
+  cols = std::max(cols, 1);
+  rows = std::max(rows, 1);
+  if (cols == cols_ && rows == rows_) {
+    return;
+  }
+  // 行数变少时保留光标所在的底部内容，和常见终端一致
+  int shift = std::max(0, cursor_.row - rows + 1);
+  auto resize_grid = [&](const std::vector<Cell>& old, int offset) {
+    std::vector<Cell> grid(static_cast<size_t>(cols) * rows, Cell());
+    for (int r = 0; r < rows && r + offset < rows_; r++) {
+      int n = std::min(cols, cols_);
+      const Cell* source = &old[static_cast<size_t>(r + offset) * cols_];
+      std::copy(source, source + n, &grid[static_cast<size_t>(r) * cols]);
+      if (n < cols_ && source[n].ch == kWideTail) {
+        grid[static_cast<size_t>(r) * cols + n - 1].ch = ' ';
+      }
+    }
+    return grid;
+  };
+  grid_ = resize_grid(grid_, shift);
+  if (!saved_grid_.empty()) {
+    saved_grid_ = resize_grid(saved_grid_, 0);
+  }
+  cols_ = cols;
+  rows_ = rows;
+  scroll_top_ = 0;
+  scroll_bottom_ = rows_ - 1;
+  cursor_.row -= shift;
+  MoveTo(cursor_.row, cursor_.col);
+  saved_cursor_.row = std::clamp(saved_cursor_.row, 0, rows_ - 1);
+  saved_cursor_.col = std::clamp(saved_cursor_.col, 0, cols_ - 1);
+  Invalidate();
+}
+
+ScreenUpdate TerminalScreen::Diff() {
+  ScreenUpdate update;
+  update.revision = ++revision_;
+  update.cols = cols_;
+  update.rows = rows_;
+  update.cursor_row = cursor_.row;
+  update.cursor_col = cursor_.col;
+  update.cursor_visible = cursor_visible_;
+  update.title_changed = title_changed_;
+  update.title = title_;
+  update.full = acked_.size() != grid_.size();
+
+  const Cell blank;
+  for (int r = 0; r < rows_; r++) {
+    const Cell* cells = Row(r);
+    const Cell* old = update.full ? nullptr : &acked_[static_cast<size_t>(r) * cols_];
+    int limit = cols_;
+    if (update.full) {
+      // 整屏时控制端先清屏，行尾的默认空白不用发
+      while (limit > 0 && cells[limit - 1] == blank) {
+        limit--;
+      }
+    }
+    int col = 0;
+    while (col < limit) {
+      if (old && cells[col] == old[col]) {
+        col++;
+        continue;
+      }
+      int start = col;
+      int end = col + 1;
+      for (int k = col + 1, gap = 0; k < limit && gap <= kMaxSpanGap; k++) {
+        if (!old || cells[k] != old[k]) {
+          end = k + 1;
+          gap = 0;
+        } else {
+          gap++;
+        }
+      }
+      // 不把宽字符拆成两段
+      if (start > 0 && cells[start].ch == kWideTail) {
+        start--;
+      }
+      if (end < cols_ && cells[end].ch == kWideTail) {
+        end++;
+      }
+
+      ScreenSpan span;
+      span.row = r;
+      span.col = start;
+      for (int k = start; k < end; k++) {
+        const Cell& cell = cells[k];
+        if (cell.ch == kWideTail) {
+          continue;
+        }
+        AppendUtf8(cell.ch, &span.text);
+        size_t size = span.styles.size();
+        if (size >= 4 && span.styles[size - 3] == cell.fg && span.styles[size - 2] == cell.bg &&
+            span.styles[size - 1] == cell.flags) {
+          span.styles[size - 4]++;
+        } else {
+          span.styles.insert(span.styles.end(), {1, cell.fg, cell.bg, cell.flags});
+        }
+      }
+      update.spans.push_back(std::move(span));
+      col = end;
+    }
+  }
+
+  unacked_.emplace_back(revision_, grid_);
+  if (unacked_.size() > kMaxUnackedRevisions) {
+    unacked_.pop_front();
+  }
+  dirty_ = false;
+  title_changed_ = false;
+  return update;
+}
+
+void TerminalScreen::Ack(int64_t revision) {
+  if (revision <= acked_revision_) {
+    return;
+  }
+  while (!unacked_.empty() && unacked_.front().first < revision) {
+    unacked_.pop_front();
+  }
+  if (unacked_.empty() || unacked_.front().first != revision) {
+    return;
+  }
+  acked_ = std::move(unacked_.front().second);
+  acked_revision_ = revision;
+  unacked_.pop_front();
+}
+
+void TerminalScreen::Invalidate() {
+  acked_.clear();
+  acked_revision_ = revision_;
+  unacked_.clear();
+  dirty_ = true;
+}
+
+std::string TerminalScreen::TakeReplies() {
+  std::string replies;
+  replies.swap(replies_);
+  return replies;
+}
@@ -0,0 +1,153 @@
+#ifndef RUNNER_TERMINAL_SCREEN_H_
+#define RUNNER_TERMINAL_SCREEN_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+// 屏幕上的一段变化：从 (row, col) 开始的一串字符。styles 按字符顺序每 4 个整数一段：
+// 字符数、前景色、背景色、属性位。颜色 -1 为默认色，0~255 为调色板，0x1000000 | RGB 为真彩色
+struct ScreenSpan {
+  int row = 0;
+  int col = 0;
+  std::string text;
+  std::vector<int32_t> styles;
+};
+
+struct ScreenUpdate {
+  int64_t revision = 0;
+  // 为 true 时 spans 覆盖整个屏幕，控制端应先清屏
+  bool full = false;
+  int cols = 0;
+  int rows = 0;
+  int cursor_row = 0;
+  int cursor_col = 0;
+  bool cursor_visible = true;
+  bool title_changed = false;
+  std::string title;
+  std::vector<ScreenSpan> spans;
+};
+
+// 服务端的 VT100/xterm 终端模拟：解析 shell 输出，维护屏幕网格。
+// 控制端不再接收原始字节流，而是定期取与上次已确认状态之间的差异，只包含变化的字符，
+// top、vim 这类全屏程序每次整屏重绘时实际传输的只有改动的几个字段。
+// 支持常用的光标移动、擦除、滚动区域、插入删除、SGR 颜色、备用屏幕和 DEC 画线字符集；
+// 宽字符按东亚宽字符区间占两列。只在平台线程上使用。
+class TerminalScreen {
+ public:
+  enum Flag : uint16_t {
+    kBold = 1,
+    kDim = 2,
+    kItalic = 4,
+    kUnderline = 8,
+    kBlink = 16,
+    kInverse = 32,
+    kHidden = 64,
+    kStrike = 128,
+  };
+
+  TerminalScreen(int cols, int rows);
+
+  TerminalScreen(const TerminalScreen&) = delete;
+  TerminalScreen& operator=(const TerminalScreen&) = delete;
+
+  void Feed(const uint8_t* data, size_t size);
+  void Resize(int cols, int rows);
+
+  // 自上次 Diff 以来屏幕是否有变化
+  bool dirty() const { return dirty_; }
+  // 计算当前屏幕相对已确认状态的差异，并生成新的修订号
+  ScreenUpdate Diff();
+  // 控制端确认已应用某个修订，之后的差异以它为基准
+  void Ack(int64_t revision);
+  // 丢弃已确认状态，下一次 Diff 发送整屏
+  void Invalidate();
+  // 取出需要写回给程序的应答（光标位置查询、设备属性查询等）
+  std::string TakeReplies();
+
+ private:
+  struct Cell {
+    uint32_t ch = ' ';
+    int32_t fg = -1;
+    int32_t bg = -1;
+    uint16_t flags = 0;
+
+    bool operator==(const Cell& other) const {
+      return ch == other.ch && fg == other.fg && bg == other.bg && flags == other.flags;
+    }
+    bool operator!=(const Cell& other) const { return !(*this == other); }
+  };
+
+  struct Cursor {
+    int row = 0;
+    int col = 0;
+    Cell pen;
+    bool origin = false;
+    bool pending_wrap = false;
+    int charset = 0;
+    char g[2] = {'B', 'B'};
+  };
+
+  enum class State { kGround, kEscape, kCharset, kCsi, kString, kStringEscape };
+
+  void Reset();
+  void Print(uint32_t ch);
+  void Control(uint8_t byte);
+  void Escape(uint8_t byte);
+  void CsiDispatch(uint8_t final_byte);
+  void SetMode(int mode, bool enabled);
+  void SelectGraphicRendition();
+  void StringDispatch();
+
+  Cell* Row(int row) { return &grid_[static_cast<size_t>(row) * cols_]; }
+  Cell Blank() const;
+  void MoveTo(int row, int col);
+  void LineFeed();
+  void ReverseIndex();
+  void ScrollUp(int top, int bottom, int count);
+  void ScrollDown(int top, int bottom, int count);
+  void ClearCells(int row, int from, int to);
+  void SwitchScreen(bool alternate);
+  int Param(size_t index, int fallback) const;
+
+  int cols_;
+  int rows_;
+  std::vector<Cell> grid_;
+  // 切到备用屏幕时保存的主屏幕
+  std::vector<Cell> saved_grid_;
+  bool alternate_ = false;
+  Cursor cursor_;
+  Cursor saved_cursor_;
+  int scroll_top_ = 0;
+  int scroll_bottom_ = 0;
+  bool autowrap_ = true;
+  bool insert_mode_ = false;
+  bool cursor_visible_ = true;
+  std::string title_;
+  bool title_changed_ = false;
+  std::string replies_;
+
+  // 解析器状态
+  State state_ = State::kGround;
+  uint32_t utf8_char_ = 0;
+  int utf8_length_ = 0;
+  int utf8_remaining_ = 0;
+  std::vector<int> params_;
+  bool param_started_ = false;
+  char private_marker_ = 0;
+  char intermediate_ = 0;
+  char string_kind_ = 0;
+  std::string string_;
+
+  // 差异基准：已确认的屏幕，以及已发出但还没确认的各修订
+  bool dirty_ = true;
+  int64_t revision_ = 0;
+  int64_t acked_revision_ = -1;
+  std::vector<Cell> acked_;
+  std::deque<std::pair<int64_t, std::vector<Cell>>> unacked_;
+};
+
+#endif  // RUNNER_TERMINAL_SCREEN_H_
@@ -0,0 +1,528 @@
+#include "transfer_engine.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+const uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+// 清单文件：32 字节文件头（"RCTM"、u32 版本、u64 文件大小、u64 块大小、u64 块数），
+// 之后每块一个状态字节，按 8 字节对齐后是每块的 u64 哈希
+const char kManifestMagic[4] = {'R', 'C', 'T', 'M'};
+const uint32_t kManifestVersion = 1;
+const int64_t kManifestHeaderSize = 32;
+
+inline uint64_t Rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t Read64(const uint8_t* p) {
+  uint64_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint32_t Read32(const uint8_t* p) {
+  uint32_t v;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+inline uint64_t Round(uint64_t acc, uint64_t input) {
+  acc += input * kPrime2;
+  acc = Rotl(acc, 31);
+  return acc * kPrime1;
+}
+
+inline uint64_t MergeRound(uint64_t acc, uint64_t val) {
+  acc ^= Round(0, val);
+  return acc * kPrime1 + kPrime4;
+}
+
+// 处理不足 32 字节的尾部数据并做最终混合
+uint64_t Finalize(uint64_t h, const uint8_t* p, const uint8_t* end) {
+  while (p + 8 <= end) {
+    h ^= Round(0, Read64(p));
+    h = Rotl(h, 27) * kPrime1 + kPrime4;
+    p += 8;
+  }
+  if (p + 4 <= end) {
+    h ^= static_cast<uint64_t>(Read32(p)) * kPrime1;
+    h = Rotl(h, 23) * kPrime2 + kPrime3;
+    p += 4;
+  }
+  while (p < end) {
+    h ^= (*p) * kPrime5;
+    h = Rotl(h, 11) * kPrime1;
+    p++;
+  }
+
+  h ^= h >> 33;
+  h *= kPrime2;
+  h ^= h >> 29;
+  h *= kPrime3;
+  h ^= h >> 32;
+  return h;
+}
+
+bool PreadAll(int fd, uint8_t* data, size_t size, int64_t offset) {
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pread(fd, data + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+bool PwriteAll(int fd, const void* data, size_t size, int64_t offset) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = pwrite(fd, p + done, size - done, offset + done);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      return false;
+    }
+    done += n;
+  }
+  return true;
+}
+
+// 多个线程从共享计数器领取块序号，各自用独立缓冲区读取并计算哈希
+bool HashChunks(int fd, int64_t size, int64_t chunk_size, const std::vector<int64_t>& indices,
+                std::vector<uint64_t>* hashes, int threads) {
+  if (threads <= 0) {
+    threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  }
+  threads = static_cast<int>(std::min<int64_t>(threads, indices.size()));
+  std::atomic<size_t> next(0);
+  std::atomic<bool> ok(true);
+  auto worker = [&]() {
+    std::vector<uint8_t> buffer(chunk_size);
+    while (ok) {
+      size_t i = next++;
+      if (i >= indices.size()) {
+        break;
+      }
+      int64_t index = indices[i];
+      int64_t offset = index * chunk_size;
+      size_t length = static_cast<size_t>(std::min(chunk_size, size - offset));
+      if (!PreadAll(fd, buffer.data(), length, offset)) {
+        ok = false;
+        break;
+      }
+      (*hashes)[index] = XXH64(buffer.data(), length);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (int i = 1; i < threads; i++) {
+    pool.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : pool) {
+    thread.join();
+  }
+  return ok;
+}
+
+int64_t HashOffset(int64_t chunk_count, int64_t index) {
+  return kManifestHeaderSize + ((chunk_count + 7) & ~int64_t(7)) + index * 8;
+}
+
+}  // namespace
+
+uint64_t XXH64(const void* data, size_t size, uint64_t seed) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + size;
+  uint64_t h;
+
+  if (size >= 32) {
+    uint64_t v1 = seed + kPrime1 + kPrime2;
+    uint64_t v2 = seed + kPrime2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - kPrime1;
+    const uint8_t* limit = end - 32;
+    do {
+      v1 = Round(v1, Read64(p));
+      v2 = Round(v2, Read64(p + 8));
+      v3 = Round(v3, Read64(p + 16));
+      v4 = Round(v4, Read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+    h = Rotl(v1, 1) + Rotl(v2, 7) + Rotl(v3, 12) + Rotl(v4, 18);
+    h = MergeRound(h, v1);
+    h = MergeRound(h, v2);
+    h = MergeRound(h, v3);
+    h = MergeRound(h, v4);
+  } else {
+    h = seed + kPrime5;
+  }
+  h += static_cast<uint64_t>(size);
+  return Finalize(h, p, end);
+}
+
+Xxh64Stream::Xxh64Stream(uint64_t seed) : seed_(seed) {
+  v_[0] = seed + kPrime1 + kPrime2;
+  v_[1] = seed + kPrime2;
+  v_[2] = seed;
+  v_[3] = seed - kPrime1;
+}
+
+void Xxh64Stream::Update(const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  const uint8_t* end = p + size;
+  total_ += size;
+  if (buffered_ + size < sizeof(buffer_)) {
+    if (size > 0) {
+      memcpy(buffer_ + buffered_, p, size);
+      buffered_ += size;
+    }
+    return;
+  }
+  if (buffered_ > 0) {
+    size_t fill = sizeof(buffer_) - buffered_;
+    memcpy(buffer_ + buffered_, p, fill);
+    p += fill;
+    for (int i = 0; i < 4; i++) {
+      v_[i] = Round(v_[i], Read64(buffer_ + i * 8));
+    }
+    buffered_ = 0;
+  }
+  while (end - p >= 32) {
+    for (int i = 0; i < 4; i++) {
+      v_[i] = Round(v_[i], Read64(p + i * 8));
+    }
+    p += 32;
+  }
+  buffered_ = end - p;
+  memcpy(buffer_, p, buffered_);
+}
+
+uint64_t Xxh64Stream::Digest() const {
+  uint64_t h;
+  if (total_ >= 32) {
+    h = Rotl(v_[0], 1) + Rotl(v_[1], 7) + Rotl(v_[2], 12) + Rotl(v_[3], 18);
+    for (int i = 0; i < 4; i++) {
+      h = MergeRound(h, v_[i]);
+    }
+  } else {
+    h = seed_ + kPrime5;
+  }
+  h += total_;
+  return Finalize(h, buffer_, buffer_ + buffered_);
+}
+
+uint64_t CombineChunkHashes(const std::vector<uint64_t>& hashes) {
+  return XXH64(hashes.data(), hashes.size() * sizeof(uint64_t));
+}
+
+bool HashFileChunks(int fd, int64_t size, int64_t chunk_size, std::vector<uint64_t>* hashes,
+                    int threads) {
+  if (chunk_size <= 0 || size < 0) {
+    return false;
+  }
+  int64_t count = (size + chunk_size - 1) / chunk_size;
+  hashes->assign(count, 0);
+  std::vector<int64_t> indices(count);
+  for (int64_t i = 0; i < count; i++) {
+    indices[i] = i;
+  }
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+  return HashChunks(fd, size, chunk_size, indices, hashes, threads);
+}
+
+std::string HashToHex(uint64_t hash) {
+  char buffer[17];
+  snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+  return buffer;
+}
+
+bool HashFromHex(const std::string& hex, uint64_t* hash) {
+  if (hex.empty() || hex.size() > 16) {
+    return false;
+  }
+  uint64_t value = 0;
+  for (char c : hex) {
+    int digit;
+    if (c >= '0' && c <= '9') {
+      digit = c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+      digit = c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+      digit = c - 'A' + 10;
+    } else {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  *hash = value;
+  return true;
+}
+
+ResumableTransfer::ResumableTransfer() {}
+
+ResumableTransfer::~ResumableTransfer() { CloseFiles(); }
+
+bool ResumableTransfer::Begin(const std::string& path, int64_t size, int64_t chunk_size,
+                              std::string* error) {
+  if (path.empty() || size < 0 || chunk_size <= 0) {
+    *error = "invalid transfer parameters";
+    return false;
+  }
+  path_ = path;
+  part_path_ = path + ".rcpart";
+  manifest_path_ = part_path_ + ".manifest";
+  size_ = size;
+  chunk_size_ = chunk_size;
+  chunk_count_ = (size + chunk_size - 1) / chunk_size;
+
+  data_fd_ = open(part_path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  manifest_fd_ = open(manifest_path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (data_fd_ < 0 || manifest_fd_ < 0) {
+    *error = strerror(errno);
+    CloseFiles();
+    return false;
+  }
+
+  if (!LoadManifest()) {
+    // 没有清单或参数不同，从头开始
+    done_.assign(chunk_count_, 0);
+    hashes_.assign(chunk_count_, 0);
+    completed_ = 0;
+    bytes_received_ = 0;
+    resumed_ = false;
+    if (ftruncate(manifest_fd_, 0) != 0 || !WriteManifestHeader() ||
+        ftruncate(manifest_fd_, HashOffset(chunk_count_, chunk_count_)) != 0) {
+      *error = strerror(errno);
+      CloseFiles();
+      return false;
+    }
+  }
+  // 预先把临时文件扩展到最终大小，各块可以按任意顺序写入
+  if (ftruncate(data_fd_, size_) != 0) {
+    *error = strerror(errno);
+    CloseFiles();
+    return false;
+  }
+  return true;
+}
+
+bool ResumableTransfer::LoadManifest() {
+  uint8_t header[kManifestHeaderSize];
+  if (!PreadAll(manifest_fd_, header, sizeof(header), 0) ||
+      memcmp(header, kManifestMagic, 4) != 0 || Read32(header + 4) != kManifestVersion ||
+      static_cast<int64_t>(Read64(header + 8)) != size_ ||
+      static_cast<int64_t>(Read64(header + 16)) != chunk_size_ ||
+      static_cast<int64_t>(Read64(header + 24)) != chunk_count_) {
+    return false;
+  }
+  done_.assign(chunk_count_, 0);
+  hashes_.assign(chunk_count_, 0);
+  if (chunk_count_ > 0 &&
+      (!PreadAll(manifest_fd_, done_.data(), chunk_count_, kManifestHeaderSize) ||
+       !PreadAll(manifest_fd_, reinterpret_cast<uint8_t*>(hashes_.data()), chunk_count_ * 8,
+                 HashOffset(chunk_count_, 0)))) {
+    return false;
+  }
+
+  // 清单没有和数据一起落盘，重新校验标记为完成的块
+  std::vector<int64_t> marked;
+  for (int64_t i = 0; i < chunk_count_; i++) {
+    if (done_[i]) {
+      marked.push_back(i);
+    }
+  }
+  std::vector<uint64_t> actual(chunk_count_, 0);
+  struct stat st;
+  if (fstat(data_fd_, &st) != 0 || st.st_size != size_ ||
+      !HashChunks(data_fd_, size_, chunk_size_, marked, &actual, 0)) {
+    return false;
+  }
+  completed_ = 0;
+  bytes_received_ = 0;
+  const uint8_t cleared = 0;
+  for (int64_t index : marked) {
+    if (actual[index] == hashes_[index]) {
+      completed_++;
+      bytes_received_ += ChunkLength(index);
+    } else {
+      done_[index] = 0;
+      PwriteAll(manifest_fd_, &cleared, 1, kManifestHeaderSize + index);
+    }
+  }
+  resumed_ = completed_ > 0;
+  return true;
+}
+
+bool ResumableTransfer::WriteManifestHeader() {
+  uint8_t header[kManifestHeaderSize] = {};
+  memcpy(header, kManifestMagic, 4);
+  memcpy(header + 4, &kManifestVersion, 4);
+  uint64_t fields[3] = {static_cast<uint64_t>(size_), static_cast<uint64_t>(chunk_size_),
+                        static_cast<uint64_t>(chunk_count_)};
+  memcpy(header + 8, fields, sizeof(fields));
+  return PwriteAll(manifest_fd_, header, sizeof(header), 0);
+}
+
+int64_t ResumableTransfer::ChunkLength(int64_t index) const {
+  return std::min(chunk_size_, size_ - index * chunk_size_);
+}
+
+bool ResumableTransfer::PutChunk(int64_t index, const uint8_t* data, size_t size, uint64_t hash,
+                                 std::string* error) {
+  if (data_fd_ < 0) {
+    *error = "transfer is not open";
+    return false;
+  }
+  if (index < 0 || index >= chunk_count_ || static_cast<int64_t>(size) != ChunkLength(index)) {
+    *error = "invalid chunk";
+    return false;
+  }
+  if (XXH64(data, size) != hash) {
+    *error = "checksum mismatch";
+    return false;
+  }
+  if (!PwriteAll(data_fd_, data, size, index * chunk_size_)) {
+    *error = strerror(errno);
+    return false;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (done_[index]) {
+      return true;
+    }
+    done_[index] = 1;
+    hashes_[index] = hash;
+    completed_++;
+    bytes_received_ += size;
+  }
+  // 先写哈希再写状态字节，状态只在哈希就位后才会被读到
+  const uint8_t marked = 1;
+  if (!PwriteAll(manifest_fd_, &hash, sizeof(hash), HashOffset(chunk_count_, index)) ||
+      !PwriteAll(manifest_fd_, &marked, 1, kManifestHeaderSize + index)) {
+    *error = strerror(errno);
+    return false;
+  }
+  return true;
+}
+
+bool ResumableTransfer::Finish(const uint64_t* file_hash, uint64_t* actual_hash,
+                               std::string* error) {
+  if (data_fd_ < 0) {
+    *error = "transfer is not open";
+    return false;
+  }
+  int64_t missing = chunk_count_ - completed_chunks();
+  if (missing > 0) {
+    *error = std::to_string(missing) + " chunks missing";
+    return false;
+  }
+  if (fdatasync(data_fd_) != 0) {
+    *error = strerror(errno);
+    return false;
+  }
+
+  // 从磁盘重新读取全部块校验，不一致的块重新标记为缺失
+  std::vector<uint64_t> actual;
+  if (!HashFileChunks(data_fd_, size_, chunk_size_, &actual)) {
+    *error = "failed to read back transferred data";
+    return false;
+  }
+  int64_t corrupted = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (int64_t i = 0; i < chunk_count_; i++) {
+      if (actual[i] != hashes_[i]) {
+        done_[i] = 0;
+        completed_--;
+        bytes_received_ -= ChunkLength(i);
+        const uint8_t cleared = 0;
+        PwriteAll(manifest_fd_, &cleared, 1, kManifestHeaderSize + i);
+        corrupted++;
+      }
+    }
+  }
+  if (corrupted > 0) {
+    *error = std::to_string(corrupted) + " chunks failed verification";
+    return false;
+  }
+  *actual_hash = CombineChunkHashes(actual);
+  if (file_hash && *file_hash != *actual_hash) {
+    *error = "file checksum mismatch";
+    return false;
+  }
+
+  CloseFiles();
+  if (rename(part_path_.c_str(), path_.c_str()) != 0) {
+    *error = strerror(errno);
+    return false;
+  }
+  unlink(manifest_path_.c_str());
+  // 目录项也落盘，改名在掉电后依然有效
+  std::string dir = path_.substr(0, path_.find_last_of('/') + 1);
+  int dir_fd = open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dir_fd >= 0) {
+    fsync(dir_fd);
+    close(dir_fd);
+  }
+  return true;
+}
+
+void ResumableTransfer::Abort(bool keep_partial) {
+  CloseFiles();
+  if (!keep_partial && !part_path_.empty()) {
+    unlink(part_path_.c_str());
+    unlink(manifest_path_.c_str());
+  }
+}
+
+std::vector<int64_t> ResumableTransfer::MissingChunks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int64_t> missing;
+  for (int64_t i = 0; i < chunk_count_; i++) {
+    if (!done_[i]) {
+      missing.push_back(i);
+    }
+  }
+  return missing;
+}
+
+int64_t ResumableTransfer::completed_chunks() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return completed_;
+}
+
+int64_t ResumableTransfer::bytes_received() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_received_;
+}
+
+void ResumableTransfer::CloseFiles() {
+  if (data_fd_ >= 0) {
+    close(data_fd_);
+    data_fd_ = -1;
+  }
+  if (manifest_fd_ >= 0) {
+    close(manifest_fd_);
+    manifest_fd_ = -1;
+  }
+}
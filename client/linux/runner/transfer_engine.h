@@ -0,0 +1,88 @@
+#ifndef RUNNER_TRANSFER_ENGINE_H_
+#define RUNNER_TRANSFER_ENGINE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// xxHash64，用于分块校验
+uint64_t XXH64(const void* data, size_t size, uint64_t seed = 0);
+
+// 分段输入的 xxHash64，结果与对拼接后的数据调用 XXH64 相同
+class Xxh64Stream {
+ public:
+  explicit Xxh64Stream(uint64_t seed = 0);
+
+  void Update(const void* data, size_t size);
+  uint64_t Digest() const;
+
+ private:
+  uint64_t seed_;
+  uint64_t v_[4];
+  uint64_t total_ = 0;
+  uint8_t buffer_[32];
+  size_t buffered_ = 0;
+};
+
+// 整个文件的校验值：对各块哈希（小端 u64 依次排列）再做一次 XXH64，
+// 发送端和接收端按同样的块大小分块即可得到相同结果
+uint64_t CombineChunkHashes(const std::vector<uint64_t>& hashes);
+
+// 多线程计算文件各块的哈希，threads 为 0 时按 CPU 数量决定
+bool HashFileChunks(int fd, int64_t size, int64_t chunk_size, std::vector<uint64_t>* hashes,
+                    int threads = 0);
+
+std::string HashToHex(uint64_t hash);
+bool HashFromHex(const std::string& hex, uint64_t* hash);
+
+// 可续传的分块接收端。数据先写到 path + ".rcpart"，每块校验通过后记录到
+// path + ".rcpart.manifest"；连接中断后用相同的大小和块大小再次 Begin 即可从已完成的块继续。
+// 清单更新不做 fsync，续传时会重新校验清单里标记完成的块，掉电后最多重传未落盘的块。
+// 各块写入互不重叠，PutChunk 可以从多个线程并发调用。
+class ResumableTransfer {
+ public:
+  ResumableTransfer();
+  ~ResumableTransfer();
+
+  bool Begin(const std::string& path, int64_t size, int64_t chunk_size, std::string* error);
+  bool PutChunk(int64_t index, const uint8_t* data, size_t size, uint64_t hash,
+                std::string* error);
+  // 重新校验全部块，file_hash 非空时与整体校验值比较，通过后改名为目标文件
+  bool Finish(const uint64_t* file_hash, uint64_t* actual_hash, std::string* error);
+  // keep_partial 为 false 时删除临时文件和清单
+  void Abort(bool keep_partial);
+
+  std::vector<int64_t> MissingChunks() const;
+  int64_t chunk_count() const { return chunk_count_; }
+  int64_t chunk_size() const { return chunk_size_; }
+  int64_t size() const { return size_; }
+  int64_t completed_chunks() const;
+  int64_t bytes_received() const;
+  bool resumed() const { return resumed_; }
+
+ private:
+  bool LoadManifest();
+  bool WriteManifestHeader();
+  int64_t ChunkLength(int64_t index) const;
+  void CloseFiles();
+
+  std::string path_;
+  std::string part_path_;
+  std::string manifest_path_;
+  int data_fd_ = -1;
+  int manifest_fd_ = -1;
+  int64_t size_ = 0;
+  int64_t chunk_size_ = 0;
+  int64_t chunk_count_ = 0;
+  bool resumed_ = false;
+
+  mutable std::mutex mutex_;
+  std::vector<uint8_t> done_;
+  std::vector<uint64_t> hashes_;
+  int64_t completed_ = 0;
+  int64_t bytes_received_ = 0;
+};
+
+#endif  // RUNNER_TRANSFER_ENGINE_H_
@@ -0,0 +1,293 @@
+#include "wire_protocol.h"
+
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const size_t kFrameFieldsBytes = 6;
+const size_t kMouseBytes = 16;
+const size_t kKeyFieldsBytes = 4;
+const size_t kChunkFieldsBytes = 13;
+
+class Writer {
+ public:
+  explicit Writer(std::vector<uint8_t>* out) : out_(out) {}
+
+  void U8(uint8_t value) { out_->push_back(value); }
+  void U16(uint16_t value) { Put(value, 2); }
+  void U32(uint32_t value) { Put(value, 4); }
+  void U64(uint64_t value) { Put(value, 8); }
+  void F32(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    U32(bits);
+  }
+  void Bytes(const uint8_t* data, size_t size) {
+    if (size > 0) {
+      out_->insert(out_->end(), data, data + size);
+    }
+  }
+
+ private:
+  void Put(uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+      out_->push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  std::vector<uint8_t>* out_;
+};
+
+// 调用方先检查长度，这里只负责按小端取值
+class Reader {
+ public:
+  explicit Reader(const uint8_t* data) : data_(data) {}
+
+  uint8_t U8() { return data_[offset_++]; }
+  uint16_t U16() { return static_cast<uint16_t>(Get(2)); }
+  uint32_t U32() { return static_cast<uint32_t>(Get(4)); }
+  uint64_t U64() { return Get(8); }
+  float F32() {
+    uint32_t bits = U32();
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+  const uint8_t* position() const { return data_ + offset_; }
+
+ private:
+  uint64_t Get(int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+      value |= static_cast<uint64_t>(data_[offset_ + i]) << (8 * i);
+    }
+    offset_ += bytes;
+    return value;
+  }
+
+  const uint8_t* data_;
+  size_t offset_ = 0;
+};
+
+bool Fail(std::string* error, const char* message) {
+  if (error) {
+    *error = message;
+  }
+  return false;
+}
+
+void WriteHeader(const WireHeader& header, WireType type, size_t payload_length,
+                 std::vector<uint8_t>* out) {
+  out->reserve(out->size() + kWireHeaderBytes + payload_length);
+  Writer writer(out);
+  writer.U8(kWireMagic);
+  writer.U8(kWireVersion);
+  writer.U8(static_cast<uint8_t>(type));
+  writer.U8(header.flags);
+  writer.U32(header.session);
+  writer.U32(header.sequence);
+  writer.U64(header.timestamp_us);
+  writer.U32(static_cast<uint32_t>(payload_length));
+}
+
+}  // namespace
+
+bool EncodeWireScreenFrame(const WireHeader& header, const WireScreenFrame& frame,
+                           std::vector<uint8_t>* out) {
+  size_t length = kFrameFieldsBytes + frame.size;
+  if (length > kWireMaxPayload) {
+    return false;
+  }
+  WriteHeader(header, WireType::kScreenFrame, length, out);
+  Writer writer(out);
+  writer.U16(frame.width);
+  writer.U16(frame.height);
+  writer.U8(static_cast<uint8_t>(frame.codec));
+  writer.U8(frame.keyframe ? kWireFrameKeyframe : 0);
+  writer.Bytes(frame.data, frame.size);
+  return true;
+}
+
+bool EncodeWireMouseInput(const WireHeader& header, const WireMouseInput& mouse,
+                          std::vector<uint8_t>* out) {
+  WriteHeader(header, WireType::kInputMouse, kMouseBytes, out);
+  Writer writer(out);
+  writer.U8(static_cast<uint8_t>(mouse.action));
+  writer.U8(static_cast<uint8_t>(mouse.button));
+  writer.U16(0);
+  writer.F32(mouse.x);
+  writer.F32(mouse.y);
+  writer.U32(static_cast<uint32_t>(mouse.delta));
+  return true;
+}
+
+bool EncodeWireKeyInput(const WireHeader& header, const WireKeyInput& key,
+                        std::vector<uint8_t>* out) {
+  if (key.key.empty() || key.key.size() > 0xFFFF) {
+    return false;
+  }
+  WriteHeader(header, WireType::kInputKeyboard, kKeyFieldsBytes + key.key.size(), out);
+  Writer writer(out);
+  writer.U8(static_cast<uint8_t>(key.action));
+  writer.U8(key.modifiers);
+  writer.U16(static_cast<uint16_t>(key.key.size()));
+  writer.Bytes(reinterpret_cast<const uint8_t*>(key.key.data()), key.key.size());
+  return true;
+}
+
+bool EncodeWireFileChunk(const WireHeader& header, const WireFileChunk& chunk,
+                         std::vector<uint8_t>* out) {
+  size_t length = kChunkFieldsBytes + chunk.size;
+  if (length > kWireMaxPayload) {
+    return false;
+  }
+  WriteHeader(header, WireType::kFileChunk, length, out);
+  Writer writer(out);
+  writer.U32(chunk.transfer);
+  writer.U64(chunk.offset);
+  writer.U8(chunk.last ? kWireChunkLast : 0);
+  writer.Bytes(chunk.data, chunk.size);
+  return true;
+}
+
+bool SetWireSession(uint32_t session, std::vector<uint8_t>* message) {
+  if (message->size() < kWireHeaderBytes) {
+    return false;
+  }
+  // 会话编号在魔数、版本、类型、标志之后
+  for (int i = 0; i < 4; i++) {
+    (*message)[4 + i] = static_cast<uint8_t>(session >> (8 * i));
+  }
+  return true;
+}
+
+bool DecodeWireHeader(const uint8_t* data, size_t size, WireHeader* header,
+                      const uint8_t** payload, std::string* error) {
+  if (!data || size < kWireHeaderBytes) {
+    return Fail(error, "message shorter than header");
+  }
+  Reader reader(data);
+  if (reader.U8() != kWireMagic) {
+    return Fail(error, "bad magic");
+  }
+  if (reader.U8() != kWireVersion) {
+    return Fail(error, "unsupported version");
+  }
+  uint8_t type = reader.U8();
+  if (type < static_cast<uint8_t>(WireType::kScreenFrame) ||
+      type > static_cast<uint8_t>(WireType::kFileChunk)) {
+    return Fail(error, "unknown message type");
+  }
+  header->type = static_cast<WireType>(type);
+  header->flags = reader.U8();
+  header->session = reader.U32();
+  header->sequence = reader.U32();
+  header->timestamp_us = reader.U64();
+  header->payload_length = reader.U32();
+  if (header->payload_length > kWireMaxPayload) {
+    return Fail(error, "payload too large");
+  }
+  // 一条消息就是一个 WebSocket 帧，长度必须正好对上
+  if (header->payload_length != size - kWireHeaderBytes) {
+    return Fail(error, "payload length mismatch");
+  }
+  *payload = data + kWireHeaderBytes;
+  return true;
+}
+
+bool DecodeWireScreenFrame(const uint8_t* payload, size_t size, WireScreenFrame* frame,
+                           std::string* error) {
+  if (size <= kFrameFieldsBytes) {
+    return Fail(error, "screen frame too short");
+  }
+  Reader reader(payload);
+  frame->width = reader.U16();
+  frame->height = reader.U16();
+  uint8_t codec = reader.U8();
+  uint8_t flags = reader.U8();
+  if (frame->width == 0 || frame->height == 0) {
+    return Fail(error, "empty screen frame");
+  }
+  if (codec > static_cast<uint8_t>(WireFrameCodec::kJpeg)) {
+    return Fail(error, "unknown frame codec");
+  }
+  frame->codec = static_cast<WireFrameCodec>(codec);
+  frame->keyframe = (flags & kWireFrameKeyframe) != 0;
+  frame->data = reader.position();
+  frame->size = size - kFrameFieldsBytes;
+  return true;
+}
+
+bool DecodeWireMouseInput(const uint8_t* payload, size_t size, WireMouseInput* mouse,
+                          std::string* error) {
+  if (size != kMouseBytes) {
+    return Fail(error, "bad mouse input length");
+  }
+  Reader reader(payload);
+  uint8_t action = reader.U8();
+  uint8_t button = reader.U8();
+  reader.U16();
+  mouse->x = reader.F32();
+  mouse->y = reader.F32();
+  mouse->delta = static_cast<int32_t>(reader.U32());
+  if (action > static_cast<uint8_t>(WireMouseAction::kUp)) {
+    return Fail(error, "unknown mouse action");
+  }
+  if (button > static_cast<uint8_t>(WireMouseButton::kMiddle)) {
+    return Fail(error, "unknown mouse button");
+  }
+  if (!std::isfinite(mouse->x) || !std::isfinite(mouse->y)) {
+    return Fail(error, "bad mouse position");
+  }
+  mouse->action = static_cast<WireMouseAction>(action);
+  mouse->button = static_cast<WireMouseButton>(button);
+  return true;
+}
+
+bool DecodeWireKeyInput(const uint8_t* payload, size_t size, WireKeyInput* key,
+                        std::string* error) {
+  if (size <= kKeyFieldsBytes) {
+    return Fail(error, "key input too short");
+  }
+  Reader reader(payload);
+  uint8_t action = reader.U8();
+  key->modifiers = reader.U8();
+  size_t length = reader.U16();
+  if (action > static_cast<uint8_t>(WireKeyAction::kPress)) {
+    return Fail(error, "unknown key action");
+  }
+  if (length == 0 || length != size - kKeyFieldsBytes) {
+    return Fail(error, "bad key length");
+  }
+  key->action = static_cast<WireKeyAction>(action);
+  key->key.assign(reinterpret_cast<const char*>(reader.position()), length);
+  return true;
+}
+
+bool DecodeWireFileChunk(const uint8_t* payload, size_t size, WireFileChunk* chunk,
+                         std::string* error) {
+  if (size < kChunkFieldsBytes) {
+    return Fail(error, "file chunk too short");
+  }
+  Reader reader(payload);
+  chunk->transfer = reader.U32();
+  chunk->offset = reader.U64();
+  chunk->last = (reader.U8() & kWireChunkLast) != 0;
+  chunk->data = reader.position();
+  chunk->size = size - kChunkFieldsBytes;
+  if (chunk->offset > UINT64_MAX - chunk->size) {
+    return Fail(error, "file chunk offset overflow");
+  }
+  return true;
+}
+
+int NegotiateWireVersion(const std::vector<int64_t>& offered) {
+  int best = 0;
+  for (int64_t version : offered) {
+    if (version >= 1 && version <= kWireVersion && version > best) {
+      best = static_cast<int>(version);
+    }
+  }
+  return best;
+}
@@ -0,0 +1,118 @@
+#ifndef RUNNER_WIRE_PROTOCOL_H_
+#define RUNNER_WIRE_PROTOCOL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 与服务器之间的二进制消息格式，取代 JSON 里 base64 编码的帧数据和文件块。
+// 每条消息占一个 WebSocket 二进制帧，开头是固定 24 字节的头（小端）：
+//   u8 魔数 'W' | u8 版本 | u8 类型 | u8 标志 | u32 会话 | u32 序号 |
+//   u64 时间戳（微秒）| u32 负载长度
+// 之后是负载长度字节的类型相关内容。是否使用由连接建立后的 protocol_negotiate
+// 文本消息协商，未协商的连接继续收发 JSON。常量与 server/pkg/protocol/wire.go 一致。
+// 解码只做边界检查和取值，帧数据和文件块指向输入缓冲区，不复制。
+
+const uint8_t kWireMagic = 'W';
+const uint8_t kWireVersion = 1;
+const size_t kWireHeaderBytes = 24;
+const uint32_t kWireMaxPayload = 64 * 1024 * 1024;
+
+enum class WireType : uint8_t {
+  kScreenFrame = 1,
+  kInputMouse = 2,
+  kInputKeyboard = 3,
+  kFileChunk = 4,
+};
+
+struct WireHeader {
+  WireType type = WireType::kScreenFrame;
+  uint8_t flags = 0;
+  // 发送方定义的会话编号，服务器原样转发
+  uint32_t session = 0;
+  // 发送方按类型递增，接收方据此发现丢帧和乱序
+  uint32_t sequence = 0;
+  uint64_t timestamp_us = 0;
+  uint32_t payload_length = 0;
+};
+
+// 屏幕帧负载：u16 宽 | u16 高 | u8 编码 | u8 帧标志 | 编码后的数据
+enum class WireFrameCodec : uint8_t { kPng = 0, kJpeg = 1 };
+const uint8_t kWireFrameKeyframe = 1;
+
+struct WireScreenFrame {
+  uint16_t width = 0;
+  uint16_t height = 0;
+  WireFrameCodec codec = WireFrameCodec::kPng;
+  bool keyframe = true;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// 鼠标负载：u8 动作 | u8 按键 | u16 保留 | f32 x | f32 y | i32 滚动量
+enum class WireMouseAction : uint8_t { kMove = 0, kClick, kScroll, kDown, kUp };
+enum class WireMouseButton : uint8_t { kLeft = 0, kRight, kMiddle };
+
+struct WireMouseInput {
+  WireMouseAction action = WireMouseAction::kMove;
+  WireMouseButton button = WireMouseButton::kLeft;
+  float x = 0;
+  float y = 0;
+  int32_t delta = 0;
+};
+
+// 键盘负载：u8 动作 | u8 修饰键 | u16 键名长度 | 键名（UTF-8）
+enum class WireKeyAction : uint8_t { kDown = 0, kUp, kPress };
+const uint8_t kWireModifierCtrl = 1;
+const uint8_t kWireModifierShift = 2;
+const uint8_t kWireModifierAlt = 4;
+const uint8_t kWireModifierMeta = 8;
+
+struct WireKeyInput {
+  WireKeyAction action = WireKeyAction::kPress;
+  uint8_t modifiers = 0;
+  std::string key;
+};
+
+// 文件块负载：u32 传输编号 | u64 偏移 | u8 块标志 | 数据
+const uint8_t kWireChunkLast = 1;
+
+struct WireFileChunk {
+  uint32_t transfer = 0;
+  uint64_t offset = 0;
+  bool last = false;
+  const uint8_t* data = nullptr;
+  size_t size = 0;
+};
+
+// 编码时头里的类型和负载长度由函数填写，结果追加到 out
+bool EncodeWireScreenFrame(const WireHeader& header, const WireScreenFrame& frame,
+                           std::vector<uint8_t>* out);
+bool EncodeWireMouseInput(const WireHeader& header, const WireMouseInput& mouse,
+                          std::vector<uint8_t>* out);
+bool EncodeWireKeyInput(const WireHeader& header, const WireKeyInput& key,
+                        std::vector<uint8_t>* out);
+bool EncodeWireFileChunk(const WireHeader& header, const WireFileChunk& chunk,
+                         std::vector<uint8_t>* out);
+
+// 改写一条完整消息头里的会话编号，消息短于头部时返回 false。
+// 多个会话共用同一份编码结果时，各自在复制出的消息里填写
+bool SetWireSession(uint32_t session, std::vector<uint8_t>* message);
+
+// data/size 是一条完整消息。成功时 payload 指向 data 内的负载
+bool DecodeWireHeader(const uint8_t* data, size_t size, WireHeader* header,
+                      const uint8_t** payload, std::string* error);
+bool DecodeWireScreenFrame(const uint8_t* payload, size_t size, WireScreenFrame* frame,
+                           std::string* error);
+bool DecodeWireMouseInput(const uint8_t* payload, size_t size, WireMouseInput* mouse,
+                          std::string* error);
+bool DecodeWireKeyInput(const uint8_t* payload, size_t size, WireKeyInput* key,
+                        std::string* error);
+bool DecodeWireFileChunk(const uint8_t* payload, size_t size, WireFileChunk* chunk,
+                         std::string* error);
+
+// 从对方提供的版本里选双方都支持的最高版本，没有时返回 0，继续使用 JSON
+int NegotiateWireVersion(const std::vector<int64_t>& offered);
+
+#endif  // RUNNER_WIRE_PROTOCOL_H_
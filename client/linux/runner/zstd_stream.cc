@@ -0,0 +1,143 @@
+#include "zstd_stream.h"
+
+#include <zstd.h>
+
+#include <algorithm>
+
+namespace {
+
+// 自适应时的起始级别和调整范围
+const int kDefaultLevel = 3;
+const int kMinAdaptiveLevel = 1;
+const int kMaxAdaptiveLevel = 12;
+
+// 统计窗口：至少 4 MB 输入且至少 250 毫秒才调整一次，避免来回抖动
+const int64_t kWindowBytes = 4 * 1024 * 1024;
+const double kWindowSeconds = 0.25;
+
+// 压缩耗时占比高于上限说明压缩是瓶颈，低于下限说明在等下游
+const double kBusyHigh = 0.8;
+const double kBusyLow = 0.3;
+// 压缩率低于这个值视为不可压缩
+const double kIncompressibleRatio = 1.05;
+
+}  // namespace
+
+ZstdCompressor::ZstdCompressor(int level) {
+  cctx_ = ZSTD_createCCtx();
+  adaptive_ = level == 0;
+  level_ = adaptive_ ? kDefaultLevel : std::clamp(level, ZSTD_minCLevel(), ZSTD_maxCLevel());
+  ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level_);
+  ZSTD_CCtx_setParameter(cctx_, ZSTD_c_checksumFlag, 1);
+  window_start_ = Clock::now();
+}
+
+ZstdCompressor::~ZstdCompressor() { ZSTD_freeCCtx(cctx_); }
+
+bool ZstdCompressor::Compress(const uint8_t* data, size_t size, Mode mode,
+                              std::vector<uint8_t>* out, std::string* error) {
+  Clock::time_point start = Clock::now();
+  ZSTD_EndDirective directive = mode == Mode::kEnd     ? ZSTD_e_end
+                                : mode == Mode::kFlush ? ZSTD_e_flush
+                                                       : ZSTD_e_continue;
+  ZSTD_inBuffer input = {data, size, 0};
+  const size_t step = ZSTD_CStreamOutSize();
+  while (true) {
+    size_t old_size = out->size();
+    out->resize(old_size + step);
+    ZSTD_outBuffer output = {out->data() + old_size, step, 0};
+    size_t remaining = ZSTD_compressStream2(cctx_, &output, &input, directive);
+    out->resize(old_size + output.pos);
+    if (ZSTD_isError(remaining)) {
+      *error = ZSTD_getErrorName(remaining);
+      return false;
+    }
+    bytes_out_ += output.pos;
+    window_out_ += output.pos;
+    // continue 只需吃完输入；flush 和 end 要等内部缓冲全部输出
+    if (directive == ZSTD_e_continue ? input.pos == input.size : remaining == 0) {
+      break;
+    }
+  }
+  bytes_in_ += size;
+  window_in_ += size;
+  window_busy_ += std::chrono::duration<double>(Clock::now() - start).count();
+  if (adaptive_) {
+    Adapt();
+  }
+  return true;
+}
+
+void ZstdCompressor::Adapt() {
+  double wall = std::chrono::duration<double>(Clock::now() - window_start_).count();
+  if (window_in_ < kWindowBytes || wall < kWindowSeconds) {
+    return;
+  }
+  double busy = window_busy_ / wall;
+  double ratio = window_out_ > 0 ? static_cast<double>(window_in_) / window_out_ : 1.0;
+  int next = level_;
+  if (ratio < kIncompressibleRatio) {
+    next = kMinAdaptiveLevel;
+  } else if (busy > kBusyHigh) {
+    next = level_ - 1;
+  } else if (busy < kBusyLow) {
+    next = level_ + 1;
+  }
+  next = std::clamp(next, kMinAdaptiveLevel, kMaxAdaptiveLevel);
+  if (next != level_) {
+    // 新级别从下一个压缩块开始生效，不需要结束当前帧
+    ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, next);
+    level_ = next;
+  }
+  window_start_ = Clock::now();
+  window_busy_ = 0;
+  window_in_ = 0;
+  window_out_ = 0;
+}
+
+ZstdDecompressor::ZstdDecompressor() { dctx_ = ZSTD_createDCtx(); }
+
+ZstdDecompressor::~ZstdDecompressor() { ZSTD_freeDCtx(dctx_); }
+
+bool ZstdDecompressor::Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>* out,
+                                  std::string* error) {
+  ZSTD_inBuffer input = {data, size, 0};
+  const size_t step = ZSTD_DStreamOutSize();
+  bool output_full = false;
+  // 输出缓冲被写满时解码器内部可能还有数据，需要继续调用
+  while (input.pos < input.size || output_full) {
+    size_t old_size = out->size();
+    out->resize(old_size + step);
+    ZSTD_outBuffer output = {out->data() + old_size, step, 0};
+    size_t hint = ZSTD_decompressStream(dctx_, &output, &input);
+    out->resize(old_size + output.pos);
+    if (ZSTD_isError(hint)) {
+      *error = ZSTD_getErrorName(hint);
+      return false;
+    }
+    frame_complete_ = hint == 0;
+    output_full = output.pos == output.size;
+  }
+  return true;
+}
+
+bool ZstdDecompressor::Decompress(const uint8_t* data, size_t size, const Sink& sink,
+                                  std::string* error) {
+  ZSTD_inBuffer input = {data, size, 0};
+  buffer_.resize(ZSTD_DStreamOutSize());
+  bool output_full = false;
+  while (input.pos < input.size || output_full) {
+    ZSTD_outBuffer output = {buffer_.data(), buffer_.size(), 0};
+    size_t hint = ZSTD_decompressStream(dctx_, &output, &input);
+    if (ZSTD_isError(hint)) {
+      *error = ZSTD_getErrorName(hint);
+      return false;
+    }
+    frame_complete_ = hint == 0;
+    output_full = output.pos == output.size;
+    if (output.pos > 0 && !sink(buffer_.data(), output.pos)) {
+      return false;
+    }
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+#ifndef RUNNER_ZSTD_STREAM_H_
+#define RUNNER_ZSTD_STREAM_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+// 流式 zstd 压缩。level 为 0 时自适应：统计压缩耗时占墙钟时间的比例，
+// 压缩成为瓶颈（下游一直在等）时降级，下游较慢、压缩有余量时升级；数据不可压缩时降到最快级别。
+class ZstdCompressor {
+ public:
+  enum class Mode { kContinue, kFlush, kEnd };
+
+  explicit ZstdCompressor(int level = 0);
+  ~ZstdCompressor();
+
+  ZstdCompressor(const ZstdCompressor&) = delete;
+  ZstdCompressor& operator=(const ZstdCompressor&) = delete;
+
+  // 压缩结果追加到 out。kFlush 让对端能立即解出已输入的数据，kEnd 结束当前帧
+  bool Compress(const uint8_t* data, size_t size, Mode mode, std::vector<uint8_t>* out,
+                std::string* error);
+
+  int level() const { return level_; }
+  int64_t bytes_in() const { return bytes_in_; }
+  int64_t bytes_out() const { return bytes_out_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void Adapt();
+
+  ZSTD_CCtx_s* cctx_ = nullptr;
+  bool adaptive_ = false;
+  int level_ = 3;
+  int64_t bytes_in_ = 0;
+  int64_t bytes_out_ = 0;
+
+  // 当前统计窗口
+  Clock::time_point window_start_;
+  double window_busy_ = 0;
+  int64_t window_in_ = 0;
+  int64_t window_out_ = 0;
+};
+
+class ZstdDecompressor {
+ public:
+  ZstdDecompressor();
+  ~ZstdDecompressor();
+
+  ZstdDecompressor(const ZstdDecompressor&) = delete;
+  ZstdDecompressor& operator=(const ZstdDecompressor&) = delete;
+
+  // 解出一段就交给 sink，sink 返回 false 时停止
+  using Sink = std::function<bool(const uint8_t* data, size_t size)>;
+
+  bool Decompress(const uint8_t* data, size_t size, std::vector<uint8_t>* out, std::string* error);
+  // 按解码器的输出缓冲分段交给 sink，内存占用与压缩比无关
+  bool Decompress(const uint8_t* data, size_t size, const Sink& sink, std::string* error);
+  // 最后一个帧已经完整解出
+  bool frame_complete() const { return frame_complete_; }
+
+ private:
+  ZSTD_DCtx_s* dctx_ = nullptr;
+  bool frame_complete_ = true;
+  std::vector<uint8_t> buffer_;
+};
+
+#endif  // RUNNER_ZSTD_STREAM_H_
@@ -0,0 +1,125 @@
+#include "chunk_store.h"
+
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// 固定种子的伪随机内容，块边界可以复现
+std::string RandomData(size_t size, uint64_t seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    data[i] = static_cast<char>(seed);
+  }
+  return data;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+class ChunkStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/chunk_store_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    root_ = dir;
+  }
+
+  void TearDown() override {
+    std::string command = "rm -rf '" + root_ + "'";
+    ASSERT_EQ(system(command.c_str()), 0);
+  }
+
+  std::string root_;
+};
+
+// 跨越多个读取批次的文件：各块首尾相接覆盖全文件，长度在范围内，哈希与内容一致
+TEST_F(ChunkStoreTest, ChunksCoverFileAcrossReadBatches) {
+  std::string data = RandomData(40 * 1024 * 1024 + 12345, 1);
+  std::string path = root_ + "/file";
+  std::ofstream(path, std::ios::binary) << data;
+
+  std::vector<ContentChunk> chunks;
+  std::string error;
+  ASSERT_TRUE(ChunkFileContent(path, &chunks, &error)) << error;
+  int64_t offset = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    const ContentChunk& chunk = chunks[i];
+    ASSERT_EQ(chunk.offset, offset);
+    ASSERT_LE(chunk.length, 256u * 1024);
+    if (i + 1 < chunks.size()) {
+      ASSERT_GE(chunk.length, 16u * 1024);
+    }
+    ChunkHash expected;
+    Sha256(data.data() + chunk.offset, chunk.length, expected.data());
+    ASSERT_EQ(chunk.hash, expected) << i;
+    offset += chunk.length;
+  }
+  EXPECT_EQ(offset, static_cast<int64_t>(data.size()));
+}
+
+TEST_F(ChunkStoreTest, EmptyFileHasNoChunks) {
+  std::string path = root_ + "/empty";
+  std::ofstream(path, std::ios::binary).close();
+  std::vector<ContentChunk> chunks;
+  std::string error;
+  ASSERT_TRUE(ChunkFileContent(path, &chunks, &error)) << error;
+  EXPECT_TRUE(chunks.empty());
+}
+
+// 同一目标的并发拼接各用各的临时文件，结果完整且不留临时文件
+TEST_F(ChunkStoreTest, ConcurrentAssembleToSamePath) {
+  std::string data = RandomData(2 * 1024 * 1024, 2);
+  std::string source = root_ + "/source";
+  std::ofstream(source, std::ios::binary) << data;
+
+  ChunkStore store;
+  std::string error;
+  ASSERT_TRUE(store.EnsureOpen(root_ + "/cache", 1LL << 30, &error)) << error;
+  int64_t added = 0;
+  ASSERT_TRUE(store.AddFile(source, &added, &error)) << error;
+  std::vector<ContentChunk> chunks;
+  ASSERT_TRUE(ChunkFileContent(source, &chunks, &error)) << error;
+  std::vector<ChunkHash> hashes;
+  for (const ContentChunk& chunk : chunks) {
+    hashes.push_back(chunk.hash);
+  }
+
+  std::string target = root_ + "/target";
+  std::vector<std::thread> threads;
+  std::vector<int> ok(4, 0);
+  for (size_t i = 0; i < ok.size(); i++) {
+    threads.emplace_back([&, i]() {
+      std::vector<int64_t> missing;
+      int64_t bytes = 0;
+      std::string thread_error;
+      ok[i] = store.Assemble(target, hashes, &missing, &bytes, &thread_error);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int result : ok) {
+    EXPECT_TRUE(result);
+  }
+  EXPECT_EQ(ReadFile(target), data);
+  EXPECT_GT(store.hits(), 0);
+  std::string leftovers = "ls '" + root_ + "' | grep -q rccache";
+  EXPECT_NE(system(leftovers.c_str()), 0);
+}
+
+}  // namespace
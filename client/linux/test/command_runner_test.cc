@@ -0,0 +1,121 @@
+#include "command_runner.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <future>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int kParallelCommands = 8;
+// 卡住的命令靠这个超时结束，测试据此判断是否死锁
+const int kCommandTimeoutMs = 30000;
+
+// stdout 和 stderr 同时各写 bytes 字节，远超管道容量
+std::string FloodCommand(size_t bytes) {
+  std::string count = std::to_string(bytes);
+  return "head -c " + count + " /dev/zero | tr '\\0' o & head -c " + count +
+         " /dev/zero | tr '\\0' e >&2; wait";
+}
+
+CommandResult RunShell(const std::string& command, size_t max_output) {
+  CommandOptions options;
+  options.command = command;
+  options.timeout_ms = kCommandTimeoutMs;
+  options.max_output = max_output;
+  CommandResult result;
+  std::string error;
+  EXPECT_TRUE(RunCommand(options, &result, &error)) << error;
+  return result;
+}
+
+// 分段必须与两路输出一致：相邻段来自不同的流，时间不倒退，按流拼起来就是完整输出
+void ExpectConsistentSegments(const CommandResult& result) {
+  std::string out;
+  std::string err;
+  for (size_t i = 0; i < result.segments.size(); i++) {
+    const CommandSegment& segment = result.segments[i];
+    EXPECT_FALSE(segment.text.empty());
+    if (i > 0) {
+      EXPECT_NE(segment.is_stderr, result.segments[i - 1].is_stderr);
+      EXPECT_GE(segment.time_ms, result.segments[i - 1].time_ms);
+    }
+    (segment.is_stderr ? err : out) += segment.text;
+  }
+  EXPECT_EQ(out, result.stdout_text);
+  EXPECT_EQ(err, result.stderr_text);
+}
+
+// 多条命令并发运行，全部在超时前正常结束即没有死锁
+std::vector<CommandResult> RunParallel(const std::string& command, size_t max_output) {
+  std::vector<std::future<CommandResult>> futures;
+  for (int i = 0; i < kParallelCommands; i++) {
+    futures.push_back(std::async(std::launch::async, RunShell, command, max_output));
+  }
+  std::vector<CommandResult> results;
+  for (auto& future : futures) {
+    EXPECT_EQ(future.wait_for(std::chrono::milliseconds(kCommandTimeoutMs * 2)),
+              std::future_status::ready);
+    results.push_back(future.get());
+  }
+  return results;
+}
+
+}  // namespace
+
+TEST(CommandRunnerTest, ParallelFloodsCompleteWithoutTruncation) {
+  const size_t bytes = 4 * 1024 * 1024;
+  for (const CommandResult& result : RunParallel(FloodCommand(bytes), bytes)) {
+    EXPECT_FALSE(result.timed_out);
+    EXPECT_FALSE(result.truncated);
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.stdout_text, std::string(bytes, 'o'));
+    EXPECT_EQ(result.stderr_text, std::string(bytes, 'e'));
+    ExpectConsistentSegments(result);
+  }
+}
+
+TEST(CommandRunnerTest, ParallelFloodsTruncateBothStreams) {
+  const size_t bytes = 8 * 1024 * 1024;
+  const size_t max_output = 256 * 1024;
+  for (const CommandResult& result : RunParallel(FloodCommand(bytes), max_output)) {
+    // 超出上限的部分也要读完，子进程才能正常退出
+    EXPECT_FALSE(result.timed_out);
+    EXPECT_TRUE(result.truncated);
+    EXPECT_EQ(result.exit_code, 0);
+    EXPECT_EQ(result.stdout_text, std::string(max_output, 'o'));
+    EXPECT_EQ(result.stderr_text, std::string(max_output, 'e'));
+    ExpectConsistentSegments(result);
+  }
+}
+
+TEST(CommandRunnerTest, OnlyOverflowingStreamMarksTruncation) {
+  const size_t max_output = 64 * 1024;
+  CommandResult result = RunShell("head -c 1048576 /dev/zero | tr '\\0' o; echo done >&2", max_output);
+  EXPECT_TRUE(result.truncated);
+  EXPECT_EQ(result.stdout_text.size(), max_output);
+  EXPECT_EQ(result.stderr_text, "done\n");
+  ExpectConsistentSegments(result);
+
+  result = RunShell("echo out; echo err >&2", max_output);
+  EXPECT_FALSE(result.truncated);
+}
+
+TEST(CommandRunnerTest, SegmentsFollowArrivalOrder) {
+  const int lines = 20;
+  CommandResult result = RunShell(
+      "i=0; while [ $i -lt 20 ]; do echo out$i; sleep 0.02; echo err$i >&2; sleep 0.02; "
+      "i=$((i + 1)); done",
+      1024);
+  EXPECT_EQ(result.exit_code, 0);
+  ASSERT_EQ(result.segments.size(), static_cast<size_t>(lines * 2));
+  for (int i = 0; i < lines; i++) {
+    EXPECT_FALSE(result.segments[i * 2].is_stderr);
+    EXPECT_EQ(result.segments[i * 2].text, "out" + std::to_string(i) + "\n");
+    EXPECT_TRUE(result.segments[i * 2 + 1].is_stderr);
+    EXPECT_EQ(result.segments[i * 2 + 1].text, "err" + std::to_string(i) + "\n");
+  }
+  ExpectConsistentSegments(result);
+}
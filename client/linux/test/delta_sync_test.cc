@@ -0,0 +1,159 @@
+#include "delta_sync.h"
+
+#include <dirent.h>
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "transfer_engine.h"
+
+namespace {
+
+// 固定种子的伪随机内容
+std::string RandomData(size_t size, uint64_t seed) {
+  std::string data(size, '\0');
+  for (size_t i = 0; i < size; i++) {
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    data[i] = static_cast<char>(seed);
+  }
+  return data;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+class DeltaSyncTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/delta_sync_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    root_ = dir;
+  }
+
+  void TearDown() override {
+    std::string command = "rm -rf '" + root_ + "'";
+    ASSERT_EQ(system(command.c_str()), 0);
+  }
+
+  // 用 source 的内容更新 target，返回统计
+  DeltaStats Sync(const std::string& source, const std::string& target) {
+    std::vector<uint8_t> signature;
+    std::vector<uint8_t> delta;
+    DeltaStats stats;
+    std::string error;
+    EXPECT_TRUE(ComputeSignature(target, 0, &signature, &error)) << error;
+    EXPECT_TRUE(ComputeDelta(source, signature, &delta, &stats, &error)) << error;
+    EXPECT_TRUE(ApplyDelta(target, delta, &error)) << error;
+    return stats;
+  }
+
+  // 目录里除 names 外没有别的文件（临时文件已清理）
+  void ExpectOnlyFiles(const std::vector<std::string>& names) {
+    DIR* dir = opendir(root_.c_str());
+    ASSERT_NE(dir, nullptr);
+    size_t count = 0;
+    while (dirent* entry = readdir(dir)) {
+      if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0) {
+        EXPECT_NE(std::find(names.begin(), names.end(), entry->d_name), names.end()) << entry->d_name;
+        count++;
+      }
+    }
+    closedir(dir);
+    EXPECT_EQ(count, names.size());
+  }
+
+  std::string root_;
+};
+
+}  // namespace
+
+TEST(Xxh64StreamTest, MatchesOneShotHash) {
+  std::string data = RandomData(1000, 7);
+  for (size_t size : {0, 1, 31, 32, 33, 100, 1000}) {
+    for (size_t step : {1, 5, 32, 77}) {
+      Xxh64Stream stream(3);
+      for (size_t offset = 0; offset < size; offset += step) {
+        stream.Update(data.data() + offset, std::min(step, size - offset));
+      }
+      EXPECT_EQ(stream.Digest(), XXH64(data.data(), size, 3)) << size << " " << step;
+    }
+  }
+}
+
+// 大文件跨越多个读取批次：中间插入和修改后，重建结果与源文件一致，未改动的块都被复制
+TEST_F(DeltaSyncTest, ReconstructsAcrossReadBatches) {
+  std::string old_data = RandomData(12 * 1024 * 1024 + 333, 1);
+  std::string new_data = old_data;
+  new_data.insert(5 * 1024 * 1024 + 17, RandomData(9000, 2));
+  new_data.replace(10 * 1024 * 1024, 4096, RandomData(4096, 3));
+  std::string source = root_ + "/source";
+  std::string target = root_ + "/target";
+  std::ofstream(source, std::ios::binary) << new_data;
+  std::ofstream(target, std::ios::binary) << old_data;
+
+  DeltaStats stats = Sync(source, target);
+  EXPECT_EQ(ReadFile(target), new_data);
+  EXPECT_EQ(stats.copied_bytes + stats.literal_bytes, static_cast<int64_t>(new_data.size()));
+  EXPECT_LT(stats.literal_bytes, 64 * 1024);
+  ExpectOnlyFiles({"source", "target"});
+}
+
+// 完全不同的内容超过字面数据的缓冲上限，分成多条字面指令
+TEST_F(DeltaSyncTest, LongLiteralRuns) {
+  std::string new_data = RandomData(9 * 1024 * 1024 + 5, 4);
+  std::string source = root_ + "/source";
+  std::string target = root_ + "/target";
+  std::ofstream(source, std::ios::binary) << new_data;
+  std::ofstream(target, std::ios::binary) << RandomData(3 * 1024 * 1024, 5);
+
+  DeltaStats stats = Sync(source, target);
+  EXPECT_EQ(ReadFile(target), new_data);
+  EXPECT_EQ(stats.literal_bytes, static_cast<int64_t>(new_data.size()));
+}
+
+TEST_F(DeltaSyncTest, MissingAndEmptyFiles) {
+  std::string source = root_ + "/source";
+  std::string target = root_ + "/target";
+  std::ofstream(source, std::ios::binary) << "hello";
+  Sync(source, target);
+  EXPECT_EQ(ReadFile(target), "hello");
+
+  std::ofstream(source, std::ios::binary | std::ios::trunc).close();
+  Sync(source, target);
+  EXPECT_EQ(ReadFile(target), "");
+  ExpectOnlyFiles({"source", "target"});
+}
+
+// 复制指令的块号和块数超出现有文件（包括乘法会溢出的取值）时拒绝，目标文件不变
+TEST_F(DeltaSyncTest, RejectsCopiesBeyondBasis) {
+  std::string target = root_ + "/target";
+  std::string old_data = RandomData(8192, 6);
+  std::ofstream(target, std::ios::binary) << old_data;
+
+  const uint32_t copies[][2] = {{0, 3}, {2, 1}, {3, 0}, {1, 0xffffffff}, {0xffffffff, 2}};
+  for (const auto& copy : copies) {
+    std::vector<uint8_t> delta = {'R', 'C', 'D', 'D', 1, 0, 0, 0, 0, 0x10, 0, 0};
+    delta.resize(32);
+    delta.push_back(0x01);
+    for (uint32_t value : copy) {
+      const uint8_t* p = reinterpret_cast<const uint8_t*>(&value);
+      delta.insert(delta.end(), p, p + 4);
+    }
+    std::string error;
+    EXPECT_FALSE(ApplyDelta(target, delta, &error)) << copy[0] << " " << copy[1];
+    EXPECT_EQ(ReadFile(target), old_data);
+  }
+  ExpectOnlyFiles({"target"});
+}
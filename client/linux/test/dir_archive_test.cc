@@ -0,0 +1,255 @@
+#include "dir_archive.h"
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "zstd_stream.h"
+
+namespace {
+
+// 手工构造 ustar 条目，模拟恶意或损坏的对端
+void AppendEntry(std::string* tar, const std::string& name, char type, const std::string& data,
+                 const std::string& link = "", unsigned int mode = 0644) {
+  char header[512] = {0};
+  snprintf(header, 100, "%s", name.c_str());
+  snprintf(header + 100, 8, "%07o", mode);
+  snprintf(header + 108, 8, "%07o", 0);
+  snprintf(header + 116, 8, "%07o", 0);
+  snprintf(header + 124, 12, "%011llo", static_cast<unsigned long long>(data.size()));
+  snprintf(header + 136, 12, "%011o", 0);
+  header[156] = type;
+  snprintf(header + 157, 100, "%s", link.c_str());
+  memcpy(header + 257, "ustar", 6);
+  memcpy(header + 263, "00", 2);
+  memset(header + 148, ' ', 8);
+  unsigned int sum = 0;
+  for (unsigned char c : header) {
+    sum += c;
+  }
+  snprintf(header + 148, 8, "%06o", sum);
+  tar->append(header, sizeof(header));
+  tar->append(data);
+  tar->append((512 - data.size() % 512) % 512, '\0');
+}
+
+std::vector<uint8_t> Compress(std::string tar) {
+  tar.append(1024, '\0');
+  ZstdCompressor compressor(3);
+  std::vector<uint8_t> out;
+  std::string error;
+  compressor.Compress(reinterpret_cast<const uint8_t*>(tar.data()), tar.size(),
+                      ZstdCompressor::Mode::kEnd, &out, &error);
+  return out;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream in(path, std::ios::binary);
+  std::stringstream ss;
+  ss << in.rdbuf();
+  return ss.str();
+}
+
+bool Exists(const std::string& path) {
+  struct stat st;
+  return lstat(path.c_str(), &st) == 0;
+}
+
+class DirArchiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/dir_archive_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    root_ = dir;
+    destination_ = root_ + "/dest";
+    outside_ = root_ + "/outside";
+    ASSERT_EQ(mkdir(outside_.c_str(), 0755), 0);
+  }
+
+  void TearDown() override {
+    std::string command = "rm -rf '" + root_ + "'";
+    ASSERT_EQ(system(command.c_str()), 0);
+  }
+
+  // 返回解出是否成功，error 记录失败原因
+  bool Extract(const std::string& tar, std::string* error) {
+    DirArchiveExtractor extractor;
+    if (!extractor.Open(destination_, error)) {
+      return false;
+    }
+    std::vector<uint8_t> data = Compress(tar);
+    return extractor.Write(data.data(), data.size(), error) && extractor.Finish(error);
+  }
+
+  std::string root_;
+  std::string destination_;
+  std::string outside_;
+};
+
+TEST_F(DirArchiveTest, RoundTrip) {
+  std::string source = root_ + "/src";
+  ASSERT_EQ(mkdir(source.c_str(), 0755), 0);
+  ASSERT_EQ(mkdir((source + "/sub").c_str(), 0755), 0);
+  std::ofstream(source + "/a.txt") << "hello";
+  std::ofstream(source + "/sub/b.bin") << std::string(300000, 'x');
+  ASSERT_EQ(symlink("../a.txt", (source + "/sub/link").c_str()), 0);
+
+  DirArchiveReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.Start(source, 3, &error)) << error;
+  DirArchiveExtractor extractor;
+  ASSERT_TRUE(extractor.Open(destination_, &error)) << error;
+  for (;;) {
+    std::vector<uint8_t> block;
+    ASSERT_TRUE(reader.Next(&block, &error)) << error;
+    if (block.empty()) {
+      break;
+    }
+    ASSERT_TRUE(extractor.Write(block.data(), block.size(), &error)) << error;
+  }
+  ASSERT_TRUE(extractor.Finish(&error)) << error;
+
+  EXPECT_EQ(ReadFile(destination_ + "/src/a.txt"), "hello");
+  EXPECT_EQ(ReadFile(destination_ + "/src/sub/b.bin"), std::string(300000, 'x'));
+  EXPECT_EQ(ReadFile(destination_ + "/src/sub/link"), "hello");
+}
+
+TEST_F(DirArchiveTest, RejectsAbsoluteSymlinkThenWriteThrough) {
+  std::string tar;
+  AppendEntry(&tar, "a", '2', "", outside_);
+  AppendEntry(&tar, "a/passwd", '0', "owned");
+  std::string error;
+  EXPECT_FALSE(Extract(tar, &error));
+  EXPECT_NE(error.find("unsafe link"), std::string::npos) << error;
+  EXPECT_FALSE(Exists(outside_ + "/passwd"));
+}
+
+TEST_F(DirArchiveTest, RejectsEscapingRelativeSymlink) {
+  std::string tar;
+  AppendEntry(&tar, "d/", '5', "");
+  AppendEntry(&tar, "d/a", '2', "", "../../outside");
+  AppendEntry(&tar, "d/a/passwd", '0', "owned");
+  std::string error;
+  EXPECT_FALSE(Extract(tar, &error));
+  EXPECT_FALSE(Exists(outside_ + "/passwd"));
+  EXPECT_FALSE(Exists(destination_ + "/d/a"));
+}
+
+TEST_F(DirArchiveTest, AllowsSymlinkInsideDestination) {
+  std::string tar;
+  AppendEntry(&tar, "f", '0', "data");
+  AppendEntry(&tar, "d/l", '2', "", "../f");
+  std::string error;
+  ASSERT_TRUE(Extract(tar, &error)) << error;
+  EXPECT_EQ(ReadFile(destination_ + "/d/l"), "data");
+}
+
+TEST_F(DirArchiveTest, RejectsChainedSymlinkEscape) {
+  // d/x 指回解压目录本身，d/y 经过 x 再向上一级就到了外面
+  std::string tar;
+  AppendEntry(&tar, "d/", '5', "");
+  AppendEntry(&tar, "d/x", '2', "", "..");
+  AppendEntry(&tar, "d/y", '2', "", "x/../outside");
+  AppendEntry(&tar, "d/y/passwd", '0', "owned");
+  std::string error;
+  EXPECT_FALSE(Extract(tar, &error));
+  EXPECT_NE(error.find("unsafe link"), std::string::npos) << error;
+  EXPECT_FALSE(Exists(destination_ + "/d/y"));
+  EXPECT_FALSE(Exists(outside_ + "/passwd"));
+}
+
+TEST_F(DirArchiveTest, DropsSpecialModeBits) {
+  std::string tar;
+  AppendEntry(&tar, "d/", '5', "", "", 01777);
+  AppendEntry(&tar, "d/tool", '0', "data", "", 06755);
+  std::string error;
+  ASSERT_TRUE(Extract(tar, &error)) << error;
+  struct stat st;
+  ASSERT_EQ(stat((destination_ + "/d/tool").c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 07000, 0u);
+  ASSERT_EQ(stat((destination_ + "/d").c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 07000, 0u);
+}
+
+TEST_F(DirArchiveTest, RejectsOversizedPaxHeader) {
+  std::string tar;
+  AppendEntry(&tar, "pax", 'x', std::string(2 * 1024 * 1024, 'a'));
+  AppendEntry(&tar, "f", '0', "data");
+  std::string error;
+  EXPECT_FALSE(Extract(tar, &error));
+  EXPECT_EQ(error, "pax header too large");
+}
+
+TEST_F(DirArchiveTest, ExtractsHighlyCompressibleData) {
+  // 几十 MB 的零压缩后只有几 KB，一次 Write 交入，解出的数据分段写盘
+  std::string tar;
+  AppendEntry(&tar, "zeros", '0', std::string(48 * 1024 * 1024, '\0'));
+  std::string error;
+  ASSERT_TRUE(Extract(tar, &error)) << error;
+  struct stat st;
+  ASSERT_EQ(stat((destination_ + "/zeros").c_str(), &st), 0);
+  EXPECT_EQ(st.st_size, 48 * 1024 * 1024);
+}
+
+TEST_F(DirArchiveTest, DoesNotFollowSymlinksAlreadyInDestination) {
+  // 目标目录里原本就有指向外面的链接，归档条目不能借道写出去
+  ASSERT_EQ(mkdir(destination_.c_str(), 0755), 0);
+  ASSERT_EQ(symlink(outside_.c_str(), (destination_ + "/dir").c_str()), 0);
+  std::ofstream(outside_ + "/file") << "keep";
+  ASSERT_EQ(symlink((outside_ + "/file").c_str(), (destination_ + "/file").c_str()), 0);
+
+  std::string tar;
+  AppendEntry(&tar, "dir/passwd", '0', "owned");
+  std::string error;
+  EXPECT_FALSE(Extract(tar, &error));
+  EXPECT_FALSE(Exists(outside_ + "/passwd"));
+
+  // 同名的链接被替换成普通文件，原来指向的文件不受影响
+  tar.clear();
+  AppendEntry(&tar, "file", '0', "new");
+  ASSERT_TRUE(Extract(tar, &error)) << error;
+  EXPECT_EQ(ReadFile(outside_ + "/file"), "keep");
+  EXPECT_EQ(ReadFile(destination_ + "/file"), "new");
+  struct stat st;
+  ASSERT_EQ(lstat((destination_ + "/file").c_str(), &st), 0);
+  EXPECT_TRUE(S_ISREG(st.st_mode));
+}
+
+TEST_F(DirArchiveTest, RejectsMalformedPaxHeaders) {
+  const char* records[] = {
+      "abc 1\n",
+      "3 \n",
+      "99 path=x\n",
+      "99999999999999999999999 path=x\n",
+      "32 size=99999999999999999999999\n",
+      "12 size=12x\n",
+      "8 nokey\n",
+  };
+  for (const char* record : records) {
+    std::string tar;
+    AppendEntry(&tar, "pax", 'x', record);
+    AppendEntry(&tar, "f", '0', "data");
+    std::string error;
+    EXPECT_FALSE(Extract(tar, &error)) << record;
+    EXPECT_EQ(error, "malformed pax header") << record;
+  }
+}
+
+TEST_F(DirArchiveTest, AppliesPaxPath) {
+  std::string tar;
+  std::string long_name(150, 'n');
+  AppendEntry(&tar, "pax", 'x', "160 path=" + long_name + "\n");
+  AppendEntry(&tar, "short", '0', "data");
+  std::string error;
+  ASSERT_TRUE(Extract(tar, &error)) << error;
+  EXPECT_EQ(ReadFile(destination_ + "/" + long_name), "data");
+}
+
+}  // namespace
@@ -0,0 +1,97 @@
+#include "file_index.h"
+
+#include <gtest/gtest.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace {
+
+// 条件在 5 秒内成立时返回 true
+bool WaitFor(const std::function<bool()>& condition) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (std::chrono::steady_clock::now() < deadline) {
+    if (condition()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return condition();
+}
+
+class FileIndexTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    char dir[] = "/tmp/file_index_test.XXXXXX";
+    ASSERT_NE(mkdtemp(dir), nullptr);
+    root_ = dir;
+  }
+
+  void TearDown() override {
+    std::string command = "rm -rf '" + root_ + "'";
+    ASSERT_EQ(system(command.c_str()), 0);
+  }
+
+  void Touch(const std::string& name) { std::ofstream(root_ + "/" + name) << "x"; }
+
+  bool Indexed(const std::string& name) {
+    FileIndex::SearchOptions options;
+    options.mode = FileIndex::MatchMode::kPrefix;
+    options.case_sensitive = true;
+    return index_.Search(name, options).total > 0;
+  }
+
+  void AddRootAndWait() {
+    std::string error;
+    ASSERT_TRUE(index_.AddRoot(root_, &error)) << error;
+    ASSERT_TRUE(WaitFor([this]() { return !index_.GetStatus().building; }));
+  }
+
+  std::string root_;
+  FileIndex index_;
+};
+
+TEST_F(FileIndexTest, IndexesAndTracksChanges) {
+  ASSERT_EQ(mkdir((root_ + "/sub").c_str(), 0755), 0);
+  Touch("sub/first.txt");
+  AddRootAndWait();
+  EXPECT_TRUE(Indexed("first.txt"));
+
+  Touch("sub/second.txt");
+  EXPECT_TRUE(WaitFor([this]() { return Indexed("second.txt"); }));
+  ASSERT_EQ(unlink((root_ + "/sub/first.txt").c_str()), 0);
+  EXPECT_TRUE(WaitFor([this]() { return !Indexed("first.txt"); }));
+}
+
+// Clear 只中止遍历，之后重新加入的根仍由监视线程保持更新
+TEST_F(FileIndexTest, KeepsWatchingAfterClear) {
+  Touch("before.txt");
+  AddRootAndWait();
+  index_.Clear();
+  EXPECT_FALSE(Indexed("before.txt"));
+
+  AddRootAndWait();
+  EXPECT_TRUE(Indexed("before.txt"));
+  Touch("after.txt");
+  EXPECT_TRUE(WaitFor([this]() { return Indexed("after.txt"); }));
+}
+
+// 重新加入已有的根时与磁盘核对，包括已经遍历过的子目录
+TEST_F(FileIndexTest, ReaddingRootReconcilesSubdirectories) {
+  ASSERT_EQ(mkdir((root_ + "/sub").c_str(), 0755), 0);
+  Touch("sub/kept.txt");
+  AddRootAndWait();
+  Touch("sub/added.txt");
+  AddRootAndWait();
+  EXPECT_TRUE(WaitFor([this]() { return Indexed("added.txt"); }));
+  EXPECT_TRUE(Indexed("kept.txt"));
+  EXPECT_EQ(index_.GetStatus().roots.size(), 1u);
+}
+
+}  // namespace
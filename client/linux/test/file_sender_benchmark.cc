@@ -0,0 +1,152 @@
+// 下载路径基准：同一文件分别用 sendfile（零拷贝）、read/write 缓冲和
+// 整体读入内存（downloadFile 的方式）写到本地 Unix 套接字，接收端只计数和校验。
+// 文件大小从 1 MB 起每次乘 4，直到 --max-mb。文件先读一遍进页缓存，测的是内存拷贝而非磁盘。
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "file_sender.h"
+
+namespace {
+
+struct SinkResult {
+  int64_t bytes = 0;
+  uint64_t sum = 0;
+};
+
+// 接收端：读到对端关闭为止
+void Drain(int fd, SinkResult* result) {
+  std::vector<uint8_t> buffer(1 << 20);
+  for (;;) {
+    ssize_t n = read(fd, buffer.data(), buffer.size());
+    if (n <= 0) {
+      break;
+    }
+    // 按流内偏移取每 4096 字节的第一个字节，与每次读到多少无关
+    for (int64_t i = (4096 - result->bytes % 4096) % 4096; i < n; i += 4096) {
+      result->sum += buffer[i];
+    }
+    result->bytes += n;
+  }
+}
+
+bool WriteAll(int fd, const uint8_t* data, size_t size) {
+  while (size > 0) {
+    ssize_t n = write(fd, data, size);
+    if (n < 0) {
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
+enum class Mode { kSendfile, kBuffered, kWhole };
+
+// 返回 MB/s，失败时返回负数
+double Run(const std::string& path, int64_t size, Mode mode) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) {
+    return -1;
+  }
+  SinkResult sink;
+  std::thread reader(Drain, fds[1], &sink);
+
+  auto start = std::chrono::steady_clock::now();
+  bool ok;
+  std::string error;
+  if (mode == Mode::kWhole) {
+    std::vector<uint8_t> data;
+    ok = ReadWholeFile(path, &data) && WriteAll(fds[0], data.data(), data.size());
+  } else {
+    FileSendStats stats;
+    ok = SendFileToSocket(path, fds[0], 0, -1, mode == Mode::kBuffered, &stats, &error);
+  }
+  shutdown(fds[0], SHUT_WR);
+  reader.join();
+  double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  close(fds[0]);
+  close(fds[1]);
+
+  // 文件每 4096 字节的第一个字节是块号的低 8 位
+  uint64_t expected = 0;
+  for (int64_t i = 0; i < size; i += 4096) {
+    expected += static_cast<uint8_t>(i / 4096);
+  }
+  if (!ok || sink.bytes != size || sink.sum != expected) {
+    fprintf(stderr, "mode %d failed: %s (%lld bytes)\n", static_cast<int>(mode), error.c_str(),
+            static_cast<long long>(sink.bytes));
+    return -1;
+  }
+  return size / (1024.0 * 1024.0) / seconds;
+}
+
+bool CreateFile(const std::string& path, int64_t size) {
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+  if (fd < 0) {
+    return false;
+  }
+  std::vector<uint8_t> block(1 << 20);
+  bool ok = true;
+  for (int64_t written = 0; ok && written < size; written += block.size()) {
+    for (size_t i = 0; i < block.size(); i += 4096) {
+      block[i] = static_cast<uint8_t>((written + i) / 4096);
+    }
+    ok = WriteAll(fd, block.data(), block.size());
+  }
+  close(fd);
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int64_t max_mb = 1024;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (strcmp(argv[i], "--max-mb") == 0) {
+      max_mb = atoll(argv[i + 1]);
+    }
+  }
+
+  char dir[] = "/tmp/file_sender_benchmark.XXXXXX";
+  if (!mkdtemp(dir)) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string path = std::string(dir) + "/data";
+  const Mode modes[] = {Mode::kSendfile, Mode::kBuffered, Mode::kWhole};
+
+  printf("%8s %12s %12s %12s\n", "size MB", "sendfile", "buffered", "read+copy");
+  bool failed = false;
+  for (int64_t mb = 1; mb <= max_mb && !failed; mb *= 4) {
+    int64_t size = mb * 1024 * 1024;
+    if (!CreateFile(path, size)) {
+      perror("create");
+      failed = true;
+      break;
+    }
+    // 预热页缓存
+    Run(path, size, Mode::kBuffered);
+    printf("%8lld", static_cast<long long>(mb));
+    for (Mode mode : modes) {
+      double rate = Run(path, size, mode);
+      failed = failed || rate < 0;
+      printf(" %7.0f MB/s", rate);
+    }
+    printf("\n");
+  }
+  unlink(path.c_str());
+  rmdir(dir);
+  return failed ? 1 : 0;
+}
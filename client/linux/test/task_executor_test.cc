@@ -0,0 +1,80 @@
+#include "task_executor.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const int kQueues = 4;
+const int kTasksPerQueue = 200;
+
+// 多个队列同时提交：每个队列内按提交顺序执行且不重叠，队列之间可以并发
+TEST(SerialTaskQueueTest, RunsEachQueueInOrderWithoutOverlap) {
+  std::vector<std::shared_ptr<SerialTaskQueue>> queues;
+  std::vector<std::vector<int>> order(kQueues);
+  std::vector<std::atomic<int>> running(kQueues);
+  std::atomic<bool> overlapped{false};
+  std::promise<void> done;
+  std::atomic<int> remaining{kQueues * kTasksPerQueue};
+  for (int q = 0; q < kQueues; q++) {
+    queues.push_back(SerialTaskQueue::Create(TaskPriority::kFile));
+  }
+
+  std::vector<std::thread> submitters;
+  for (int q = 0; q < kQueues; q++) {
+    submitters.emplace_back([&, q]() {
+      for (int i = 0; i < kTasksPerQueue; i++) {
+        queues[q]->Submit([&, q, i]() {
+          if (running[q].fetch_add(1) != 0) {
+            overlapped = true;
+          }
+          // 同一队列的任务不并发，这里不需要加锁
+          order[q].push_back(i);
+          if (i % 16 == 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+          }
+          running[q].fetch_sub(1);
+          if (remaining.fetch_sub(1) == 1) {
+            done.set_value();
+          }
+        });
+      }
+    });
+  }
+  for (auto& thread : submitters) {
+    thread.join();
+  }
+  ASSERT_EQ(done.get_future().wait_for(std::chrono::seconds(30)), std::future_status::ready);
+
+  EXPECT_FALSE(overlapped);
+  for (int q = 0; q < kQueues; q++) {
+    ASSERT_EQ(order[q].size(), static_cast<size_t>(kTasksPerQueue));
+    for (int i = 0; i < kTasksPerQueue; i++) {
+      EXPECT_EQ(order[q][i], i);
+    }
+  }
+}
+
+// 调用方释放队列后，已排队的任务仍然执行完
+TEST(SerialTaskQueueTest, PendingTasksOutliveCaller) {
+  std::promise<int> done;
+  {
+    auto queue = SerialTaskQueue::Create(TaskPriority::kFile);
+    auto count = std::make_shared<int>(0);
+    for (int i = 0; i < 10; i++) {
+      queue->Submit([count]() { (*count)++; });
+    }
+    queue->Submit([count, &done]() { done.set_value(*count); });
+  }
+  std::future<int> result = done.get_future();
+  ASSERT_EQ(result.wait_for(std::chrono::seconds(30)), std::future_status::ready);
+  EXPECT_EQ(result.get(), 10);
+}
+
+}  // namespace
@@ -0,0 +1,55 @@
+#include "terminal_screen.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+namespace {
+
+void Feed(TerminalScreen* screen, const std::vector<uint8_t>& data) {
+  screen->Feed(data.data(), data.size());
+}
+
+// 整屏差异中第 row 行的文本，去掉行尾空格
+std::string RowText(const ScreenUpdate& update, int row) {
+  std::string text;
+  for (const ScreenSpan& span : update.spans) {
+    if (span.row == row) {
+      text += span.text;
+    }
+  }
+  return text.substr(0, text.find_last_not_of(' ') + 1);
+}
+
+const std::string kReplacement = "\xEF\xBF\xBD";
+
+TEST(TerminalScreenTest, ReplacesInvalidUtf8) {
+  TerminalScreen screen(40, 4);
+  // F7 开头的序列超出 0x10FFFF，ED A0 80 为代理项，C0 80 为过长编码，单独的续字节各自替换
+  Feed(&screen, {0xF7, 0xBF, 0xBF, 0xBF, 0xED, 0xA0, 0x80, 0x41, 0xC0, 0x80, 0x42});
+  EXPECT_EQ(RowText(screen.Diff(), 0), kReplacement + kReplacement + kReplacement + kReplacement +
+                                           kReplacement + "A" + kReplacement + "B");
+}
+
+TEST(TerminalScreenTest, KeepsValidUtf8) {
+  TerminalScreen screen(40, 4);
+  std::string text = "a\xC3\xA9\xE4\xB8\xAD\xF0\x9F\x98\x80\xF4\x8F\xBF\xBF";
+  Feed(&screen, std::vector<uint8_t>(text.begin(), text.end()));
+  std::string row = RowText(screen.Diff(), 0);
+  // 宽字符后面的占位列不输出字符
+  EXPECT_NE(row.find("a\xC3\xA9\xE4\xB8\xAD"), std::string::npos);
+  EXPECT_NE(row.find("\xF0\x9F\x98\x80"), std::string::npos);
+  EXPECT_NE(row.find("\xF4\x8F\xBF\xBF"), std::string::npos);
+  EXPECT_EQ(row.find(kReplacement), std::string::npos);
+}
+
+TEST(TerminalScreenTest, SanitizesTitle) {
+  TerminalScreen screen(40, 4);
+  Feed(&screen, {0x1B, ']', '0', ';', 0xFF, 0xFE, 'x', 0xE4, 0xB8, 0x07});
+  ScreenUpdate update = screen.Diff();
+  ASSERT_TRUE(update.title_changed);
+  EXPECT_EQ(update.title, kReplacement + kReplacement + "x" + kReplacement);
+}
+
+}  // namespace
@@ -0,0 +1,243 @@
+#include "wire_protocol.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+WireHeader TestHeader() {
+  WireHeader header;
+  header.flags = 0x5a;
+  header.session = 7;
+  header.sequence = 0xfffffffe;
+  header.timestamp_us = 1700000000123456ULL;
+  return header;
+}
+
+// 解码一条完整消息并按解出的值重新编码。payload 里的指针必须落在 data 内
+bool DecodeAndReencode(const uint8_t* data, size_t size, std::vector<uint8_t>* out) {
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  if (!DecodeWireHeader(data, size, &header, &payload, &error)) {
+    EXPECT_FALSE(error.empty());
+    return false;
+  }
+  EXPECT_EQ(payload, data + kWireHeaderBytes);
+  EXPECT_EQ(header.payload_length, size - kWireHeaderBytes);
+  const uint8_t* end = data + size;
+  switch (header.type) {
+    case WireType::kScreenFrame: {
+      WireScreenFrame frame;
+      if (!DecodeWireScreenFrame(payload, header.payload_length, &frame, &error)) {
+        return false;
+      }
+      EXPECT_TRUE(frame.data >= payload && frame.data + frame.size == end);
+      return EncodeWireScreenFrame(header, frame, out);
+    }
+    case WireType::kInputMouse: {
+      WireMouseInput mouse;
+      if (!DecodeWireMouseInput(payload, header.payload_length, &mouse, &error)) {
+        return false;
+      }
+      return EncodeWireMouseInput(header, mouse, out);
+    }
+    case WireType::kInputKeyboard: {
+      WireKeyInput key;
+      if (!DecodeWireKeyInput(payload, header.payload_length, &key, &error)) {
+        return false;
+      }
+      return EncodeWireKeyInput(header, key, out);
+    }
+    case WireType::kFileChunk: {
+      WireFileChunk chunk;
+      if (!DecodeWireFileChunk(payload, header.payload_length, &chunk, &error)) {
+        return false;
+      }
+      EXPECT_TRUE(chunk.data >= payload && chunk.data + chunk.size == end);
+      return EncodeWireFileChunk(header, chunk, out);
+    }
+  }
+  ADD_FAILURE() << "decoded unknown type " << static_cast<int>(header.type);
+  return false;
+}
+
+// 放进恰好等长的堆缓冲区再解码，越界读取能被 AddressSanitizer 发现
+bool DecodeExact(const std::vector<uint8_t>& message, size_t size, std::vector<uint8_t>* out) {
+  std::unique_ptr<uint8_t[]> copy(new uint8_t[size > 0 ? size : 1]);
+  memcpy(copy.get(), message.data(), size);
+  return DecodeAndReencode(copy.get(), size, out);
+}
+
+std::vector<std::vector<uint8_t>> SampleMessages() {
+  std::vector<std::vector<uint8_t>> messages(4);
+  const uint8_t image[] = {0xff, 0xd8, 0x00, 0x01, 0xff, 0xd9};
+  WireScreenFrame frame;
+  frame.width = 1920;
+  frame.height = 1080;
+  frame.codec = WireFrameCodec::kJpeg;
+  frame.data = image;
+  frame.size = sizeof(image);
+  EXPECT_TRUE(EncodeWireScreenFrame(TestHeader(), frame, &messages[0]));
+
+  WireMouseInput mouse;
+  mouse.action = WireMouseAction::kScroll;
+  mouse.button = WireMouseButton::kMiddle;
+  mouse.x = 0.25f;
+  mouse.y = 1023.5f;
+  mouse.delta = -120;
+  EXPECT_TRUE(EncodeWireMouseInput(TestHeader(), mouse, &messages[1]));
+
+  WireKeyInput key;
+  key.action = WireKeyAction::kDown;
+  key.modifiers = kWireModifierCtrl | kWireModifierShift;
+  key.key = "ArrowLeft";
+  EXPECT_TRUE(EncodeWireKeyInput(TestHeader(), key, &messages[2]));
+
+  const uint8_t bytes[] = {1, 2, 3, 4, 5};
+  WireFileChunk chunk;
+  chunk.transfer = 42;
+  chunk.offset = 1ULL << 40;
+  chunk.last = true;
+  chunk.data = bytes;
+  chunk.size = sizeof(bytes);
+  EXPECT_TRUE(EncodeWireFileChunk(TestHeader(), chunk, &messages[3]));
+  return messages;
+}
+
+}  // namespace
+
+TEST(WireProtocolTest, HeaderRoundTrip) {
+  std::vector<uint8_t> message = SampleMessages()[0];
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  WireHeader expected = TestHeader();
+  EXPECT_EQ(header.type, WireType::kScreenFrame);
+  EXPECT_EQ(header.flags, expected.flags);
+  EXPECT_EQ(header.session, expected.session);
+  EXPECT_EQ(header.sequence, expected.sequence);
+  EXPECT_EQ(header.timestamp_us, expected.timestamp_us);
+  EXPECT_EQ(header.payload_length, message.size() - kWireHeaderBytes);
+
+  ASSERT_TRUE(SetWireSession(0x01020304, &message));
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  EXPECT_EQ(header.session, 0x01020304u);
+  std::vector<uint8_t> short_message(kWireHeaderBytes - 1);
+  EXPECT_FALSE(SetWireSession(1, &short_message));
+}
+
+TEST(WireProtocolTest, ScreenFrameRoundTrip) {
+  std::vector<uint8_t> message = SampleMessages()[0];
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  WireScreenFrame frame;
+  ASSERT_TRUE(DecodeWireScreenFrame(payload, header.payload_length, &frame, &error)) << error;
+  EXPECT_EQ(frame.width, 1920);
+  EXPECT_EQ(frame.height, 1080);
+  EXPECT_EQ(frame.codec, WireFrameCodec::kJpeg);
+  EXPECT_TRUE(frame.keyframe);
+  ASSERT_EQ(frame.size, 6u);
+  EXPECT_EQ(frame.data[0], 0xff);
+  EXPECT_EQ(frame.data[5], 0xd9);
+}
+
+TEST(WireProtocolTest, MouseInputRoundTrip) {
+  std::vector<uint8_t> message = SampleMessages()[1];
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  EXPECT_EQ(header.type, WireType::kInputMouse);
+  WireMouseInput mouse;
+  ASSERT_TRUE(DecodeWireMouseInput(payload, header.payload_length, &mouse, &error)) << error;
+  EXPECT_EQ(mouse.action, WireMouseAction::kScroll);
+  EXPECT_EQ(mouse.button, WireMouseButton::kMiddle);
+  EXPECT_EQ(mouse.x, 0.25f);
+  EXPECT_EQ(mouse.y, 1023.5f);
+  EXPECT_EQ(mouse.delta, -120);
+}
+
+TEST(WireProtocolTest, KeyInputRoundTrip) {
+  std::vector<uint8_t> message = SampleMessages()[2];
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  EXPECT_EQ(header.type, WireType::kInputKeyboard);
+  WireKeyInput key;
+  ASSERT_TRUE(DecodeWireKeyInput(payload, header.payload_length, &key, &error)) << error;
+  EXPECT_EQ(key.action, WireKeyAction::kDown);
+  EXPECT_EQ(key.modifiers, kWireModifierCtrl | kWireModifierShift);
+  EXPECT_EQ(key.key, "ArrowLeft");
+
+  std::vector<uint8_t> out;
+  key.key.clear();
+  EXPECT_FALSE(EncodeWireKeyInput(TestHeader(), key, &out));
+}
+
+TEST(WireProtocolTest, FileChunkRoundTrip) {
+  std::vector<uint8_t> message = SampleMessages()[3];
+  WireHeader header;
+  const uint8_t* payload = nullptr;
+  std::string error;
+  ASSERT_TRUE(DecodeWireHeader(message.data(), message.size(), &header, &payload, &error)) << error;
+  EXPECT_EQ(header.type, WireType::kFileChunk);
+  WireFileChunk chunk;
+  ASSERT_TRUE(DecodeWireFileChunk(payload, header.payload_length, &chunk, &error)) << error;
+  EXPECT_EQ(chunk.transfer, 42u);
+  EXPECT_EQ(chunk.offset, 1ULL << 40);
+  EXPECT_TRUE(chunk.last);
+  ASSERT_EQ(chunk.size, 5u);
+  EXPECT_EQ(chunk.data[4], 5);
+
+  // 偏移加长度超出 u64 时拒绝
+  chunk.offset = UINT64_MAX - 2;
+  std::vector<uint8_t> overflow;
+  ASSERT_TRUE(EncodeWireFileChunk(TestHeader(), chunk, &overflow));
+  EXPECT_FALSE(DecodeWireFileChunk(overflow.data() + kWireHeaderBytes,
+                                   overflow.size() - kWireHeaderBytes, &chunk, &error));
+}
+
+TEST(WireProtocolTest, NegotiateVersion) {
+  EXPECT_EQ(NegotiateWireVersion({}), 0);
+  EXPECT_EQ(NegotiateWireVersion({0, -1, kWireVersion + 1}), 0);
+  EXPECT_EQ(NegotiateWireVersion({kWireVersion + 5, 1}), 1);
+}
+
+// 每条消息的所有截断长度：只有完整长度能通过，解码不能越界
+TEST(WireProtocolTest, TruncatedMessagesAreRejected) {
+  for (const std::vector<uint8_t>& message : SampleMessages()) {
+    for (size_t size = 0; size < message.size(); size++) {
+      std::vector<uint8_t> out;
+      EXPECT_FALSE(DecodeExact(message, size, &out)) << size;
+    }
+    std::vector<uint8_t> out;
+    EXPECT_TRUE(DecodeExact(message, message.size(), &out));
+    EXPECT_EQ(out, message);
+  }
+}
+
+// 逐位翻转：解码不能越界，能解码的消息重新编码后必须稳定（再解码得到同样的字节）
+TEST(WireProtocolTest, BitFlippedMessagesDecodeSafely) {
+  for (const std::vector<uint8_t>& message : SampleMessages()) {
+    for (size_t bit = 0; bit < message.size() * 8; bit++) {
+      std::vector<uint8_t> mutated = message;
+      mutated[bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+      std::vector<uint8_t> first;
+      if (!DecodeExact(mutated, mutated.size(), &first)) {
+        continue;
+      }
+      std::vector<uint8_t> second;
+      ASSERT_TRUE(DecodeExact(first, first.size(), &second)) << bit;
+      EXPECT_EQ(first, second) << bit;
+    }
+  }
+}
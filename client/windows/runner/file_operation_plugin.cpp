@@ -74,12 +74,26 @@ void FileOperationPlugin::HandleMethodCall(
         args->find(flutter::EncodableValue("fileData")) != args->end()) {
       std::string targetPath = std::get<std::string>(args->at(flutter::EncodableValue("targetPath")));
       std::string fileName = std::get<std::string>(args->at(flutter::EncodableValue("fileName")));
-      auto fileDataList = std::get<flutter::EncodableList>(args->at(flutter::EncodableValue("fileData")));
-      std::vector<uint8_t> fileData;
-      for (const auto& item : fileDataList) {
-        fileData.push_back(std::get<uint8_t>(item));
+      const auto& fileDataValue = args->at(flutter::EncodableValue("fileData"));
+      bool success = false;
+      // 字节数据以 Uint8List 传入，直接引用参数里的缓冲区，不逐字节拷贝
+      if (const auto* fileData = std::get_if<std::vector<uint8_t>>(&fileDataValue)) {
+        success = UploadFile(targetPath, fileName, *fileData);
+      } else if (const auto* fileDataList = std::get_if<flutter::EncodableList>(&fileDataValue)) {
+        // 兼容旧版本按 List<int> 传入的数据
+        std::vector<uint8_t> fileData;
+        fileData.reserve(fileDataList->size());
+        for (const auto& item : *fileDataList) {
+          const auto* byte = std::get_if<int32_t>(&item);
+          // 超出 0..255 的值不是字节，截断会悄悄写入错误的数据
+          if (!byte || *byte < 0 || *byte > 255) {
+            result->Error("INVALID_ARGS", "Invalid arguments");
+            return;
+          }
+          fileData.push_back(static_cast<uint8_t>(*byte));
+        }
+        success = UploadFile(targetPath, fileName, fileData);
       }
-      bool success = UploadFile(targetPath, fileName, fileData);
       result->Success(flutter::EncodableValue(success));
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments");
@@ -87,12 +101,8 @@ void FileOperationPlugin::HandleMethodCall(
   } else if (method_call.method_name().compare("downloadFile") == 0) {
     if (args && args->find(flutter::EncodableValue("filePath")) != args->end()) {
       std::string filePath = std::get<std::string>(args->at(flutter::EncodableValue("filePath")));
-      auto fileData = DownloadFile(filePath);
-      flutter::EncodableList resultList;
-      for (uint8_t byte : fileData) {
-        resultList.push_back(flutter::EncodableValue(byte));
-      }
-      result->Success(flutter::EncodableValue(resultList));
+      // 以 std::vector<uint8_t> 返回，Dart 端收到的是 Uint8List
+      result->Success(flutter::EncodableValue(DownloadFile(filePath)));
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments");
     }
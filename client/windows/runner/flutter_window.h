@@ -4,6 +4,7 @@
 #include <flutter/dart_project.h>
 #include <flutter/flutter_view_controller.h>
 
+#include <chrono>
 #include <memory>
 
 #include "win32_window.h"
@@ -28,6 +29,10 @@ class FlutterWindow : public Win32Window {
 
   // The Flutter instance hosted by this window.
   std::unique_ptr<flutter::FlutterViewController> flutter_controller_;
+
+  // 启动耗时统计，profile 构建在首帧时输出
+  std::chrono::steady_clock::time_point created_;
+  std::chrono::steady_clock::duration plugins_time_{};
 };
 
 #endif  // RUNNER_FLUTTER_WINDOW_H_
@@ -7,6 +7,7 @@
 #include <windows.h>
 #include <gdiplus.h>
 #include <memory>
+#include <mutex>
 #include <sstream>
 #include <vector>
 
@@ -50,14 +51,21 @@ void ScreenCapturePlugin::RegisterWithRegistrar(
 }
 
 static ULONG_PTR g_gdiplusToken = 0;
+static std::once_flag g_gdiplusOnce;
 
-ScreenCapturePlugin::ScreenCapturePlugin() {
-  if (g_gdiplusToken == 0) {
+// GDI+ 在第一次截屏时才启动，不占用窗口创建的时间
+static bool EnsureGdiplus() {
+  std::call_once(g_gdiplusOnce, []() {
     GdiplusStartupInput gdiplusStartupInput;
-    GdiplusStartup(&g_gdiplusToken, &gdiplusStartupInput, NULL);
-  }
+    if (GdiplusStartup(&g_gdiplusToken, &gdiplusStartupInput, NULL) != Ok) {
+      g_gdiplusToken = 0;
+    }
+  });
+  return g_gdiplusToken != 0;
 }
 
+ScreenCapturePlugin::ScreenCapturePlugin() {}
+
 ScreenCapturePlugin::~ScreenCapturePlugin() {
   // GDI+ 在程序结束时清理
 }
@@ -86,6 +94,10 @@ std::pair<int, int> ScreenCapturePlugin::GetScreenSize() {
 }
 
 std::vector<uint8_t> ScreenCapturePlugin::CaptureScreen() {
+  if (!EnsureGdiplus()) {
+    return {};
+  }
+
   int screenWidth = GetSystemMetrics(SM_CXSCREEN);
   int screenHeight = GetSystemMetrics(SM_CYSCREEN);
 
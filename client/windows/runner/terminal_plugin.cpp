@@ -6,9 +6,14 @@
 
 #include <windows.h>
 #include <process.h>
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <sstream>
+#include <thread>
+#include <vector>
 
 class TerminalPlugin : public flutter::Plugin {
  public:
@@ -23,7 +28,9 @@ class TerminalPlugin : public flutter::Plugin {
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-  flutter::EncodableValue ExecuteCommand(const std::string& command, const std::string& workingDir);
+  // timeoutMs 为 0 时不限时
+  flutter::EncodableValue ExecuteCommand(const std::string& command, const std::string& workingDir,
+                                         int64_t timeoutMs);
 };
 
 void TerminalPlugin::RegisterWithRegistrar(
@@ -59,7 +66,16 @@ void TerminalPlugin::HandleMethodCall(
       if (args->find(flutter::EncodableValue("workingDir")) != args->end()) {
         workingDir = std::get<std::string>(args->at(flutter::EncodableValue("workingDir")));
       }
-      auto output = ExecuteCommand(command, workingDir);
+      int64_t timeoutMs = 0;
+      auto timeoutIt = args->find(flutter::EncodableValue("timeoutMs"));
+      if (timeoutIt != args->end()) {
+        if (const auto* value = std::get_if<int32_t>(&timeoutIt->second)) {
+          timeoutMs = *value;
+        } else if (const auto* value64 = std::get_if<int64_t>(&timeoutIt->second)) {
+          timeoutMs = *value64;
+        }
+      }
+      auto output = ExecuteCommand(command, workingDir, timeoutMs > 0 ? timeoutMs : 0);
       result->Success(output);
     } else {
       result->Error("INVALID_ARGS", "Invalid arguments");
@@ -69,7 +85,8 @@ void TerminalPlugin::HandleMethodCall(
   }
 }
 
-flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& command, const std::string& workingDir) {
+flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& command, const std::string& workingDir,
+                                                       int64_t timeoutMs) {
   flutter::EncodableMap result;
   std::string stdout_str;
   std::string stderr_str;
@@ -118,6 +135,16 @@ flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& comman
   // 构建命令（使用 cmd /c）
   std::string fullCommand = "cmd /c \"" + command + "\"";
 
+  // cmd 启动的子进程放进同一个作业对象，超时时整组结束，不会有孙进程继续占着管道。
+  // 进程挂起创建，加入作业后再恢复，避免子进程在加入前已经派生出去
+  HANDLE hJob = CreateJobObjectA(NULL, NULL);
+  if (hJob) {
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION limits;
+    ZeroMemory(&limits, sizeof(limits));
+    limits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+    SetInformationJobObject(hJob, JobObjectExtendedLimitInformation, &limits, sizeof(limits));
+  }
+
   // 创建进程
   BOOL bSuccess = CreateProcessA(
       NULL,
@@ -125,13 +152,16 @@ flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& comman
       NULL,
       NULL,
       TRUE,
-      0,
+      CREATE_SUSPENDED,
       NULL,
       workingDir.empty() ? NULL : workingDir.c_str(),
       &siStartInfo,
       &piProcInfo);
 
   if (!bSuccess) {
+    if (hJob) {
+      CloseHandle(hJob);
+    }
     CloseHandle(hChildStd_OUT_Rd);
     CloseHandle(hChildStd_OUT_Wr);
     CloseHandle(hChildStd_ERR_Rd);
@@ -142,31 +172,63 @@ flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& comman
     return flutter::EncodableValue(result);
   }
 
+  if (hJob && !AssignProcessToJobObject(hJob, piProcInfo.hProcess)) {
+    CloseHandle(hJob);
+    hJob = NULL;
+  }
+  ResumeThread(piProcInfo.hThread);
+
   // 关闭写入端
   CloseHandle(hChildStd_OUT_Wr);
   CloseHandle(hChildStd_ERR_Wr);
 
-  // 读取输出
-  DWORD dwRead;
-  CHAR chBuf[4096];
-  BOOL bSuccessRead = FALSE;
-
-  // 读取 stdout
-  for (;;) {
-    bSuccessRead = ReadFile(hChildStd_OUT_Rd, chBuf, 4096, &dwRead, NULL);
-    if (!bSuccessRead || dwRead == 0) break;
-    stdout_str.append(chBuf, dwRead);
-  }
-
-  // 读取 stderr
-  for (;;) {
-    bSuccessRead = ReadFile(hChildStd_ERR_Rd, chBuf, 4096, &dwRead, NULL);
-    if (!bSuccessRead || dwRead == 0) break;
-    stderr_str.append(chBuf, dwRead);
+  // 两个管道各用一个线程同时读取。顺序读取时子进程先写满 stderr 管道会永远阻塞，
+  // 而我们还在等 stdout 结束。输出按到达顺序带时间戳记录在 segments 里，
+  // 同一路连续到达的输出合并为一段
+  struct Segment {
+    const char* stream;
+    int64_t timeMs;
+    std::string text;
+  };
+  auto start = std::chrono::steady_clock::now();
+  std::mutex segmentsMutex;
+  std::vector<Segment> segments;
+  auto drain = [&](HANDLE pipe, std::string* output, const char* stream) {
+    DWORD dwRead;
+    CHAR chBuf[4096];
+    for (;;) {
+      BOOL bSuccessRead = ReadFile(pipe, chBuf, sizeof(chBuf), &dwRead, NULL);
+      if (!bSuccessRead || dwRead == 0) break;
+      output->append(chBuf, dwRead);
+      int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - start).count();
+      std::lock_guard<std::mutex> lock(segmentsMutex);
+      if (!segments.empty() && segments.back().stream == stream) {
+        segments.back().text.append(chBuf, dwRead);
+      } else {
+        segments.push_back({stream, elapsed, std::string(chBuf, dwRead)});
+      }
+    }
+  };
+  std::thread stdoutReader(drain, hChildStd_OUT_Rd, &stdout_str, "stdout");
+  std::thread stderrReader(drain, hChildStd_ERR_Rd, &stderr_str, "stderr");
+
+  // 等待进程结束，超时则结束整个作业（没有作业对象时只能结束 cmd 本身）。
+  // 结束后管道写入端全部关闭，读取线程随之退出
+  bool timedOut = false;
+  DWORD wait = timeoutMs > 0 ? static_cast<DWORD>(std::min<int64_t>(timeoutMs, INFINITE - 1))
+                             : INFINITE;
+  if (WaitForSingleObject(piProcInfo.hProcess, wait) == WAIT_TIMEOUT) {
+    timedOut = true;
+    if (!hJob || !TerminateJobObject(hJob, 1)) {
+      TerminateProcess(piProcInfo.hProcess, 1);
+    }
+    WaitForSingleObject(piProcInfo.hProcess, INFINITE);
   }
-
-  // 等待进程结束
-  WaitForSingleObject(piProcInfo.hProcess, INFINITE);
+  stdoutReader.join();
+  stderrReader.join();
+  int64_t durationMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::steady_clock::now() - start).count();
   DWORD dwExitCode;
   GetExitCodeProcess(piProcInfo.hProcess, &dwExitCode);
   exitCode = static_cast<int>(dwExitCode);
@@ -176,10 +238,27 @@ flutter::EncodableValue TerminalPlugin::ExecuteCommand(const std::string& comman
   CloseHandle(piProcInfo.hThread);
   CloseHandle(hChildStd_OUT_Rd);
   CloseHandle(hChildStd_ERR_Rd);
+  if (hJob) {
+    CloseHandle(hJob);
+  }
 
   result[flutter::EncodableValue("stdout")] = flutter::EncodableValue(stdout_str);
   result[flutter::EncodableValue("stderr")] = flutter::EncodableValue(stderr_str);
   result[flutter::EncodableValue("exit_code")] = flutter::EncodableValue(exitCode);
+  result[flutter::EncodableValue("timed_out")] = flutter::EncodableValue(timedOut);
+  // Windows 端没有取消接口，也不限制输出大小，这两个字段只为与 Linux 端保持一致
+  result[flutter::EncodableValue("cancelled")] = flutter::EncodableValue(false);
+  result[flutter::EncodableValue("truncated")] = flutter::EncodableValue(false);
+  result[flutter::EncodableValue("duration_ms")] = flutter::EncodableValue(durationMs);
+  flutter::EncodableList segmentList;
+  for (const auto& segment : segments) {
+    flutter::EncodableMap item;
+    item[flutter::EncodableValue("stream")] = flutter::EncodableValue(segment.stream);
+    item[flutter::EncodableValue("time_ms")] = flutter::EncodableValue(segment.timeMs);
+    item[flutter::EncodableValue("text")] = flutter::EncodableValue(segment.text);
+    segmentList.push_back(flutter::EncodableValue(item));
+  }
+  result[flutter::EncodableValue("segments")] = flutter::EncodableValue(segmentList);
 
   return flutter::EncodableValue(result);
 }
@@ -1,6 +1,7 @@
 package handler
 
 import (
+	"encoding/base64"
 	"encoding/json"
 	"log"
 	"net/http"
@@ -49,12 +50,18 @@ func (h *WebSocketHandler) HandleWebSocket(c *gin.Context) {
 
 	// 处理消息循环
 	for {
-		_, message, err := conn.ReadMessage()
+		messageType, message, err := conn.ReadMessage()
 		if err != nil {
 			log.Printf("读取消息失败: %v", err)
 			break
 		}
 
+		// 协商后的二进制帧只解析消息头，按类型转发
+		if messageType == websocket.BinaryMessage {
+			h.handleWireMessage(message, deviceID)
+			continue
+		}
+
 		var msg protocol.Message
 		if err := json.Unmarshal(message, &msg); err != nil {
 			log.Printf("解析消息失败: %v", err)
@@ -119,6 +126,8 @@ func (h *WebSocketHandler) handleMessage(msg *protocol.Message, conn *websocket.
 	case "app_install":
 		h.handleAppInstall(msg, *deviceID)
 		return nil // 应用安装需要响应，但通过转发处理
+	case "protocol_negotiate":
+		return h.handleProtocolNegotiate(msg, *deviceID)
 	case "ping":
 		return h.handlePing()
 	default:
@@ -418,6 +427,79 @@ func (h *WebSocketHandler) handleAppInstall(msg *protocol.Message, controllerID
 	}
 }
 
+// 协商二进制协议版本，协商成功后该连接可以收发二进制帧
+func (h *WebSocketHandler) handleProtocolNegotiate(msg *protocol.Message, deviceID string) *protocol.Message {
+	var data protocol.ProtocolNegotiateData
+	if err := json.Unmarshal(msg.Data, &data); err != nil {
+		return h.errorResponse("解析协议协商数据失败")
+	}
+
+	version := protocol.NegotiateWireVersion(data.Versions)
+	if !h.connectionService.SetWireVersion(deviceID, version) {
+		return h.errorResponse("请先注册设备")
+	}
+
+	return h.successResponse("protocol_negotiate_response", protocol.ProtocolNegotiateData{
+		Version: version,
+	})
+}
+
+// 处理二进制消息：屏幕帧从被控端转发到控制端，输入和文件块从控制端转发到被控端。
+// 对端没有协商二进制协议时，屏幕帧转成原来的 JSON 消息，其余类型丢弃
+func (h *WebSocketHandler) handleWireMessage(message []byte, deviceID string) {
+	if h.connectionService.GetWireVersion(deviceID) == 0 {
+		log.Printf("设备 %s 未协商二进制协议", deviceID)
+		return
+	}
+	header, payload, err := protocol.ParseWireHeader(message)
+	if err != nil {
+		log.Printf("解析二进制消息失败: %v", err)
+		return
+	}
+
+	var targetID string
+	if header.Type == protocol.WireTypeScreenFrame {
+		targetID = h.connectionService.GetControllerID(deviceID)
+	} else {
+		targetID = h.connectionService.GetControlledID(deviceID)
+	}
+	if targetID == "" {
+		return
+	}
+	targetConn, ok := h.connectionService.GetConnection(targetID)
+	if !ok {
+		return
+	}
+	wsConn, ok := targetConn.Conn.(*websocket.Conn)
+	if !ok {
+		return
+	}
+
+	if h.connectionService.GetWireVersion(targetID) > 0 {
+		wsConn.WriteMessage(websocket.BinaryMessage, message)
+		return
+	}
+	if header.Type != protocol.WireTypeScreenFrame {
+		return
+	}
+	frame, err := protocol.ParseWireScreenFrame(payload)
+	if err != nil {
+		log.Printf("解析屏幕帧失败: %v", err)
+		return
+	}
+	dataJSON, _ := json.Marshal(protocol.ScreenFrameData{
+		FrameData: base64.StdEncoding.EncodeToString(frame.Data),
+		Timestamp: protocol.WireTimestampSeconds(header.TimestampUs),
+		Width:     frame.Width,
+		Height:    frame.Height,
+	})
+	wsConn.WriteJSON(&protocol.Message{
+		Type:      "screen_frame",
+		Timestamp: protocol.WireTimestampSeconds(header.TimestampUs),
+		Data:      dataJSON,
+	})
+}
+
 func (h *WebSocketHandler) handlePing() *protocol.Message {
 	return h.successResponse("pong", map[string]interface{}{
 		"timestamp": time.Now().Unix(),
@@ -5,8 +5,9 @@ import (
 )
 
 type Connection struct {
-	DeviceID string
-	Conn     interface{} // WebSocket connection
+	DeviceID    string
+	Conn        interface{} // WebSocket connection
+	WireVersion int         // 协商的二进制协议版本，0 表示只用 JSON
 }
 
 type Session struct {
@@ -50,6 +51,27 @@ func (s *ConnectionService) GetConnection(deviceID string) (*Connection, bool) {
 	return conn, ok
 }
 
+// SetWireVersion 记录连接协商的二进制协议版本
+func (s *ConnectionService) SetWireVersion(deviceID string, version int) bool {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	conn, ok := s.connections[deviceID]
+	if ok {
+		conn.WireVersion = version
+	}
+	return ok
+}
+
+// GetWireVersion 返回连接协商的二进制协议版本
+func (s *ConnectionService) GetWireVersion(deviceID string) int {
+	s.mu.RLock()
+	defer s.mu.RUnlock()
+	if conn, ok := s.connections[deviceID]; ok {
+		return conn.WireVersion
+	}
+	return 0
+}
+
 func (s *ConnectionService) GetConnectionCount() int {
 	s.mu.RLock()
 	defer s.mu.RUnlock()
@@ -64,7 +64,7 @@ type ScreenFrameData struct {
 
 // InputMouseData 鼠标输入数据
 type InputMouseData struct {
-	Action string  `json:"action"` // move, click, scroll
+	Action string  `json:"action"` // move, click, scroll, down, up
 	X      float64 `json:"x"`
 	Y      float64 `json:"y"`
 	Button string  `json:"button,omitempty"` // left, right, middle
@@ -0,0 +1,129 @@
+package protocol
+
+import (
+	"encoding/binary"
+	"errors"
+)
+
+// 二进制消息格式，与客户端 client/linux/runner/wire_protocol.h 保持一致。
+// 每条消息占一个 WebSocket 二进制帧，开头是 24 字节的小端头：
+//
+//	u8 魔数 'W' | u8 版本 | u8 类型 | u8 标志 | u32 会话 | u32 序号 |
+//	u64 时间戳（微秒）| u32 负载长度
+//
+// 连接通过 protocol_negotiate 文本消息协商后才会收发二进制帧，未协商的连接继续使用 JSON。
+const (
+	WireMagic      = 'W'
+	WireVersion    = 1
+	WireHeaderSize = 24
+	WireMaxPayload = 64 << 20
+)
+
+// 二进制消息类型
+const (
+	WireTypeScreenFrame   byte = 1
+	WireTypeInputMouse    byte = 2
+	WireTypeInputKeyboard byte = 3
+	WireTypeFileChunk     byte = 4
+)
+
+// 屏幕帧负载：u16 宽 | u16 高 | u8 编码 | u8 帧标志 | 编码后的数据
+const (
+	WireFrameCodecPNG  byte = 0
+	WireFrameCodecJPEG byte = 1
+	WireFrameKeyframe  byte = 1
+)
+
+var (
+	ErrWireTruncated = errors.New("wire: message shorter than header")
+	ErrWireMagic     = errors.New("wire: bad magic")
+	ErrWireVersion   = errors.New("wire: unsupported version")
+	ErrWireType      = errors.New("wire: unknown message type")
+	ErrWireLength    = errors.New("wire: payload length mismatch")
+	ErrWireFrame     = errors.New("wire: malformed screen frame")
+)
+
+// WireHeader 二进制消息头
+type WireHeader struct {
+	Type          byte
+	Flags         byte
+	Session       uint32 // 发送方定义的会话编号，服务器原样转发
+	Sequence      uint32
+	TimestampUs   uint64
+	PayloadLength uint32
+}
+
+// WireScreenFrame 屏幕帧负载，Data 指向原消息，不复制
+type WireScreenFrame struct {
+	Width    int
+	Height   int
+	Codec    byte
+	Keyframe bool
+	Data     []byte
+}
+
+// ProtocolNegotiateData 协议协商数据
+type ProtocolNegotiateData struct {
+	Versions []int `json:"versions,omitempty"` // 请求：支持的二进制协议版本
+	Version  int   `json:"version"`            // 响应：选定的版本，0 表示继续使用 JSON
+}
+
+// ParseWireHeader 解析并校验消息头，返回负载
+func ParseWireHeader(data []byte) (WireHeader, []byte, error) {
+	var header WireHeader
+	if len(data) < WireHeaderSize {
+		return header, nil, ErrWireTruncated
+	}
+	if data[0] != WireMagic {
+		return header, nil, ErrWireMagic
+	}
+	if data[1] != WireVersion {
+		return header, nil, ErrWireVersion
+	}
+	header.Type = data[2]
+	if header.Type < WireTypeScreenFrame || header.Type > WireTypeFileChunk {
+		return header, nil, ErrWireType
+	}
+	header.Flags = data[3]
+	header.Session = binary.LittleEndian.Uint32(data[4:])
+	header.Sequence = binary.LittleEndian.Uint32(data[8:])
+	header.TimestampUs = binary.LittleEndian.Uint64(data[12:])
+	header.PayloadLength = binary.LittleEndian.Uint32(data[20:])
+	if header.PayloadLength > WireMaxPayload || int(header.PayloadLength) != len(data)-WireHeaderSize {
+		return header, nil, ErrWireLength
+	}
+	return header, data[WireHeaderSize:], nil
+}
+
+// ParseWireScreenFrame 解析屏幕帧负载
+func ParseWireScreenFrame(payload []byte) (WireScreenFrame, error) {
+	var frame WireScreenFrame
+	if len(payload) <= 6 {
+		return frame, ErrWireFrame
+	}
+	frame.Width = int(binary.LittleEndian.Uint16(payload[0:]))
+	frame.Height = int(binary.LittleEndian.Uint16(payload[2:]))
+	frame.Codec = payload[4]
+	frame.Keyframe = payload[5]&WireFrameKeyframe != 0
+	if frame.Width == 0 || frame.Height == 0 || frame.Codec > WireFrameCodecJPEG {
+		return frame, ErrWireFrame
+	}
+	frame.Data = payload[6:]
+	return frame, nil
+}
+
+// NegotiateWireVersion 从对方提供的版本里选双方都支持的最高版本，没有时返回 0
+func NegotiateWireVersion(offered []int) int {
+	best := 0
+	for _, version := range offered {
+		if version >= 1 && version <= WireVersion && version > best {
+			best = version
+		}
+	}
+	return best
+}
+
+// WireTimestampSeconds 把消息头的微秒时间戳换成 JSON 消息使用的秒
+func WireTimestampSeconds(timestampUs uint64) int64 {
+	return int64(timestampUs / 1000000)
+}
@@ -0,0 +1,155 @@
+package protocol
+
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"testing"
+)
+
+// encodeWireMessage 按客户端 wire_protocol.h 的格式拼出一条消息，测试里代替客户端编码器
+func encodeWireMessage(header WireHeader, payload []byte) []byte {
+	data := make([]byte, WireHeaderSize, WireHeaderSize+len(payload))
+	data[0] = WireMagic
+	data[1] = WireVersion
+	data[2] = header.Type
+	data[3] = header.Flags
+	binary.LittleEndian.PutUint32(data[4:], header.Session)
+	binary.LittleEndian.PutUint32(data[8:], header.Sequence)
+	binary.LittleEndian.PutUint64(data[12:], header.TimestampUs)
+	binary.LittleEndian.PutUint32(data[20:], uint32(len(payload)))
+	return append(data, payload...)
+}
+
+func encodeWireScreenFrame(frame WireScreenFrame) []byte {
+	payload := make([]byte, 6, 6+len(frame.Data))
+	binary.LittleEndian.PutUint16(payload[0:], uint16(frame.Width))
+	binary.LittleEndian.PutUint16(payload[2:], uint16(frame.Height))
+	payload[4] = frame.Codec
+	if frame.Keyframe {
+		payload[5] = WireFrameKeyframe
+	}
+	return append(payload, frame.Data...)
+}
+
+func TestWireScreenFrameRoundTrip(t *testing.T) {
+	header := WireHeader{
+		Type:        WireTypeScreenFrame,
+		Flags:       0x5a,
+		Session:     7,
+		Sequence:    0xfffffffe,
+		TimestampUs: 1700000000123456,
+	}
+	frame := WireScreenFrame{Width: 1920, Height: 1080, Codec: WireFrameCodecJPEG, Keyframe: true,
+		Data: []byte{0xff, 0xd8, 0x00, 0x01, 0xff, 0xd9}}
+	message := encodeWireMessage(header, encodeWireScreenFrame(frame))
+
+	gotHeader, payload, err := ParseWireHeader(message)
+	if err != nil {
+		t.Fatalf("ParseWireHeader: %v", err)
+	}
+	header.PayloadLength = uint32(len(message) - WireHeaderSize)
+	if gotHeader != header {
+		t.Fatalf("header = %+v, want %+v", gotHeader, header)
+	}
+	gotFrame, err := ParseWireScreenFrame(payload)
+	if err != nil {
+		t.Fatalf("ParseWireScreenFrame: %v", err)
+	}
+	if gotFrame.Width != frame.Width || gotFrame.Height != frame.Height ||
+		gotFrame.Codec != frame.Codec || gotFrame.Keyframe != frame.Keyframe ||
+		!bytes.Equal(gotFrame.Data, frame.Data) {
+		t.Fatalf("frame = %+v, want %+v", gotFrame, frame)
+	}
+	if WireTimestampSeconds(gotHeader.TimestampUs) != 1700000000 {
+		t.Fatalf("timestamp seconds = %d", WireTimestampSeconds(gotHeader.TimestampUs))
+	}
+}
+
+func TestParseWireHeaderErrors(t *testing.T) {
+	valid := encodeWireMessage(WireHeader{Type: WireTypeInputMouse}, []byte{1, 2, 3})
+	corrupt := func(index int, value byte) []byte {
+		data := append([]byte(nil), valid...)
+		data[index] = value
+		return data
+	}
+	tests := []struct {
+		name string
+		data []byte
+		want error
+	}{
+		{"empty", nil, ErrWireTruncated},
+		{"short", valid[:WireHeaderSize-1], ErrWireTruncated},
+		{"magic", corrupt(0, 'X'), ErrWireMagic},
+		{"version", corrupt(1, WireVersion+1), ErrWireVersion},
+		{"type zero", corrupt(2, 0), ErrWireType},
+		{"type unknown", corrupt(2, WireTypeFileChunk+1), ErrWireType},
+		{"payload missing", valid[:len(valid)-1], ErrWireLength},
+		{"payload extra", append(append([]byte(nil), valid...), 0), ErrWireLength},
+		{"payload too large", corrupt(23, 0xff), ErrWireLength},
+	}
+	for _, test := range tests {
+		if _, _, err := ParseWireHeader(test.data); !errors.Is(err, test.want) {
+			t.Errorf("%s: err = %v, want %v", test.name, err, test.want)
+		}
+	}
+}
+
+func TestNegotiateWireVersion(t *testing.T) {
+	tests := []struct {
+		offered []int
+		want    int
+	}{
+		{nil, 0},
+		{[]int{}, 0},
+		{[]int{0}, 0},
+		{[]int{-1}, 0},
+		{[]int{WireVersion + 1}, 0},
+		{[]int{1}, 1},
+		{[]int{WireVersion + 5, 1}, 1},
+		{[]int{0, WireVersion, WireVersion + 1}, WireVersion},
+		{[]int{1, 1, 1}, 1},
+	}
+	for _, test := range tests {
+		if got := NegotiateWireVersion(test.offered); got != test.want {
+			t.Errorf("NegotiateWireVersion(%v) = %d, want %d", test.offered, got, test.want)
+		}
+	}
+}
+
+func FuzzParseWireHeader(f *testing.F) {
+	f.Add(encodeWireMessage(WireHeader{Type: WireTypeScreenFrame, Session: 1, Sequence: 2}, []byte{1, 2, 3}))
+	f.Add(encodeWireMessage(WireHeader{Type: WireTypeInputKeyboard}, nil))
+	f.Add([]byte("W"))
+	f.Fuzz(func(t *testing.T, data []byte) {
+		header, payload, err := ParseWireHeader(data)
+		if err != nil {
+			return
+		}
+		// 解析成功的消息重新编码后必须与原消息一致
+		if int(header.PayloadLength) != len(payload) || header.PayloadLength > WireMaxPayload {
+			t.Fatalf("payload length %d, header says %d", len(payload), header.PayloadLength)
+		}
+		if !bytes.Equal(encodeWireMessage(header, payload), data) {
+			t.Fatalf("re-encoded message differs from input")
+		}
+	})
+}
+
+func FuzzParseWireScreenFrame(f *testing.F) {
+	f.Add(encodeWireScreenFrame(WireScreenFrame{Width: 640, Height: 480, Codec: WireFrameCodecPNG, Data: []byte{0x89}}))
+	f.Add(encodeWireScreenFrame(WireScreenFrame{Width: 1, Height: 1, Codec: WireFrameCodecJPEG, Keyframe: true, Data: []byte{0}}))
+	f.Add([]byte{0, 0, 0, 0, 0, 0})
+	f.Fuzz(func(t *testing.T, payload []byte) {
+		frame, err := ParseWireScreenFrame(payload)
+		if err != nil {
+			return
+		}
+		if frame.Width <= 0 || frame.Height <= 0 || frame.Codec > WireFrameCodecJPEG || len(frame.Data) == 0 {
+			t.Fatalf("accepted invalid frame %+v", frame)
+		}
+		if !bytes.Equal(frame.Data, payload[6:]) {
+			t.Fatalf("frame data does not alias the payload tail")
+		}
+	})
+}